@@ -0,0 +1,119 @@
+// astbin_bench.cpp
+// 二进制 AST 的加载耗时与重新词法、语法分析的对比。把 workloads.txt 中的工作负载
+// 各复制若干份（函数改名）拼成一个大源文件，分别计时：
+//   parse    词法 + 语法分析
+//   write    writeAstBin 写出文件
+//   load     映射文件并一次线性扫描重建 AST
+//   walk     映射文件后经 AstBinView 直接遍历全部节点，不建立对象
+// 用法：astbin_bench <bench 目录> <临时文件> [份数]
+#include "astbin.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+static std::string readFile(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Cannot open file " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// 第 copy 份：所有函数名加后缀 _<copy>，调用处同时改名
+static std::string renameFunctions(const std::string &source, int copy) {
+    static const std::regex definition(R"(\b(?:int|void)\s+(\w+)\s*\()");
+    std::string result = source;
+    for (std::sregex_iterator it(source.begin(), source.end(), definition), end; it != end; ++it) {
+        std::regex use("\\b" + (*it)[1].str() + "\\s*\\(");
+        result = std::regex_replace(result, use, (*it)[1].str() + "_" + std::to_string(copy) + "(");
+    }
+    return result;
+}
+
+// 取 repeat 次中最短的耗时（毫秒）
+template <typename F>
+static double bestOf(int repeat, F &&body) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static size_t walk(const AstBinView &view, const AstBinNode &node) {
+    size_t count = 1;
+    for (uint32_t i = 0; i < node.childCount; i++) count += walk(view, view.child(node, i));
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: astbin_bench <bench-dir> <temp-file> [copies]\n";
+        return 1;
+    }
+    std::string dir = argv[1], tempPath = argv[2];
+    int copies = argc > 3 ? std::stoi(argv[3]) : 200;
+    const int repeat = 5;
+
+    try {
+        std::string source;
+        std::istringstream workloads(readFile(dir + "/workloads.txt"));
+        std::string line;
+        std::vector<std::string> bodies;
+        while (std::getline(workloads, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            bodies.push_back(readFile(dir + "/" + line.substr(0, line.find(' ')) + ".tc"));
+        }
+        for (int copy = 0; copy < copies; copy++) {
+            for (auto &body : bodies) source += renameFunctions(body, copy);
+        }
+
+        std::vector<std::unique_ptr<FuncDef>> program;
+        double parseMs = bestOf(repeat, [&] {
+            Lexer lexer(source);
+            auto tokens = lexer.tokenize();
+            Parser parser(tokens);
+            program = parser.parseCompUnit();
+        });
+        double writeMs = bestOf(repeat, [&] {
+            std::ofstream out(tempPath, std::ios::binary);
+            writeAstBin(out, program);
+        });
+        size_t binSize = 0;
+        double loadMs = bestOf(repeat, [&] {
+            auto loaded = loadAstBin(tempPath);
+            if (loaded.size() != program.size()) throw std::runtime_error("Round trip lost functions");
+        });
+        size_t nodes = 0;
+        double walkMs = bestOf(repeat, [&] {
+            MappedFile file(tempPath);
+            AstBinView view(file.data(), file.size());
+            nodes = 0;
+            for (uint32_t i = 0; i < view.functionCount(); i++) nodes += walk(view, view.function(i));
+            binSize = file.size();
+        });
+
+        std::cout << "source: " << source.size() << " bytes, " << program.size() << " functions, " << nodes
+                  << " nodes; binary AST: " << binSize << " bytes\n";
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "  parse  " << std::setw(10) << parseMs << " ms\n";
+        std::cout << "  write  " << std::setw(10) << writeMs << " ms\n";
+        std::cout << "  load   " << std::setw(10) << loadMs << " ms  (" << std::setprecision(1)
+                  << parseMs / loadMs << "x faster than parse)\n" << std::setprecision(3);
+        std::cout << "  walk   " << std::setw(10) << walkMs << " ms  (" << std::setprecision(1)
+                  << parseMs / walkMs << "x faster than parse)\n";
+    } catch (const std::exception &ex) {
+        std::cerr << "astbin_bench: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+// lexer_bench.cpp
+// 并行词法分析的扩展性：把 workloads.txt 中的工作负载反复拼接成一个大源文件，
+// 分别用 Lexer::tokenize 与 1..N 个线程的 tokenizeParallel 扫描，报告吞吐量与加速比，
+// 并逐个比较 token（类型、文本、行列号）与顺序扫描的结果
+// 用法：lexer_bench <bench 目录> [MB] [最大线程数]
+#include "lexer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+static std::string readFile(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Cannot open file " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// 取 repeat 次中最短的耗时（毫秒）
+template <typename F>
+static double bestOf(int repeat, F &&body) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static bool sameTokens(const std::vector<Token> &a, const std::vector<Token> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].type != b[i].type || a[i].lexeme != b[i].lexeme || a[i].line != b[i].line ||
+            a[i].column != b[i].column) {
+            std::cerr << "token " << i << " differs: '" << a[i].lexeme << "' " << a[i].line << ":" << a[i].column
+                      << " vs '" << b[i].lexeme << "' " << b[i].line << ":" << b[i].column << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: lexer_bench <bench-dir> [megabytes] [max-threads]\n";
+        return 1;
+    }
+    std::string dir = argv[1];
+    size_t megabytes = argc > 2 ? std::stoul(argv[2]) : 64;
+    unsigned maxThreads = argc > 3 ? (unsigned)std::stoul(argv[3]) : std::max(4u, std::thread::hardware_concurrency());
+    const int repeat = 3;
+
+    try {
+        std::string unit;
+        std::istringstream workloads(readFile(dir + "/workloads.txt"));
+        std::string line;
+        while (std::getline(workloads, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            unit += readFile(dir + "/" + line.substr(0, line.find(' ')) + ".tc");
+        }
+        // 混入空行、CRLF 与制表符，切分点可能落在这些位置
+        unit += "\r\n\n\t// \n";
+        std::string source;
+        source.reserve(megabytes << 20);
+        while (source.size() < (megabytes << 20)) source += unit;
+
+        std::vector<Token> expected;
+        double sequentialMs = bestOf(repeat, [&] { expected = Lexer(source).tokenize(); });
+        double mb = source.size() / 1048576.0;
+        std::cout << "source: " << std::fixed << std::setprecision(1) << mb << " MB, " << expected.size()
+                  << " tokens, " << std::thread::hardware_concurrency() << " hardware threads\n";
+        std::cout << "  threads    time(ms)     MB/s  speedup\n";
+        std::cout << "  sequential" << std::setw(10) << sequentialMs << std::setw(9) << mb / sequentialMs * 1000
+                  << "     1.00\n";
+        for (unsigned threads = 1; threads <= maxThreads; threads++) {
+            std::vector<Token> tokens;
+            double ms = bestOf(repeat, [&] { tokens = tokenizeParallel(source, threads); });
+            if (!sameTokens(expected, tokens)) throw std::runtime_error("Token stream differs with " +
+                                                                        std::to_string(threads) + " threads");
+            std::cout << "  " << std::setw(7) << threads << std::setw(12) << std::setprecision(1) << ms << std::setw(9)
+                      << mb / ms * 1000 << std::setw(9) << std::setprecision(2) << sequentialMs / ms << "\n";
+        }
+    } catch (const std::exception &ex) {
+        std::cerr << "lexer_bench: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+// pipeline_bench.cpp
+// 流水线前端的端到端耗时：把 workloads.txt 中的工作负载各复制若干份（函数改名）拼成一个
+// 大源文件，从源码到汇编文本完整编译一遍，比较
+//   stream    单线程逐个函数：词法、语法、语义分析与代码生成交替进行
+//   pipeline  词法、语法分析各在一个线程，经两个 SPSC 环把函数交给本线程做语义分析与代码生成
+// 两种方式的输出逐字节比较
+// 用法：pipeline_bench <bench 目录> [份数]
+#include "codegen.h"
+#include "lexer.h"
+#include "parser.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "semantic.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <thread>
+
+static std::string readFile(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Cannot open file " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// 所有函数名加后缀 _<copy>，调用处同时改名
+static std::string renameFunctions(const std::string &source, int copy) {
+    static const std::regex definition(R"(\b(?:int|void)\s+(\w+)\s*\()");
+    std::string result = source;
+    for (std::sregex_iterator it(source.begin(), source.end(), definition), end; it != end; ++it) {
+        std::regex use("\\b" + (*it)[1].str() + "\\s*\\(");
+        result = std::regex_replace(result, use, (*it)[1].str() + "_" + std::to_string(copy) + "(");
+    }
+    return result;
+}
+
+// 取 repeat 次中最短的耗时（毫秒）
+template <typename F>
+static double bestOf(int repeat, F &&body) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// next() 依次给出函数，直到空指针
+template <typename Next>
+static std::string compile(Next &&next) {
+    std::ostringstream out;
+    CodeGen codegen(out);
+    SemanticAnalyzer semantic;
+    ProfileLayout layout;
+    while (auto func = next()) {
+        semantic.analyzeFunction(func.get());
+        assignProfileIds(*func, layout);
+        codegen.generateFunction(func.get());
+    }
+    semantic.finish();
+    if (semantic.errorCount() > 0) throw std::runtime_error("Semantic errors in benchmark source");
+    return out.str();
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: pipeline_bench <bench-dir> [copies]\n";
+        return 1;
+    }
+    std::string dir = argv[1];
+    int copies = argc > 2 ? std::stoi(argv[2]) : 500;
+    const int repeat = 3;
+
+    try {
+        std::string source;
+        std::istringstream workloads(readFile(dir + "/workloads.txt"));
+        std::string line;
+        std::vector<std::string> bodies;
+        while (std::getline(workloads, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            bodies.push_back(readFile(dir + "/" + line.substr(0, line.find(' ')) + ".tc"));
+        }
+        // 每个工作负载都有 main，按 (份, 工作负载) 编号改名
+        for (int copy = 0; copy < copies; copy++) {
+            for (size_t i = 0; i < bodies.size(); i++) {
+                source += renameFunctions(bodies[i], copy * (int)bodies.size() + (int)i);
+            }
+        }
+
+        std::string streamAsm, pipelineAsm;
+        double streamMs = bestOf(repeat, [&] {
+            Lexer lexer(source);
+            Parser parser([&] { return lexer.next(); });
+            streamAsm = compile([&] { return parser.parseNextFunc(); });
+        });
+        PipelineStats stats;
+        double pipelineMs = bestOf(repeat, [&] {
+            PipelinedFrontEnd frontEnd(source);
+            pipelineAsm = compile([&] { return frontEnd.next(); });
+            stats = frontEnd.stats();
+        });
+        if (streamAsm != pipelineAsm) throw std::runtime_error("Pipelined output differs");
+
+        std::cout << "source: " << source.size() << " bytes, " << stats.functions << " functions; "
+                  << std::thread::hardware_concurrency() << " hardware threads\n";
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  stream    " << std::setw(10) << streamMs << " ms\n";
+        std::cout << "  pipeline  " << std::setw(10) << pipelineMs << " ms  (" << std::setprecision(2)
+                  << streamMs / pipelineMs << "x)\n";
+        stats.print(std::cout);
+    } catch (const std::exception &ex) {
+        std::cerr << "pipeline_bench: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
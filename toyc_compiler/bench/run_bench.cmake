@@ -0,0 +1,116 @@
+# 生成代码性能回归测试，由 bench / bench-update 目标以 cmake -P 调用。
+# 每个工作负载在各优化级别下编译、在 toysim 中执行并核对返回值，
+# 动态指令数与估算周期数与 baseline.txt 比较，超过阈值（百分比）视为回归。
+#
+# 参数：TOYC、TOYSIM、BENCH_DIR、WORK_DIR、TUNE、INSN_THRESHOLD、CYCLE_THRESHOLD、UPDATE
+
+# 优化级别，对应 toyc 的 -O0/-O1/-O2
+set(LEVELS O0 O1 O2)
+
+set(BASELINE ${BENCH_DIR}/baseline.txt)
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# 读入基线：# tune <核心> 以及 <负载> <级别> <指令数> <周期数>
+set(BASE_TUNE "")
+if(EXISTS ${BASELINE})
+  file(STRINGS ${BASELINE} BASE_LINES ENCODING UTF-8)
+  foreach(LINE IN LISTS BASE_LINES)
+    if(LINE MATCHES "^# tune ([^ ]+)$")
+      set(BASE_TUNE ${CMAKE_MATCH_1})
+    elseif(LINE MATCHES "^([^ #]+) ([^ ]+) ([0-9]+) ([0-9]+)$")
+      set(BASE_INSN_${CMAKE_MATCH_1}_${CMAKE_MATCH_2} ${CMAKE_MATCH_3})
+      set(BASE_CYCLE_${CMAKE_MATCH_1}_${CMAKE_MATCH_2} ${CMAKE_MATCH_4})
+    endif()
+  endforeach()
+endif()
+set(COMPARE ON)
+if(UPDATE OR NOT BASE_TUNE STREQUAL TUNE)
+  set(COMPARE OFF)
+  if(NOT UPDATE)
+    message(WARNING "Baseline was recorded for -mtune=${BASE_TUNE}, not ${TUNE}; only checking results")
+  endif()
+endif()
+
+# 超过 base * (100 + threshold) / 100 即回归；返回 regression / improved / same
+function(classify VALUE BASE THRESHOLD OUT)
+  math(EXPR SCALED "${VALUE} * 100")
+  math(EXPR LIMIT "${BASE} * (100 + ${THRESHOLD})")
+  math(EXPR FLOOR "${BASE} * (100 - ${THRESHOLD})")
+  if(SCALED GREATER LIMIT)
+    set(${OUT} regression PARENT_SCOPE)
+  elseif(SCALED LESS FLOOR)
+    set(${OUT} improved PARENT_SCOPE)
+  else()
+    set(${OUT} same PARENT_SCOPE)
+  endif()
+endfunction()
+
+file(STRINGS ${BENCH_DIR}/workloads.txt WORKLOADS ENCODING UTF-8 REGEX "^[^#]")
+set(NEW_BASELINE "# tune ${TUNE}\n# workload level instructions cycles\n")
+set(FAILURES 0)
+message("workload   level  instructions      cycles  status")
+foreach(ENTRY IN LISTS WORKLOADS)
+  string(REGEX MATCH "^([^ ]+) (-?[0-9]+)$" OK "${ENTRY}")
+  if(NOT OK)
+    message(FATAL_ERROR "Malformed workloads.txt line: ${ENTRY}")
+  endif()
+  set(NAME ${CMAKE_MATCH_1})
+  set(EXPECTED ${CMAKE_MATCH_2})
+  foreach(LEVEL IN LISTS LEVELS)
+    set(ASM ${WORK_DIR}/${NAME}-${LEVEL}.s)
+    execute_process(COMMAND ${TOYC} -${LEVEL} ${BENCH_DIR}/${NAME}.tc
+                    OUTPUT_FILE ${ASM} ERROR_VARIABLE COMPILE_LOG RESULT_VARIABLE COMPILE_RESULT)
+    if(NOT COMPILE_RESULT EQUAL 0)
+      message(FATAL_ERROR "${NAME} -${LEVEL}: toyc failed\n${COMPILE_LOG}")
+    endif()
+    execute_process(COMMAND ${TOYSIM} -mtune=${TUNE} ${ASM} ERROR_VARIABLE SIM_LOG OUTPUT_QUIET)
+    if(NOT SIM_LOG MATCHES "return value: (-?[0-9]+)")
+      message(FATAL_ERROR "${NAME} -${LEVEL}: simulation failed\n${SIM_LOG}")
+    endif()
+    set(RESULT ${CMAKE_MATCH_1})
+    string(REGEX MATCH "instructions +([0-9]+)" _ "${SIM_LOG}")
+    set(INSN ${CMAKE_MATCH_1})
+    string(REGEX MATCH "cycles +([0-9]+)" _ "${SIM_LOG}")
+    set(CYCLES ${CMAKE_MATCH_1})
+    string(APPEND NEW_BASELINE "${NAME} ${LEVEL} ${INSN} ${CYCLES}\n")
+
+    set(STATUS ok)
+    if(NOT RESULT EQUAL EXPECTED)
+      set(STATUS "WRONG RESULT ${RESULT}, expected ${EXPECTED}")
+      math(EXPR FAILURES "${FAILURES} + 1")
+    elseif(COMPARE)
+      if(NOT DEFINED BASE_INSN_${NAME}_${LEVEL})
+        set(STATUS "no baseline")
+      else()
+        set(BASE_INSN ${BASE_INSN_${NAME}_${LEVEL}})
+        set(BASE_CYCLES ${BASE_CYCLE_${NAME}_${LEVEL}})
+        classify(${INSN} ${BASE_INSN} ${INSN_THRESHOLD} INSN_STATUS)
+        classify(${CYCLES} ${BASE_CYCLES} ${CYCLE_THRESHOLD} CYCLE_STATUS)
+        if(INSN_STATUS STREQUAL regression OR CYCLE_STATUS STREQUAL regression)
+          set(STATUS "REGRESSION (baseline ${BASE_INSN} / ${BASE_CYCLES})")
+          math(EXPR FAILURES "${FAILURES} + 1")
+        elseif(INSN_STATUS STREQUAL improved OR CYCLE_STATUS STREQUAL improved)
+          set(STATUS "improved (baseline ${BASE_INSN} / ${BASE_CYCLES})")
+        endif()
+      endif()
+    endif()
+
+    string(LENGTH "${NAME}" LEN)
+    math(EXPR PAD "11 - ${LEN}")
+    string(REPEAT " " ${PAD} NAME_PAD)
+    string(LENGTH "${INSN}" LEN)
+    math(EXPR PAD "12 - ${LEN}")
+    string(REPEAT " " ${PAD} INSN_PAD)
+    string(LENGTH "${CYCLES}" LEN)
+    math(EXPR PAD "12 - ${LEN}")
+    string(REPEAT " " ${PAD} CYCLE_PAD)
+    message("${NAME}${NAME_PAD}${LEVEL}  ${INSN_PAD}${INSN}${CYCLE_PAD}${CYCLES}  ${STATUS}")
+  endforeach()
+endforeach()
+
+if(UPDATE)
+  file(WRITE ${BASELINE} "${NEW_BASELINE}")
+  message("Baseline written to ${BASELINE}")
+elseif(FAILURES GREATER 0)
+  message(FATAL_ERROR "${FAILURES} benchmark check(s) failed")
+endif()
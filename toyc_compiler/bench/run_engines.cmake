@@ -0,0 +1,79 @@
+# 执行引擎对比，由 bench-engines 目标以 cmake -P 调用。
+# 每个工作负载分别用 toyc --run=ast/vm/jit 在 -O0 下执行并核对返回值，
+# 取 REPEAT 次中 run 阶段的最短耗时，报告相对 AST 遍历解释器的加速比。
+#
+# 参数：TOYC、BENCH_DIR、REPEAT
+
+set(ENGINES ast vm jit)
+if(NOT REPEAT)
+  set(REPEAT 3)
+endif()
+
+# "12.345" 毫秒 -> 12345 微秒
+function(to_micros MS OUT)
+  string(REPLACE "." "" DIGITS "${MS}")
+  string(REGEX MATCH "[1-9][0-9]*$" DIGITS "${DIGITS}")
+  if(DIGITS STREQUAL "")
+    set(DIGITS 0)
+  endif()
+  set(${OUT} ${DIGITS} PARENT_SCOPE)
+endfunction()
+
+file(STRINGS ${BENCH_DIR}/workloads.txt WORKLOADS ENCODING UTF-8 REGEX "^[^#]")
+set(FAILURES 0)
+message("workload   engine     run(us)  speedup")
+foreach(ENTRY IN LISTS WORKLOADS)
+  string(REGEX MATCH "^([^ ]+) (-?[0-9]+)$" OK "${ENTRY}")
+  if(NOT OK)
+    message(FATAL_ERROR "Malformed workloads.txt line: ${ENTRY}")
+  endif()
+  set(NAME ${CMAKE_MATCH_1})
+  set(EXPECTED ${CMAKE_MATCH_2})
+  foreach(ENGINE IN LISTS ENGINES)
+    set(BEST "")
+    set(STATUS "")
+    foreach(I RANGE 1 ${REPEAT})
+      execute_process(COMMAND ${TOYC} -O0 --run=${ENGINE} --pass-stats ${BENCH_DIR}/${NAME}.tc
+                      OUTPUT_QUIET ERROR_VARIABLE LOG)
+      if(NOT LOG MATCHES "return value: (-?[0-9]+)")
+        message(FATAL_ERROR "${NAME} --run=${ENGINE}: execution failed\n${LOG}")
+      endif()
+      if(NOT CMAKE_MATCH_1 EQUAL EXPECTED)
+        set(STATUS "  WRONG RESULT ${CMAKE_MATCH_1}, expected ${EXPECTED}")
+      endif()
+      string(REGEX MATCH "\n  run +1 +([0-9]+\\.[0-9]+)" _ "${LOG}")
+      to_micros(${CMAKE_MATCH_1} MICROS)
+      if(BEST STREQUAL "" OR MICROS LESS BEST)
+        set(BEST ${MICROS})
+      endif()
+    endforeach()
+    if(STATUS)
+      math(EXPR FAILURES "${FAILURES} + 1")
+    endif()
+    if(BEST EQUAL 0)
+      set(BEST 1)
+    endif()
+    if(ENGINE STREQUAL ast)
+      set(AST_MICROS ${BEST})
+    endif()
+    # 加速比保留一位小数
+    math(EXPR TENTHS "${AST_MICROS} * 10 / ${BEST}")
+    math(EXPR WHOLE "${TENTHS} / 10")
+    math(EXPR FRACTION "${TENTHS} % 10")
+
+    string(LENGTH "${NAME}" LEN)
+    math(EXPR PAD "11 - ${LEN}")
+    string(REPEAT " " ${PAD} NAME_PAD)
+    string(LENGTH "${ENGINE}" LEN)
+    math(EXPR PAD "6 - ${LEN}")
+    string(REPEAT " " ${PAD} ENGINE_PAD)
+    string(LENGTH "${BEST}" LEN)
+    math(EXPR PAD "12 - ${LEN}")
+    string(REPEAT " " ${PAD} TIME_PAD)
+    message("${NAME}${NAME_PAD}${ENGINE}${ENGINE_PAD}${TIME_PAD}${BEST}  ${WHOLE}.${FRACTION}x${STATUS}")
+  endforeach()
+endforeach()
+
+if(FAILURES GREATER 0)
+  message(FATAL_ERROR "${FAILURES} engine check(s) failed")
+endif()
@@ -0,0 +1,87 @@
+# RVC 压缩的静态代码体积，由 bench-rvc 目标以 cmake -P 调用。
+# 每个工作负载在 -O0/-O1/-O2 下加 -mrvc 编译，取 --pass-stats 中 compress 前后的代码字节数，
+# 并在 toysim 中执行压缩后的程序核对返回值。
+#
+# 参数：TOYC、TOYSIM、BENCH_DIR、WORK_DIR
+
+set(LEVELS O0 O1 O2)
+
+# 百分比保留一位小数
+function(percent PART WHOLE OUT)
+  math(EXPR TENTHS "${PART} * 1000 / ${WHOLE}")
+  math(EXPR INT "${TENTHS} / 10")
+  math(EXPR FRACTION "${TENTHS} % 10")
+  set(${OUT} "${INT}.${FRACTION}%" PARENT_SCOPE)
+endfunction()
+
+function(pad_left TEXT WIDTH OUT)
+  string(LENGTH "${TEXT}" LEN)
+  math(EXPR PAD "${WIDTH} - ${LEN}")
+  string(REPEAT " " ${PAD} SPACES)
+  set(${OUT} "${SPACES}${TEXT}" PARENT_SCOPE)
+endfunction()
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(STRINGS ${BENCH_DIR}/workloads.txt WORKLOADS ENCODING UTF-8 REGEX "^[^#]")
+set(FAILURES 0)
+foreach(LEVEL IN LISTS LEVELS)
+  set(TOTAL_BEFORE_${LEVEL} 0)
+  set(TOTAL_AFTER_${LEVEL} 0)
+endforeach()
+
+message("workload   level   bytes    rvc   saved")
+foreach(ENTRY IN LISTS WORKLOADS)
+  string(REGEX MATCH "^([^ ]+) (-?[0-9]+)$" OK "${ENTRY}")
+  if(NOT OK)
+    message(FATAL_ERROR "Malformed workloads.txt line: ${ENTRY}")
+  endif()
+  set(NAME ${CMAKE_MATCH_1})
+  set(EXPECTED ${CMAKE_MATCH_2})
+  foreach(LEVEL IN LISTS LEVELS)
+    set(ASM ${WORK_DIR}/${NAME}-${LEVEL}-rvc.s)
+    execute_process(COMMAND ${TOYC} -${LEVEL} -mrvc --pass-stats -o ${ASM} ${BENCH_DIR}/${NAME}.tc
+                    RESULT_VARIABLE RC OUTPUT_QUIET ERROR_VARIABLE LOG)
+    if(NOT RC EQUAL 0 OR NOT LOG MATCHES "\n  compress +[0-9]+ +[0-9.]+ +[0-9]+  ([0-9]+) -> ([0-9]+) bytes")
+      message(FATAL_ERROR "${NAME} -${LEVEL} -mrvc: compilation failed\n${LOG}")
+    endif()
+    set(BEFORE ${CMAKE_MATCH_1})
+    set(AFTER ${CMAKE_MATCH_2})
+    math(EXPR TOTAL_BEFORE_${LEVEL} "${TOTAL_BEFORE_${LEVEL}} + ${BEFORE}")
+    math(EXPR TOTAL_AFTER_${LEVEL} "${TOTAL_AFTER_${LEVEL}} + ${AFTER}")
+
+    execute_process(COMMAND ${TOYSIM} ${ASM} ERROR_VARIABLE SIM_LOG OUTPUT_QUIET)
+    if(NOT SIM_LOG MATCHES "return value: (-?[0-9]+)")
+      message(FATAL_ERROR "${NAME} -${LEVEL} -mrvc: simulation failed\n${SIM_LOG}")
+    endif()
+    set(STATUS "")
+    if(NOT CMAKE_MATCH_1 EQUAL EXPECTED)
+      set(STATUS "  WRONG RESULT ${CMAKE_MATCH_1}, expected ${EXPECTED}")
+    endif()
+    if(STATUS)
+      math(EXPR FAILURES "${FAILURES} + 1")
+    endif()
+
+    math(EXPR SAVED "${BEFORE} - ${AFTER}")
+    percent(${SAVED} ${BEFORE} RATIO)
+    string(LENGTH "${NAME}" LEN)
+    math(EXPR PAD "11 - ${LEN}")
+    string(REPEAT " " ${PAD} NAME_PAD)
+    pad_left(${BEFORE} 7 BEFORE_COL)
+    pad_left(${AFTER} 7 AFTER_COL)
+    pad_left(${RATIO} 8 RATIO_COL)
+    message("${NAME}${NAME_PAD}-${LEVEL}${BEFORE_COL}${AFTER_COL}${RATIO_COL}${STATUS}")
+  endforeach()
+endforeach()
+
+foreach(LEVEL IN LISTS LEVELS)
+  math(EXPR SAVED "${TOTAL_BEFORE_${LEVEL}} - ${TOTAL_AFTER_${LEVEL}}")
+  percent(${SAVED} ${TOTAL_BEFORE_${LEVEL}} RATIO)
+  pad_left(${TOTAL_BEFORE_${LEVEL}} 7 BEFORE_COL)
+  pad_left(${TOTAL_AFTER_${LEVEL}} 7 AFTER_COL)
+  pad_left(${RATIO} 8 RATIO_COL)
+  message("total      -${LEVEL}${BEFORE_COL}${AFTER_COL}${RATIO_COL}")
+endforeach()
+
+if(FAILURES GREATER 0)
+  message(FATAL_ERROR "${FAILURES} compressed workload(s) failed")
+endif()
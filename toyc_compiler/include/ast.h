@@ -3,10 +3,19 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <ostream>
+
+// 源码范围：起点为第一个 token 的行列，终点为最后一个 token 之后的列，行列从 1 开始；
+// 变换生成的节点沿用被替换节点的范围，未知时为 0
+struct SourceSpan {
+    int line = 0, column = 0;
+    int endLine = 0, endColumn = 0;
+};
 
 // 基类
 struct ASTNode {
     virtual ~ASTNode() = default;
+    SourceSpan span;
 };
 
 // 基类
@@ -33,6 +42,7 @@ struct FuncDef : ASTNode {
     };
     std::vector<Param> params;
     std::unique_ptr<class Block> body;
+    int profileId = -1;   // 插桩计数器编号：函数入口次数
 
     FuncDef(const std::string &rt, const std::string &n) : retType(rt), name(n) {}
 };
@@ -85,6 +95,7 @@ struct BinaryExpr : Expr {
 struct CallExpr : Expr {
     std::string callee;
     std::vector<std::unique_ptr<Expr>> args;
+    int profileId = -1;   // 插桩计数器编号：该调用点的执行次数
     CallExpr(std::string c) : callee(std::move(c)) {}
 };
 // 如果有这些语句，就需要这样补
@@ -107,6 +118,7 @@ struct IfStmt : Stmt {
     std::unique_ptr<Expr> condition;
     std::unique_ptr<Block> thenBlock;
     std::unique_ptr<Block> elseBlock;
+    int profileId = -1;   // 插桩计数器编号：profileId 为执行次数，profileId + 1 为进入 then 的次数
 
     IfStmt(std::unique_ptr<Expr> cond, std::unique_ptr<Block> thenBlk, std::unique_ptr<Block> elseBlk)
         : condition(std::move(cond)), thenBlock(std::move(thenBlk)), elseBlock(std::move(elseBlk)) {}
@@ -115,6 +127,7 @@ struct IfStmt : Stmt {
 struct WhileStmt : Stmt {
     std::unique_ptr<Expr> condition;
     std::unique_ptr<Block> body;
+    int profileId = -1;   // 插桩计数器编号：profileId 为进入循环的次数，profileId + 1 为迭代次数
 
     WhileStmt(std::unique_ptr<Expr> cond, std::unique_ptr<Block> b)
         : condition(std::move(cond)), body(std::move(b)) {}
@@ -123,3 +136,15 @@ struct WhileStmt : Stmt {
 struct BreakStmt : Stmt {};
 
 struct ContinueStmt : Stmt {};
+
+// 深拷贝，供内联、循环展开等 AST 变换使用
+std::unique_ptr<Expr> cloneExpr(const Expr *expr);
+std::unique_ptr<Stmt> cloneStmt(const Stmt *stmt);
+std::unique_ptr<Block> cloneBlock(const Block *block);
+
+// AST 规模（节点数），内联、循环展开和 if 转换的代价模型共用
+int countNodes(const Stmt *stmt);
+int countNodes(const Expr *expr);
+
+// 以 ToyC 源码形式输出（二元运算全部加括号），结果可以重新解析，供 --print-after 查看 AST 变换
+void printSource(std::ostream &os, const std::vector<std::unique_ptr<FuncDef>> &funcs);
@@ -0,0 +1,103 @@
+#pragma once
+#include "ast.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 二进制 AST 格式（小端）。文件由头部和四个 4 字节对齐的节组成：
+//   字符串表  uint32 偏移 [stringCount + 1] + 以 NUL 结尾的字符串数据，名字只存一份
+//   节点数组  AstBinNode [nodeCount]，按后序排列：子树都在父节点之前，函数节点是根
+//   子节点表  uint32 节点下标，每个节点的子节点连续存放
+//   函数表    uint32 根节点下标 [functionCount]，按源码顺序
+// 反序列化只需顺序扫描节点数组并用一个栈拼装子树；也可以把文件映射进内存，
+// 经 AstBinView 按下标直接遍历，不建立任何对象
+enum class AstBinKind : uint8_t {
+    Func, Param, Block, Return, VarDecl, Assign, ExprStmt, If, While, Break, Continue,
+    Number, Var, Unary, Binary, Call,
+};
+
+enum class AstBinOp : uint8_t {
+    None, Add, Sub, Mul, Div, Mod, Lt, Gt, Le, Ge, Eq, Ne, And, Or, Not,
+};
+
+// 各类节点的字段含义：
+//   Func      value = 函数名, aux = 返回类型；子节点为若干 Param，之后是函数体 Block
+//   Param     value = 参数名, aux = 类型
+//   VarDecl   value = 变量名, aux = 类型；子节点为初值（可选）
+//   Assign    value = 变量名；子节点为右值
+//   Number    value = 整数值
+//   Var       value = 变量名
+//   Call      value = 被调函数名；子节点为实参
+//   Unary / Binary  op 为运算符；Block、Return、ExprStmt、If、While 的子节点按源码顺序
+struct AstBinNode {
+    AstBinKind kind;
+    AstBinOp op;
+    uint16_t childCount;
+    uint32_t value;          // 字符串表下标，Number 为值的补码
+    uint32_t aux;
+    uint32_t firstChild;     // 子节点表中的起始位置
+    int32_t profileId;
+    uint32_t line, endLine;
+    uint16_t column, endColumn;  // 超过 65535 的列号记为 65535
+};
+static_assert(sizeof(AstBinNode) == 32, "AstBinNode layout");
+
+struct AstBinHeader {
+    char magic[8];           // "TOYCAST\0"
+    uint32_t version;
+    uint32_t byteOrder;      // 写入端的 0x01020304，读取端据此拒绝字节序不同的文件
+    uint32_t stringCount, stringOffsets, stringData, stringDataSize;
+    uint32_t nodeCount, nodes;
+    uint32_t childCount, children;
+    uint32_t functionCount, functions;
+};
+
+// 序列化语法分析（及语义分析、剖析编号）之后的函数列表
+void writeAstBin(std::ostream &out, const std::vector<std::unique_ptr<FuncDef>> &funcs);
+
+// 只读视图：构造时校验头部与各节的边界，访问越界的下标抛出 runtime_error；不复制数据
+class AstBinView {
+public:
+    AstBinView(const void *data, size_t size);
+
+    uint32_t functionCount() const { return header->functionCount; }
+    uint32_t nodeCount() const { return header->nodeCount; }
+    uint32_t stringCount() const { return header->stringCount; }
+    const AstBinNode &node(uint32_t index) const;
+    const AstBinNode &function(uint32_t index) const;
+    const AstBinNode &child(const AstBinNode &parent, uint32_t index) const;
+    const char *string(uint32_t index) const;
+
+private:
+    const uint8_t *base;
+    size_t size;
+    const AstBinHeader *header;
+
+    template <typename T> const T *section(uint32_t offset, uint64_t count) const;
+};
+
+// 一次线性扫描重建 AST；节点种类与子节点结构不符时抛出 runtime_error
+std::vector<std::unique_ptr<FuncDef>> readAstBin(const AstBinView &view);
+
+// 只读映射整个文件（POSIX 下用 mmap，否则读入内存）
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const void *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const void *bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<char> buffer;
+};
+
+// 映射文件并重建 AST
+std::vector<std::unique_ptr<FuncDef>> loadAstBin(const std::string &path);
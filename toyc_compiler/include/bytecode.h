@@ -0,0 +1,87 @@
+#pragma once
+#include "ast.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 寄存器式字节码。名字中的 K 表示最后一个源操作数是内联在指令里的常量
+enum class BcOp : uint16_t {
+    LoadK,                       // a = b
+    Move,                        // a = r[b]
+    Neg, Not,                    // a = -r[b] / !r[b]
+    Add, Sub, Mul, Div, Rem,     // a = r[b] op r[c]
+    AddK, MulK, DivK, RemK,      // a = r[b] op c（减常量化为加）
+    Lt, Le, Eq, Ne,              // a = r[b] op r[c]（> 与 >= 交换操作数）
+    LtK, LeK, GtK, GeK, EqK, NeK,
+    Jmp,                         // 跳到 c
+    JLt, JLe, JEq, JNe,          // r[a] op r[b] 时跳到 c
+    JLtK, JLeK, JGtK, JGeK, JEqK, JNeK,
+    JZ, JNZ,                     // r[a] 为 0 / 非 0 时跳到 c
+    Call,                        // a = 函数 b(r[c], r[c+1], ...)
+    Ret, RetK,                   // 返回 r[a] / 常量 b
+    Count
+};
+
+// 定长指令，12 字节。a 总是寄存器；b、c 按操作码解释为寄存器、常量、函数号或跳转目标
+struct BcInstr {
+    BcOp op;
+    uint16_t a;
+    int32_t b;
+    int32_t c;
+};
+
+struct BcFunction {
+    std::string name;
+    int params = 0;
+    int registers = 0;           // 帧大小：参数占 r0..r(params-1)，其后是局部变量与临时值
+    std::vector<BcInstr> code;
+};
+
+struct BcModule {
+    std::vector<BcFunction> functions;
+    std::unordered_map<std::string, int> index;
+};
+
+// 整个程序一次编译为字节码。变量按作用域分配寄存器，块结束后复用；表达式的临时值按栈式分配，
+// 实参放在连续的寄存器中，被调用者的帧就从那里开始，调用时不复制参数。
+// 未定义的变量或函数、实参个数不符、循环外的 break/continue 抛出 runtime_error
+BcModule compileBytecode(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+
+void printBytecode(std::ostream &os, const BcModule &module);
+
+struct VmOptions {
+    size_t registerFileSize = 1 << 20;  // 所有帧共用的寄存器堆（32 位字）
+    size_t maxFrames = 1 << 16;         // 调用深度上限
+};
+
+struct VmStats {
+    uint64_t calls = 0;
+    size_t maxDepth = 0;
+};
+
+// 字节码解释器。寄存器堆与帧栈在构造时一次分配；GCC/Clang 下用计算 goto 做线索化分派，
+// 其他编译器退回 switch。整数语义与 RV32IM 一致；栈溢出时抛出 runtime_error
+class Vm {
+public:
+    explicit Vm(const BcModule &module, const VmOptions &options = VmOptions());
+
+    int32_t run(const std::string &entry = "main", const std::vector<int32_t> &args = {});
+    const VmStats &stats() const { return counters; }
+    void printStats(std::ostream &os) const;
+
+private:
+    struct Frame {
+        const BcFunction *func;
+        const BcInstr *returnPc;
+        int32_t *base;
+        uint16_t dest;           // 返回值写入调用者的哪个寄存器
+    };
+
+    const BcModule &module;
+    std::vector<int32_t> registers;
+    std::vector<Frame> frames;
+    VmStats counters;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include "ast.h"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 由 CallExpr 构建的调用图，节点下标与 FuncDef 列表一致
+class CallGraph {
+public:
+    explicit CallGraph(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+
+    size_t size() const { return funcs.size(); }
+    FuncDef *func(size_t i) const { return funcs[i]; }
+    // 找不到时返回 -1
+    int indexOf(const std::string &name) const;
+
+    const std::vector<size_t> &callees(size_t i) const { return edges[i]; }
+    // 每个调用点一个条目（含重复），用于统计调用次数
+    int callSiteCount(size_t caller, size_t callee) const;
+
+    // 强连通分量，按自底向上（被调用者先于调用者）排列
+    const std::vector<std::vector<size_t>> &sccs() const { return components; }
+    int sccOf(size_t i) const { return sccIndex[i]; }
+    // 函数位于环上（含直接自递归）
+    bool isRecursive(size_t i) const { return recursive[i]; }
+    // 从 root 出发沿调用边可达的函数（含 root 本身）
+    std::vector<bool> reachableFrom(size_t root) const;
+
+private:
+    std::vector<FuncDef *> funcs;
+    std::unordered_map<std::string, size_t> nameIndex;
+    std::vector<std::vector<size_t>> edges;
+    std::vector<std::unordered_map<size_t, int>> siteCounts;
+    std::vector<std::vector<size_t>> components;
+    std::vector<int> sccIndex;
+    std::vector<bool> recursive;
+
+    void collectCalls(size_t caller, Stmt *stmt);
+    void collectCalls(size_t caller, Expr *expr);
+    void computeSccs();
+};
+
+// 删除从 main 不可达的函数，返回删除的个数。没有 main 时（函数库）全部保留。
+// 只依据语法上的调用点，须在语义分析之前运行，死函数不再分析
+int eliminateDeadFunctions(std::vector<std::unique_ptr<FuncDef>> &funcs);
+
+// --print-callgraph：每个函数的被调用者（含调用点个数）以及是否从 main 可达
+void printCallGraph(std::ostream &os, const CallGraph &graph);
@@ -1,23 +1,144 @@
 #pragma once
 #include "ast.h"
+#include "cost.h"
+#include "isel.h"
+#include "peephole.h"
+#include "profile.h"
+#include "riscv.h"
+#include "scheduler.h"
+#include <functional>
 #include <ostream>
 #include <unordered_map>
 #include <string>
+#include <vector>
+
+// 变量的存放位置：寄存器或栈槽（相对 sp 的偏移）
+struct VarHome {
+    std::string reg;
+    int offset = 0;
+    bool inReg() const { return !reg.empty(); }
+};
+
+// 单个函数的栈帧布局，自底向上：
+//   [出栈参数区][ra 与被调用者保存寄存器][局部变量槽][跨调用临时值溢出槽]
+struct FrameInfo {
+    bool isLeaf = true;
+    int outArgSlots = 0;                  // 超过 8 个实参时经栈传递的个数
+    int maxCallArgs = 0;                  // 各调用点（含尾调用）占用的 a 寄存器个数的最大值
+    std::vector<std::string> callees;     // 普通调用点的被调用者
+    std::vector<std::string> homeRegs;    // 可作为变量住所的寄存器，按分配顺序
+    int maxHomes = 0;                     // 同时存活变量的最大个数
+    std::vector<std::string> savedRegs;   // 需要在序言中保存的寄存器
+    int localSlots = 0;
+    int spillSlots = 0;
+
+    int savedOffset() const { return outArgSlots * 4; }
+    int localOffset() const { return savedOffset() + (int)savedRegs.size() * 4; }
+    int spillOffset() const { return localOffset() + localSlots * 4; }
+    int frameSize() const { return (spillOffset() + spillSlots * 4 + 15) / 16 * 16; }
+};
+
+struct CodeGenOptions {
+    bool tailCalls = true;   // return f(...) 复用本函数栈帧，以 tail 跳转
+    bool peephole = true;    // 输出前对每个函数做窥孔优化
+    bool schedule = true;    // 按目标核心的延迟表做基本块内指令调度
+    std::string tune = "generic";
+    bool ipra = true;        // 按被调用者实际改写的寄存器决定调用点的保存与变量住所
+    bool ifConvert = true;   // 简单的条件赋值改为无分支的掩码选择
+    int ifConvertMaxArm = 4; // 参与 if 转换的每个分支表达式的最大节点数
+
+    // 插桩：函数入口、if/while 与调用点累加计数器，main 返回后写出到 profilePath
+    bool profileGenerate = false;
+    std::string profilePath = "toyc.profdata";
+    ProfileLayout profileLayout;
+    // 使用剖析：热分支作为顺序执行路径，冷分支移到函数末尾
+    const ProfileData *profile = nullptr;
+
+    // --cost-report：设置时记录每个函数最终代码的静态代价估计
+    CostReport *costReport = nullptr;
+
+    // 每个函数生成后运行的机器层变换；设置后取代上面 peephole/schedule 开关的默认顺序
+    std::function<void(const std::string &, std::vector<AsmInstr> &, const ClobberMap *)> machinePasses;
+};
 
 class CodeGen {
 public:
-    CodeGen(std::ostream &out);
+    CodeGen(std::ostream &out, const CodeGenOptions &options = CodeGenOptions());
     void genBlock(Block *block);
     void generate(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+    // 生成整个程序的指令序列而不输出，供直接编码为目标文件
+    std::vector<AsmInstr> lower(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+    // 流式生成：按到达顺序生成单个函数并立即输出，之后调用者即可释放它。
+    // 被调用者尚未生成时调用点按调用约定保存寄存器
+    void generateFunction(FuncDef *func);
+    // 流式生成结束；插桩构建在此输出剖析运行时，计数器个数取自 layout
+    void finishStream(const ProfileLayout &layout);
+    const Peephole &peepholeStats() const { return peephole; }
+    const Scheduler &schedulerStats() const { return scheduler; }
 
 private:
     std::ostream &out;
+    CodeGenOptions options;
     int labelCount = 0;
-    std::unordered_map<std::string, int> localVarOffset;
+    Peephole peephole;
+    Scheduler scheduler;
+    ClobberMap clobbers;     // 已生成函数的破坏集合
+
+    // 当前函数的栈帧与变量作用域（按作用域栈式分配住所，兄弟作用域复用）
+    FrameInfo frame;
+    std::vector<std::unordered_map<std::string, VarHome>> scopes;
+    int liveHomes = 0;
+
+    // 函数体先缓存，序言和各处尾声以占位标记记录，待栈帧确定后再展开
+    // 剖析判定为冷的分支移出主路径，生成完函数体后追加到末尾
+    std::vector<AsmInstr> body;
+    std::vector<AsmInstr> coldCode;
+    bool beforePrologue = false;
 
-    void genFunc(FuncDef *func);
+    // 表达式临时寄存器池，genExpr 返回结果所在寄存器
+    std::vector<bool> tempUsed;
+    int stageDepth = 0;
+    InstructionSelector isel;
+
+    // 循环上下文：{continue 目标, break 目标}
+    std::vector<std::pair<std::string, std::string>> loopLabels;
+
+    void layoutFrame(FuncDef *func);
+    std::vector<AsmInstr> genFunc(FuncDef *func);
+    // 生成函数并记录其破坏集合
+    std::vector<AsmInstr> lowerFunction(FuncDef *func);
+    RegSet clobbersOf(const std::string &callee) const;
     void genStmt(Stmt *stmt);
     std::string genExpr(Expr *expr);
-    void emit(const std::string &instr);
+    // 按指令选择给出的规则归约：求值模式的 Reg 叶子，发射规则的指令模板
+    std::string genRule(const IselRule &rule, Expr *expr);
+    void genCallArgs(CallExpr *call);
+    bool genSelect(IfStmt *ifStmt);
+    CallExpr *tailCallOf(ReturnStmt *ret) const;
+    // 控制流上下文：条件为 jumpIf 时跳转到 target，否则顺序执行
+    void genBranch(Expr *cond, const std::string &target, bool jumpIf);
+    void emit(const std::string &op, std::vector<std::string> args = {});
+    void emitLabel(const std::string &label);
+    // 尾调用时给出跳转目标
+    void emitEpilogue(const std::string &tailCallee = "");
+    void emitCounter(int profileId);
+    std::string symbolFor(const std::string &func) const;
+    void genIf(IfStmt *ifStmt);
+    void genArm(Block *block, int profileId);
+    void outlineCold(const std::string &label, Block *block, int profileId, const std::string &resume);
     std::string newLabel(const std::string &base);
+
+    VarHome declareVar(const std::string &name);
+    VarHome lookupVar(const std::string &name) const;
+    std::string loadVar(const std::string &name);
+    void storeVar(const std::string &name, const std::string &reg);
+
+    std::string allocTemp();
+    void freeTemp(const std::string &reg);
+    bool isTemp(const std::string &reg) const;
+    std::string destFor(const std::string &lhs, const std::string &rhs);
+    int freeTemps() const;
+    int pushStage(const std::string &reg);
+    void popStage();
+    std::pair<std::string, std::string> genOperands(Expr *lhs, Expr *rhs);
 };
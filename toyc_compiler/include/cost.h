@@ -0,0 +1,50 @@
+#pragma once
+#include "riscv.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 静态代价估计：不运行程序，按生成的指令序列与 -mtune 的延迟表估计每个函数与循环的代价。
+// 每条指令计其延迟，跳转、调用、返回与循环回边的分支另计跳转损失；
+// 循环按支配关系找出的自然循环，循环内的指令乘以 kLoopWeight 的嵌套深度次幂
+constexpr int kLoopWeight = 10;
+
+struct LoopCost {
+    std::string header;   // 循环头的标签
+    int depth = 1;        // 最外层循环为 1
+    int instrs = 0;       // 循环体（含内层循环）的静态指令数
+    long perIteration = 0;    // 单次迭代的代价，内层循环按其相对权重计入
+    long cost = 0;            // 计入本层及外层权重后的代价
+};
+
+struct FunctionCost {
+    std::string name;
+    int instrs = 0;
+    long cost = 0;
+    int frameSize = 0;    // 栈帧字节数
+    int calls = 0;        // 调用点，含尾调用
+    int spills = 0;       // 栈上变量与跨调用临时值的 load/store 条数
+    std::vector<LoopCost> loops;   // 按循环头在代码中的位置排列
+};
+
+// sp 相对偏移落在 [spillBase, frameSize) 的访存计为溢出（序言保存的寄存器与出栈参数区在其下）
+FunctionCost estimateCost(const std::string &name, const std::vector<AsmInstr> &code, const LatencyModel &model,
+                          int frameSize, int spillBase);
+
+// --cost-report：收集代码生成中每个函数的估计，按代价从高到低输出
+class CostReport {
+public:
+    explicit CostReport(const LatencyModel &model) : model(model) {}
+
+    const LatencyModel &latencyModel() const { return model; }
+    void add(FunctionCost cost) { functions.push_back(std::move(cost)); }
+    // 按代价从高到低，代价相同时按函数名
+    std::vector<FunctionCost> ranked() const;
+
+    void printText(std::ostream &os) const;
+    void printJson(std::ostream &os) const;
+
+private:
+    const LatencyModel &model;
+    std::vector<FunctionCost> functions;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include "riscv.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// RISC-V psABI 重定位类型（只列出本汇编器会产生或需要识别的）
+enum : uint32_t {
+    R_RISCV_BRANCH = 16,
+    R_RISCV_JAL = 17,
+    R_RISCV_CALL = 18,
+    R_RISCV_CALL_PLT = 19,
+    R_RISCV_PCREL_HI20 = 23,
+    R_RISCV_PCREL_LO12_I = 24,
+};
+
+struct ElfSymbol {
+    enum class Section { Undefined, Text, Data, Other };
+
+    std::string name;
+    Section section = Section::Undefined;
+    uint32_t value = 0;      // 所在节内偏移
+    uint32_t size = 0;
+    bool global = false;
+    bool function = false;   // .text 中的 .globl 符号标为 STT_FUNC，大小到下一个全局符号
+};
+
+// .text 节的重定位（RELA 形式）
+struct ElfReloc {
+    uint32_t offset = 0;
+    uint32_t type = 0;
+    std::string symbol;
+    int32_t addend = 0;
+};
+
+// 可重定位目标文件的内容：.text、.data、符号表与 .rela.text
+struct ElfObject {
+    std::vector<uint8_t> text;
+    std::vector<uint8_t> data;
+    std::vector<ElfSymbol> symbols;
+    std::vector<ElfReloc> relocs;
+    bool rvc = false;        // 含压缩指令，e_flags 置 EF_RISCV_RVC
+
+    const ElfSymbol *findSymbol(const std::string &name) const;
+};
+
+// 把 toyc 的汇编程序（含伪指令）直接编码为 RV32IMC 机器码，行为与关闭链接器松弛的
+// 汇编器一致：节内标签的分支就地解析，超出 ±4KiB 的条件分支改写为反向分支加 jal，
+// 目标越界或未定义的 c. 分支与跳转改用 32 位形式；
+// call/tail 一律生成 R_RISCV_CALL，la 生成 PCREL_HI20/LO12_I 对，未定义目标的分支生成
+// R_RISCV_BRANCH/JAL。非法指令、立即数越界等抛出 runtime_error
+ElfObject assembleObject(const std::vector<AsmInstr> &program);
+
+// 按 ELF32 小端格式（EM_RISCV, ET_REL）写出，节依次为 .text .data .rela.text .symtab .strtab .shstrtab
+void writeElf(std::ostream &out, const ElfObject &object);
+// 读回 ELF32 RISC-V 可重定位目标文件中的上述内容，用于与外部汇编器的输出比对
+ElfObject readElf(const std::string &bytes);
@@ -0,0 +1,60 @@
+#pragma once
+#include "ast.h"
+#include "callgraph.h"
+#include "profile.h"
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 内联代价模型参数，代价以 AST 节点数计
+struct InlineOptions {
+    bool enabled = true;
+    int threshold = 25;        // 允许的最大净代价（被调用者规模减去调用收益）
+    int loopMultiplier = 3;    // 循环内调用点的阈值倍数
+    int callOverhead = 6;      // 一次调用省下的固定开销（call/ret、序言尾声、参数搬运）
+    int maxCallerSize = 2000;  // 调用者膨胀上限
+    int recursiveDepth = 0;    // 递归 SCC 成员最多展开的层数，0 表示从不内联
+    bool remarks = false;      // 输出优化备注（-Rpass=inline）
+    // 有剖析时：热调用点的阈值再乘 hotMultiplier，从未执行的调用点只在代价不为正时内联
+    const ProfileData *profile = nullptr;
+    int hotMultiplier = 4;
+};
+
+// 基于调用图自底向上的函数内联：
+//   - 函数体只有一条 return 的被调用者直接代入表达式；
+//   - 其余只在末尾返回的被调用者在语句级展开，局部变量重命名以免冲突
+class Inliner {
+public:
+    explicit Inliner(const InlineOptions &options, std::ostream &remarkOut = std::cerr);
+
+    // 返回内联的调用点个数
+    int run(std::vector<std::unique_ptr<FuncDef>> &funcs);
+
+private:
+    InlineOptions opts;
+    std::ostream &remarkOut;
+    const CallGraph *graph = nullptr;
+    FuncDef *caller = nullptr;
+    int callerSize = 0;
+    int renameCount = 0;
+    int inlinedCount = 0;
+
+    struct Context {
+        int loopDepth = 0;
+        int recursionDepth = 0;
+    };
+
+    void inlineBlock(Block *block, Context ctx);
+    void inlineStmt(std::vector<std::unique_ptr<Stmt>> &stmts, size_t &index, Context ctx);
+    void inlineExpr(std::unique_ptr<Expr> &slot, Context ctx);
+    // 语句级展开，成功时把替换后的语句写回 stmts 并更新 index
+    bool inlineCallStmt(std::vector<std::unique_ptr<Stmt>> &stmts, size_t &index,
+                        CallExpr *call, Context ctx);
+
+    FuncDef *calleeOf(CallExpr *call, Context ctx, std::string &reason) const;
+    bool shouldInline(FuncDef *callee, const CallExpr *call, int cost, Context ctx, std::string &reason) const;
+    void remark(FuncDef *callee, bool inlined, const std::string &detail) const;
+
+    std::unique_ptr<Block> renameBody(FuncDef *callee, std::vector<std::string> &paramNames);
+};
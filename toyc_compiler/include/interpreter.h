@@ -0,0 +1,34 @@
+#pragma once
+#include "ast.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 直接遍历 AST 的解释器：每次求值都经 dynamic_cast 分派、按名字查作用域表。
+// 不做任何预处理，作为字节码虚拟机与 JIT 的性能参照和结果对照；整数语义与 RV32IM 一致
+class AstInterpreter {
+public:
+    explicit AstInterpreter(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+
+    int32_t run(const std::string &entry = "main", const std::vector<int32_t> &args = {});
+
+    static constexpr int kMaxDepth = 10000;  // 递归深度上限，超过时抛出 runtime_error
+
+private:
+    enum class Flow { Normal, Break, Continue, Return };
+
+    struct Env {
+        const FuncDef *func;
+        std::vector<std::unordered_map<std::string, int32_t>> scopes;
+        int32_t result = 0;
+    };
+
+    std::unordered_map<std::string, const FuncDef *> funcs;
+    int depth = 0;
+
+    int32_t call(const FuncDef *func, const std::vector<int32_t> &args);
+    int32_t eval(Env &env, const Expr *expr);
+    Flow exec(Env &env, const Stmt *stmt);
+    int32_t &lookup(Env &env, const std::string &name);
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include "ast.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 树模式匹配的指令选择（BURS）。规则表中每条规则把一棵表达式模式归约为寄存器中的值；
+// 标注时自底向上求出每个结点归约为寄存器的最小代价及所用规则，
+// 代码生成时自顶向下按选中的规则求值模式叶子、发射规则的指令模板
+
+// 非终结符：Reg 为寄存器中的值；Con 为编译期常量，不产生指令，由规则以立即数形式使用
+enum class Nonterm { Reg, Con };
+
+// Con 叶子的附加条件，同时决定模板中 $k 的取值
+enum class ImmForm {
+    Any,         // 任意常量，$hi/$lo 为 lui/addi 拆分
+    Zero,        // 0，不占用 $k
+    Imm12,       // 12 位有符号立即数，$k = K
+    NegImm12,    // -K 为 12 位立即数，$k = -K
+    Imm12Plus1,  // K+1 为 12 位立即数，$k = K+1
+    UImm12,      // 0..2047，作无符号比较的上界，$k = K
+    Pow2,        // 2 的正整数次幂，$k = log2 K
+    High,        // 低 12 位为 0，$k = K >> 12（lui 的 20 位立即数）
+};
+
+// 模式树：内部结点匹配一元或二元运算符，叶子匹配可归约为某个非终结符的任意子表达式
+struct IselPattern {
+    std::string op;                  // 空表示叶子
+    Nonterm leaf = Nonterm::Reg;
+    ImmForm imm = ImmForm::Any;      // Con 叶子的条件
+    std::vector<IselPattern> kids;
+};
+
+// 指令模板的操作数：$d 目标寄存器，$0 $1 按从左到右第几个 Reg 叶子，$k $hi $lo 取自 Con 叶子。
+// 目标寄存器可能与叶子相同，只有第一条指令可以读取叶子
+struct IselInstr {
+    std::string op;
+    std::vector<std::string> args;
+};
+
+struct IselRule {
+    std::string name;
+    IselPattern pattern;
+    int cost;                        // 约为 generic 核心上的周期数
+    std::vector<IselInstr> code;
+    std::string result = "$d";       // 结果所在：$d、$0 或 zero
+    bool sameVar = false;            // 两个 Reg 叶子须为同一变量，只求值一次
+};
+
+const std::vector<IselRule> &iselRules();
+
+// 结点的标注：归约为寄存器的最小代价与规则。rule 为 -1 时由代码生成直接处理（变量、调用、短路求值）
+struct IselLabel {
+    int cost = 0;
+    int rule = -1;
+};
+
+// 规则在结点处匹配时的叶子
+struct IselMatch {
+    std::vector<Expr *> regs;        // Reg 叶子，从左到右
+    ImmForm form = ImmForm::Zero;    // 非零条件的 Con 叶子（每条规则至多一个）
+    int32_t value = 0;
+};
+
+class InstructionSelector {
+public:
+    // 标注以 expr 为根的子树，已标注的结点直接返回
+    const IselLabel &label(Expr *expr);
+    IselMatch leaves(const IselRule &rule, Expr *expr);
+    // 结点地址在函数之间可能复用，每个函数开始时清空
+    void clear() { labels.clear(); }
+
+private:
+    std::unordered_map<const Expr *, IselLabel> labels;
+
+    bool match(const IselPattern &pattern, Expr *expr, IselMatch &match, int &cost);
+    bool matchRule(const IselRule &rule, Expr *expr, IselMatch &match, int &cost);
+};
+
+// 数字及其一元 +/- 构成的常量表达式，按 32 位回绕求值
+bool constantValue(Expr *expr, int32_t &value);
+
+// 把模板操作数替换为寄存器与立即数
+std::vector<std::string> expandOperands(const IselInstr &instr, const std::string &dest,
+                                        const std::vector<std::string> &regs, const IselMatch &match);
@@ -0,0 +1,54 @@
+#pragma once
+#include "ast.h"
+#include <csetjmp>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct JitStats {
+    int functions = 0;        // 程序中的函数数
+    int compiled = 0;         // 实际被调用、已编译的函数数
+    size_t codeBytes = 0;     // 已生成的本机代码字节数（不含桩代码）
+    double compileSeconds = 0;
+};
+
+// x86-64 即时编译执行：每个 FuncDef 在第一次被调用时才编译为本机代码，写入可执行页。
+// 函数间调用经入口表间接进行；未编译函数的表项指向桩代码，桩代码调用编译器并回填表项。
+// 整数运算语义与 RV32IM 一致：32 位回绕，除以 0 得 -1、余数为被除数，INT_MIN / -1 得 INT_MIN。
+// 只支持 x86-64 的 POSIX 主机；编译错误（如未定义的变量）在调用到该函数时以 runtime_error 报告
+class Jit {
+public:
+    explicit Jit(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+    ~Jit();
+    Jit(const Jit &) = delete;
+    Jit &operator=(const Jit &) = delete;
+
+    // 以 args 为参数调用 entry，返回其返回值
+    int32_t run(const std::string &entry = "main", const std::vector<int32_t> &args = {});
+    const JitStats &stats() const { return counters; }
+    void printStats(std::ostream &os) const;
+
+private:
+    // 可执行内存块，写入时临时改为可写
+    struct CodeChunk {
+        uint8_t *base;
+        size_t size;
+        size_t used;
+    };
+
+    std::vector<const FuncDef *> funcs;
+    std::unordered_map<std::string, int> funcIndex;
+    std::unique_ptr<void *[]> entries;      // 入口表：已编译函数的代码或其桩代码
+    std::vector<CodeChunk> chunks;
+    void *callThunk = nullptr;              // 从 C++ 调用 JIT 代码：int64 (void **entry, const int64_t *args, int64_t n)
+    JitStats counters;
+    std::jmp_buf escape;                    // 桩代码中编译失败时跳回 run
+    std::string error;
+
+    void *install(const std::vector<uint8_t> &code);
+    void *compile(int index);
+    static void *resolve(Jit *jit, int index);
+};
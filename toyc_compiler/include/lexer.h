@@ -10,6 +10,8 @@ public:
     explicit Lexer(const std::string& src);
 
     std::vector<Token> tokenize();
+    // 读出下一个 token，到达末尾后一直返回 END_OF_FILE
+    Token next();
 
 private:
     std::string source;
@@ -31,4 +33,10 @@ private:
     Token makeToken(TokenType type, const std::string& lexeme);
 };
 
+// 并行词法分析：在换行处把源码切成至多 threads 块（ToyC 的 token 不跨行，换行处总是安全的），
+// 各块在工作线程中独立扫描，再按顺序拼接并加上各块之前的行数。结果与 Lexer::tokenize 完全相同。
+// threads 为 0 时取硬件线程数；每块不足 kMinParallelChunk 字节时减少块数，小文件直接顺序扫描
+constexpr size_t kMinParallelChunk = 256 * 1024;
+std::vector<Token> tokenizeParallel(const std::string& source, unsigned threads = 0);
+
 #endif
@@ -1,15 +1,20 @@
 #pragma once
 #include "token.h"
 #include "ast.h"
+#include <functional>
 #include <vector>
 #include <memory>
 
 class Parser {
 public:
     explicit Parser(const std::vector<Token> &tokens);
+    // 流式输入：每次需要时调用 source 取下一个 token，已解析函数的 token 随即丢弃
+    explicit Parser(std::function<Token()> source);
     
     // 解析整个程序单元，返回函数定义列表
     std::vector<std::unique_ptr<FuncDef>> parseCompUnit();
+    // 解析下一个函数定义，输入结束时返回空指针
+    std::unique_ptr<FuncDef> parseNextFunc();
 
 private:
     // 表达式相关
@@ -37,15 +42,20 @@ private:
     std::unique_ptr<FuncDef> parseFuncDef();
 
     // 工具函数
-    const Token &peek() const;
+    bool available(size_t index);
+    const Token &peek();
     const Token &advance();
     bool match(TokenType type);
     bool expect(TokenType type, const char *msg);
+    // 节点的源码范围：从下标 first 的 token 到最近读入的 token
+    void setSpan(ASTNode &node, size_t first) const;
 
     // 异常抛出辅助函数（可以在实现中用来抛语法错误）
     [[noreturn]] void error(const char *msg) const;
 
 private:
+    std::function<Token()> source;
+    std::vector<Token> window;   // 流式输入已读入、尚未丢弃的 token
     const std::vector<Token> &tokens;
     size_t current = 0;
 };
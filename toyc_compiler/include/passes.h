@@ -0,0 +1,93 @@
+#pragma once
+#include "ast.h"
+#include "codegen.h"
+#include "inliner.h"
+#include "peephole.h"
+#include "riscv.h"
+#include "rvc.h"
+#include "scheduler.h"
+#include "unroll.h"
+#include <chrono>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 已注册的变换：AST 层在代码生成之前对整个程序运行一次，
+// 机器层在每个函数的指令序列生成后依次运行
+struct PassInfo {
+    enum class Kind { Ast, Machine };
+    const char *name;
+    Kind kind;
+    const char *description;
+};
+
+const std::vector<PassInfo> &registeredPasses();
+const PassInfo *findPass(const std::string &name);
+
+// 流水线配置：要运行的 pass 及其参数，以及不属于独立 pass 的代码生成特性
+struct PassOptions {
+    std::vector<std::string> pipeline;
+    std::vector<std::string> printAfter;  // "all" 表示每个 pass 之后都输出
+    InlineOptions inlining;
+    UnrollOptions unrolling;
+    CodeGenOptions codegen;
+};
+
+// -O0：不做任何变换；-O1：尾递归、窥孔与 IPRA 等廉价优化；-O2：全部（默认）
+void applyOptLevel(int level, PassOptions &options);
+// 解析 --passes= 的逗号分隔列表；未知 pass、机器层 pass 排在 AST 层之前或 compress 之后还有 pass 时抛出 runtime_error
+std::vector<std::string> parsePipeline(const std::string &list);
+
+class PassManager {
+public:
+    explicit PassManager(PassOptions &options, std::ostream &dump = std::cerr);
+
+    // 依次运行流水线中的 AST 层 pass
+    void runAstPasses(std::vector<std::unique_ptr<FuncDef>> &funcs);
+    // 依次运行机器层 pass，作为 CodeGenOptions::machinePasses 的回调
+    void runMachinePasses(const std::string &func, std::vector<AsmInstr> &code, const ClobberMap *clobbers);
+    // 把机器层 pass 接入代码生成选项
+    void attach(CodeGenOptions &codegen);
+
+    // 记录流水线之外的编译阶段（词法、语法分析等）的耗时；同名阶段（流式编译中逐个函数）累加
+    template <typename F>
+    void timePhase(const std::string &name, F &&phase) {
+        auto start = std::chrono::steady_clock::now();
+        phase();
+        recordPhase(name, elapsedSince(start));
+    }
+
+    // 各 pass 的运行次数、耗时、改动量与前后规模（AST 节点数或指令数）
+    void printStats(std::ostream &os) const;
+    const Peephole &peepholeStats() const { return peephole; }
+    const Compressor &compressStats() const { return compressor; }
+
+private:
+    struct Stats {
+        std::string name;
+        PassInfo::Kind kind;
+        int runs = 0;
+        double seconds = 0;
+        long changed = 0;
+        long sizeBefore = 0;
+        long sizeAfter = 0;
+    };
+    struct Phase {
+        std::string name;
+        int runs = 0;
+        double seconds = 0;
+    };
+
+    PassOptions &options;
+    std::ostream &dump;
+    Peephole peephole;
+    Scheduler scheduler;
+    Compressor compressor;
+    std::vector<Stats> stats;
+    std::vector<Phase> phases;
+
+    void recordPhase(const std::string &name, double seconds);
+    bool shouldPrint(const std::string &pass) const;
+    static double elapsedSince(std::chrono::steady_clock::time_point start);
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include "riscv.h"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 规则匹配时的上下文：当前函数的指令序列，以及每轮扫描开始时建立、随改写局部维护的
+// 活跃信息与标签表，规则查询时不再扫描整个函数
+struct PeepholeContext {
+    std::vector<AsmInstr> &code;
+    const ClobberMap *clobbers = nullptr;
+
+    explicit PeepholeContext(std::vector<AsmInstr> &c) : code(c) {}
+    // 寄存器在第 i 条指令之后是否不再被读取
+    bool deadAfter(size_t i, const std::string &reg);
+    // 标签所在的下标，不存在时为 code.size()
+    size_t findLabel(const std::string &name) const;
+    // 跳转与伪指令对标签的引用次数
+    int labelUses(const std::string &name) const;
+    void erase(size_t i);
+
+    // 重新计算活跃信息与标签表
+    void rebuild();
+    // 在第 i 条指令处尝试规则之前记下 window 条指令的状态；规则改写了其中前 n 条之后
+    // 调用 endRewrite，只重算改写区间的活跃信息。区间入口的活跃集合变大时才整体重算
+    void beginRewrite(size_t i, size_t window);
+    void endRewrite(size_t n);
+
+private:
+    std::vector<RegSet> liveOut;
+    bool liveValid = false;
+    std::unordered_map<std::string, size_t> labels;
+    std::unordered_map<std::string, int> uses;
+
+    size_t rewriteAt = 0, rewriteSize = 0;
+    RegSet rewriteLiveIn = 0;
+    std::vector<std::string> rewriteRefs;   // 区间内每条指令引用的标签
+    std::vector<bool> rewriteLabels;        // 区间内每个位置是否为标签
+
+    RegSet liveIn(size_t i) const;
+    RegSet successorLive(size_t i) const;
+};
+
+// 一条窥孔规则：从第 i 条指令开始查看 window 条，匹配则就地改写并返回 true
+struct PeepholeRule {
+    const char *name;
+    int window;
+    bool (*apply)(PeepholeContext &ctx, size_t i);
+};
+
+const std::vector<PeepholeRule> &peepholeRules();
+
+class Peephole {
+public:
+    Peephole();
+    // 对一个函数反复应用所有规则直到不动点，返回改写次数
+    int run(std::vector<AsmInstr> &code, const ClobberMap *clobbers = nullptr);
+    // 各规则累计命中次数
+    void printStats(std::ostream &os) const;
+    const std::vector<int> &hits() const { return hitCounts; }
+
+private:
+    std::vector<int> hitCounts;
+};
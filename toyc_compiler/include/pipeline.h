@@ -0,0 +1,97 @@
+#pragma once
+#include "ast.h"
+#include "token.h"
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 单生产者、单消费者的定长环形队列，无锁。容量取不小于给定值的 2 的幂；
+// head 与 tail 只增不减，各自只由一方写入，分处不同缓存行
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+    // 队列满时返回 false，value 不变
+    bool tryPush(T &value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size()) return false;
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列空时返回 false
+    bool tryPop(T &value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> head{0};   // 消费者下一个读取的位置
+    alignas(64) std::atomic<size_t> tail{0};   // 生产者下一个写入的位置
+};
+
+struct PipelineOptions {
+    size_t tokenBatch = 512;    // 每批 token 个数
+    size_t tokenBatches = 64;   // token 环的容量（批）
+    size_t functions = 16;      // 函数环的容量
+};
+
+// 等待次数：生产者遇到队列满、消费者遇到队列空时各记一次
+struct PipelineStats {
+    size_t tokens = 0, batches = 0, functions = 0;
+    size_t lexerStalls = 0;      // token 环满，词法分析等待语法分析
+    size_t parserStarved = 0;    // token 环空，语法分析等待词法分析
+    size_t parserStalls = 0;     // 函数环满，语法分析等待代码生成
+    size_t consumerStarved = 0;  // 函数环空，调用者等待语法分析
+
+    void print(std::ostream &os) const;
+};
+
+// 流水线前端：词法分析线程把 token 按批写入 token 环，语法分析线程从中读取，
+// 每解析完一个函数就放入函数环，由调用者线程按源码顺序取出做语义分析与代码生成。
+// 两个环都是定长的，一方跟不上时另一方等待，同时存活的 token 与函数数量有上限
+class PipelinedFrontEnd {
+public:
+    // source 由词法分析线程读取，须在对象销毁前保持有效
+    explicit PipelinedFrontEnd(const std::string &source, const PipelineOptions &options = PipelineOptions());
+    // 取消尚未完成的工作并回收线程
+    ~PipelinedFrontEnd();
+    PipelinedFrontEnd(const PipelinedFrontEnd &) = delete;
+    PipelinedFrontEnd &operator=(const PipelinedFrontEnd &) = delete;
+
+    // 取下一个函数，输入结束时返回空指针；语法错误在这里重新抛出
+    std::unique_ptr<FuncDef> next();
+    // 在 next 返回空指针之后读取
+    const PipelineStats &stats() const { return counters; }
+
+private:
+    SpscRing<std::vector<Token>> tokenRing;
+    SpscRing<std::unique_ptr<FuncDef>> funcRing;
+    std::atomic<bool> cancelled{false};
+    std::exception_ptr parseError;   // 语法分析线程写入，函数环的结束标记之后读取
+    PipelineStats counters;
+    bool finished = false;
+    std::thread lexerThread, parserThread;
+
+    void lex(const std::string &source, size_t batchSize);
+    void parse();
+};
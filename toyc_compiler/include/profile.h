@@ -0,0 +1,49 @@
+#pragma once
+#include "ast.h"
+#include "riscv.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 剖析数据文件布局（小端 32 位字）：
+//   magic, version, 计数器个数 N, 结构校验和, 计数器[N]
+// 插桩程序在 main 返回后把整块数据原样写出
+constexpr uint32_t kProfileMagic = 0x46525054;   // "TPRF"
+constexpr uint32_t kProfileVersion = 1;
+constexpr int kProfileHeaderWords = 4;
+
+// 在任何 AST 变换之前按源码顺序给函数、if、while 和调用点分配计数器编号。
+// 插桩构建与使用剖析的构建对同一源码得到相同的编号；校验和覆盖函数名与编号结构
+struct ProfileLayout {
+    int counters = 0;
+    uint32_t checksum = 2166136261u;
+};
+
+ProfileLayout assignProfileIds(std::vector<std::unique_ptr<FuncDef>> &funcs);
+// 流式编译逐个函数编号，layout 在函数之间累积；结果与整体编号相同
+void assignProfileIds(FuncDef &func, ProfileLayout &layout);
+
+// 从 --profile-use 读回的计数
+class ProfileData {
+public:
+    // 文件无法读取或格式错误时抛出 runtime_error；与当前源码的结构不符时返回空剖析并给出警告
+    static ProfileData load(const std::string &path, const ProfileLayout &layout, std::ostream &warn);
+
+    bool empty() const { return counts.empty(); }
+    bool has(int id) const { return id >= 0 && id < (int)counts.size(); }
+    uint32_t count(int id) const { return has(id) ? counts[id] : 0; }
+    // 热：达到所有计数最大值的十分之一；冷：从未执行
+    bool isHot(int id) const { return has(id) && counts[id] > 0 && (uint64_t)counts[id] * 10 >= maxCount; }
+    bool isCold(int id) const { return has(id) && counts[id] == 0; }
+
+    std::vector<uint32_t> counts;
+    uint32_t maxCount = 0;
+};
+
+// 插桩构建的运行时：计数器数据段、把数据写到 path 的 __toyc_prof_dump（Linux 系统调用），
+// 以及调用用户 main（改名为 __toyc_main）后写出剖析数据的 main
+std::vector<AsmInstr> profileRuntime(const ProfileLayout &layout, const std::string &path);
+
+constexpr const char *kProfileCounters = "__toyc_prof_counters";
+constexpr const char *kProfileUserMain = "__toyc_main";
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 一行汇编：指令、标签或伪指令（.globl 等）
+struct AsmInstr {
+    enum class Kind { Instr, Label, Directive };
+
+    Kind kind = Kind::Instr;
+    std::string op;                 // 助记符 / 标签名 / 伪指令名
+    std::vector<std::string> args;  // 操作数，访存操作数保持 "off(base)" 形式
+
+    static AsmInstr instr(const std::string &op, std::vector<std::string> args = {});
+    static AsmInstr label(const std::string &name);
+    static AsmInstr directive(const std::string &name, std::vector<std::string> args = {});
+
+    bool isInstr() const { return kind == Kind::Instr; }
+    bool isLabel() const { return kind == Kind::Label; }
+    std::string text() const;
+};
+
+// 寄存器集合，按 x0-x31 编号的位图
+using RegSet = uint32_t;
+
+inline RegSet regBit(int index) { return index > 0 ? (RegSet)1 << index : 0; }
+
+// ABI 名或 xN 转编号，非寄存器返回 -1
+int regIndex(const std::string &name);
+const char *regName(int index);
+
+std::string memOperand(int offset, const std::string &base = "sp");
+bool parseMemOperand(const std::string &operand, int &offset, std::string &base);
+
+extern const RegSet kCallerSavedSet;  // ra, t0-t6, a0-a7
+extern const RegSet kCalleeSavedSet;  // s0-s11
+extern const RegSet kArgRegSet;       // a0-a7
+extern const RegSet kExitLiveSet;     // 函数出口活跃：a0, sp, ra, s0-s11
+
+// RVC 压缩指令（c. 前缀）。下面的分类与读写集合函数对它们按展开后的 32 位形式处理
+bool isCompressed(const AsmInstr &ins);
+// 对应的 32 位指令：c.addi a0, 1 -> addi a0, a0, 1，c.jr ra -> ret；其余指令原样返回。
+// 未知的 c. 指令抛出 runtime_error
+AsmInstr expandCompressed(const AsmInstr &ins);
+
+// 控制流
+bool isCondBranch(const AsmInstr &ins);
+bool isUncondTransfer(const AsmInstr &ins);    // j / jr / ret / tail
+std::string branchTarget(const AsmInstr &ins); // 目标标签，没有则为空
+void setBranchTarget(AsmInstr &ins, const std::string &target);
+std::string invertBranch(const std::string &op);
+bool isLoad(const AsmInstr &ins);
+bool isStore(const AsmInstr &ins);
+
+// 函数名 -> 调用该函数后可能被改写的寄存器（过程间破坏集合）
+using ClobberMap = std::unordered_map<std::string, RegSet>;
+
+// 寄存器定义与使用（含 call/ret 等的隐式读写）；给出破坏集合时 call 只定义被调用者实际改写的寄存器
+RegSet regDefs(const AsmInstr &ins, const ClobberMap *clobbers = nullptr);
+RegSet regUses(const AsmInstr &ins);
+// 只写一个寄存器、可以安全删除或移动的指令
+bool isPure(const AsmInstr &ins);
+
+// 逐条指令出口处的活跃寄存器。函数出口视 a0、sp、ra 和被调用者保存寄存器为活跃
+std::vector<RegSet> computeLiveOut(const std::vector<AsmInstr> &code, const ClobberMap *clobbers = nullptr);
+
+// 函数自身代码可能改写、返回后调用者可见的寄存器：已在序言中保存恢复的除外，
+// call/tail 并入被调用者的破坏集合，未知被调用者按全部调用者保存寄存器计
+RegSet clobberSetOf(const std::vector<AsmInstr> &code, RegSet savedRegs, const ClobberMap &clobbers);
+
+void printAsm(std::ostream &out, const std::vector<AsmInstr> &code);
+// printAsm 的逆过程：按行读回标签、伪指令与指令，# 之后为注释；字符串内的逗号和 # 保持原样
+std::vector<AsmInstr> parseAsm(std::istream &in);
+// 汇编操作数：十进制/十六进制立即数（允许 32 位无符号写法），带转义的字符串字面量；非法时抛出 runtime_error
+int32_t parseImmediate(const std::string &text);
+std::string unquoteString(const std::string &text);
+
+// 单发射顺序流水线的指令延迟表（结果可被下一条指令使用前的周期数）
+struct LatencyModel {
+    const char *name;
+    int alu;
+    int load;
+    int mul;
+    int div;
+    int branch;  // 发生跳转的分支、跳转与调用额外损失的周期数
+};
+
+// 按 -mtune 名称查找，未知名称返回 nullptr
+const LatencyModel *findLatencyModel(const std::string &name);
+const std::vector<LatencyModel> &latencyModels();
+int latencyOf(const AsmInstr &ins, const LatencyModel &model);
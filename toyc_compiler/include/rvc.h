@@ -0,0 +1,37 @@
+#pragma once
+#include "riscv.h"
+#include <ostream>
+#include <vector>
+
+// 指令编码后的字节数：压缩指令 2，call/tail/la 8，li 按立即数 4 或 8，其余 4
+uint32_t encodedSize(const AsmInstr &ins);
+uint32_t codeBytes(const std::vector<AsmInstr> &code);
+
+// 不涉及分支偏移的压缩：操作数满足条件时给出 c. 形式，返回是否成功
+bool compressInstr(const AsmInstr &ins, AsmInstr &out);
+// 分支与跳转的压缩形式（不检查偏移），以及压缩后可达的偏移范围 [-range, range)
+bool compressBranch(const AsmInstr &ins, AsmInstr &out);
+int32_t compressedRange(const AsmInstr &ins);
+
+// -mrvc：把函数改写为 RVC 压缩指令。
+// 多数压缩形式只能寻址 x8-x15，先把临时寄存器改名到与之不冲突（从不同时存活）的 a0-a5 中；
+// 再压缩操作数合格的指令，分支按函数内的布局估计偏移，只压缩目标在范围内的，直到不动点。
+// 必须是最后一个机器层变换：其他变换不理解两地址的压缩形式
+class Compressor {
+public:
+    // 返回压缩的指令数
+    int run(std::vector<AsmInstr> &code, const ClobberMap *clobbers = nullptr);
+    void printStats(std::ostream &os) const;
+
+    int renamedRegs() const { return renamed; }
+    long bytesBefore() const { return before; }
+    long bytesAfter() const { return after; }
+
+private:
+    int renamed = 0;
+    int compressed = 0;
+    long before = 0;
+    long after = 0;
+
+    int renameTemps(std::vector<AsmInstr> &code, const ClobberMap *clobbers);
+};
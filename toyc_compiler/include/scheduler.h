@@ -0,0 +1,24 @@
+#pragma once
+#include "riscv.h"
+#include <vector>
+
+// 基本块内的表调度：在不改变语义的前提下重排无依赖的指令，
+// 让 load 和乘除法的结果延迟被后续无关指令填满
+class Scheduler {
+public:
+    explicit Scheduler(const LatencyModel &model);
+    // 返回按延迟模型估计减少的停顿周期数
+    int run(std::vector<AsmInstr> &code);
+    // 按单发射顺序流水线估计一段指令的执行周期数
+    int estimateCycles(const std::vector<AsmInstr> &code, size_t begin, size_t end) const;
+
+    int blocksReordered() const { return reordered; }
+    int cyclesSaved() const { return saved; }
+
+private:
+    const LatencyModel &model;
+    int reordered = 0;
+    int saved = 0;
+
+    int scheduleBlock(std::vector<AsmInstr> &code, size_t begin, size_t end);
+};
@@ -15,25 +15,50 @@ struct Symbol {
     std::vector<Type> paramTypes;
 };
 
+// 可以整体分析，也可以逐个函数分析（流式编译）：每个函数分析完即可释放，
+// 只保留函数签名表；调用尚未出现的函数时记下调用点，到 finish 时再检查
 class SemanticAnalyzer {
 public:
+    // 分析整个程序并调用 finish
     void analyze(const std::vector<std::unique_ptr<FuncDef>>& funcs);
+    // 登记签名并分析函数体，不保留指向 func 的任何引用
+    void analyzeFunction(const FuncDef* func);
+    // 检查推迟的调用点
+    void finish();
+
+    // 已报告的错误数，错误本身随时输出到 stderr
+    int errorCount() const { return errors; }
 
 private:
+    // 调用点在被调用者定义之前出现，签名未知
+    struct PendingCall {
+        std::string caller, callee;
+        size_t args = 0;
+        bool asValue = false;
+        SourceSpan span;
+    };
+
+    std::unordered_map<std::string, Symbol> functions;
+    std::vector<PendingCall> pending;
     std::vector<std::unordered_map<std::string, Symbol>> scopes;
+    std::string currentFunc;
+    int loopDepth = 0;
+    int errors = 0;
 
     void enterScope();
     void exitScope();
 
     bool declare(const std::string& name, const Symbol& symbol);
-    Symbol lookup(const std::string& name);
+    const Symbol* lookup(const std::string& name) const;
 
-    void analyzeFunc(FuncDef* func);
-    void analyzeBlock(Block* block);
-    void analyzeStmt(Stmt* stmt);
-    void analyzeExpr(Expr* expr);
+    void analyzeBlock(const Block* block);
+    void analyzeStmt(const Stmt* stmt);
+    void analyzeExpr(const Expr* expr);
+    // asValue：调用结果作为表达式的值使用，被调用者不能是 void
+    void analyzeCall(const CallExpr* call, bool asValue);
+    void checkCall(const Symbol& callee, const std::string& name, size_t args, bool asValue, const SourceSpan& span);
 
-    void reportError(const std::string& msg);
+    void reportError(const std::string& msg, const SourceSpan& span = SourceSpan());
 };
 
-#endif // SEMANTIC_H
\ No newline at end of file
+#endif // SEMANTIC_H
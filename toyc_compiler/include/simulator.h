@@ -0,0 +1,78 @@
+#pragma once
+#include "riscv.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 执行统计
+struct SimStats {
+    uint64_t instructions = 0;
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+    uint64_t branches = 0;       // 条件分支
+    uint64_t takenBranches = 0;  // 其中发生跳转的
+    uint64_t jumps = 0;          // j/jr/ret/tail 等无条件跳转（不含调用）
+    uint64_t calls = 0;
+    uint64_t cycles = 0;
+};
+
+struct SimOptions {
+    LatencyModel model = latencyModels()[0];
+    uint64_t maxSteps = 2000000000ull;  // 超过后视为死循环
+    uint32_t stackSize = 8u << 20;
+    std::string entry = "main";
+    std::ostream *out = nullptr;        // write(1/2) 的去向，默认 stdout/stderr
+};
+
+// RV32IM 汇编级模拟器：直接执行 toyc 输出的汇编文本（含伪指令），不经过二进制编码。
+// 周期按单发射顺序流水线估算：每条指令占一个发射周期，读取尚未就绪的寄存器时停顿，
+// 结果在 model 给出的延迟后就绪；分支跳转、无条件跳转与调用另加 model.branch 个周期。
+// 支持 .data/.word/.zero/.asciz 数据段，ecall 支持 openat/write/close/exit。
+// 汇编错误、非法访存或超过步数上限时抛出 runtime_error
+class Simulator {
+public:
+    explicit Simulator(const std::vector<AsmInstr> &program, const SimOptions &options = SimOptions());
+
+    // 以 args 为 a0-a7 调用入口函数，返回其 a0；调用 exit 时返回退出码
+    int32_t run(const std::vector<int32_t> &args = {});
+    const SimStats &stats() const { return counters; }
+    void printStats(std::ostream &os) const;
+
+    // 地址空间布局
+    static constexpr uint32_t kTextBase = 0x00010000;
+    static constexpr uint32_t kDataBase = 0x10000000;
+    static constexpr uint32_t kStackTop = 0x7ff00000;
+    static constexpr uint32_t kExitAddress = 0xfffffff0;  // 入口函数的返回地址
+
+    enum class Op : uint8_t;
+
+    struct Instr {
+        Op op;
+        uint8_t rd = 0, rs1 = 0, rs2 = 0;
+        int32_t imm = 0;            // 立即数、访存偏移或跳转目标地址
+        uint8_t latency = 1;
+        std::string callee = {};    // call/tail 目标，仅用于报错
+    };
+
+private:
+    SimOptions options;
+    std::vector<Instr> text;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> stack;
+    std::unordered_map<std::string, uint32_t> symbols;
+    std::unordered_map<int32_t, int> files;   // 模拟的文件描述符 -> 宿主描述符
+    int32_t nextFd = 3;
+    uint32_t regs[32] = {};
+    uint64_t ready[32] = {};
+    SimStats counters;
+    bool exited = false;
+    int32_t exitCode = 0;
+
+    void assemble(const std::vector<AsmInstr> &program);
+    uint8_t *addressOf(uint32_t addr, uint32_t size);
+    uint32_t load(uint32_t addr, uint32_t size, bool isSigned);
+    void store(uint32_t addr, uint32_t size, uint32_t value);
+    void syscall();
+};
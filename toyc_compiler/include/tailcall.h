@@ -0,0 +1,8 @@
+#pragma once
+#include "ast.h"
+#include <vector>
+
+// 尾递归转循环：函数体包进 while (1)，return f(...) 改为参数重新赋值后 continue。
+// 位于用户循环内部的自尾调用无法用 continue 回到函数入口，保持原样，由 CodeGen 以 tail 跳转处理。
+// 返回改写的调用点个数
+int eliminateTailRecursion(std::vector<std::unique_ptr<FuncDef>> &funcs);
@@ -0,0 +1,23 @@
+#pragma once
+#include "ast.h"
+#include "profile.h"
+#include <vector>
+
+// 循环展开参数，规模以 AST 节点数计
+struct UnrollOptions {
+    bool enabled = true;
+    int factor = 4;            // 部分展开的倍数，1 表示不做部分展开
+    int maxBodySize = 40;      // 参与部分展开的循环体规模上限
+    int fullBudget = 160;      // 完全展开后的规模上限（次数 × 循环体规模）
+    int maxFullTrips = 32;     // 完全展开的最大迭代次数
+    // 有剖析时：从未进入的循环不展开，平均迭代次数不足 factor 的不做部分展开，
+    // 热循环的循环体规模上限加倍
+    const ProfileData *profile = nullptr;
+};
+
+// 计数循环 while (i < N) { ...; i = i + C; } 的展开：
+//   - 迭代次数在编译期可知且展开后不超过预算时，完全展开为 N 份循环体；
+//   - 否则按 factor 展开为主循环，每次检查剩余次数是否足够 factor 轮，余下的迭代交给原循环。
+// 循环体内不得有本层的 break/continue，也不得在别处改写 i 或 N。
+// 返回展开的循环个数
+int unrollLoops(std::vector<std::unique_ptr<FuncDef>> &funcs, const UnrollOptions &options);
@@ -0,0 +1,214 @@
+#include "ast.h"
+#include <cassert>
+#include <cstdint>
+
+namespace {
+
+std::unique_ptr<Expr> cloneExprNode(const Expr *expr) {
+    if (auto num = dynamic_cast<const NumberExpr *>(expr)) {
+        return std::make_unique<NumberExpr>(num->value);
+    } else if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+        return std::make_unique<VarExpr>(var->name);
+    } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        return std::make_unique<UnaryExpr>(unary->op, cloneExpr(unary->operand.get()));
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        return std::make_unique<BinaryExpr>(bin->op, cloneExpr(bin->lhs.get()), cloneExpr(bin->rhs.get()));
+    } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+        auto copy = std::make_unique<CallExpr>(call->callee);
+        for (auto &arg : call->args) copy->args.push_back(cloneExpr(arg.get()));
+        copy->profileId = call->profileId;
+        return copy;
+    }
+    assert(false && "Unknown Expr type");
+    return nullptr;
+}
+
+std::unique_ptr<Stmt> cloneStmtNode(const Stmt *stmt) {
+    if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+        return std::make_unique<VarDeclStmt>(decl->varType, decl->name,
+            decl->initializer ? cloneExpr(decl->initializer.get()) : nullptr);
+    } else if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+        return std::make_unique<AssignStmt>(assign->name, cloneExpr(assign->value.get()));
+    } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(stmt)) {
+        return std::make_unique<ExprStmt>(cloneExpr(exprStmt->expr.get()));
+    } else if (auto ret = dynamic_cast<const ReturnStmt *>(stmt)) {
+        auto copy = std::make_unique<ReturnStmt>();
+        if (ret->expr) copy->expr = cloneExpr(ret->expr.get());
+        return copy;
+    } else if (auto block = dynamic_cast<const Block *>(stmt)) {
+        return cloneBlock(block);
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        auto copy = std::make_unique<IfStmt>(cloneExpr(ifStmt->condition.get()),
+            cloneBlock(ifStmt->thenBlock.get()),
+            ifStmt->elseBlock ? cloneBlock(ifStmt->elseBlock.get()) : nullptr);
+        copy->profileId = ifStmt->profileId;
+        return copy;
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+        auto copy = std::make_unique<WhileStmt>(cloneExpr(whileStmt->condition.get()),
+            cloneBlock(whileStmt->body.get()));
+        copy->profileId = whileStmt->profileId;
+        return copy;
+    } else if (dynamic_cast<const BreakStmt *>(stmt)) {
+        return std::make_unique<BreakStmt>();
+    } else if (dynamic_cast<const ContinueStmt *>(stmt)) {
+        return std::make_unique<ContinueStmt>();
+    }
+    assert(false && "Unknown Stmt type");
+    return nullptr;
+}
+
+}  // namespace
+
+// 深拷贝保留源码范围，内联、展开后的代码仍能对应到原始位置
+std::unique_ptr<Expr> cloneExpr(const Expr *expr) {
+    auto copy = cloneExprNode(expr);
+    copy->span = expr->span;
+    return copy;
+}
+
+std::unique_ptr<Block> cloneBlock(const Block *block) {
+    auto copy = std::make_unique<Block>();
+    for (auto &stmt : block->stmts) copy->stmts.push_back(cloneStmt(stmt.get()));
+    copy->span = block->span;
+    return copy;
+}
+
+std::unique_ptr<Stmt> cloneStmt(const Stmt *stmt) {
+    auto copy = cloneStmtNode(stmt);
+    copy->span = stmt->span;
+    return copy;
+}
+
+int countNodes(const Expr *expr) {
+    if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        return 1 + countNodes(unary->operand.get());
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        return 1 + countNodes(bin->lhs.get()) + countNodes(bin->rhs.get());
+    } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+        int n = 1;
+        for (auto &arg : call->args) n += countNodes(arg.get());
+        return n;
+    }
+    return 1;
+}
+
+int countNodes(const Stmt *stmt) {
+    if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+        return 1 + (decl->initializer ? countNodes(decl->initializer.get()) : 0);
+    } else if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+        return 1 + countNodes(assign->value.get());
+    } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(stmt)) {
+        return countNodes(exprStmt->expr.get());
+    } else if (auto ret = dynamic_cast<const ReturnStmt *>(stmt)) {
+        return 1 + (ret->expr ? countNodes(ret->expr.get()) : 0);
+    } else if (auto block = dynamic_cast<const Block *>(stmt)) {
+        int n = 0;
+        for (auto &s : block->stmts) n += countNodes(s.get());
+        return n;
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        return 1 + countNodes(ifStmt->condition.get()) + countNodes(ifStmt->thenBlock.get()) +
+               (ifStmt->elseBlock ? countNodes(ifStmt->elseBlock.get()) : 0);
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+        return 1 + countNodes(whileStmt->condition.get()) + countNodes(whileStmt->body.get());
+    }
+    return 1;
+}
+
+static void printExpr(std::ostream &os, const Expr *expr) {
+    if (auto num = dynamic_cast<const NumberExpr *>(expr)) {
+        if (num->value == INT32_MIN) os << "(-2147483647 - 1)";
+        else if (num->value < 0) os << "(" << num->value << ")";
+        else os << num->value;
+    } else if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+        os << var->name;
+    } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        os << unary->op << "(";
+        printExpr(os, unary->operand.get());
+        os << ")";
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        os << "(";
+        printExpr(os, bin->lhs.get());
+        os << " " << bin->op << " ";
+        printExpr(os, bin->rhs.get());
+        os << ")";
+    } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+        os << call->callee << "(";
+        for (size_t i = 0; i < call->args.size(); i++) {
+            if (i) os << ", ";
+            printExpr(os, call->args[i].get());
+        }
+        os << ")";
+    } else {
+        assert(false && "Unknown Expr type");
+    }
+}
+
+static void printStmt(std::ostream &os, const Stmt *stmt, int depth);
+
+static void printBlock(std::ostream &os, const Block *block, int depth) {
+    os << "{\n";
+    for (auto &s : block->stmts) printStmt(os, s.get(), depth + 1);
+    os << std::string(depth * 4, ' ') << "}";
+}
+
+static void printStmt(std::ostream &os, const Stmt *stmt, int depth) {
+    os << std::string(depth * 4, ' ');
+    if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+        os << decl->varType << " " << decl->name;
+        if (decl->initializer) {
+            os << " = ";
+            printExpr(os, decl->initializer.get());
+        }
+        os << ";";
+    } else if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+        os << assign->name << " = ";
+        printExpr(os, assign->value.get());
+        os << ";";
+    } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(stmt)) {
+        printExpr(os, exprStmt->expr.get());
+        os << ";";
+    } else if (auto ret = dynamic_cast<const ReturnStmt *>(stmt)) {
+        os << "return";
+        if (ret->expr) {
+            os << " ";
+            printExpr(os, ret->expr.get());
+        }
+        os << ";";
+    } else if (auto block = dynamic_cast<const Block *>(stmt)) {
+        printBlock(os, block, depth);
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        os << "if (";
+        printExpr(os, ifStmt->condition.get());
+        os << ") ";
+        printBlock(os, ifStmt->thenBlock.get(), depth);
+        if (ifStmt->elseBlock) {
+            os << " else ";
+            printBlock(os, ifStmt->elseBlock.get(), depth);
+        }
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+        os << "while (";
+        printExpr(os, whileStmt->condition.get());
+        os << ") ";
+        printBlock(os, whileStmt->body.get(), depth);
+    } else if (dynamic_cast<const BreakStmt *>(stmt)) {
+        os << "break;";
+    } else if (dynamic_cast<const ContinueStmt *>(stmt)) {
+        os << "continue;";
+    } else {
+        assert(false && "Unknown Stmt type");
+    }
+    os << "\n";
+}
+
+void printSource(std::ostream &os, const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    for (auto &func : funcs) {
+        os << func->retType << " " << func->name << "(";
+        for (size_t i = 0; i < func->params.size(); i++) {
+            if (i) os << ", ";
+            os << func->params[i].type << " " << func->params[i].name;
+        }
+        os << ") ";
+        if (func->body) printBlock(os, func->body.get(), 0);
+        os << "\n";
+    }
+}
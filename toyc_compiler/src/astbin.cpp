@@ -0,0 +1,461 @@
+#include "astbin.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TOYC_HAVE_MMAP 1
+#endif
+
+namespace {
+
+const char kMagic[8] = {'T', 'O', 'Y', 'C', 'A', 'S', 'T', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrder = 0x01020304;
+
+const char *const kOpNames[] = {"", "+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||", "!"};
+
+AstBinOp opCode(const std::string &op) {
+    for (size_t i = 1; i < sizeof(kOpNames) / sizeof(kOpNames[0]); i++) {
+        if (op == kOpNames[i]) return (AstBinOp)i;
+    }
+    throw std::runtime_error("Cannot serialize operator " + op);
+}
+
+std::string opName(AstBinOp op) {
+    if ((size_t)op >= sizeof(kOpNames) / sizeof(kOpNames[0]) || op == AstBinOp::None) {
+        throw std::runtime_error("Malformed AST file: bad operator code");
+    }
+    return kOpNames[(size_t)op];
+}
+
+uint32_t align4(uint32_t offset) { return (offset + 3) & ~3u; }
+
+class Writer {
+public:
+    std::vector<std::string> strings;
+    std::vector<AstBinNode> nodes;
+    std::vector<uint32_t> children;
+    std::vector<uint32_t> functions;
+
+    void addFunction(const FuncDef *func) {
+        std::vector<uint32_t> kids;
+        for (auto &param : func->params) {
+            AstBinNode node = make(AstBinKind::Param, *func);
+            node.value = intern(param.name);
+            node.aux = intern(param.type);
+            kids.push_back(add(node, {}));
+        }
+        if (func->body) kids.push_back(stmt(func->body.get()));
+        AstBinNode node = make(AstBinKind::Func, *func);
+        node.value = intern(func->name);
+        node.aux = intern(func->retType);
+        node.profileId = func->profileId;
+        functions.push_back(add(node, kids));
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> interned;
+
+    uint32_t intern(const std::string &text) {
+        auto it = interned.emplace(text, (uint32_t)strings.size());
+        if (it.second) strings.push_back(text);
+        return it.first->second;
+    }
+
+    static AstBinNode make(AstBinKind kind, const ASTNode &source) {
+        AstBinNode node{};
+        node.kind = kind;
+        node.profileId = -1;
+        node.line = (uint32_t)source.span.line;
+        node.endLine = (uint32_t)source.span.endLine;
+        node.column = (uint16_t)std::min(source.span.column, 0xffff);
+        node.endColumn = (uint16_t)std::min(source.span.endColumn, 0xffff);
+        return node;
+    }
+
+    uint32_t add(AstBinNode node, const std::vector<uint32_t> &kids) {
+        if (kids.size() > 0xffff) throw std::runtime_error("Cannot serialize a node with more than 65535 children");
+        node.childCount = (uint16_t)kids.size();
+        node.firstChild = (uint32_t)children.size();
+        children.insert(children.end(), kids.begin(), kids.end());
+        nodes.push_back(node);
+        return (uint32_t)nodes.size() - 1;
+    }
+
+    uint32_t expr(const Expr *e) {
+        std::vector<uint32_t> kids;
+        if (auto num = dynamic_cast<const NumberExpr *>(e)) {
+            AstBinNode node = make(AstBinKind::Number, *e);
+            node.value = (uint32_t)num->value;
+            return add(node, kids);
+        } else if (auto var = dynamic_cast<const VarExpr *>(e)) {
+            AstBinNode node = make(AstBinKind::Var, *e);
+            node.value = intern(var->name);
+            return add(node, kids);
+        } else if (auto unary = dynamic_cast<const UnaryExpr *>(e)) {
+            kids.push_back(expr(unary->operand.get()));
+            AstBinNode node = make(AstBinKind::Unary, *e);
+            node.op = opCode(unary->op);
+            return add(node, kids);
+        } else if (auto bin = dynamic_cast<const BinaryExpr *>(e)) {
+            kids.push_back(expr(bin->lhs.get()));
+            kids.push_back(expr(bin->rhs.get()));
+            AstBinNode node = make(AstBinKind::Binary, *e);
+            node.op = opCode(bin->op);
+            return add(node, kids);
+        } else if (auto call = dynamic_cast<const CallExpr *>(e)) {
+            for (auto &arg : call->args) kids.push_back(expr(arg.get()));
+            AstBinNode node = make(AstBinKind::Call, *e);
+            node.value = intern(call->callee);
+            node.profileId = call->profileId;
+            return add(node, kids);
+        }
+        throw std::runtime_error("Cannot serialize unknown expression");
+    }
+
+    uint32_t stmt(const Stmt *s) {
+        std::vector<uint32_t> kids;
+        if (auto block = dynamic_cast<const Block *>(s)) {
+            for (auto &child : block->stmts) kids.push_back(stmt(child.get()));
+            return add(make(AstBinKind::Block, *s), kids);
+        } else if (auto ret = dynamic_cast<const ReturnStmt *>(s)) {
+            if (ret->expr) kids.push_back(expr(ret->expr.get()));
+            return add(make(AstBinKind::Return, *s), kids);
+        } else if (auto decl = dynamic_cast<const VarDeclStmt *>(s)) {
+            if (decl->initializer) kids.push_back(expr(decl->initializer.get()));
+            AstBinNode node = make(AstBinKind::VarDecl, *s);
+            node.value = intern(decl->name);
+            node.aux = intern(decl->varType);
+            return add(node, kids);
+        } else if (auto assign = dynamic_cast<const AssignStmt *>(s)) {
+            kids.push_back(expr(assign->value.get()));
+            AstBinNode node = make(AstBinKind::Assign, *s);
+            node.value = intern(assign->name);
+            return add(node, kids);
+        } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(s)) {
+            if (exprStmt->expr) kids.push_back(expr(exprStmt->expr.get()));
+            return add(make(AstBinKind::ExprStmt, *s), kids);
+        } else if (auto ifStmt = dynamic_cast<const IfStmt *>(s)) {
+            kids.push_back(expr(ifStmt->condition.get()));
+            kids.push_back(stmt(ifStmt->thenBlock.get()));
+            if (ifStmt->elseBlock) kids.push_back(stmt(ifStmt->elseBlock.get()));
+            AstBinNode node = make(AstBinKind::If, *s);
+            node.profileId = ifStmt->profileId;
+            return add(node, kids);
+        } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(s)) {
+            kids.push_back(expr(whileStmt->condition.get()));
+            kids.push_back(stmt(whileStmt->body.get()));
+            AstBinNode node = make(AstBinKind::While, *s);
+            node.profileId = whileStmt->profileId;
+            return add(node, kids);
+        } else if (dynamic_cast<const BreakStmt *>(s)) {
+            return add(make(AstBinKind::Break, *s), kids);
+        } else if (dynamic_cast<const ContinueStmt *>(s)) {
+            return add(make(AstBinKind::Continue, *s), kids);
+        }
+        throw std::runtime_error("Cannot serialize unknown statement");
+    }
+};
+
+template <typename T>
+void writeArray(std::ostream &out, const std::vector<T> &values) {
+    if (!values.empty()) out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+}
+
+// 重建过程中参数暂存在栈上，拼装 FuncDef 时取出
+struct ParamNode : ASTNode {
+    FuncDef::Param param;
+};
+
+// 栈上的子树连同节点种类，取出时按种类检查后直接转换，不需要 dynamic_cast
+struct Subtree {
+    AstBinKind kind;
+    std::unique_ptr<ASTNode> node;
+};
+
+[[noreturn]] void malformed(const char *what) {
+    throw std::runtime_error(std::string("Malformed AST file: ") + what);
+}
+
+bool isExprKind(AstBinKind kind) { return kind >= AstBinKind::Number && kind <= AstBinKind::Call; }
+bool isStmtKind(AstBinKind kind) { return kind >= AstBinKind::Block && kind <= AstBinKind::Continue; }
+
+template <typename T>
+std::unique_ptr<T> take(Subtree &tree, bool valid, const char *what) {
+    if (!valid) malformed(what);
+    return std::unique_ptr<T>(static_cast<T *>(tree.node.release()));
+}
+
+std::unique_ptr<Expr> takeExpr(Subtree &tree) {
+    return take<Expr>(tree, isExprKind(tree.kind), "expected an expression");
+}
+std::unique_ptr<Stmt> takeStmt(Subtree &tree) {
+    return take<Stmt>(tree, isStmtKind(tree.kind), "expected a statement");
+}
+std::unique_ptr<Block> takeBlock(Subtree &tree) {
+    return take<Block>(tree, tree.kind == AstBinKind::Block, "expected a block");
+}
+
+}  // namespace
+
+void writeAstBin(std::ostream &out, const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    Writer writer;
+    for (auto &func : funcs) writer.addFunction(func.get());
+
+    std::vector<uint32_t> offsets;
+    std::string data;
+    for (auto &text : writer.strings) {
+        offsets.push_back((uint32_t)data.size());
+        data += text;
+        data += '\0';
+    }
+    offsets.push_back((uint32_t)data.size());
+    data.resize(align4((uint32_t)data.size()), '\0');
+
+    AstBinHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.stringCount = (uint32_t)writer.strings.size();
+    header.stringOffsets = sizeof(AstBinHeader);
+    header.stringData = header.stringOffsets + (uint32_t)(offsets.size() * sizeof(uint32_t));
+    header.stringDataSize = offsets.back();
+    header.nodeCount = (uint32_t)writer.nodes.size();
+    header.nodes = header.stringData + (uint32_t)data.size();
+    header.childCount = (uint32_t)writer.children.size();
+    header.children = header.nodes + header.nodeCount * (uint32_t)sizeof(AstBinNode);
+    header.functionCount = (uint32_t)writer.functions.size();
+    header.functions = header.children + header.childCount * (uint32_t)sizeof(uint32_t);
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeArray(out, offsets);
+    out.write(data.data(), data.size());
+    writeArray(out, writer.nodes);
+    writeArray(out, writer.children);
+    writeArray(out, writer.functions);
+}
+
+AstBinView::AstBinView(const void *data, size_t size)
+    : base(static_cast<const uint8_t *>(data)), size(size), header(nullptr) {
+    if (size < sizeof(AstBinHeader) || reinterpret_cast<uintptr_t>(base) % alignof(AstBinHeader) != 0) {
+        malformed("truncated header");
+    }
+    header = reinterpret_cast<const AstBinHeader *>(base);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) malformed("bad magic");
+    if (header->byteOrder != kByteOrder) throw std::runtime_error("AST file was written with a different byte order");
+    if (header->version != kVersion) throw std::runtime_error("Unsupported AST file version");
+    section<uint32_t>(header->stringOffsets, (uint64_t)header->stringCount + 1);
+    section<char>(header->stringData, header->stringDataSize);
+    section<AstBinNode>(header->nodes, header->nodeCount);
+    section<uint32_t>(header->children, header->childCount);
+    section<uint32_t>(header->functions, header->functionCount);
+}
+
+template <typename T>
+const T *AstBinView::section(uint32_t offset, uint64_t count) const {
+    if (offset % alignof(T) != 0 || offset > size || count * sizeof(T) > size - offset) malformed("section out of bounds");
+    return reinterpret_cast<const T *>(base + offset);
+}
+
+const AstBinNode &AstBinView::node(uint32_t index) const {
+    if (index >= header->nodeCount) malformed("node index out of range");
+    return reinterpret_cast<const AstBinNode *>(base + header->nodes)[index];
+}
+
+const AstBinNode &AstBinView::function(uint32_t index) const {
+    if (index >= header->functionCount) malformed("function index out of range");
+    return node(reinterpret_cast<const uint32_t *>(base + header->functions)[index]);
+}
+
+const AstBinNode &AstBinView::child(const AstBinNode &parent, uint32_t index) const {
+    if (index >= parent.childCount || (uint64_t)parent.firstChild + index >= header->childCount) {
+        malformed("child index out of range");
+    }
+    return node(reinterpret_cast<const uint32_t *>(base + header->children)[parent.firstChild + index]);
+}
+
+const char *AstBinView::string(uint32_t index) const {
+    if (index >= header->stringCount) malformed("string index out of range");
+    const uint32_t *offsets = reinterpret_cast<const uint32_t *>(base + header->stringOffsets);
+    const char *data = reinterpret_cast<const char *>(base + header->stringData);
+    if (offsets[index] >= offsets[index + 1] || offsets[index + 1] > header->stringDataSize ||
+        data[offsets[index + 1] - 1] != '\0') {
+        malformed("bad string table");
+    }
+    return data + offsets[index];
+}
+
+std::vector<std::unique_ptr<FuncDef>> readAstBin(const AstBinView &view) {
+    // 节点为后序：每个节点的子节点恰好是栈顶的 childCount 棵子树
+    std::vector<Subtree> stack;
+    for (uint32_t i = 0; i < view.nodeCount(); i++) {
+        const AstBinNode &bin = view.node(i);
+        size_t n = bin.childCount;
+        if (n > stack.size()) malformed("missing children");
+        Subtree *kids = stack.data() + (stack.size() - n);
+        auto expect = [&](size_t low, size_t high) {
+            if (n < low || n > high) malformed("wrong number of children");
+        };
+
+        std::unique_ptr<ASTNode> node;
+        switch (bin.kind) {
+        case AstBinKind::Number:
+            expect(0, 0);
+            node = std::make_unique<NumberExpr>((int32_t)bin.value);
+            break;
+        case AstBinKind::Var:
+            expect(0, 0);
+            node = std::make_unique<VarExpr>(view.string(bin.value));
+            break;
+        case AstBinKind::Unary:
+            expect(1, 1);
+            node = std::make_unique<UnaryExpr>(opName(bin.op), takeExpr(kids[0]));
+            break;
+        case AstBinKind::Binary:
+            expect(2, 2);
+            node = std::make_unique<BinaryExpr>(opName(bin.op), takeExpr(kids[0]), takeExpr(kids[1]));
+            break;
+        case AstBinKind::Call: {
+            auto call = std::make_unique<CallExpr>(view.string(bin.value));
+            call->args.reserve(n);
+            for (size_t k = 0; k < n; k++) call->args.push_back(takeExpr(kids[k]));
+            call->profileId = bin.profileId;
+            node = std::move(call);
+            break;
+        }
+        case AstBinKind::Block: {
+            auto block = std::make_unique<Block>();
+            block->stmts.reserve(n);
+            for (size_t k = 0; k < n; k++) block->stmts.push_back(takeStmt(kids[k]));
+            node = std::move(block);
+            break;
+        }
+        case AstBinKind::Return: {
+            expect(0, 1);
+            auto ret = std::make_unique<ReturnStmt>();
+            if (n) ret->expr = takeExpr(kids[0]);
+            node = std::move(ret);
+            break;
+        }
+        case AstBinKind::VarDecl:
+            expect(0, 1);
+            node = std::make_unique<VarDeclStmt>(view.string(bin.aux), view.string(bin.value),
+                                                 n ? takeExpr(kids[0]) : nullptr);
+            break;
+        case AstBinKind::Assign:
+            expect(1, 1);
+            node = std::make_unique<AssignStmt>(view.string(bin.value), takeExpr(kids[0]));
+            break;
+        case AstBinKind::ExprStmt:
+            expect(0, 1);
+            node = std::make_unique<ExprStmt>(n ? takeExpr(kids[0]) : nullptr);
+            break;
+        case AstBinKind::If: {
+            expect(2, 3);
+            auto ifStmt = std::make_unique<IfStmt>(takeExpr(kids[0]), takeBlock(kids[1]),
+                                                   n == 3 ? takeBlock(kids[2]) : nullptr);
+            ifStmt->profileId = bin.profileId;
+            node = std::move(ifStmt);
+            break;
+        }
+        case AstBinKind::While: {
+            expect(2, 2);
+            auto whileStmt = std::make_unique<WhileStmt>(takeExpr(kids[0]), takeBlock(kids[1]));
+            whileStmt->profileId = bin.profileId;
+            node = std::move(whileStmt);
+            break;
+        }
+        case AstBinKind::Break:
+            expect(0, 0);
+            node = std::make_unique<BreakStmt>();
+            break;
+        case AstBinKind::Continue:
+            expect(0, 0);
+            node = std::make_unique<ContinueStmt>();
+            break;
+        case AstBinKind::Param: {
+            expect(0, 0);
+            auto param = std::make_unique<ParamNode>();
+            param->param = FuncDef::Param(view.string(bin.aux), view.string(bin.value));
+            node = std::move(param);
+            break;
+        }
+        case AstBinKind::Func: {
+            auto func = std::make_unique<FuncDef>(view.string(bin.aux), view.string(bin.value));
+            size_t k = 0;
+            for (; k < n && kids[k].kind == AstBinKind::Param; k++) {
+                func->params.push_back(std::move(static_cast<ParamNode *>(kids[k].node.get())->param));
+            }
+            if (k + 1 < n) malformed("unexpected function child");
+            if (k < n) func->body = takeBlock(kids[k]);
+            func->profileId = bin.profileId;
+            node = std::move(func);
+            break;
+        }
+        default:
+            malformed("unknown node kind");
+        }
+        node->span.line = (int)bin.line;
+        node->span.column = bin.column;
+        node->span.endLine = (int)bin.endLine;
+        node->span.endColumn = bin.endColumn;
+        stack.resize(stack.size() - n);
+        stack.push_back({bin.kind, std::move(node)});
+    }
+
+    if (stack.size() != view.functionCount()) malformed("function count mismatch");
+    std::vector<std::unique_ptr<FuncDef>> funcs;
+    for (auto &tree : stack) {
+        funcs.push_back(take<FuncDef>(tree, tree.kind == AstBinKind::Func, "top-level node is not a function"));
+    }
+    return funcs;
+}
+
+MappedFile::MappedFile(const std::string &path) {
+#ifdef TOYC_HAVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open file " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot stat file " + path);
+    }
+    length = (size_t)st.st_size;
+    if (length > 0) {
+        void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            bytes = addr;
+            mapped = true;
+        }
+    }
+    close(fd);
+    if (mapped || length == 0) return;
+#endif
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Cannot open file " + path);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    const std::string text = contents.str();
+    buffer.assign(text.begin(), text.end());
+    bytes = buffer.data();
+    length = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef TOYC_HAVE_MMAP
+    if (mapped) munmap(const_cast<void *>(bytes), length);
+#endif
+}
+
+std::vector<std::unique_ptr<FuncDef>> loadAstBin(const std::string &path) {
+    MappedFile file(path);
+    return readAstBin(AstBinView(file.data(), file.size()));
+}
@@ -0,0 +1,537 @@
+#include "bytecode.h"
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+
+// RV32IM 语义：32 位回绕，除以 0 得 -1、余数为被除数，INT_MIN / -1 不溢出
+inline int32_t wrapAdd(int32_t x, int32_t y) { return (int32_t)((uint32_t)x + (uint32_t)y); }
+inline int32_t wrapSub(int32_t x, int32_t y) { return (int32_t)((uint32_t)x - (uint32_t)y); }
+inline int32_t wrapMul(int32_t x, int32_t y) { return (int32_t)((uint32_t)x * (uint32_t)y); }
+inline int32_t divide(int32_t x, int32_t y) {
+    if (y == 0) return -1;
+    if (y == -1) return (int32_t)(0u - (uint32_t)x);
+    return x / y;
+}
+inline int32_t remainder(int32_t x, int32_t y) {
+    if (y == 0) return x;
+    if (y == -1) return 0;
+    return x % y;
+}
+
+bool isRelOp(const std::string &op) {
+    return op == "<" || op == ">" || op == "<=" || op == ">=" || op == "==" || op == "!=";
+}
+
+// 交换比较的两个操作数
+std::string swapRelOp(const std::string &op) {
+    if (op == "<") return ">";
+    if (op == ">") return "<";
+    if (op == "<=") return ">=";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+// 比较结果取反
+std::string negateRelOp(const std::string &op) {
+    if (op == "<") return ">=";
+    if (op == ">") return "<=";
+    if (op == "<=") return ">";
+    if (op == ">=") return "<";
+    if (op == "==") return "!=";
+    return "==";
+}
+
+const NumberExpr *asNumber(const Expr *expr) { return dynamic_cast<const NumberExpr *>(expr); }
+
+class FuncCompiler {
+public:
+    FuncCompiler(const FuncDef *func, const std::unordered_map<std::string, int> &index,
+                 const std::vector<std::unique_ptr<FuncDef>> &funcs)
+        : func(func), index(index), funcs(funcs) {}
+
+    BcFunction compile() {
+        BcFunction out;
+        out.name = func->name;
+        out.params = (int)func->params.size();
+        scopes.emplace_back();
+        for (auto &param : func->params) bindVariable(param.name, allocate());
+        if (func->body) genBlock(func->body.get());
+        emit(BcOp::RetK, 0, 0);
+        for (auto &f : fixups) code[f.first].c = labels[f.second];
+        out.registers = maxTop;
+        out.code = std::move(code);
+        return out;
+    }
+
+private:
+    const FuncDef *func;
+    const std::unordered_map<std::string, int> &index;
+    const std::vector<std::unique_ptr<FuncDef>> &funcs;
+    std::vector<BcInstr> code;
+    std::vector<std::unordered_map<std::string, int>> scopes;
+    std::vector<bool> variable;                    // 寄存器当前是否绑定了变量
+    int top = 0;
+    int maxTop = 0;
+    std::vector<int> labels;
+    std::vector<std::pair<size_t, int>> fixups;    // {指令位置, 标签}
+    std::vector<std::pair<int, int>> loops;        // {continue 目标, break 目标}
+
+    int allocate() {
+        if (top >= 0xffff) throw std::runtime_error("Too many registers in function " + func->name);
+        maxTop = std::max(maxTop, top + 1);
+        if ((int)variable.size() <= top) variable.resize(top + 1);
+        return top++;
+    }
+
+    void bindVariable(const std::string &name, int reg) {
+        scopes.back()[name] = reg;
+        variable[reg] = true;
+    }
+
+    void emit(BcOp op, int a, int32_t b, int32_t c = 0) { code.push_back({op, (uint16_t)a, b, c}); }
+
+    int newLabel() {
+        labels.push_back(-1);
+        return (int)labels.size() - 1;
+    }
+    void bind(int label) { labels[label] = (int)code.size(); }
+    void emitJump(BcOp op, int a, int32_t b, int label) {
+        fixups.push_back({code.size(), label});
+        emit(op, a, b);
+    }
+
+    int lookup(const std::string &name) const {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end()) return found->second;
+        }
+        throw std::runtime_error("Undefined variable: " + name + " in function " + func->name);
+    }
+
+    // 变量直接使用其寄存器，其他表达式算到新的临时寄存器；临时寄存器由调用者恢复 top 释放
+    int operand(const Expr *expr) {
+        if (auto var = dynamic_cast<const VarExpr *>(expr)) return lookup(var->name);
+        int reg = allocate();
+        genExpr(expr, reg);
+        return reg;
+    }
+
+    // 第一个求值的操作数：dst 不是变量时先借来存放它，省掉一个临时寄存器
+    int operandInto(const Expr *expr, int dst) {
+        if (variable[dst] || dynamic_cast<const VarExpr *>(expr)) return operand(expr);
+        genExpr(expr, dst);
+        return dst;
+    }
+
+    // 把 expr 的值写入 dst。dst 只在最后一条指令写入，因此可以是表达式中读到的变量
+    void genExpr(const Expr *expr, int dst) {
+        int saved = top;
+        if (auto num = asNumber(expr)) {
+            emit(BcOp::LoadK, dst, num->value);
+        } else if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+            int reg = lookup(var->name);
+            if (reg != dst) emit(BcOp::Move, dst, reg);
+        } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+            if (unary->op == "+") {
+                genExpr(unary->operand.get(), dst);
+            } else {
+                int reg = operandInto(unary->operand.get(), dst);
+                emit(unary->op == "-" ? BcOp::Neg : BcOp::Not, dst, reg);
+            }
+        } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+            genBinary(bin, dst);
+        } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+            auto it = index.find(call->callee);
+            if (it == index.end()) throw std::runtime_error("Undefined function: " + call->callee);
+            if (funcs[it->second]->params.size() != call->args.size()) {
+                throw std::runtime_error("Wrong argument count in call to " + call->callee);
+            }
+            // 实参依次放在栈顶的连续寄存器中，即被调用者帧的 r0 起
+            int base = top;
+            for (size_t i = 0; i < call->args.size(); i++) allocate();
+            for (size_t i = 0; i < call->args.size(); i++) genExpr(call->args[i].get(), base + (int)i);
+            emit(BcOp::Call, dst, it->second, base);
+        } else {
+            throw std::runtime_error("Unsupported expression in function " + func->name);
+        }
+        top = saved;
+    }
+
+    void genBinary(const BinaryExpr *bin, int dst) {
+        const std::string &op = bin->op;
+        if (op == "&&" || op == "||") {
+            int skip = newLabel(), done = newLabel();
+            branch(bin, false, skip);
+            emit(BcOp::LoadK, dst, 1);
+            emitJump(BcOp::Jmp, 0, 0, done);
+            bind(skip);
+            emit(BcOp::LoadK, dst, 0);
+            bind(done);
+            return;
+        }
+        const Expr *lhs = bin->lhs.get(), *rhs = bin->rhs.get();
+        std::string actual = op;
+        // 常量放到右边：可交换运算与比较可以交换左右操作数
+        if (asNumber(lhs) && !asNumber(rhs) && (op == "+" || op == "*" || isRelOp(op))) {
+            std::swap(lhs, rhs);
+            actual = swapRelOp(op);
+        }
+        if (auto num = asNumber(rhs)) {
+            int reg = operandInto(lhs, dst);
+            int32_t k = num->value;
+            if (actual == "+") emit(BcOp::AddK, dst, reg, k);
+            else if (actual == "-") emit(BcOp::AddK, dst, reg, (int32_t)(0u - (uint32_t)k));
+            else if (actual == "*") emit(BcOp::MulK, dst, reg, k);
+            else if (actual == "/") emit(BcOp::DivK, dst, reg, k);
+            else if (actual == "%") emit(BcOp::RemK, dst, reg, k);
+            else if (actual == "<") emit(BcOp::LtK, dst, reg, k);
+            else if (actual == "<=") emit(BcOp::LeK, dst, reg, k);
+            else if (actual == ">") emit(BcOp::GtK, dst, reg, k);
+            else if (actual == ">=") emit(BcOp::GeK, dst, reg, k);
+            else if (actual == "==") emit(BcOp::EqK, dst, reg, k);
+            else if (actual == "!=") emit(BcOp::NeK, dst, reg, k);
+            else throw std::runtime_error("Unsupported operator: " + op);
+            return;
+        }
+        int left = operandInto(lhs, dst);
+        int right = operand(rhs);
+        if (actual == "+") emit(BcOp::Add, dst, left, right);
+        else if (actual == "-") emit(BcOp::Sub, dst, left, right);
+        else if (actual == "*") emit(BcOp::Mul, dst, left, right);
+        else if (actual == "/") emit(BcOp::Div, dst, left, right);
+        else if (actual == "%") emit(BcOp::Rem, dst, left, right);
+        else if (actual == "<") emit(BcOp::Lt, dst, left, right);
+        else if (actual == "<=") emit(BcOp::Le, dst, left, right);
+        else if (actual == ">") emit(BcOp::Lt, dst, right, left);
+        else if (actual == ">=") emit(BcOp::Le, dst, right, left);
+        else if (actual == "==") emit(BcOp::Eq, dst, left, right);
+        else if (actual == "!=") emit(BcOp::Ne, dst, left, right);
+        else throw std::runtime_error("Unsupported operator: " + op);
+    }
+
+    // 当 expr 的真值等于 when 时跳到 label；比较与跳转合并为一条指令
+    void branch(const Expr *expr, bool when, int label) {
+        int saved = top;
+        if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+            if (bin->op == "&&" || bin->op == "||") {
+                bool isAnd = bin->op == "&&";
+                if (isAnd != when) {
+                    branch(bin->lhs.get(), when, label);
+                    branch(bin->rhs.get(), when, label);
+                } else {
+                    int skip = newLabel();
+                    branch(bin->lhs.get(), !when, skip);
+                    branch(bin->rhs.get(), when, label);
+                    bind(skip);
+                }
+                return;
+            }
+            if (isRelOp(bin->op)) {
+                const Expr *lhs = bin->lhs.get(), *rhs = bin->rhs.get();
+                std::string op = when ? bin->op : negateRelOp(bin->op);
+                if (asNumber(lhs) && !asNumber(rhs)) {
+                    std::swap(lhs, rhs);
+                    op = swapRelOp(op);
+                }
+                if (auto num = asNumber(rhs)) {
+                    int reg = operand(lhs);
+                    BcOp jop = op == "<" ? BcOp::JLtK : op == "<=" ? BcOp::JLeK : op == ">" ? BcOp::JGtK
+                             : op == ">=" ? BcOp::JGeK : op == "==" ? BcOp::JEqK : BcOp::JNeK;
+                    emitJump(jop, reg, num->value, label);
+                } else {
+                    int left = operand(lhs);
+                    int right = operand(rhs);
+                    if (op == ">" || op == ">=") {
+                        std::swap(left, right);
+                        op = swapRelOp(op);
+                    }
+                    BcOp jop = op == "<" ? BcOp::JLt : op == "<=" ? BcOp::JLe : op == "==" ? BcOp::JEq : BcOp::JNe;
+                    emitJump(jop, left, right, label);
+                }
+                top = saved;
+                return;
+            }
+        }
+        if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+            if (unary->op == "!") {
+                branch(unary->operand.get(), !when, label);
+                return;
+            }
+        }
+        if (auto num = asNumber(expr)) {
+            if ((num->value != 0) == when) emitJump(BcOp::Jmp, 0, 0, label);
+            return;
+        }
+        int reg = operand(expr);
+        emitJump(when ? BcOp::JNZ : BcOp::JZ, reg, 0, label);
+        top = saved;
+    }
+
+    void genBlock(const Block *block) {
+        scopes.emplace_back();
+        int saved = top;
+        for (auto &stmt : block->stmts) genStmt(stmt.get());
+        for (auto &entry : scopes.back()) variable[entry.second] = false;
+        top = saved;
+        scopes.pop_back();
+    }
+
+    void genStmt(const Stmt *stmt) {
+        if (auto block = dynamic_cast<const Block *>(stmt)) {
+            genBlock(block);
+        } else if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+            // 先求初值再绑定名字：初值中同名的变量指外层的那个
+            int reg = allocate();
+            if (decl->initializer) genExpr(decl->initializer.get(), reg);
+            else emit(BcOp::LoadK, reg, 0);
+            bindVariable(decl->name, reg);
+        } else if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+            genExpr(assign->value.get(), lookup(assign->name));
+        } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(stmt)) {
+            if (exprStmt->expr) {
+                int saved = top;
+                genExpr(exprStmt->expr.get(), allocate());
+                top = saved;
+            }
+        } else if (auto ret = dynamic_cast<const ReturnStmt *>(stmt)) {
+            if (!ret->expr) {
+                emit(BcOp::RetK, 0, 0);
+            } else if (auto num = asNumber(ret->expr.get())) {
+                emit(BcOp::RetK, 0, num->value);
+            } else {
+                int saved = top;
+                emit(BcOp::Ret, operand(ret->expr.get()), 0);
+                top = saved;
+            }
+        } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+            int elseLabel = newLabel(), endLabel = newLabel();
+            branch(ifStmt->condition.get(), false, elseLabel);
+            genBlock(ifStmt->thenBlock.get());
+            if (ifStmt->elseBlock) {
+                emitJump(BcOp::Jmp, 0, 0, endLabel);
+                bind(elseLabel);
+                genBlock(ifStmt->elseBlock.get());
+            } else {
+                bind(elseLabel);
+            }
+            bind(endLabel);
+        } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+            // 条件放在循环体之后，每轮只分派一次条件跳转
+            int bodyLabel = newLabel(), checkLabel = newLabel(), endLabel = newLabel();
+            emitJump(BcOp::Jmp, 0, 0, checkLabel);
+            bind(bodyLabel);
+            loops.push_back({checkLabel, endLabel});
+            genBlock(whileStmt->body.get());
+            loops.pop_back();
+            bind(checkLabel);
+            branch(whileStmt->condition.get(), true, bodyLabel);
+            bind(endLabel);
+        } else if (dynamic_cast<const BreakStmt *>(stmt)) {
+            if (loops.empty()) throw std::runtime_error("break outside of a loop in function " + func->name);
+            emitJump(BcOp::Jmp, 0, 0, loops.back().second);
+        } else if (dynamic_cast<const ContinueStmt *>(stmt)) {
+            if (loops.empty()) throw std::runtime_error("continue outside of a loop in function " + func->name);
+            emitJump(BcOp::Jmp, 0, 0, loops.back().first);
+        } else {
+            throw std::runtime_error("Unsupported statement in function " + func->name);
+        }
+    }
+};
+
+const char *opName(BcOp op) {
+    static const char *names[] = {
+        "loadk", "move", "neg", "not", "add", "sub", "mul", "div", "rem",
+        "addk", "mulk", "divk", "remk", "lt", "le", "eq", "ne",
+        "ltk", "lek", "gtk", "gek", "eqk", "nek", "jmp",
+        "jlt", "jle", "jeq", "jne", "jltk", "jlek", "jgtk", "jgek", "jeqk", "jnek",
+        "jz", "jnz", "call", "ret", "retk",
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == (size_t)BcOp::Count, "opcode table out of sync");
+    return names[(size_t)op];
+}
+
+}  // namespace
+
+BcModule compileBytecode(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    BcModule module;
+    for (size_t i = 0; i < funcs.size(); i++) {
+        if (!module.index.emplace(funcs[i]->name, (int)i).second) {
+            throw std::runtime_error("Duplicate function: " + funcs[i]->name);
+        }
+    }
+    for (auto &func : funcs) {
+        FuncCompiler compiler(func.get(), module.index, funcs);
+        module.functions.push_back(compiler.compile());
+    }
+    return module;
+}
+
+void printBytecode(std::ostream &os, const BcModule &module) {
+    for (auto &func : module.functions) {
+        os << func.name << ": params " << func.params << ", registers " << func.registers << "\n";
+        for (size_t pc = 0; pc < func.code.size(); pc++) {
+            const BcInstr &in = func.code[pc];
+            os << std::setw(6) << pc << "  " << std::left << std::setw(6) << opName(in.op) << std::right;
+            switch (in.op) {
+            case BcOp::LoadK: os << "r" << in.a << ", " << in.b; break;
+            case BcOp::Move: case BcOp::Neg: case BcOp::Not: os << "r" << in.a << ", r" << in.b; break;
+            case BcOp::Add: case BcOp::Sub: case BcOp::Mul: case BcOp::Div: case BcOp::Rem:
+            case BcOp::Lt: case BcOp::Le: case BcOp::Eq: case BcOp::Ne:
+                os << "r" << in.a << ", r" << in.b << ", r" << in.c;
+                break;
+            case BcOp::AddK: case BcOp::MulK: case BcOp::DivK: case BcOp::RemK:
+            case BcOp::LtK: case BcOp::LeK: case BcOp::GtK: case BcOp::GeK: case BcOp::EqK: case BcOp::NeK:
+                os << "r" << in.a << ", r" << in.b << ", " << in.c;
+                break;
+            case BcOp::Jmp: os << in.c; break;
+            case BcOp::JLt: case BcOp::JLe: case BcOp::JEq: case BcOp::JNe:
+                os << "r" << in.a << ", r" << in.b << ", " << in.c;
+                break;
+            case BcOp::JLtK: case BcOp::JLeK: case BcOp::JGtK: case BcOp::JGeK: case BcOp::JEqK: case BcOp::JNeK:
+                os << "r" << in.a << ", " << in.b << ", " << in.c;
+                break;
+            case BcOp::JZ: case BcOp::JNZ: os << "r" << in.a << ", " << in.c; break;
+            case BcOp::Call: os << "r" << in.a << ", " << module.functions[in.b].name << ", r" << in.c; break;
+            case BcOp::Ret: os << "r" << in.a; break;
+            case BcOp::RetK: os << in.b; break;
+            case BcOp::Count: break;
+            }
+            os << "\n";
+        }
+    }
+}
+
+Vm::Vm(const BcModule &module, const VmOptions &options)
+    : module(module), registers(options.registerFileSize), frames(options.maxFrames) {}
+
+int32_t Vm::run(const std::string &entry, const std::vector<int32_t> &args) {
+    auto it = module.index.find(entry);
+    if (it == module.index.end()) throw std::runtime_error("Undefined function: " + entry);
+    const BcFunction *func = &module.functions[it->second];
+    if ((size_t)func->params != args.size()) throw std::runtime_error("Wrong argument count for " + entry);
+    if ((size_t)func->registers > registers.size()) throw std::runtime_error("VM stack overflow");
+
+    int32_t *const limit = registers.data() + registers.size();
+    Frame *const firstFrame = frames.data();
+    Frame *const lastFrame = frames.data() + frames.size();
+    Frame *frame = firstFrame;
+    int32_t *r = registers.data();
+    for (size_t i = 0; i < args.size(); i++) r[i] = args[i];
+    const BcInstr *pc = func->code.data();
+    const BcInstr *in;
+    int32_t value;
+
+#if defined(__GNUC__)
+    // 线索化分派：每个处理例程末尾直接跳到下一条指令的例程，分支预测按指令位置区分
+    static const void *const handlers[] = {
+        &&op_LoadK, &&op_Move, &&op_Neg, &&op_Not, &&op_Add, &&op_Sub, &&op_Mul, &&op_Div, &&op_Rem,
+        &&op_AddK, &&op_MulK, &&op_DivK, &&op_RemK, &&op_Lt, &&op_Le, &&op_Eq, &&op_Ne,
+        &&op_LtK, &&op_LeK, &&op_GtK, &&op_GeK, &&op_EqK, &&op_NeK, &&op_Jmp,
+        &&op_JLt, &&op_JLe, &&op_JEq, &&op_JNe, &&op_JLtK, &&op_JLeK, &&op_JGtK, &&op_JGeK, &&op_JEqK, &&op_JNeK,
+        &&op_JZ, &&op_JNZ, &&op_Call, &&op_Ret, &&op_RetK,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == (size_t)BcOp::Count, "handler table out of sync");
+#define VM_DISPATCH() \
+    do { \
+        in = pc++; \
+        goto *handlers[(size_t)in->op]; \
+    } while (0)
+#define VM_CASE(name) op_##name:
+#define VM_LOOP VM_DISPATCH();
+#define VM_LOOP_END
+#else
+#define VM_DISPATCH() continue
+#define VM_CASE(name) case BcOp::name:
+#define VM_LOOP \
+    for (;;) { \
+        in = pc++; \
+        switch (in->op) {
+#define VM_LOOP_END \
+        case BcOp::Count: break; \
+        } \
+    }
+#endif
+
+// 回到调用者的帧，把返回值写入调用指令的目标寄存器；最外层返回时结束
+#define VM_RETURN() \
+    { \
+        if (frame == firstFrame) return value; \
+        --frame; \
+        func = frame->func; \
+        pc = frame->returnPc; \
+        r = frame->base; \
+        r[frame->dest] = value; \
+    } \
+    VM_DISPATCH()
+
+    VM_LOOP
+    VM_CASE(LoadK) r[in->a] = in->b; VM_DISPATCH();
+    VM_CASE(Move) r[in->a] = r[in->b]; VM_DISPATCH();
+    VM_CASE(Neg) r[in->a] = wrapSub(0, r[in->b]); VM_DISPATCH();
+    VM_CASE(Not) r[in->a] = r[in->b] == 0; VM_DISPATCH();
+    VM_CASE(Add) r[in->a] = wrapAdd(r[in->b], r[in->c]); VM_DISPATCH();
+    VM_CASE(Sub) r[in->a] = wrapSub(r[in->b], r[in->c]); VM_DISPATCH();
+    VM_CASE(Mul) r[in->a] = wrapMul(r[in->b], r[in->c]); VM_DISPATCH();
+    VM_CASE(Div) r[in->a] = divide(r[in->b], r[in->c]); VM_DISPATCH();
+    VM_CASE(Rem) r[in->a] = remainder(r[in->b], r[in->c]); VM_DISPATCH();
+    VM_CASE(AddK) r[in->a] = wrapAdd(r[in->b], in->c); VM_DISPATCH();
+    VM_CASE(MulK) r[in->a] = wrapMul(r[in->b], in->c); VM_DISPATCH();
+    VM_CASE(DivK) r[in->a] = divide(r[in->b], in->c); VM_DISPATCH();
+    VM_CASE(RemK) r[in->a] = remainder(r[in->b], in->c); VM_DISPATCH();
+    VM_CASE(Lt) r[in->a] = r[in->b] < r[in->c]; VM_DISPATCH();
+    VM_CASE(Le) r[in->a] = r[in->b] <= r[in->c]; VM_DISPATCH();
+    VM_CASE(Eq) r[in->a] = r[in->b] == r[in->c]; VM_DISPATCH();
+    VM_CASE(Ne) r[in->a] = r[in->b] != r[in->c]; VM_DISPATCH();
+    VM_CASE(LtK) r[in->a] = r[in->b] < in->c; VM_DISPATCH();
+    VM_CASE(LeK) r[in->a] = r[in->b] <= in->c; VM_DISPATCH();
+    VM_CASE(GtK) r[in->a] = r[in->b] > in->c; VM_DISPATCH();
+    VM_CASE(GeK) r[in->a] = r[in->b] >= in->c; VM_DISPATCH();
+    VM_CASE(EqK) r[in->a] = r[in->b] == in->c; VM_DISPATCH();
+    VM_CASE(NeK) r[in->a] = r[in->b] != in->c; VM_DISPATCH();
+    VM_CASE(Jmp) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JLt) if (r[in->a] < r[in->b]) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JLe) if (r[in->a] <= r[in->b]) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JEq) if (r[in->a] == r[in->b]) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JNe) if (r[in->a] != r[in->b]) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JLtK) if (r[in->a] < in->b) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JLeK) if (r[in->a] <= in->b) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JGtK) if (r[in->a] > in->b) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JGeK) if (r[in->a] >= in->b) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JEqK) if (r[in->a] == in->b) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JNeK) if (r[in->a] != in->b) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JZ) if (r[in->a] == 0) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(JNZ) if (r[in->a] != 0) pc = func->code.data() + in->c; VM_DISPATCH();
+    VM_CASE(Call) {
+        // 被调用者的帧从实参所在的寄存器开始
+        const BcFunction *callee = &module.functions[in->b];
+        int32_t *calleeBase = r + in->c;
+        if (frame + 1 == lastFrame || calleeBase + callee->registers > limit) {
+            throw std::runtime_error("VM stack overflow in call to " + callee->name);
+        }
+        *frame++ = {func, pc, r, in->a};
+        counters.calls++;
+        counters.maxDepth = std::max(counters.maxDepth, (size_t)(frame - firstFrame));
+        func = callee;
+        r = calleeBase;
+        pc = func->code.data();
+        VM_DISPATCH();
+    }
+    VM_CASE(Ret) value = r[in->a]; VM_RETURN();
+    VM_CASE(RetK) value = in->b; VM_RETURN();
+    VM_LOOP_END
+
+#undef VM_DISPATCH
+#undef VM_CASE
+#undef VM_LOOP
+#undef VM_LOOP_END
+#undef VM_RETURN
+}
+
+void Vm::printStats(std::ostream &os) const {
+    size_t instrs = 0;
+    for (auto &func : module.functions) instrs += func.code.size();
+    os << "vm: " << module.functions.size() << " functions, " << instrs << " instructions ("
+       << instrs * sizeof(BcInstr) << " bytes), " << counters.calls << " calls, max depth "
+       << counters.maxDepth << "\n";
+}
@@ -0,0 +1,158 @@
+#include "callgraph.h"
+#include <algorithm>
+#include <functional>
+
+CallGraph::CallGraph(const std::vector<std::unique_ptr<FuncDef>> &fs) {
+    for (auto &f : fs) {
+        nameIndex.emplace(f->name, funcs.size());
+        funcs.push_back(f.get());
+    }
+    edges.resize(funcs.size());
+    siteCounts.resize(funcs.size());
+    for (size_t i = 0; i < funcs.size(); i++) {
+        if (funcs[i]->body) collectCalls(i, funcs[i]->body.get());
+    }
+    computeSccs();
+}
+
+int CallGraph::indexOf(const std::string &name) const {
+    auto it = nameIndex.find(name);
+    return it == nameIndex.end() ? -1 : (int)it->second;
+}
+
+std::vector<bool> CallGraph::reachableFrom(size_t root) const {
+    std::vector<bool> reached(funcs.size(), false);
+    std::vector<size_t> work = {root};
+    reached[root] = true;
+    while (!work.empty()) {
+        size_t f = work.back();
+        work.pop_back();
+        for (size_t callee : edges[f]) {
+            if (!reached[callee]) {
+                reached[callee] = true;
+                work.push_back(callee);
+            }
+        }
+    }
+    return reached;
+}
+
+int CallGraph::callSiteCount(size_t caller, size_t callee) const {
+    auto it = siteCounts[caller].find(callee);
+    return it == siteCounts[caller].end() ? 0 : it->second;
+}
+
+void CallGraph::collectCalls(size_t caller, Expr *expr) {
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        collectCalls(caller, bin->lhs.get());
+        collectCalls(caller, bin->rhs.get());
+    } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        collectCalls(caller, unary->operand.get());
+    } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
+        int callee = indexOf(call->callee);
+        if (callee >= 0) {
+            if (siteCounts[caller][callee]++ == 0) edges[caller].push_back(callee);
+        }
+        for (auto &arg : call->args) collectCalls(caller, arg.get());
+    }
+}
+
+void CallGraph::collectCalls(size_t caller, Stmt *stmt) {
+    if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
+        if (decl->initializer) collectCalls(caller, decl->initializer.get());
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        collectCalls(caller, assign->value.get());
+    } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+        collectCalls(caller, exprStmt->expr.get());
+    } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        if (ret->expr) collectCalls(caller, ret->expr.get());
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        for (auto &s : block->stmts) collectCalls(caller, s.get());
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        collectCalls(caller, ifStmt->condition.get());
+        collectCalls(caller, ifStmt->thenBlock.get());
+        if (ifStmt->elseBlock) collectCalls(caller, ifStmt->elseBlock.get());
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        collectCalls(caller, whileStmt->condition.get());
+        collectCalls(caller, whileStmt->body.get());
+    }
+}
+
+// Tarjan 算法，分量按逆拓扑序产生，正好是自底向上的顺序
+void CallGraph::computeSccs() {
+    size_t n = funcs.size();
+    std::vector<int> order(n, -1), low(n, 0);
+    std::vector<bool> onStack(n, false);
+    std::vector<size_t> stack;
+    int counter = 0;
+    sccIndex.assign(n, -1);
+    recursive.assign(n, false);
+
+    std::function<void(size_t)> visit = [&](size_t v) {
+        order[v] = low[v] = counter++;
+        stack.push_back(v);
+        onStack[v] = true;
+        for (size_t w : edges[v]) {
+            if (order[w] < 0) {
+                visit(w);
+                low[v] = std::min(low[v], low[w]);
+            } else if (onStack[w]) {
+                low[v] = std::min(low[v], order[w]);
+            }
+        }
+        if (low[v] == order[v]) {
+            std::vector<size_t> component;
+            size_t w;
+            do {
+                w = stack.back();
+                stack.pop_back();
+                onStack[w] = false;
+                sccIndex[w] = (int)components.size();
+                component.push_back(w);
+            } while (w != v);
+            bool cyclic = component.size() > 1 || siteCounts[v].count(v);
+            for (size_t f : component) recursive[f] = cyclic;
+            components.push_back(std::move(component));
+        }
+    };
+
+    for (size_t v = 0; v < n; v++) {
+        if (order[v] < 0) visit(v);
+    }
+}
+
+int eliminateDeadFunctions(std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    CallGraph graph(funcs);
+    int root = graph.indexOf("main");
+    if (root < 0) return 0;
+    std::vector<bool> live = graph.reachableFrom(root);
+    size_t kept = 0;
+    for (size_t i = 0; i < funcs.size(); i++) {
+        // 重名的后一个定义不在调用图中，留给语义分析报错
+        if (live[i] || graph.indexOf(funcs[i]->name) != (int)i) funcs[kept++] = std::move(funcs[i]);
+    }
+    int removed = (int)(funcs.size() - kept);
+    funcs.resize(kept);
+    return removed;
+}
+
+void printCallGraph(std::ostream &os, const CallGraph &graph) {
+    int root = graph.indexOf("main");
+    std::vector<bool> live = root >= 0 ? graph.reachableFrom(root) : std::vector<bool>(graph.size(), true);
+    int dead = (int)std::count(live.begin(), live.end(), false);
+    os << "call graph: " << graph.size() << " functions, " << graph.size() - dead << " reachable from main, "
+       << dead << " dead\n";
+    for (size_t i = 0; i < graph.size(); i++) {
+        os << "  " << graph.func(i)->name;
+        if (graph.isRecursive(i)) os << " [recursive]";
+        if (!live[i]) os << " [dead]";
+        const char *sep = " -> ";
+        for (size_t callee : graph.callees(i)) {
+            os << sep << graph.func(callee)->name;
+            int sites = graph.callSiteCount(i, callee);
+            if (sites > 1) os << " x" << sites;
+            sep = ", ";
+        }
+        os << "\n";
+    }
+}
@@ -1,144 +1,888 @@
 #include "codegen.h"
 #include "ast.h"
+#include "riscv.h"
+#include "callgraph.h"
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <stdexcept>
 
-CodeGen::CodeGen(std::ostream &os) : out(os), labelCount(0) {}
+static const LatencyModel &tuneModel(const std::string &tune) {
+    const LatencyModel *model = findLatencyModel(tune);
+    if (!model) throw std::runtime_error("Unknown -mtune value: " + tune);
+    return *model;
+}
+
+CodeGen::CodeGen(std::ostream &os, const CodeGenOptions &opts)
+    : out(os), options(opts), labelCount(0), scheduler(tuneModel(opts.tune)) {}
 
 void CodeGen::generate(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
-    for (const auto &f : funcs) {
-        genFunc(f.get());
+    printAsm(out, lower(funcs));
+}
+
+// 按调用图自底向上生成，调用点可用上被调用者的破坏集合；输出仍保持源码顺序
+std::vector<AsmInstr> CodeGen::lower(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    CallGraph graph(funcs);
+    std::vector<std::vector<AsmInstr>> code(funcs.size());
+    clobbers.clear();
+    for (auto &scc : graph.sccs()) {
+        for (size_t f : scc) code[f] = lowerFunction(funcs[f].get());
+    }
+    std::vector<AsmInstr> program;
+    for (auto &c : code) program.insert(program.end(), c.begin(), c.end());
+    if (options.profileGenerate) {
+        auto runtime = profileRuntime(options.profileLayout, options.profilePath);
+        program.insert(program.end(), runtime.begin(), runtime.end());
+    }
+    return program;
+}
+
+std::vector<AsmInstr> CodeGen::lowerFunction(FuncDef *func) {
+    std::vector<AsmInstr> code = genFunc(func);
+    if (options.ipra) {
+        RegSet saved = 0;
+        for (auto &r : frame.savedRegs) saved |= regBit(regIndex(r));
+        clobbers[func->name] = clobberSetOf(code, saved, clobbers);
+    }
+    if (options.costReport) {
+        options.costReport->add(estimateCost(func->name, code, options.costReport->latencyModel(),
+                                             frame.frameSize(), frame.localOffset()));
+    }
+    return code;
+}
+
+void CodeGen::generateFunction(FuncDef *func) {
+    printAsm(out, lowerFunction(func));
+}
+
+void CodeGen::finishStream(const ProfileLayout &layout) {
+    if (options.profileGenerate) printAsm(out, profileRuntime(layout, options.profilePath));
+}
+
+// 调用 callee 后可能被改写的寄存器；尚未生成（同一递归环内）或关闭时按调用约定全部计入
+RegSet CodeGen::clobbersOf(const std::string &callee) const {
+    auto it = clobbers.find(callee);
+    return options.ipra && it != clobbers.end() ? it->second : kCallerSavedSet;
+}
+
+void CodeGen::emit(const std::string &op, std::vector<std::string> args) {
+    body.push_back(AsmInstr::instr(op, std::move(args)));
+}
+
+void CodeGen::emitLabel(const std::string &label) {
+    body.push_back(AsmInstr::label(label));
+}
+
+// 序言与尾声在栈帧确定后才能生成，函数体中先放占位标记
+static const char *kPrologueMarker = "#prologue";
+static const char *kEpilogueMarker = "#epilogue";
+
+void CodeGen::emitEpilogue(const std::string &tailCallee) {
+    if (beforePrologue && tailCallee.empty()) {
+        emit("ret");
+    } else {
+        body.push_back(AsmInstr::directive(kEpilogueMarker, {tailCallee}));
     }
 }
 
-void CodeGen::emit(const std::string &code) {
-    out << "\t" << code << "\n";
+// return f(...) 且实参都能经寄存器传递时可作为尾调用
+CallExpr *CodeGen::tailCallOf(ReturnStmt *ret) const {
+    if (!options.tailCalls || !ret->expr || beforePrologue) return nullptr;
+    auto call = dynamic_cast<CallExpr *>(ret->expr.get());
+    return call && call->args.size() <= 8 ? call : nullptr;
 }
 
 std::string CodeGen::newLabel(const std::string &base) {
     return base + "_" + std::to_string(labelCount++);
 }
 
+static const char *kTempRegs[] = {"t0", "t1", "t2", "t3", "t4", "t5", "t6"};
+static const int kNumTempRegs = sizeof(kTempRegs) / sizeof(kTempRegs[0]);
+
+std::string CodeGen::allocTemp() {
+    if (tempUsed.empty()) tempUsed.assign(kNumTempRegs, false);
+    for (int i = 0; i < kNumTempRegs; i++) {
+        if (!tempUsed[i]) {
+            tempUsed[i] = true;
+            return kTempRegs[i];
+        }
+    }
+    throw std::runtime_error("Expression too complex: out of temporary registers");
+}
+
+void CodeGen::freeTemp(const std::string &reg) {
+    for (int i = 0; i < kNumTempRegs; i++) {
+        if (reg == kTempRegs[i]) tempUsed[i] = false;
+    }
+}
+
+bool CodeGen::isTemp(const std::string &reg) const {
+    for (int i = 0; i < kNumTempRegs; i++) {
+        if (reg == kTempRegs[i]) return true;
+    }
+    return false;
+}
+
+// 二元运算的目标寄存器：优先复用左右操作数所占的临时寄存器
+std::string CodeGen::destFor(const std::string &lhs, const std::string &rhs) {
+    if (isTemp(lhs)) {
+        freeTemp(rhs);
+        return lhs;
+    }
+    if (isTemp(rhs)) return rhs;
+    return allocTemp();
+}
+
+int CodeGen::freeTemps() const {
+    if (tempUsed.empty()) return kNumTempRegs;
+    return (int)std::count(tempUsed.begin(), tempUsed.end(), false);
+}
+
+// 暂存槽位于跨调用保存区之后，按栈式分配
+int CodeGen::pushStage(const std::string &reg) {
+    int index = kNumTempRegs + stageDepth++;
+    frame.spillSlots = std::max(frame.spillSlots, index + 1);
+    int offset = frame.spillOffset() + index * 4;
+    emit("sw", {reg, memOperand(offset)});
+    freeTemp(reg);
+    return offset;
+}
+
+void CodeGen::popStage() {
+    stageDepth--;
+}
+
+// 计数器加一：la/lw/addi/sw。临时寄存器不足时借用在用的，计数后从暂存槽恢复
+void CodeGen::emitCounter(int profileId) {
+    if (profileId < 0) return;
+    std::vector<std::pair<int, int>> borrowed;
+    while (freeTemps() < 2) {
+        int i = kNumTempRegs - 1;
+        while (!tempUsed[i]) i--;
+        borrowed.push_back({i, pushStage(kTempRegs[i])});
+    }
+    std::string addr = allocTemp();
+    std::string value = allocTemp();
+    emit("la", {addr, std::string(kProfileCounters) + "+" + std::to_string(profileId * 4)});
+    emit("lw", {value, memOperand(0, addr)});
+    emit("addi", {value, value, "1"});
+    emit("sw", {value, memOperand(0, addr)});
+    freeTemp(value);
+    freeTemp(addr);
+    for (auto it = borrowed.rbegin(); it != borrowed.rend(); ++it) {
+        tempUsed[it->first] = true;
+        emit("lw", {kTempRegs[it->first], memOperand(it->second)});
+        popStage();
+    }
+}
+
+// 插桩构建中用户的 main 改名，由运行时的 main 调用
+std::string CodeGen::symbolFor(const std::string &func) const {
+    return options.profileGenerate && func == "main" ? kProfileUserMain : func;
+}
+
+// 依次求值两个操作数；临时寄存器将耗尽时先把左操作数暂存到栈上
+std::pair<std::string, std::string> CodeGen::genOperands(Expr *lhsExpr, Expr *rhsExpr) {
+    std::string lhs = genExpr(lhsExpr);
+    int staged = -1;
+    if (isTemp(lhs) && freeTemps() < 2) staged = pushStage(lhs);
+    std::string rhs = genExpr(rhsExpr);
+    if (staged >= 0) {
+        lhs = allocTemp();
+        emit("lw", {lhs, memOperand(staged)});
+        popStage();
+    }
+    return {lhs, rhs};
+}
+
+static bool isRelOp(const std::string &op) {
+    return op == "<" || op == ">" || op == "<=" || op == ">=" || op == "==" || op == "!=";
+}
+
 std::string CodeGen::genExpr(Expr *expr) {
-    if (auto num = dynamic_cast<NumberExpr *>(expr)) {
-        emit("li a0, " + std::to_string(num->value));
-        return "a0";
-    } else if (auto var = dynamic_cast<VarExpr *>(expr)) {
-        assert(localVarOffset.count(var->name));
-        int offset = localVarOffset[var->name];
-        emit("lw a0, " + std::to_string(offset) + "(sp)");
-        return "a0";
+    int rule = isel.label(expr).rule;
+    if (rule >= 0) return genRule(iselRules()[rule], expr);
+
+    if (auto var = dynamic_cast<VarExpr *>(expr)) {
+        return loadVar(var->name);
     } else if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
-        genExpr(bin->lhs.get());
-        emit("mv t0, a0");
-        genExpr(bin->rhs.get());
-
-        if (bin->op == "+") {
-            emit("add a0, t0, a0");
-        } else if (bin->op == "-") {
-            emit("sub a0, t0, a0");
-        } else if (bin->op == "*") {
-            emit("mul a0, t0, a0");
-        } else if (bin->op == "/") {
-            emit("div a0, t0, a0");
-        } else if (bin->op == "%") {
-            emit("rem a0, t0, a0");
+        assert((bin->op == "&&" || bin->op == "||") && "Binary operator without selection rule");
+        // 短路求值：左操作数已能决定结果时跳过右操作数
+        std::string endLabel = newLabel(bin->op == "&&" ? "land" : "lor");
+        std::string lhs = genExpr(bin->lhs.get());
+        std::string rd = destFor(lhs, "");
+        emit("snez", {rd, lhs});
+        emit(bin->op == "&&" ? "beqz" : "bnez", {rd, endLabel});
+        std::string rhs = genExpr(bin->rhs.get());
+        emit("snez", {rd, rhs});
+        freeTemp(rhs);
+        emitLabel(endLabel);
+        return rd;
+    } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
+        if (options.profileGenerate) emitCounter(call->profileId);
+        genCallArgs(call);
+
+        // 调用期间仍存活、且会被被调用者改写的临时值存入溢出槽
+        RegSet clobbered = clobbersOf(call->callee);
+        std::vector<int> live;
+        for (int i = 0; i < (int)tempUsed.size(); i++) {
+            if (tempUsed[i] && (clobbered & regBit(regIndex(kTempRegs[i])))) live.push_back(i);
+        }
+        for (int i : live) {
+            frame.spillSlots = std::max(frame.spillSlots, i + 1);
+            emit("sw", {kTempRegs[i], memOperand(frame.spillOffset() + i * 4)});
+        }
+        emit("call", {symbolFor(call->callee)});
+        for (int i : live) {
+            emit("lw", {kTempRegs[i], memOperand(frame.spillOffset() + i * 4)});
+        }
+
+        std::string rd = allocTemp();
+        emit("mv", {rd, "a0"});
+        return rd;
+    }
+    assert(false && "Unknown Expr type");
+    return "zero";
+}
+
+std::string CodeGen::genRule(const IselRule &rule, Expr *expr) {
+    IselMatch match = isel.leaves(rule, expr);
+    std::vector<std::string> regs;
+    if (match.regs.size() == 2 && !rule.sameVar) {
+        auto [lhs, rhs] = genOperands(match.regs[0], match.regs[1]);
+        regs = {lhs, rhs};
+    } else if (!match.regs.empty()) {
+        regs.assign(match.regs.size(), genExpr(match.regs[0]));
+    }
+    if (rule.result == "zero") return "zero";
+    if (rule.result == "$0") return regs[0];
+
+    std::string rd;
+    if (regs.empty()) rd = allocTemp();
+    else rd = destFor(regs[0], regs.size() == 2 && !rule.sameVar ? regs[1] : "");
+    for (const IselInstr &instr : rule.code) emit(instr.op, expandOperands(instr, rd, regs, match));
+    return rd;
+}
+
+// 求值实参并放入 a0-a7，超过 8 个的写入出栈参数区
+void CodeGen::genCallArgs(CallExpr *call) {
+    // 实参较多、临时寄存器不足时，先逐个暂存到栈上
+    size_t argc = call->args.size();
+    bool staged = (int)argc + 1 > freeTemps();
+    std::vector<std::string> argRegs(argc);
+    std::vector<int> stageSlots(argc);
+    for (size_t i = 0; i < argc; i++) {
+        std::string reg = genExpr(call->args[i].get());
+        if (staged) {
+            stageSlots[i] = pushStage(reg);
         } else {
-            assert(false && "Unsupported binary operator");
+            argRegs[i] = reg;
         }
-        return "a0";
-    } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
-        for (size_t i = 0; i < call->args.size(); i++) {
-            genExpr(call->args[i].get());
-            emit("mv a" + std::to_string(i) + ", a0");
+    }
+    // 实参若直接取自 a 寄存器中的变量，先复制到临时寄存器，避免搬运时互相覆盖
+    for (size_t i = 0; i < argc && !staged; i++) {
+        if (argRegs[i][0] == 'a' && argRegs[i] != "a" + std::to_string(i)) {
+            std::string tmp = allocTemp();
+            emit("mv", {tmp, argRegs[i]});
+            argRegs[i] = tmp;
         }
-        emit("call " + call->callee);
-        return "a0";
+    }
+    for (size_t i = argc; i-- > 0;) {
+        std::string reg = argRegs[i];
+        if (staged) {
+            reg = i < 8 ? "a" + std::to_string(i) : allocTemp();
+            emit("lw", {reg, memOperand(stageSlots[i])});
+            popStage();
+        }
+        if (i < 8) {
+            if (!staged && reg != "a" + std::to_string(i)) emit("mv", {"a" + std::to_string(i), reg});
+        } else {
+            emit("sw", {reg, memOperand((int)(i - 8) * 4)});
+        }
+        freeTemp(reg);
+    }
+}
+
+// if 转换只接受短小、无调用、无除法的表达式：两边都会被求值，
+// 除法延迟远高于一次分支预测失败
+static bool isCheapArm(Expr *expr, int &budget) {
+    if (--budget < 0) return false;
+    if (dynamic_cast<NumberExpr *>(expr) || dynamic_cast<VarExpr *>(expr)) return true;
+    if (auto unary = dynamic_cast<UnaryExpr *>(expr)) return isCheapArm(unary->operand.get(), budget);
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        if (bin->op == "/" || bin->op == "%" || bin->op == "&&" || bin->op == "||") return false;
+        return isCheapArm(bin->lhs.get(), budget) && isCheapArm(bin->rhs.get(), budget);
+    }
+    return false;
+}
+
+static AssignStmt *singleAssign(Block *block) {
+    if (!block || block->stmts.size() != 1) return nullptr;
+    return dynamic_cast<AssignStmt *>(block->stmts[0].get());
+}
+
+// 结果本身就是 0/1 的条件
+static bool isBoolExpr(Expr *expr) {
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        return isRelOp(bin->op) || bin->op == "&&" || bin->op == "||";
+    }
+    auto unary = dynamic_cast<UnaryExpr *>(expr);
+    return unary && unary->op == "!";
+}
+
+// if (c) x = a; else x = b;  =>  m = -(c != 0); x = b ^ ((a ^ b) & m)
+// 没有 else 时 b 取 x 自身
+bool CodeGen::genSelect(IfStmt *ifStmt) {
+    if (!options.ifConvert || dynamic_cast<NumberExpr *>(ifStmt->condition.get())) return false;
+    // 剖析表明某一分支从不执行时分支几乎总能预测正确，保留分支
+    if (options.profile && options.profile->count(ifStmt->profileId) > 0) {
+        uint32_t thenCount = options.profile->count(ifStmt->profileId + 1);
+        if (thenCount == 0 || thenCount == options.profile->count(ifStmt->profileId)) return false;
+    }
+    AssignStmt *thenAssign = singleAssign(ifStmt->thenBlock.get());
+    AssignStmt *elseAssign = singleAssign(ifStmt->elseBlock.get());
+    if (!thenAssign || (ifStmt->elseBlock && (!elseAssign || elseAssign->name != thenAssign->name))) return false;
+
+    int condBudget = 2 * options.ifConvertMaxArm;
+    int thenBudget = options.ifConvertMaxArm, elseBudget = options.ifConvertMaxArm;
+    VarExpr self(thenAssign->name);
+    Expr *thenExpr = thenAssign->value.get();
+    Expr *elseExpr = elseAssign ? elseAssign->value.get() : &self;
+    if (!isCheapArm(thenExpr, thenBudget) || !isCheapArm(elseExpr, elseBudget)) return false;
+    auto condBin = dynamic_cast<BinaryExpr *>(ifStmt->condition.get());
+    if (condBin && (condBin->op == "&&" || condBin->op == "||")) return false;
+    if (!isCheapArm(ifStmt->condition.get(), condBudget)) return false;
+
+    std::string cond = genExpr(ifStmt->condition.get());
+    std::string mask = isTemp(cond) ? cond : allocTemp();
+    if (!isBoolExpr(ifStmt->condition.get())) emit("snez", {mask, cond});
+    emit("neg", {mask, isBoolExpr(ifStmt->condition.get()) ? cond : mask});
+
+    std::string a = genExpr(thenExpr);
+    std::string b = genExpr(elseExpr);
+    std::string d = isTemp(a) ? a : allocTemp();
+    emit("xor", {d, a, b});
+    emit("and", {d, d, mask});
+    emit("xor", {d, b, d});
+    storeVar(thenAssign->name, d);
+    freeTemp(d);
+    freeTemp(b);
+    freeTemp(mask);
+    return true;
+}
+
+// 有剖析时执行次数多的分支作为顺序执行路径；几乎不执行的分支移到函数末尾，
+// 主路径上不再需要跳过它
+void CodeGen::genIf(IfStmt *ifStmt) {
+    if (options.profileGenerate) {
+        emitCounter(ifStmt->profileId);
+    } else if (genSelect(ifStmt)) {
+        return;
+    }
+    std::string endLabel = newLabel("endif");
+    const ProfileData *profile = options.profile;
+    bool profiled = profile && profile->count(ifStmt->profileId) > 0;
+    uint32_t thenCount = profiled ? profile->count(ifStmt->profileId + 1) : 0;
+    uint32_t elseCount = profiled ? profile->count(ifStmt->profileId) - std::min(thenCount, profile->count(ifStmt->profileId)) : 0;
+    auto isCold = [&](uint32_t count, uint32_t other) {
+        return profiled && !beforePrologue && (uint64_t)count * 100 <= other;
+    };
+
+    int thenId = ifStmt->profileId < 0 ? -1 : ifStmt->profileId + 1;
+    if (!ifStmt->elseBlock) {
+        if (isCold(thenCount, elseCount)) {
+            std::string coldLabel = newLabel("cold");
+            genBranch(ifStmt->condition.get(), coldLabel, true);
+            emitLabel(endLabel);
+            outlineCold(coldLabel, ifStmt->thenBlock.get(), thenId, endLabel);
+            return;
+        }
+        genBranch(ifStmt->condition.get(), endLabel, false);
+        genArm(ifStmt->thenBlock.get(), thenId);
+        emitLabel(endLabel);
+        return;
+    }
+
+    // else 执行得更多时反转条件，让 else 分支顺序执行
+    Block *first = ifStmt->thenBlock.get(), *second = ifStmt->elseBlock.get();
+    int firstId = thenId, secondId = -1;
+    uint32_t firstCount = thenCount, secondCount = elseCount;
+    bool jumpIf = false;
+    if (elseCount > thenCount) {
+        std::swap(first, second);
+        std::swap(firstId, secondId);
+        std::swap(firstCount, secondCount);
+        jumpIf = true;
+    }
+    std::string secondLabel = newLabel("else");
+    genBranch(ifStmt->condition.get(), secondLabel, jumpIf);
+    genArm(first, firstId);
+    if (isCold(secondCount, firstCount)) {
+        emitLabel(endLabel);
+        outlineCold(secondLabel, second, secondId, endLabel);
+        return;
+    }
+    emit("j", {endLabel});
+    emitLabel(secondLabel);
+    genArm(second, secondId);
+    emitLabel(endLabel);
+}
+
+void CodeGen::genArm(Block *block, int profileId) {
+    if (options.profileGenerate) emitCounter(profileId);
+    genBlock(block);
+}
+
+// 在 label 处生成 block 并跳回 resume，整段移入 coldCode
+void CodeGen::outlineCold(const std::string &label, Block *block, int profileId, const std::string &resume) {
+    size_t start = body.size();
+    emitLabel(label);
+    genArm(block, profileId);
+    emit("j", {resume});
+    coldCode.insert(coldCode.end(), body.begin() + start, body.end());
+    body.resize(start);
+}
+
+void CodeGen::genBranch(Expr *cond, const std::string &target, bool jumpIf) {
+    if (auto num = dynamic_cast<NumberExpr *>(cond)) {
+        if ((num->value != 0) == jumpIf) emit("j", {target});
+        return;
+    }
+    if (auto unary = dynamic_cast<UnaryExpr *>(cond)) {
+        if (unary->op == "!") {
+            genBranch(unary->operand.get(), target, !jumpIf);
+            return;
+        }
+        if (unary->op == "+") {
+            genBranch(unary->operand.get(), target, jumpIf);
+            return;
+        }
+    }
+    if (auto bin = dynamic_cast<BinaryExpr *>(cond)) {
+        // 规则表给出无分支形式（如区间判断）时按值求值再分支
+        if ((bin->op == "&&" || bin->op == "||") && isel.label(bin).rule < 0) {
+            // a && b 为假 <=> a 为假 || b 为假；|| 对偶
+            bool isAnd = bin->op == "&&";
+            if (isAnd != jumpIf) {
+                genBranch(bin->lhs.get(), target, jumpIf);
+                genBranch(bin->rhs.get(), target, jumpIf);
+            } else {
+                std::string skipLabel = newLabel(isAnd ? "land" : "lor");
+                genBranch(bin->lhs.get(), skipLabel, !jumpIf);
+                genBranch(bin->rhs.get(), target, jumpIf);
+                emitLabel(skipLabel);
+            }
+            return;
+        }
+        if (isRelOp(bin->op)) {
+            auto [lhs, rhs] = genOperands(bin->lhs.get(), bin->rhs.get());
+            // 统一为 blt/bge/beq/bne 四种形式，必要时交换操作数
+            std::string op = bin->op;
+            std::string a = lhs, b = rhs;
+            if (op == ">" || op == "<=") std::swap(a, b);
+            std::string mnemonic;
+            if (op == "<" || op == ">") mnemonic = jumpIf ? "blt" : "bge";
+            else if (op == "<=" || op == ">=") mnemonic = jumpIf ? "bge" : "blt";
+            else if (op == "==") mnemonic = jumpIf ? "beq" : "bne";
+            else mnemonic = jumpIf ? "bne" : "beq";
+            emit(mnemonic, {a, b, target});
+            freeTemp(lhs);
+            freeTemp(rhs);
+            return;
+        }
+    }
+    std::string reg = genExpr(cond);
+    emit(jumpIf ? "bnez" : "beqz", {reg, target});
+    freeTemp(reg);
+}
+
+// 叶函数的变量优先放在调用者保存的 a 寄存器中（无调用，不会被破坏），
+// 非叶函数只能使用被调用者保存的 s 寄存器，其余变量放入栈槽
+static const char *kLeafHomeRegs[] = {
+    "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
+static const char *kCalleeSavedRegs[] = {
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
+
+static void scanCalls(Expr *expr, FrameInfo &frame) {
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        scanCalls(bin->lhs.get(), frame);
+        scanCalls(bin->rhs.get(), frame);
     } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
-        genExpr(unary->operand.get());
-        if (unary->op == "-") {
-            emit("neg a0, a0");
-        } else if (unary->op == "!") {
-            emit("seqz a0, a0");
+        scanCalls(unary->operand.get(), frame);
+    } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
+        frame.isLeaf = false;
+        frame.outArgSlots = std::max(frame.outArgSlots, (int)call->args.size() - 8);
+        frame.maxCallArgs = std::max(frame.maxCallArgs, std::min((int)call->args.size(), 8));
+        frame.callees.push_back(call->callee);
+        for (auto &arg : call->args) scanCalls(arg.get(), frame);
+    }
+}
+
+// 返回语句序列中同时存活变量数的峰值：离开作用域即释放，兄弟作用域共享
+static int scanBlock(Block *block, FrameInfo &frame, const CodeGenOptions &options);
+
+static int scanStmt(Stmt *stmt, FrameInfo &frame, const CodeGenOptions &options) {
+    if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
+        if (decl->initializer) scanCalls(decl->initializer.get(), frame);
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        scanCalls(assign->value.get(), frame);
+    } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+        scanCalls(exprStmt->expr.get(), frame);
+    } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        auto call = dynamic_cast<CallExpr *>(ret->expr.get());
+        if (options.tailCalls && call && call->args.size() <= 8) {
+            // 尾调用不需要保存 ra，也不会破坏本函数的临时值
+            frame.maxCallArgs = std::max(frame.maxCallArgs, (int)call->args.size());
+            for (auto &arg : call->args) scanCalls(arg.get(), frame);
+        } else if (ret->expr) {
+            scanCalls(ret->expr.get(), frame);
+        }
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        return scanBlock(block, frame, options);
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        scanCalls(ifStmt->condition.get(), frame);
+        int peak = scanBlock(ifStmt->thenBlock.get(), frame, options);
+        if (ifStmt->elseBlock) peak = std::max(peak, scanBlock(ifStmt->elseBlock.get(), frame, options));
+        return peak;
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        scanCalls(whileStmt->condition.get(), frame);
+        return scanBlock(whileStmt->body.get(), frame, options);
+    }
+    return 0;
+}
+
+static int scanBlock(Block *block, FrameInfo &frame, const CodeGenOptions &options) {
+    int live = 0, peak = 0;
+    for (auto &stmt : block->stmts) {
+        if (dynamic_cast<VarDeclStmt *>(stmt.get())) {
+            scanStmt(stmt.get(), frame, options);
+            peak = std::max(peak, ++live);
         } else {
-            assert(false && "Unsupported unary operator");
+            peak = std::max(peak, live + scanStmt(stmt.get(), frame, options));
         }
-        return "a0";
     }
-    assert(false && "Unknown Expr type");
-    return "a0";
+    return peak;
 }
 
-void CodeGen::genFunc(FuncDef *func) {
-    localVarOffset.clear();
-    int offset = 0;
+void CodeGen::layoutFrame(FuncDef *func) {
+    frame = FrameInfo();
+    int peak = scanBlock(func->body.get(), frame, options);
+    frame.maxHomes = (int)func->params.size() + peak;
+
+    if (frame.isLeaf) {
+        frame.homeRegs.assign(std::begin(kLeafHomeRegs), std::end(kLeafHomeRegs));
+    } else {
+        if (options.ipra) {
+            // 不传参、不接收参数、且没有被调用者改写的 a 寄存器可以跨调用存放变量，
+            // 不必像 s 寄存器那样在序言中保存
+            RegSet clobbered = 0;
+            for (auto &callee : frame.callees) clobbered |= clobbersOf(callee);
+            int first = std::max({1, frame.maxCallArgs, std::min((int)func->params.size(), 8)});
+            for (int i = first; i < 8; i++) {
+                std::string reg = "a" + std::to_string(i);
+                if (!(clobbered & regBit(regIndex(reg)))) frame.homeRegs.push_back(reg);
+            }
+        }
+        frame.homeRegs.insert(frame.homeRegs.end(), std::begin(kCalleeSavedRegs), std::end(kCalleeSavedRegs));
+        frame.savedRegs.push_back("ra");
+    }
 
-    out << ".globl " << func->name << "\n";
-    out << func->name << ":\n";
+    int regHomes = std::min(frame.maxHomes, (int)frame.homeRegs.size());
+    for (int i = 0; i < regHomes; i++) {
+        if (frame.homeRegs[i][0] == 's') frame.savedRegs.push_back(frame.homeRegs[i]);
+    }
+    frame.localSlots = frame.maxHomes - regHomes;
+}
 
-    emit("addi sp, sp, -128"); // 分配栈空间
+VarHome CodeGen::declareVar(const std::string &name) {
+    VarHome home;
+    int index = liveHomes++;
+    if (index < (int)frame.homeRegs.size()) {
+        home.reg = frame.homeRegs[index];
+    } else {
+        home.offset = frame.localOffset() + (index - (int)frame.homeRegs.size()) * 4;
+        if (home.offset > 2047) throw std::runtime_error("Stack frame too large");
+    }
+    scopes.back()[name] = home;
+    return home;
+}
 
-    // 参数保存
-    for (size_t i = 0; i < func->params.size(); i++) {
-        offset -= 4;
-        localVarOffset[func->params[i].name] = offset;
-        emit("sw a" + std::to_string(i) + ", " + std::to_string(offset) + "(sp)");
+VarHome CodeGen::lookupVar(const std::string &name) const {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) return found->second;
     }
+    assert(false && "Undeclared variable");
+    return VarHome();
+}
 
-    genBlock(func->body.get());
+std::string CodeGen::loadVar(const std::string &name) {
+    VarHome home = lookupVar(name);
+    if (home.inReg()) return home.reg;
+    std::string rd = allocTemp();
+    emit("lw", {rd, memOperand(home.offset)});
+    return rd;
+}
 
-    emit("addi sp, sp, 128");
-    emit("ret");
+void CodeGen::storeVar(const std::string &name, const std::string &reg) {
+    VarHome home = lookupVar(name);
+    if (home.inReg()) {
+        if (home.reg != reg) emit("mv", {home.reg, reg});
+    } else {
+        emit("sw", {reg, memOperand(home.offset)});
+    }
+}
+
+// 能否在序言之前执行：不调用函数、不声明变量，只读写寄存器传入的参数，
+// 且表达式足够浅，不会用到栈上的暂存槽
+static bool isFrameFree(Expr *expr, FuncDef *func, int depth) {
+    if (depth > 4) return false;
+    if (dynamic_cast<NumberExpr *>(expr)) return true;
+    if (auto var = dynamic_cast<VarExpr *>(expr)) {
+        for (size_t i = 0; i < func->params.size() && i < 8; i++) {
+            if (func->params[i].name == var->name) return true;
+        }
+        return false;
+    }
+    if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        return isFrameFree(unary->operand.get(), func, depth + 1);
+    }
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        return isFrameFree(bin->lhs.get(), func, depth + 1) &&
+               isFrameFree(bin->rhs.get(), func, depth + 1);
+    }
+    return false;
+}
+
+static bool isFrameFree(Stmt *stmt, FuncDef *func, bool &returns) {
+    if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        returns = true;
+        return !ret->expr || isFrameFree(ret->expr.get(), func, 0);
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        return isFrameFree(assign->value.get(), func, 0) &&
+               isFrameFree(std::make_unique<VarExpr>(assign->name).get(), func, 0);
+    } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+        return isFrameFree(exprStmt->expr.get(), func, 0);
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        for (auto &s : block->stmts) {
+            if (!isFrameFree(s.get(), func, returns)) return false;
+        }
+        return true;
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        return isFrameFree(ifStmt->condition.get(), func, 0) &&
+               isFrameFree(ifStmt->thenBlock.get(), func, returns) &&
+               (!ifStmt->elseBlock || isFrameFree(ifStmt->elseBlock.get(), func, returns));
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        return isFrameFree(whileStmt->condition.get(), func, 0) &&
+               isFrameFree(whileStmt->body.get(), func, returns);
+    }
+    return dynamic_cast<BreakStmt *>(stmt) || dynamic_cast<ContinueStmt *>(stmt);
+}
+
+// 收缩包装：函数开头无需栈帧的语句（典型如 if (n <= 1) return n;）
+// 放到序言之前执行，提前返回的路径不再保存/恢复寄存器和调整 sp
+static size_t shrinkWrapPrefix(FuncDef *func) {
+    size_t prefix = 0;
+    bool returns = false;
+    auto &stmts = func->body->stmts;
+    while (prefix < stmts.size() && isFrameFree(stmts[prefix].get(), func, returns)) prefix++;
+    return returns ? prefix : 0;
+}
+
+std::vector<AsmInstr> CodeGen::genFunc(FuncDef *func) {
+    layoutFrame(func);
+    scopes.clear();
+    scopes.emplace_back();
+    liveHomes = 0;
+    stageDepth = 0;
+    isel.clear();
+    body.clear();
+    coldCode.clear();
+
+    // 参数住所；寄存器传入的参数在序言中搬运，栈传入的参数从调用者栈帧读取
+    std::vector<VarHome> paramHomes;
+    for (auto &param : func->params) {
+        paramHomes.push_back(declareVar(param.name));
+    }
+
+    // 序言之前参数仍在传入的 a 寄存器中；前缀的每条语句都可能读到任一参数
+    size_t prefix = shrinkWrapPrefix(func);
+    beforePrologue = prefix > 0;
+    if (beforePrologue) {
+        for (size_t i = 0; i < std::min<size_t>(paramHomes.size(), 8); i++) {
+            scopes[0][func->params[i].name].reg = "a" + std::to_string(i);
+        }
+    }
+
+    if (options.profileGenerate) emitCounter(func->profileId);
+
+    // 前缀覆盖整个函数体时不建立栈帧，落出函数体直接返回
+    auto &stmts = func->body->stmts;
+    bool framed = prefix < stmts.size();
+    scopes.emplace_back();
+    for (size_t i = 0; i <= stmts.size(); i++) {
+        if (i == prefix && framed) {
+            body.push_back(AsmInstr::directive(kPrologueMarker));
+            beforePrologue = false;
+            for (size_t p = 0; p < paramHomes.size(); p++) {
+                scopes[0][func->params[p].name] = paramHomes[p];
+            }
+        }
+        if (i < stmts.size()) genStmt(stmts[i].get());
+    }
+    scopes.pop_back();
+    if (!framed && (body.empty() || !isUncondTransfer(body.back()))) emitEpilogue();
+
+    // 冷代码放在函数末尾，主路径落出函数体时先返回
+    if (!coldCode.empty()) {
+        emitEpilogue();
+        body.insert(body.end(), coldCode.begin(), coldCode.end());
+    }
+
+    int frameSize = frame.frameSize();
+    std::vector<AsmInstr> code;
+    auto put = [&](const std::string &op, std::vector<std::string> args) {
+        code.push_back(AsmInstr::instr(op, std::move(args)));
+    };
+    auto adjustSp = [&](int delta) {
+        if (delta >= -2048 && delta <= 2047) {
+            put("addi", {"sp", "sp", std::to_string(delta)});
+        } else {
+            put("li", {"t0", std::to_string(delta)});
+            put("add", {"sp", "sp", "t0"});
+        }
+    };
+    auto restoreFrame = [&]() {
+        for (size_t r = 0; r < frame.savedRegs.size(); r++) {
+            put("lw", {frame.savedRegs[r], memOperand(frame.savedOffset() + (int)r * 4)});
+        }
+        if (frameSize > 0) adjustSp(frameSize);
+    };
+
+    code.push_back(AsmInstr::directive(".globl", {symbolFor(func->name)}));
+    code.push_back(AsmInstr::label(symbolFor(func->name)));
+
+    // 尾声只有一条 ret 时就地展开，否则所有返回点共用函数末尾的出口块
+    bool trivialExit = frameSize == 0 && frame.savedRegs.empty();
+    std::string exitLabel = newLabel("exit");
+    bool exitUsed = false;
+
+    for (size_t i = 0; i < body.size(); i++) {
+        const AsmInstr &ins = body[i];
+        if (ins.op == kPrologueMarker) {
+            // 序言：无溢出、无调用的叶函数不分配栈帧
+            if (frameSize > 0) adjustSp(-frameSize);
+            for (size_t r = 0; r < frame.savedRegs.size(); r++) {
+                put("sw", {frame.savedRegs[r], memOperand(frame.savedOffset() + (int)r * 4)});
+            }
+            for (size_t p = 0; p < paramHomes.size(); p++) {
+                const VarHome &home = paramHomes[p];
+                std::string src = "a" + std::to_string(p);
+                if (p >= 8) {
+                    src = home.inReg() ? home.reg : "t0";
+                    put("lw", {src, memOperand(frameSize + (int)(p - 8) * 4)});
+                }
+                if (home.inReg()) {
+                    if (home.reg != src) put("mv", {home.reg, src});
+                } else {
+                    put("sw", {src, memOperand(home.offset)});
+                }
+            }
+        } else if (ins.op == kEpilogueMarker) {
+            const std::string &tailCallee = ins.args[0];
+            if (!tailCallee.empty()) {
+                restoreFrame();
+                put("tail", {tailCallee});
+            } else if (i + 1 == body.size()) {
+                // 紧接出口块，直接落入
+            } else if (trivialExit) {
+                put("ret", {});
+            } else {
+                put("j", {exitLabel});
+                exitUsed = true;
+            }
+        } else {
+            code.push_back(ins);
+        }
+    }
+
+    if (framed) {
+        if (exitUsed) code.push_back(AsmInstr::label(exitLabel));
+        restoreFrame();
+        put("ret", {});
+    }
+
+    if (options.machinePasses) {
+        options.machinePasses(func->name, code, options.ipra ? &clobbers : nullptr);
+    } else {
+        if (options.peephole) peephole.run(code, options.ipra ? &clobbers : nullptr);
+        if (options.schedule) scheduler.run(code);
+    }
+    return code;
 }
 
 void CodeGen::genBlock(Block *block) {
+    scopes.emplace_back();
+    int savedHomes = liveHomes;
     for (auto &stmt : block->stmts) {
         genStmt(stmt.get());
     }
+    liveHomes = savedHomes;
+    scopes.pop_back();
 }
 
 void CodeGen::genStmt(Stmt *stmt) {
     if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
-        int offset = localVarOffset.size() * -4 - 4;
-        localVarOffset[decl->name] = offset;
-        if (decl->initializer) {
-            genExpr(decl->initializer.get());
-            emit("sw a0, " + std::to_string(offset) + "(sp)");
-        }
+        // 初始化表达式在新变量可见之前求值
+        std::string reg = decl->initializer ? genExpr(decl->initializer.get()) : "zero";
+        declareVar(decl->name);
+        storeVar(decl->name, reg);
+        freeTemp(reg);
     } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
-        int offset = localVarOffset[assign->name];
-        genExpr(assign->value.get());
-        emit("sw a0, " + std::to_string(offset) + "(sp)");
+        std::string reg = genExpr(assign->value.get());
+        storeVar(assign->name, reg);
+        freeTemp(reg);
     } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
-        genExpr(exprStmt->expr.get());
+        freeTemp(genExpr(exprStmt->expr.get()));
     } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
-        if (ret->expr) genExpr(ret->expr.get());
-        emit("addi sp, sp, 128");
-        emit("ret");
+        if (CallExpr *call = tailCallOf(ret)) {
+            // 尾调用：实参就位后拆除本函数栈帧，用 tail 跳转，被调用者直接返回到我们的调用者
+            if (options.profileGenerate) emitCounter(call->profileId);
+            genCallArgs(call);
+            emitEpilogue(symbolFor(call->callee));
+            return;
+        }
+        if (ret->expr) {
+            std::string reg = genExpr(ret->expr.get());
+            if (reg != "a0") emit("mv", {"a0", reg});
+            freeTemp(reg);
+        }
+        emitEpilogue();
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        genBlock(block);
     } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
-        std::string elseLabel = newLabel("else");
-        std::string endLabel = newLabel("endif");
-
-        genExpr(ifStmt->condition.get());
-        emit("beqz a0, " + elseLabel);
-        genBlock(ifStmt->thenBlock.get());
-        emit("j " + endLabel);
-        emit(elseLabel + ":");
-        if (ifStmt->elseBlock) genBlock(ifStmt->elseBlock.get());
-        emit(endLabel + ":");
+        genIf(ifStmt);
     } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        // 旋转为带入口检查的 do-while：每轮迭代只在末尾执行一次向回的条件跳转
         std::string loopLabel = newLabel("loop");
+        std::string condLabel = newLabel("loopcond");
         std::string endLabel = newLabel("endloop");
-        emit(loopLabel + ":");
-        genExpr(whileStmt->condition.get());
-        emit("beqz a0, " + endLabel);
-        genBlock(whileStmt->body.get());
-        emit("j " + loopLabel);
-        emit(endLabel + ":");
+        if (options.profileGenerate) emitCounter(whileStmt->profileId);
+        genBranch(whileStmt->condition.get(), endLabel, false);
+        emitLabel(loopLabel);
+        loopLabels.emplace_back(condLabel, endLabel);
+        genArm(whileStmt->body.get(), whileStmt->profileId + 1);
+        loopLabels.pop_back();
+        emitLabel(condLabel);
+        genBranch(whileStmt->condition.get(), loopLabel, true);
+        emitLabel(endLabel);
     } else if (dynamic_cast<BreakStmt *>(stmt)) {
-        // TODO: 需要循环上下文
+        assert(!loopLabels.empty() && "break outside of loop");
+        emit("j", {loopLabels.back().second});
     } else if (dynamic_cast<ContinueStmt *>(stmt)) {
-        // TODO: 需要循环上下文
+        assert(!loopLabels.empty() && "continue outside of loop");
+        emit("j", {loopLabels.back().first});
     } else {
         assert(false && "Unknown Stmt type");
     }
@@ -0,0 +1,258 @@
+#include "cost.h"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <unordered_map>
+
+// 更深的嵌套按此深度计权，避免溢出
+static const int kMaxWeightDepth = 6;
+
+static long loopWeight(int depth) {
+    long weight = 1;
+    for (int d = 0; d < std::min(depth, kMaxWeightDepth); d++) weight *= kLoopWeight;
+    return weight;
+}
+
+namespace {
+
+// 基本块：标签处与控制转移之后开始新块，连续的标签属于同一块
+struct Block {
+    size_t begin = 0, end = 0;
+    int target = -1;      // 末尾的分支或跳转在本函数内的目标块
+    std::vector<int> succs, preds;
+};
+
+}  // namespace
+
+static std::vector<Block> buildBlocks(const std::vector<AsmInstr> &code, std::vector<int> &blockOf) {
+    std::vector<Block> blocks;
+    std::unordered_map<std::string, int> labelBlock;
+    blockOf.assign(code.size(), 0);
+    bool startNew = true;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (startNew || (code[i].isLabel() && !code[i - 1].isLabel())) {
+            if (!blocks.empty()) blocks.back().end = i;
+            blocks.push_back(Block{i, i, -1, {}, {}});
+            startNew = false;
+        }
+        blockOf[i] = (int)blocks.size() - 1;
+        if (code[i].isLabel()) labelBlock[code[i].op] = blockOf[i];
+        if (isCondBranch(code[i]) || isUncondTransfer(code[i])) startNew = true;
+    }
+    if (!blocks.empty()) blocks.back().end = code.size();
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const AsmInstr *last = nullptr;
+        for (size_t i = blocks[b].begin; i < blocks[b].end; i++) {
+            if (code[i].isInstr()) last = &code[i];
+        }
+        if (last) {
+            auto it = labelBlock.find(branchTarget(*last));
+            if (it != labelBlock.end()) {
+                blocks[b].target = it->second;
+                blocks[b].succs.push_back(it->second);
+            }
+        }
+        if ((!last || !isUncondTransfer(*last)) && b + 1 < blocks.size()) blocks[b].succs.push_back((int)b + 1);
+        for (int s : blocks[b].succs) blocks[s].preds.push_back((int)b);
+    }
+    return blocks;
+}
+
+// 直接支配者（Cooper-Harvey-Kennedy 迭代算法），入口块为 0，不可达的块为 -1
+static std::vector<int> dominators(const std::vector<Block> &blocks) {
+    size_t n = blocks.size();
+    std::vector<int> order, rpoIndex(n, -1);
+    std::vector<bool> visited(n, false);
+    // 迭代的深度优先后序
+    std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.second < blocks[top.first].succs.size()) {
+            int s = blocks[top.first].succs[top.second++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack.push_back({s, 0});
+            }
+        } else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); i++) rpoIndex[order[i]] = (int)i;
+
+    std::vector<int> idom(n, -1);
+    idom[0] = 0;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (rpoIndex[a] > rpoIndex[b]) a = idom[a];
+            while (rpoIndex[b] > rpoIndex[a]) b = idom[b];
+        }
+        return a;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); i++) {
+            int b = order[i];
+            int next = -1;
+            for (int p : blocks[b].preds) {
+                if (idom[p] < 0) continue;
+                next = next < 0 ? p : intersect(p, next);
+            }
+            if (next != idom[b]) {
+                idom[b] = next;
+                changed = true;
+            }
+        }
+    }
+    return idom;
+}
+
+static bool dominates(const std::vector<int> &idom, int a, int b) {
+    for (int x = b; x >= 0; x = idom[x]) {
+        if (x == a) return true;
+        if (x == 0) break;
+    }
+    return false;
+}
+
+FunctionCost estimateCost(const std::string &name, const std::vector<AsmInstr> &code, const LatencyModel &model,
+                          int frameSize, int spillBase) {
+    FunctionCost result;
+    result.name = name;
+    result.frameSize = frameSize;
+    if (code.empty()) return result;
+
+    std::vector<int> blockOf;
+    std::vector<Block> blocks = buildBlocks(code, blockOf);
+    std::vector<int> idom = dominators(blocks);
+
+    // 自然循环：回边 b -> h（h 支配 b）上，从 b 逆向不经过 h 可达的块；同一循环头的回边合并
+    std::map<int, std::vector<bool>> bodies;
+    for (size_t b = 0; b < blocks.size(); b++) {
+        if (idom[b] < 0) continue;
+        for (int h : blocks[b].succs) {
+            if (!dominates(idom, h, (int)b)) continue;
+            auto &body = bodies[h];
+            body.resize(blocks.size(), false);
+            body[h] = true;
+            std::vector<int> work;
+            if (!body[b]) {
+                body[b] = true;
+                work.push_back((int)b);
+            }
+            while (!work.empty()) {
+                int x = work.back();
+                work.pop_back();
+                for (int p : blocks[x].preds) {
+                    if (!body[p] && idom[p] >= 0) {
+                        body[p] = true;
+                        work.push_back(p);
+                    }
+                }
+            }
+        }
+    }
+    std::vector<int> depth(blocks.size(), 0);
+    for (auto &entry : bodies) {
+        for (size_t b = 0; b < blocks.size(); b++) depth[b] += entry.second[b];
+    }
+
+    // 每条指令的代价：延迟，加上假定发生跳转的控制转移（无条件跳转、调用与循环回边）的损失
+    std::vector<long> instrCost(code.size(), 0);
+    for (size_t i = 0; i < code.size(); i++) {
+        const AsmInstr &ins = code[i];
+        if (!ins.isInstr()) continue;
+        long c = latencyOf(ins, model);
+        bool call = ins.op == "call" || ins.op == "tail";
+        const Block &block = blocks[blockOf[i]];
+        bool backEdge = isCondBranch(ins) && idom[blockOf[i]] >= 0 && block.target >= 0 &&
+                        dominates(idom, block.target, blockOf[i]);
+        if (isUncondTransfer(ins) || call || backEdge) c += model.branch;
+        instrCost[i] = c;
+
+        result.instrs++;
+        result.cost += c * loopWeight(depth[blockOf[i]]);
+        if (call) result.calls++;
+        int offset;
+        std::string base;
+        if ((isLoad(ins) || isStore(ins)) && ins.args.size() == 2 && parseMemOperand(ins.args[1], offset, base) &&
+            base == "sp" && offset >= spillBase && offset < frameSize) {
+            result.spills++;
+        }
+    }
+
+    for (auto &entry : bodies) {
+        int header = entry.first;
+        LoopCost loop;
+        loop.header = code[blocks[header].begin].isLabel() ? code[blocks[header].begin].op : "";
+        loop.depth = depth[header];
+        for (size_t b = 0; b < blocks.size(); b++) {
+            if (!entry.second[b]) continue;
+            for (size_t i = blocks[b].begin; i < blocks[b].end; i++) {
+                if (!code[i].isInstr()) continue;
+                loop.instrs++;
+                loop.perIteration += instrCost[i] * loopWeight(depth[b] - loop.depth);
+                loop.cost += instrCost[i] * loopWeight(depth[b]);
+            }
+        }
+        result.loops.push_back(loop);
+    }
+    return result;
+}
+
+std::vector<FunctionCost> CostReport::ranked() const {
+    std::vector<FunctionCost> sorted = functions;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const FunctionCost &a, const FunctionCost &b) {
+        return a.cost != b.cost ? a.cost > b.cost : a.name < b.name;
+    });
+    return sorted;
+}
+
+void CostReport::printText(std::ostream &os) const {
+    os << "cost report (" << model.name << ", loop weight " << kLoopWeight << "):\n";
+    os << "  " << std::left << std::setw(20) << "function" << std::right << std::setw(8) << "instrs"
+       << std::setw(12) << "cost" << std::setw(8) << "frame" << std::setw(8) << "calls" << std::setw(8)
+       << "spills" << "\n";
+    for (auto &f : ranked()) {
+        os << "  " << std::left << std::setw(20) << f.name << std::right << std::setw(8) << f.instrs
+           << std::setw(12) << f.cost << std::setw(8) << f.frameSize << std::setw(8) << f.calls << std::setw(8)
+           << f.spills << "\n";
+        for (auto &loop : f.loops) {
+            os << "    loop " << loop.header << ": depth " << loop.depth << ", " << loop.instrs << " instrs, "
+               << loop.perIteration << " per iteration, cost " << loop.cost << "\n";
+        }
+    }
+}
+
+// 函数名与标签只含标识符字符，仍按 JSON 规则转义
+static std::string jsonString(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+void CostReport::printJson(std::ostream &os) const {
+    os << "{\n  \"tune\": " << jsonString(model.name) << ",\n  \"loopWeight\": " << kLoopWeight
+       << ",\n  \"functions\": [";
+    auto sorted = ranked();
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const FunctionCost &f = sorted[i];
+        os << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(f.name) << ", \"instrs\": " << f.instrs
+           << ", \"cost\": " << f.cost << ", \"frameSize\": " << f.frameSize << ", \"calls\": " << f.calls
+           << ", \"spills\": " << f.spills << ", \"loops\": [";
+        for (size_t l = 0; l < f.loops.size(); l++) {
+            const LoopCost &loop = f.loops[l];
+            os << (l ? ", " : "") << "{\"header\": " << jsonString(loop.header) << ", \"depth\": " << loop.depth
+               << ", \"instrs\": " << loop.instrs << ", \"perIteration\": " << loop.perIteration
+               << ", \"cost\": " << loop.cost << "}";
+        }
+        os << "]}";
+    }
+    os << (sorted.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
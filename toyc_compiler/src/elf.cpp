@@ -0,0 +1,851 @@
+#include "elf.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+using Section = ElfSymbol::Section;
+
+const ElfSymbol *ElfObject::findSymbol(const std::string &name) const {
+    for (auto &sym : symbols) {
+        if (sym.name == name) return &sym;
+    }
+    return nullptr;
+}
+
+// {funct7, funct3}
+struct Funct {
+    uint32_t funct7;
+    uint32_t funct3;
+};
+
+static const std::unordered_map<std::string, Funct> kRTypeTable = {
+    {"add", {0x00, 0}}, {"sub", {0x20, 0}}, {"sll", {0x00, 1}}, {"slt", {0x00, 2}}, {"sltu", {0x00, 3}},
+    {"xor", {0x00, 4}}, {"srl", {0x00, 5}}, {"sra", {0x20, 5}}, {"or", {0x00, 6}}, {"and", {0x00, 7}},
+    {"mul", {0x01, 0}}, {"mulh", {0x01, 1}}, {"mulhsu", {0x01, 2}}, {"mulhu", {0x01, 3}},
+    {"div", {0x01, 4}}, {"divu", {0x01, 5}}, {"rem", {0x01, 6}}, {"remu", {0x01, 7}}};
+static const std::unordered_map<std::string, uint32_t> kITypeTable = {
+    {"addi", 0}, {"slti", 2}, {"sltiu", 3}, {"xori", 4}, {"ori", 6}, {"andi", 7}};
+static const std::unordered_map<std::string, Funct> kShiftTable = {
+    {"slli", {0x00, 1}}, {"srli", {0x00, 5}}, {"srai", {0x20, 5}}};
+static const std::unordered_map<std::string, uint32_t> kLoadTable = {
+    {"lb", 0}, {"lh", 1}, {"lw", 2}, {"lbu", 4}, {"lhu", 5}};
+static const std::unordered_map<std::string, uint32_t> kStoreTable = {{"sb", 0}, {"sh", 1}, {"sw", 2}};
+static const std::unordered_map<std::string, uint32_t> kBranchTable = {
+    {"beq", 0}, {"bne", 1}, {"blt", 4}, {"bge", 5}, {"bltu", 6}, {"bgeu", 7}};
+
+enum : uint32_t {
+    kOpLoad = 0x03, kOpImm = 0x13, kOpAuipc = 0x17, kOpStore = 0x23, kOpReg = 0x33,
+    kOpLui = 0x37, kOpBranch = 0x63, kOpJalr = 0x67, kOpJal = 0x6f, kOpSystem = 0x73,
+};
+
+static const int kRa = 1, kT1 = 6;
+
+static uint32_t rType(Funct f, int rd, int rs1, int rs2) {
+    return f.funct7 << 25 | (uint32_t)rs2 << 20 | (uint32_t)rs1 << 15 | f.funct3 << 12 | (uint32_t)rd << 7 | kOpReg;
+}
+
+static uint32_t iType(uint32_t opcode, uint32_t funct3, int rd, int rs1, int32_t imm) {
+    if (imm < -2048 || imm > 2047) throw std::runtime_error("Immediate out of range: " + std::to_string(imm));
+    return ((uint32_t)imm & 0xfff) << 20 | (uint32_t)rs1 << 15 | funct3 << 12 | (uint32_t)rd << 7 | opcode;
+}
+
+static uint32_t sType(uint32_t funct3, int rs1, int rs2, int32_t imm) {
+    if (imm < -2048 || imm > 2047) throw std::runtime_error("Immediate out of range: " + std::to_string(imm));
+    uint32_t u = (uint32_t)imm;
+    return (u >> 5 & 0x7f) << 25 | (uint32_t)rs2 << 20 | (uint32_t)rs1 << 15 | funct3 << 12 | (u & 0x1f) << 7 |
+           kOpStore;
+}
+
+static uint32_t bType(uint32_t funct3, int rs1, int rs2, int32_t offset) {
+    uint32_t u = (uint32_t)offset;
+    return (u >> 12 & 1) << 31 | (u >> 5 & 0x3f) << 25 | (uint32_t)rs2 << 20 | (uint32_t)rs1 << 15 |
+           funct3 << 12 | (u >> 1 & 0xf) << 8 | (u >> 11 & 1) << 7 | kOpBranch;
+}
+
+static uint32_t uType(uint32_t opcode, int rd, uint32_t imm20) {
+    return (imm20 & 0xfffff) << 12 | (uint32_t)rd << 7 | opcode;
+}
+
+static uint32_t jType(int rd, int32_t offset) {
+    uint32_t u = (uint32_t)offset;
+    return (u >> 20 & 1) << 31 | (u >> 1 & 0x3ff) << 21 | (u >> 11 & 1) << 20 | (u >> 12 & 0xff) << 12 |
+           (uint32_t)rd << 7 | kOpJal;
+}
+
+static int parseReg(const std::string &text) {
+    int index = regIndex(text);
+    if (index < 0) throw std::runtime_error("Invalid register: " + text);
+    return index;
+}
+
+// "sym+4" -> sym, 4
+static std::string splitSymbol(const std::string &operand, int32_t &addend) {
+    size_t plus = operand.find('+');
+    addend = plus == std::string::npos ? 0 : parseImmediate(operand.substr(plus + 1));
+    return operand.substr(0, plus);
+}
+
+// li 的展开：12 位以内一条 addi，否则 lui 加（低 12 位非零时）addi
+static int32_t lowPart(int32_t value) { return (int32_t)((uint32_t)value << 20) >> 20; }
+
+static bool fitsImm12(int32_t value) { return value >= -2048 && value <= 2047; }
+
+static uint32_t liSize(int32_t value) {
+    return fitsImm12(value) || lowPart(value) == 0 ? 4 : 8;
+}
+
+// 条件分支（含 beqz/bgt 等伪指令）归一为 funct3 与两个源寄存器
+static bool decodeBranch(const AsmInstr &ins, uint32_t &funct3, int &rs1, int &rs2, std::string &target) {
+    const std::string &op = ins.op;
+    const auto &a = ins.args;
+    auto need = [&](size_t n) {
+        if (a.size() != n) throw std::runtime_error("Wrong operand count: " + ins.text());
+    };
+    if (kBranchTable.count(op)) {
+        need(3);
+        funct3 = kBranchTable.at(op);
+        rs1 = parseReg(a[0]);
+        rs2 = parseReg(a[1]);
+        target = a[2];
+    } else if (op == "bgt" || op == "ble" || op == "bgtu" || op == "bleu") {
+        need(3);
+        funct3 = kBranchTable.at(op == "bgt" ? "blt" : op == "ble" ? "bge" : op == "bgtu" ? "bltu" : "bgeu");
+        rs1 = parseReg(a[1]);
+        rs2 = parseReg(a[0]);
+        target = a[2];
+    } else if (op == "beqz" || op == "bnez" || op == "bltz" || op == "bgez") {
+        need(2);
+        funct3 = kBranchTable.at(op == "beqz" ? "beq" : op == "bnez" ? "bne" : op == "bltz" ? "blt" : "bge");
+        rs1 = parseReg(a[0]);
+        rs2 = 0;
+        target = a[1];
+    } else if (op == "blez" || op == "bgtz") {
+        need(2);
+        funct3 = kBranchTable.at(op == "blez" ? "bge" : "blt");
+        rs1 = 0;
+        rs2 = parseReg(a[0]);
+        target = a[1];
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ---------------- RVC 压缩指令 ----------------
+
+// 压缩形式 3 位寄存器字段的编号（x8-x15）
+static uint32_t rvcReg(const std::string &text) {
+    int index = parseReg(text);
+    if (index < 8 || index > 15) throw std::runtime_error("Register not allowed in compressed instruction: " + text);
+    return (uint32_t)index - 8;
+}
+
+static uint32_t bits(uint32_t value, int hi, int lo) { return value >> lo & ((1u << (hi - lo + 1)) - 1); }
+
+// 16 位编码；delta 为分支与跳转的 PC 相对偏移，调用者已确认在范围内
+static uint32_t encodeCompressed(const AsmInstr &ins, int32_t delta) {
+    const std::string op = ins.op.substr(2);
+    const auto &a = ins.args;
+    auto need = [&](size_t n) {
+        if (a.size() != n) throw std::runtime_error("Wrong operand count: " + ins.text());
+    };
+    auto check = [&](bool ok) {
+        if (!ok) throw std::runtime_error("Operand out of range: " + ins.text());
+    };
+    auto memOperand = [&](int32_t &offset, std::string &base) {
+        int memOffset;
+        if (!parseMemOperand(a[1], memOffset, base)) throw std::runtime_error("Invalid memory operand: " + ins.text());
+        offset = memOffset;
+    };
+
+    if (op == "nop") {
+        need(0);
+        return 0x0001;
+    }
+    if (op == "mv" || op == "add") {
+        need(2);
+        int rd = parseReg(a[0]), rs = parseReg(a[1]);
+        check(rd != 0 && rs != 0);
+        return (op == "mv" ? 0x8u : 0x9u) << 12 | (uint32_t)rd << 7 | (uint32_t)rs << 2 | 2;
+    }
+    if (op == "jr" || op == "jalr") {
+        need(1);
+        int rs = parseReg(a[0]);
+        check(rs != 0);
+        return (op == "jr" ? 0x8u : 0x9u) << 12 | (uint32_t)rs << 7 | 2;
+    }
+    if (op == "li" || op == "addi") {
+        need(2);
+        int rd = parseReg(a[0]);
+        int32_t imm = parseImmediate(a[1]);
+        check(rd != 0 && imm >= -32 && imm <= 31 && (op == "li" || imm != 0));
+        uint32_t u = (uint32_t)imm;
+        return (op == "li" ? 2u : 0u) << 13 | bits(u, 5, 5) << 12 | (uint32_t)rd << 7 | bits(u, 4, 0) << 2 | 1;
+    }
+    if (op == "lui") {
+        need(2);
+        int rd = parseReg(a[0]);
+        int32_t imm = parseImmediate(a[1]);
+        check(rd != 0 && rd != 2 && ((imm >= 1 && imm <= 31) || (imm >= 0xfffe0 && imm <= 0xfffff)));
+        uint32_t u = (uint32_t)imm;
+        return 3u << 13 | bits(u, 5, 5) << 12 | (uint32_t)rd << 7 | bits(u, 4, 0) << 2 | 1;
+    }
+    if (op == "addi16sp") {
+        need(2);
+        int32_t imm = parseImmediate(a[1]);
+        check(parseReg(a[0]) == 2 && imm != 0 && imm % 16 == 0 && imm >= -512 && imm <= 496);
+        uint32_t u = (uint32_t)imm;
+        return 3u << 13 | bits(u, 9, 9) << 12 | 2u << 7 | bits(u, 4, 4) << 6 | bits(u, 6, 6) << 5 |
+               bits(u, 8, 7) << 3 | bits(u, 5, 5) << 2 | 1;
+    }
+    if (op == "addi4spn") {
+        need(3);
+        int32_t imm = parseImmediate(a[2]);
+        check(parseReg(a[1]) == 2 && imm > 0 && imm % 4 == 0 && imm <= 1020);
+        uint32_t u = (uint32_t)imm;
+        return bits(u, 5, 4) << 11 | bits(u, 9, 6) << 7 | bits(u, 2, 2) << 6 | bits(u, 3, 3) << 5 | rvcReg(a[0]) << 2;
+    }
+    if (op == "slli") {
+        need(2);
+        int rd = parseReg(a[0]);
+        int32_t shamt = parseImmediate(a[1]);
+        check(rd != 0 && shamt >= 1 && shamt <= 31);
+        return (uint32_t)rd << 7 | (uint32_t)shamt << 2 | 2;
+    }
+    if (op == "srli" || op == "srai" || op == "andi") {
+        need(2);
+        int32_t imm = parseImmediate(a[1]);
+        check(op == "andi" ? imm >= -32 && imm <= 31 : imm >= 1 && imm <= 31);
+        uint32_t u = (uint32_t)imm;
+        uint32_t funct2 = op == "srli" ? 0 : op == "srai" ? 1 : 2;
+        return 4u << 13 | bits(u, 5, 5) << 12 | funct2 << 10 | rvcReg(a[0]) << 7 | bits(u, 4, 0) << 2 | 1;
+    }
+    if (op == "sub" || op == "xor" || op == "or" || op == "and") {
+        need(2);
+        uint32_t funct2 = op == "sub" ? 0 : op == "xor" ? 1 : op == "or" ? 2 : 3;
+        return 0x8c01 | rvcReg(a[0]) << 7 | funct2 << 5 | rvcReg(a[1]) << 2;
+    }
+    if (op == "lwsp" || op == "swsp") {
+        need(2);
+        int32_t offset;
+        std::string base;
+        memOperand(offset, base);
+        int reg = parseReg(a[0]);
+        check(parseReg(base) == 2 && offset >= 0 && offset <= 252 && offset % 4 == 0 && (op == "swsp" || reg != 0));
+        uint32_t u = (uint32_t)offset;
+        if (op == "lwsp") {
+            return 2u << 13 | bits(u, 5, 5) << 12 | (uint32_t)reg << 7 | bits(u, 4, 2) << 4 | bits(u, 7, 6) << 2 | 2;
+        }
+        return 6u << 13 | bits(u, 5, 2) << 9 | bits(u, 7, 6) << 7 | (uint32_t)reg << 2 | 2;
+    }
+    if (op == "lw" || op == "sw") {
+        need(2);
+        int32_t offset;
+        std::string base;
+        memOperand(offset, base);
+        check(offset >= 0 && offset <= 124 && offset % 4 == 0);
+        uint32_t u = (uint32_t)offset;
+        return (op == "lw" ? 2u : 6u) << 13 | bits(u, 5, 3) << 10 | rvcReg(base) << 7 | bits(u, 2, 2) << 6 |
+               bits(u, 6, 6) << 5 | rvcReg(a[0]) << 2;
+    }
+    if (op == "beqz" || op == "bnez") {
+        need(2);
+        uint32_t u = (uint32_t)delta;
+        return (op == "beqz" ? 6u : 7u) << 13 | bits(u, 8, 8) << 12 | bits(u, 4, 3) << 10 | rvcReg(a[0]) << 7 |
+               bits(u, 7, 6) << 5 | bits(u, 2, 1) << 3 | bits(u, 5, 5) << 2 | 1;
+    }
+    if (op == "j") {
+        need(1);
+        uint32_t u = (uint32_t)delta;
+        return 5u << 13 | bits(u, 11, 11) << 12 | bits(u, 4, 4) << 11 | bits(u, 9, 8) << 9 | bits(u, 10, 10) << 8 |
+               bits(u, 6, 6) << 7 | bits(u, 7, 7) << 6 | bits(u, 3, 1) << 3 | bits(u, 5, 5) << 2 | 1;
+    }
+    throw std::runtime_error("Unsupported instruction: " + ins.text());
+}
+
+// 压缩分支与跳转可达的偏移范围 [-limit, limit)
+static int32_t compressedLimit(const AsmInstr &ins) { return ins.op == "c.j" ? 1 << 11 : 1 << 8; }
+
+namespace {
+
+class ObjectAssembler {
+public:
+    explicit ObjectAssembler(const std::vector<AsmInstr> &program) : program(program) {}
+    ElfObject run();
+
+private:
+    struct Label {
+        Section section;
+        uint32_t offset;
+    };
+
+    const std::vector<AsmInstr> &program;
+    ElfObject object;
+    std::unordered_map<std::string, Label> labels;
+    std::vector<std::string> labelOrder;
+    std::vector<std::string> globals;
+    std::vector<uint32_t> offsets;            // 每条指令在 .text 中的偏移
+    std::unordered_set<size_t> longBranches;  // 目标超出 ±4KiB、改写为两条指令的条件分支
+    // 目标越界或不在本文件 .text 中的压缩分支与跳转，改用 32 位形式
+    std::unordered_map<size_t, AsmInstr> relaxed;
+    std::vector<std::pair<std::string, uint32_t>> pcrelLabels;
+
+    const AsmInstr &instrAt(size_t index) const;
+    void layout();
+    void emitData(const AsmInstr &ins, std::vector<uint8_t> &bytes, bool isText);
+    uint32_t sizeOf(size_t index) const;
+    void encode(size_t index);
+    int32_t resolve(const std::string &target, uint32_t offset, uint32_t relocType);
+    void buildSymbols();
+};
+
+}  // namespace
+
+const AsmInstr &ObjectAssembler::instrAt(size_t index) const {
+    auto it = relaxed.find(index);
+    return it == relaxed.end() ? program[index] : it->second;
+}
+
+uint32_t ObjectAssembler::sizeOf(size_t index) const {
+    const AsmInstr &ins = instrAt(index);
+    if (isCompressed(ins)) return 2;
+    if (ins.op == "call" || ins.op == "tail" || ins.op == "la") return 8;
+    if (ins.op == "li" && ins.args.size() == 2) return liSize(parseImmediate(ins.args[1]));
+    return longBranches.count(index) ? 8 : 4;
+}
+
+void ObjectAssembler::emitData(const AsmInstr &ins, std::vector<uint8_t> &bytes, bool isText) {
+    if (ins.op == ".word" || ins.op == ".half" || ins.op == ".byte") {
+        size_t size = ins.op == ".word" ? 4 : ins.op == ".half" ? 2 : 1;
+        for (auto &arg : ins.args) {
+            uint32_t value = (uint32_t)parseImmediate(arg);
+            for (size_t b = 0; b < size; b++) bytes.push_back((uint8_t)(value >> (8 * b)));
+        }
+    } else if (ins.op == ".zero") {
+        bytes.resize(bytes.size() + (uint32_t)parseImmediate(ins.args.at(0)));
+    } else if (ins.op == ".asciz" || ins.op == ".string") {
+        std::string s = unquoteString(ins.args.at(0));
+        bytes.insert(bytes.end(), s.begin(), s.end());
+        bytes.push_back(0);
+    } else if (ins.op == ".p2align" || ins.op == ".align") {
+        // 代码段以 nop 填充，含压缩指令时先以 c.nop 补齐到 4 字节
+        uint32_t align = 1u << parseImmediate(ins.args.at(0));
+        while (bytes.size() % align) {
+            if (isText && bytes.size() % 4 == 0) {
+                const uint8_t nop[4] = {0x13, 0, 0, 0};
+                bytes.insert(bytes.end(), nop, nop + 4);
+            } else if (isText && bytes.size() % 2 == 0) {
+                const uint8_t cnop[2] = {0x01, 0};
+                bytes.insert(bytes.end(), cnop, cnop + 2);
+            } else {
+                bytes.push_back(0);
+            }
+        }
+    }
+}
+
+// 确定各标签与指令的偏移；指令先以零占位，数据伪指令直接写入
+void ObjectAssembler::layout() {
+    object.text.clear();
+    object.data.clear();
+    labels.clear();
+    labelOrder.clear();
+    globals.clear();
+    offsets.assign(program.size(), 0);
+    Section section = Section::Text;
+    for (size_t i = 0; i < program.size(); i++) {
+        const AsmInstr &ins = program[i];
+        std::vector<uint8_t> &bytes = section == Section::Text ? object.text : object.data;
+        if (ins.isLabel()) {
+            if (!labels.emplace(ins.op, Label{section, (uint32_t)bytes.size()}).second) {
+                throw std::runtime_error("Duplicate label: " + ins.op);
+            }
+            labelOrder.push_back(ins.op);
+        } else if (ins.isInstr()) {
+            if (section != Section::Text) throw std::runtime_error("Instruction in data section: " + ins.text());
+            offsets[i] = (uint32_t)bytes.size();
+            bytes.resize(bytes.size() + sizeOf(i));
+        } else if (ins.op == ".text" || (ins.op == ".section" && !ins.args.empty() && ins.args[0] == ".text")) {
+            section = Section::Text;
+        } else if (ins.op == ".data" || ins.op == ".section") {
+            section = Section::Data;
+        } else if (ins.op == ".globl" || ins.op == ".global") {
+            for (auto &name : ins.args) {
+                if (std::find(globals.begin(), globals.end(), name) == globals.end()) globals.push_back(name);
+            }
+        } else {
+            emitData(ins, bytes, section == Section::Text);
+        }
+    }
+}
+
+// 分支、跳转目标的 PC 相对偏移；目标不在本文件的 .text 中时记录重定位并返回 0
+int32_t ObjectAssembler::resolve(const std::string &target, uint32_t offset, uint32_t relocType) {
+    auto it = labels.find(target);
+    if (it == labels.end()) {
+        object.relocs.push_back({offset, relocType, target, 0});
+        return 0;
+    }
+    if (it->second.section != Section::Text) throw std::runtime_error("Branch to a data label: " + target);
+    int32_t delta = (int32_t)(it->second.offset - offset);
+    int32_t limit = relocType == R_RISCV_BRANCH ? 1 << 12 : 1 << 20;
+    if (delta < -limit || delta >= limit) throw std::runtime_error("Branch target out of range: " + target);
+    return delta;
+}
+
+void ObjectAssembler::encode(size_t index) {
+    const AsmInstr &ins = instrAt(index);
+    const std::string &op = ins.op;
+    const auto &a = ins.args;
+    uint32_t offset = offsets[index];
+    uint32_t cursor = offset;
+    auto put = [&](uint32_t word) {
+        for (int b = 0; b < 4; b++) object.text[cursor++] = (uint8_t)(word >> (8 * b));
+    };
+    auto need = [&](size_t n) {
+        if (a.size() != n) throw std::runtime_error("Wrong operand count: " + ins.text());
+    };
+
+    uint32_t funct3;
+    int rs1, rs2;
+    std::string target;
+    if (isCompressed(ins)) {
+        // 留在压缩形式的分支，目标必在本文件 .text 中且在范围内
+        std::string label = branchTarget(ins);
+        int32_t delta = label.empty() ? 0 : (int32_t)(labels.at(label).offset - offset);
+        uint32_t half = encodeCompressed(ins, delta);
+        object.text[cursor++] = (uint8_t)half;
+        object.text[cursor++] = (uint8_t)(half >> 8);
+    } else if (decodeBranch(ins, funct3, rs1, rs2, target)) {
+        if (longBranches.count(index)) {
+            // 反向分支跳过紧随的 jal
+            put(bType(funct3 ^ 1, rs1, rs2, 8));
+            put(jType(0, resolve(target, offset + 4, R_RISCV_JAL)));
+        } else {
+            put(bType(funct3, rs1, rs2, resolve(target, offset, R_RISCV_BRANCH)));
+        }
+    } else if (kRTypeTable.count(op)) {
+        need(3);
+        put(rType(kRTypeTable.at(op), parseReg(a[0]), parseReg(a[1]), parseReg(a[2])));
+    } else if (kITypeTable.count(op)) {
+        need(3);
+        put(iType(kOpImm, kITypeTable.at(op), parseReg(a[0]), parseReg(a[1]), parseImmediate(a[2])));
+    } else if (kShiftTable.count(op)) {
+        need(3);
+        Funct f = kShiftTable.at(op);
+        int32_t shamt = parseImmediate(a[2]);
+        if (shamt < 0 || shamt > 31) throw std::runtime_error("Shift amount out of range: " + ins.text());
+        put(iType(kOpImm, f.funct3, parseReg(a[0]), parseReg(a[1]), (int32_t)(f.funct7 << 5) | shamt));
+    } else if (kLoadTable.count(op) || kStoreTable.count(op)) {
+        need(2);
+        int memOffset;
+        std::string base;
+        if (!parseMemOperand(a[1], memOffset, base)) throw std::runtime_error("Invalid memory operand: " + ins.text());
+        if (kLoadTable.count(op)) put(iType(kOpLoad, kLoadTable.at(op), parseReg(a[0]), parseReg(base), memOffset));
+        else put(sType(kStoreTable.at(op), parseReg(base), parseReg(a[0]), memOffset));
+    } else if (op == "li") {
+        need(2);
+        int rd = parseReg(a[0]);
+        int32_t value = parseImmediate(a[1]);
+        if (fitsImm12(value)) {
+            put(iType(kOpImm, 0, rd, 0, value));
+        } else {
+            int32_t lo = lowPart(value);
+            put(uType(kOpLui, rd, ((uint32_t)value - (uint32_t)lo) >> 12));
+            if (lo != 0) put(iType(kOpImm, 0, rd, rd, lo));
+        }
+    } else if (op == "lui" || op == "auipc") {
+        need(2);
+        put(uType(op == "lui" ? kOpLui : kOpAuipc, parseReg(a[0]), (uint32_t)parseImmediate(a[1])));
+    } else if (op == "la") {
+        // auipc 处的局部标签供 %pcrel_lo 引用
+        need(2);
+        int rd = parseReg(a[0]);
+        int32_t addend;
+        std::string symbol = splitSymbol(a[1], addend);
+        std::string hiLabel = ".Lpcrel_hi" + std::to_string(pcrelLabels.size());
+        pcrelLabels.push_back({hiLabel, offset});
+        object.relocs.push_back({offset, R_RISCV_PCREL_HI20, symbol, addend});
+        object.relocs.push_back({offset + 4, R_RISCV_PCREL_LO12_I, hiLabel, 0});
+        put(uType(kOpAuipc, rd, 0));
+        put(iType(kOpImm, 0, rd, rd, 0));
+    } else if (op == "call" || op == "tail") {
+        // call 经 ra 返回；tail 借 t1 跳转，不写 ra
+        need(1);
+        int32_t addend;
+        std::string symbol = splitSymbol(a[0], addend);
+        object.relocs.push_back({offset, R_RISCV_CALL, symbol, addend});
+        int link = op == "call" ? kRa : kT1;
+        put(uType(kOpAuipc, link, 0));
+        put(iType(kOpJalr, 0, op == "call" ? kRa : 0, link, 0));
+    } else if (op == "j" || op == "jal") {
+        int rd = op == "jal" ? kRa : 0;
+        if (op == "jal" && a.size() == 2) rd = parseReg(a[0]);
+        else need(1);
+        put(jType(rd, resolve(a.back(), offset, R_RISCV_JAL)));
+    } else if (op == "jr" || op == "ret") {
+        need(op == "jr" ? 1 : 0);
+        put(iType(kOpJalr, 0, 0, op == "ret" ? kRa : parseReg(a[0]), 0));
+    } else if (op == "jalr") {
+        int memOffset = 0;
+        std::string base;
+        if (a.size() == 1) put(iType(kOpJalr, 0, kRa, parseReg(a[0]), 0));
+        else if (a.size() == 2 && parseMemOperand(a[1], memOffset, base))
+            put(iType(kOpJalr, 0, parseReg(a[0]), parseReg(base), memOffset));
+        else if (a.size() == 3) put(iType(kOpJalr, 0, parseReg(a[0]), parseReg(a[1]), parseImmediate(a[2])));
+        else throw std::runtime_error("Wrong operand count: " + ins.text());
+    } else if (op == "mv") {
+        need(2);
+        put(iType(kOpImm, 0, parseReg(a[0]), parseReg(a[1]), 0));
+    } else if (op == "not") {
+        need(2);
+        put(iType(kOpImm, 4, parseReg(a[0]), parseReg(a[1]), -1));
+    } else if (op == "neg") {
+        need(2);
+        put(rType(kRTypeTable.at("sub"), parseReg(a[0]), 0, parseReg(a[1])));
+    } else if (op == "seqz") {
+        need(2);
+        put(iType(kOpImm, 3, parseReg(a[0]), parseReg(a[1]), 1));
+    } else if (op == "snez") {
+        need(2);
+        put(rType(kRTypeTable.at("sltu"), parseReg(a[0]), 0, parseReg(a[1])));
+    } else if (op == "sltz") {
+        need(2);
+        put(rType(kRTypeTable.at("slt"), parseReg(a[0]), parseReg(a[1]), 0));
+    } else if (op == "sgtz") {
+        need(2);
+        put(rType(kRTypeTable.at("slt"), parseReg(a[0]), 0, parseReg(a[1])));
+    } else if (op == "nop") {
+        need(0);
+        put(iType(kOpImm, 0, 0, 0, 0));
+    } else if (op == "ecall") {
+        need(0);
+        put(kOpSystem);
+    } else {
+        throw std::runtime_error("Unsupported instruction: " + ins.text());
+    }
+    if (cursor != offset + sizeOf(index)) throw std::runtime_error("Instruction size mismatch: " + ins.text());
+}
+
+// 局部符号在前：非 .L 标签与被重定位引用的 .L 标签；其后为 .globl 符号与引用到的未定义符号
+void ObjectAssembler::buildSymbols() {
+    std::unordered_set<std::string> referenced;
+    for (auto &reloc : object.relocs) referenced.insert(reloc.symbol);
+    std::unordered_set<std::string> globalSet(globals.begin(), globals.end());
+
+    auto defined = [&](const std::string &name, bool global) {
+        const Label &label = labels.at(name);
+        ElfSymbol sym;
+        sym.name = name;
+        sym.section = label.section;
+        sym.value = label.offset;
+        sym.global = global;
+        if (global && label.section == Section::Text) {
+            sym.function = true;
+            uint32_t end = (uint32_t)object.text.size();
+            for (auto &other : labels) {
+                if (other.second.section == Section::Text && globalSet.count(other.first) &&
+                    other.second.offset > label.offset) {
+                    end = std::min(end, other.second.offset);
+                }
+            }
+            sym.size = end - label.offset;
+        }
+        object.symbols.push_back(sym);
+    };
+
+    for (auto &name : labelOrder) {
+        if (globalSet.count(name)) continue;
+        if (name.rfind(".L", 0) != 0 || referenced.count(name)) defined(name, false);
+    }
+    for (auto &label : pcrelLabels) {
+        ElfSymbol sym;
+        sym.name = label.first;
+        sym.section = Section::Text;
+        sym.value = label.second;
+        object.symbols.push_back(sym);
+    }
+    std::vector<std::string> externals;
+    for (auto &reloc : object.relocs) {
+        if (!labels.count(reloc.symbol) && !globalSet.count(reloc.symbol) &&
+            reloc.symbol.rfind(".Lpcrel_hi", 0) != 0 &&
+            std::find(externals.begin(), externals.end(), reloc.symbol) == externals.end()) {
+            externals.push_back(reloc.symbol);
+        }
+    }
+    for (auto &name : globals) {
+        if (labels.count(name)) {
+            defined(name, true);
+        } else {
+            ElfSymbol sym;
+            sym.name = name;
+            sym.global = true;
+            object.symbols.push_back(sym);
+        }
+    }
+    for (auto &name : externals) {
+        ElfSymbol sym;
+        sym.name = name;
+        sym.global = true;
+        object.symbols.push_back(sym);
+    }
+}
+
+ElfObject ObjectAssembler::run() {
+    // 逐轮把越界的压缩分支改为 32 位形式、越界的条件分支改为长形式，
+    // 直到布局稳定（只增不减，必然收敛）
+    for (;;) {
+        layout();
+        bool grew = false;
+        for (size_t i = 0; i < program.size(); i++) {
+            const AsmInstr &ins = instrAt(i);
+            if (isCompressed(ins) && (isCondBranch(ins) || ins.op == "c.j")) {
+                auto it = labels.find(branchTarget(ins));
+                int32_t limit = compressedLimit(ins);
+                int32_t delta = it == labels.end() ? 0 : (int32_t)(it->second.offset - offsets[i]);
+                if (it == labels.end() || it->second.section != Section::Text || delta < -limit || delta >= limit) {
+                    relaxed[i] = expandCompressed(ins);
+                    grew = true;
+                }
+                continue;
+            }
+            uint32_t funct3;
+            int rs1, rs2;
+            std::string target;
+            if (!ins.isInstr() || longBranches.count(i) || !decodeBranch(ins, funct3, rs1, rs2, target)) {
+                continue;
+            }
+            auto it = labels.find(target);
+            if (it == labels.end() || it->second.section != Section::Text) continue;
+            int32_t delta = (int32_t)(it->second.offset - offsets[i]);
+            if (delta < -4096 || delta > 4094) {
+                longBranches.insert(i);
+                grew = true;
+            }
+        }
+        if (!grew) break;
+    }
+    for (size_t i = 0; i < program.size(); i++) {
+        if (!program[i].isInstr()) continue;
+        encode(i);
+        if (isCompressed(instrAt(i))) object.rvc = true;
+    }
+    buildSymbols();
+    return std::move(object);
+}
+
+ElfObject assembleObject(const std::vector<AsmInstr> &program) {
+    return ObjectAssembler(program).run();
+}
+
+// ---------------- ELF32 文件格式 ----------------
+
+enum : uint32_t {
+    kEhdrSize = 52, kShdrSize = 40, kSymSize = 16, kRelaSize = 12,
+    kEmRiscv = 243, kEtRel = 1,
+    kShtProgbits = 1, kShtSymtab = 2, kShtStrtab = 3, kShtRela = 4,
+    kShfWrite = 1, kShfAlloc = 2, kShfExec = 4, kShfInfoLink = 0x40,
+    kSttNotype = 0, kSttFunc = 2, kSttSection = 3, kSttFile = 4,
+    kStbLocal = 0, kStbGlobal = 1,
+    kEfRiscvRvc = 1,
+};
+
+static void put16(std::vector<uint8_t> &buf, uint32_t value) {
+    buf.push_back((uint8_t)value);
+    buf.push_back((uint8_t)(value >> 8));
+}
+
+static void put32(std::vector<uint8_t> &buf, uint32_t value) {
+    put16(buf, value);
+    put16(buf, value >> 16);
+}
+
+static void alignTo(std::vector<uint8_t> &buf, size_t align) {
+    while (buf.size() % align) buf.push_back(0);
+}
+
+namespace {
+
+// 字符串表，0 号为空串
+struct StringTable {
+    std::vector<uint8_t> bytes{0};
+
+    uint32_t add(const std::string &s) {
+        uint32_t offset = (uint32_t)bytes.size();
+        bytes.insert(bytes.end(), s.begin(), s.end());
+        bytes.push_back(0);
+        return offset;
+    }
+};
+
+struct SectionHeader {
+    uint32_t name, type, flags, offset, size, link, info, align, entsize;
+};
+
+}  // namespace
+
+void writeElf(std::ostream &out, const ElfObject &object) {
+    enum { kText = 1, kData, kRela, kSymtab, kStrtab, kShstrtab, kSectionCount };
+
+    // 符号表：局部符号必须排在全局符号之前
+    std::vector<const ElfSymbol *> order;
+    for (auto &sym : object.symbols) {
+        if (!sym.global) order.push_back(&sym);
+    }
+    uint32_t firstGlobal = (uint32_t)order.size() + 1;
+    for (auto &sym : object.symbols) {
+        if (sym.global) order.push_back(&sym);
+    }
+    std::unordered_map<std::string, uint32_t> symIndex;
+    StringTable strtab;
+    std::vector<uint8_t> symtab(kSymSize, 0);
+    for (auto *sym : order) {
+        symIndex[sym->name] = (uint32_t)(symtab.size() / kSymSize);
+        uint32_t shndx = sym->section == Section::Text ? kText : sym->section == Section::Data ? kData : 0;
+        put32(symtab, strtab.add(sym->name));
+        put32(symtab, sym->value);
+        put32(symtab, sym->size);
+        symtab.push_back((uint8_t)((sym->global ? kStbGlobal : kStbLocal) << 4 | (sym->function ? kSttFunc : kSttNotype)));
+        symtab.push_back(0);
+        put16(symtab, shndx);
+    }
+
+    std::vector<uint8_t> rela;
+    for (auto &reloc : object.relocs) {
+        auto it = symIndex.find(reloc.symbol);
+        if (it == symIndex.end()) throw std::runtime_error("Relocation against unknown symbol: " + reloc.symbol);
+        put32(rela, reloc.offset);
+        put32(rela, it->second << 8 | reloc.type);
+        put32(rela, (uint32_t)reloc.addend);
+    }
+
+    StringTable shstrtab;
+    SectionHeader headers[kSectionCount] = {};
+    std::vector<uint8_t> file(kEhdrSize, 0);
+    auto place = [&](int index, const char *name, uint32_t type, uint32_t flags, const std::vector<uint8_t> &bytes,
+                     uint32_t align, uint32_t entsize) {
+        alignTo(file, align);
+        headers[index] = {shstrtab.add(name), type, flags, (uint32_t)file.size(), (uint32_t)bytes.size(),
+                          0, 0, align, entsize};
+        file.insert(file.end(), bytes.begin(), bytes.end());
+    };
+    place(kText, ".text", kShtProgbits, kShfAlloc | kShfExec, object.text, 4, 0);
+    place(kData, ".data", kShtProgbits, kShfAlloc | kShfWrite, object.data, 4, 0);
+    place(kRela, ".rela.text", kShtRela, kShfInfoLink, rela, 4, kRelaSize);
+    headers[kRela].link = kSymtab;
+    headers[kRela].info = kText;
+    place(kSymtab, ".symtab", kShtSymtab, 0, symtab, 4, kSymSize);
+    headers[kSymtab].link = kStrtab;
+    headers[kSymtab].info = firstGlobal;
+    place(kStrtab, ".strtab", kShtStrtab, 0, strtab.bytes, 1, 0);
+    uint32_t shstrName = shstrtab.add(".shstrtab");
+    place(kShstrtab, ".shstrtab", kShtStrtab, 0, shstrtab.bytes, 1, 0);
+    headers[kShstrtab].name = shstrName;
+    alignTo(file, 4);
+    uint32_t shoff = (uint32_t)file.size();
+    for (auto &h : headers) {
+        for (uint32_t field : {h.name, h.type, h.flags, 0u, h.offset, h.size, h.link, h.info, h.align, h.entsize}) {
+            put32(file, field);
+        }
+    }
+
+    // ELF 头
+    std::vector<uint8_t> ehdr = {0x7f, 'E', 'L', 'F', 1 /* ELFCLASS32 */, 1 /* 小端 */, 1 /* EV_CURRENT */};
+    ehdr.resize(16, 0);
+    put16(ehdr, kEtRel);
+    put16(ehdr, kEmRiscv);
+    put32(ehdr, 1);      // e_version
+    put32(ehdr, 0);      // e_entry
+    put32(ehdr, 0);      // e_phoff
+    put32(ehdr, shoff);
+    put32(ehdr, object.rvc ? (uint32_t)kEfRiscvRvc : 0u);  // e_flags：软浮点 ABI
+    put16(ehdr, kEhdrSize);
+    put16(ehdr, 0);      // e_phentsize
+    put16(ehdr, 0);      // e_phnum
+    put16(ehdr, kShdrSize);
+    put16(ehdr, kSectionCount);
+    put16(ehdr, kShstrtab);
+    std::copy(ehdr.begin(), ehdr.end(), file.begin());
+
+    out.write(reinterpret_cast<const char *>(file.data()), (std::streamsize)file.size());
+}
+
+ElfObject readElf(const std::string &bytes) {
+    auto get16 = [&](size_t offset) -> uint32_t {
+        if (offset + 2 > bytes.size()) throw std::runtime_error("Truncated ELF file");
+        return (uint8_t)bytes[offset] | (uint32_t)(uint8_t)bytes[offset + 1] << 8;
+    };
+    auto get32 = [&](size_t offset) { return get16(offset) | get16(offset + 2) << 16; };
+    if (bytes.size() < kEhdrSize || bytes.compare(0, 4, "\x7f" "ELF") != 0 || bytes[4] != 1 || bytes[5] != 1 ||
+        get16(16) != kEtRel || get16(18) != kEmRiscv) {
+        throw std::runtime_error("Not a RV32 relocatable ELF object");
+    }
+    uint32_t shoff = get32(32), shnum = get16(48), shstrndx = get16(50);
+    std::vector<SectionHeader> headers(shnum);
+    for (uint32_t i = 0; i < shnum; i++) {
+        size_t base = shoff + (size_t)i * kShdrSize;
+        headers[i] = {get32(base), get32(base + 4), get32(base + 8), get32(base + 16), get32(base + 20),
+                      get32(base + 24), get32(base + 28), get32(base + 32), get32(base + 36)};
+        if ((size_t)headers[i].offset + headers[i].size > bytes.size() && headers[i].type != 8 /* NOBITS */) {
+            throw std::runtime_error("Truncated ELF file");
+        }
+    }
+    auto cstring = [&](const SectionHeader &table, uint32_t offset) {
+        return std::string(bytes.c_str() + table.offset + offset);
+    };
+    auto sectionName = [&](uint32_t index) { return cstring(headers.at(shstrndx), headers.at(index).name); };
+    auto contents = [&](const SectionHeader &h) {
+        return std::vector<uint8_t>(bytes.begin() + h.offset, bytes.begin() + h.offset + h.size);
+    };
+
+    ElfObject object;
+    object.rvc = (get32(36) & kEfRiscvRvc) != 0;
+    int textIndex = -1, symtabIndex = -1;
+    for (uint32_t i = 1; i < shnum; i++) {
+        std::string name = sectionName(i);
+        if (name == ".text") {
+            object.text = contents(headers[i]);
+            textIndex = (int)i;
+        } else if (name == ".data") {
+            object.data = contents(headers[i]);
+        } else if (headers[i].type == kShtSymtab) {
+            symtabIndex = (int)i;
+        }
+    }
+    if (symtabIndex < 0) return object;
+
+    // 符号：跳过节符号与文件符号；重定位引用节符号时以节名代替
+    const SectionHeader &symtab = headers[symtabIndex];
+    const SectionHeader &strtab = headers.at(symtab.link);
+    std::vector<std::string> names;
+    for (uint32_t offset = 0; offset + kSymSize <= symtab.size; offset += kSymSize) {
+        size_t base = symtab.offset + offset;
+        uint32_t info = (uint8_t)bytes[base + 12], shndx = get16(base + 14);
+        uint32_t type = info & 0xf;
+        std::string name = cstring(strtab, get32(base));
+        if (type == kSttSection) name = sectionName(shndx);
+        names.push_back(name);
+        if (offset == 0 || type == kSttSection || type == kSttFile) continue;
+        ElfSymbol sym;
+        sym.name = name;
+        sym.value = get32(base + 4);
+        sym.size = get32(base + 8);
+        sym.global = (info >> 4) != kStbLocal;
+        sym.function = type == kSttFunc;
+        if (shndx != 0) {
+            std::string section = shndx < shnum ? sectionName(shndx) : "";
+            sym.section = section == ".text" ? Section::Text : section == ".data" ? Section::Data : Section::Other;
+        }
+        object.symbols.push_back(sym);
+    }
+    for (uint32_t i = 1; i < shnum; i++) {
+        if (headers[i].type != kShtRela || (int)headers[i].info != textIndex) continue;
+        for (uint32_t offset = 0; offset + kRelaSize <= headers[i].size; offset += kRelaSize) {
+            size_t base = headers[i].offset + offset;
+            uint32_t info = get32(base + 4);
+            object.relocs.push_back({get32(base), info & 0xff, names.at(info >> 8), (int32_t)get32(base + 8)});
+        }
+    }
+    return object;
+}
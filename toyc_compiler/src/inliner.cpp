@@ -0,0 +1,429 @@
+#include "inliner.h"
+#include <algorithm>
+
+static bool containsCall(const Expr *expr) {
+    if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        return containsCall(unary->operand.get());
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        return containsCall(bin->lhs.get()) || containsCall(bin->rhs.get());
+    }
+    return dynamic_cast<const CallExpr *>(expr) != nullptr;
+}
+
+static bool referencesVar(const Expr *expr, const std::string &name) {
+    if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+        return var->name == name;
+    } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        return referencesVar(unary->operand.get(), name);
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        return referencesVar(bin->lhs.get(), name) || referencesVar(bin->rhs.get(), name);
+    } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+        for (auto &arg : call->args) {
+            if (referencesVar(arg.get(), name)) return true;
+        }
+    }
+    return false;
+}
+
+static void countUses(const Expr *expr, std::unordered_map<std::string, int> &uses) {
+    if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+        uses[var->name]++;
+    } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        countUses(unary->operand.get(), uses);
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        countUses(bin->lhs.get(), uses);
+        countUses(bin->rhs.get(), uses);
+    } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+        for (auto &arg : call->args) countUses(arg.get(), uses);
+    }
+}
+
+// 形参替换为实参的副本（ToyC 函数没有副作用，重复求值不改变语义）
+static void substitute(std::unique_ptr<Expr> &slot, const std::unordered_map<std::string, Expr *> &args) {
+    if (auto var = dynamic_cast<VarExpr *>(slot.get())) {
+        auto it = args.find(var->name);
+        if (it != args.end()) slot = cloneExpr(it->second);
+    } else if (auto unary = dynamic_cast<UnaryExpr *>(slot.get())) {
+        substitute(unary->operand, args);
+    } else if (auto bin = dynamic_cast<BinaryExpr *>(slot.get())) {
+        substitute(bin->lhs, args);
+        substitute(bin->rhs, args);
+    } else if (auto call = dynamic_cast<CallExpr *>(slot.get())) {
+        for (auto &arg : call->args) substitute(arg, args);
+    }
+}
+
+static int countReturns(const Stmt *stmt) {
+    if (dynamic_cast<const ReturnStmt *>(stmt)) return 1;
+    if (auto block = dynamic_cast<const Block *>(stmt)) {
+        int n = 0;
+        for (auto &s : block->stmts) n += countReturns(s.get());
+        return n;
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        return countReturns(ifStmt->thenBlock.get()) +
+               (ifStmt->elseBlock ? countReturns(ifStmt->elseBlock.get()) : 0);
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+        return countReturns(whileStmt->body.get());
+    }
+    return 0;
+}
+
+// 函数体只有一条 return 表达式时返回该语句
+static ReturnStmt *singleReturn(FuncDef *func) {
+    if (func->body->stmts.size() != 1) return nullptr;
+    auto ret = dynamic_cast<ReturnStmt *>(func->body->stmts[0].get());
+    return ret && ret->expr ? ret : nullptr;
+}
+
+// 按作用域重命名被内联函数体中的变量
+namespace {
+struct Renamer {
+    std::vector<std::unordered_map<std::string, std::string>> scopes;
+    std::string suffix;
+
+    std::string lookup(const std::string &name) const {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end()) return found->second;
+        }
+        return name;
+    }
+
+    std::string declare(const std::string &name) {
+        std::string fresh = name + suffix;
+        scopes.back()[name] = fresh;
+        return fresh;
+    }
+
+    void expr(Expr *e) {
+        if (auto var = dynamic_cast<VarExpr *>(e)) {
+            var->name = lookup(var->name);
+        } else if (auto unary = dynamic_cast<UnaryExpr *>(e)) {
+            expr(unary->operand.get());
+        } else if (auto bin = dynamic_cast<BinaryExpr *>(e)) {
+            expr(bin->lhs.get());
+            expr(bin->rhs.get());
+        } else if (auto call = dynamic_cast<CallExpr *>(e)) {
+            for (auto &arg : call->args) expr(arg.get());
+        }
+    }
+
+    void block(Block *b) {
+        scopes.emplace_back();
+        for (auto &s : b->stmts) stmt(s.get());
+        scopes.pop_back();
+    }
+
+    void stmt(Stmt *s) {
+        if (auto decl = dynamic_cast<VarDeclStmt *>(s)) {
+            if (decl->initializer) expr(decl->initializer.get());
+            decl->name = declare(decl->name);
+        } else if (auto assign = dynamic_cast<AssignStmt *>(s)) {
+            expr(assign->value.get());
+            assign->name = lookup(assign->name);
+        } else if (auto exprStmt = dynamic_cast<ExprStmt *>(s)) {
+            expr(exprStmt->expr.get());
+        } else if (auto ret = dynamic_cast<ReturnStmt *>(s)) {
+            if (ret->expr) expr(ret->expr.get());
+        } else if (auto b = dynamic_cast<Block *>(s)) {
+            block(b);
+        } else if (auto ifStmt = dynamic_cast<IfStmt *>(s)) {
+            expr(ifStmt->condition.get());
+            block(ifStmt->thenBlock.get());
+            if (ifStmt->elseBlock) block(ifStmt->elseBlock.get());
+        } else if (auto whileStmt = dynamic_cast<WhileStmt *>(s)) {
+            expr(whileStmt->condition.get());
+            block(whileStmt->body.get());
+        }
+    }
+};
+} // namespace
+
+Inliner::Inliner(const InlineOptions &options, std::ostream &os) : opts(options), remarkOut(os) {}
+
+int Inliner::run(std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    inlinedCount = 0;
+    if (!opts.enabled) return 0;
+
+    CallGraph callGraph(funcs);
+    graph = &callGraph;
+    // 自底向上处理，被调用者先完成内联再被复制进调用者
+    for (auto &scc : callGraph.sccs()) {
+        for (size_t f : scc) {
+            caller = callGraph.func(f);
+            if (!caller->body) continue;
+            callerSize = countNodes(caller->body.get());
+            inlineBlock(caller->body.get(), Context());
+        }
+    }
+    graph = nullptr;
+    caller = nullptr;
+    return inlinedCount;
+}
+
+void Inliner::remark(FuncDef *callee, bool inlined, const std::string &detail) const {
+    if (!opts.remarks) return;
+    if (inlined) {
+        remarkOut << "remark: inlined '" << callee->name << "' into '" << caller->name
+                  << "' (" << detail << ")\n";
+    } else {
+        remarkOut << "remark: '" << callee->name << "' not inlined into '" << caller->name
+                  << "': " << detail << "\n";
+    }
+}
+
+FuncDef *Inliner::calleeOf(CallExpr *call, Context ctx, std::string &reason) const {
+    int index = graph->indexOf(call->callee);
+    if (index < 0) return nullptr;
+    FuncDef *callee = graph->func(index);
+    if (!callee->body) return nullptr;
+    if (graph->isRecursive(index) && ctx.recursionDepth >= opts.recursiveDepth) {
+        reason = "callee is recursive";
+        return nullptr;
+    }
+    if (call->args.size() != callee->params.size()) {
+        reason = "argument count mismatch";
+        return nullptr;
+    }
+    return callee;
+}
+
+bool Inliner::shouldInline(FuncDef *callee, const CallExpr *call, int cost, Context ctx,
+                           std::string &reason) const {
+    int threshold = opts.threshold * (ctx.loopDepth > 0 ? opts.loopMultiplier : 1);
+    std::string heat;
+    if (opts.profile && opts.profile->isCold(call->profileId)) {
+        threshold = 0;
+        heat = ", cold call site";
+    } else if (opts.profile && opts.profile->isHot(call->profileId)) {
+        threshold *= opts.hotMultiplier;
+        heat = ", hot call site";
+    }
+    std::string costs = "cost=" + std::to_string(cost) + ", threshold=" + std::to_string(threshold) + heat;
+    if (cost > threshold) {
+        reason = costs + " too costly";
+        return false;
+    }
+    if (callerSize + countNodes(callee->body.get()) > opts.maxCallerSize) {
+        reason = "caller size limit " + std::to_string(opts.maxCallerSize) + " reached";
+        return false;
+    }
+    reason = costs;
+    return true;
+}
+
+void Inliner::inlineBlock(Block *block, Context ctx) {
+    for (size_t i = 0; i < block->stmts.size(); i++) {
+        inlineStmt(block->stmts, i, ctx);
+    }
+}
+
+void Inliner::inlineStmt(std::vector<std::unique_ptr<Stmt>> &stmts, size_t &index, Context ctx) {
+    Stmt *stmt = stmts[index].get();
+
+    std::unique_ptr<Expr> *root = nullptr;
+    if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
+        if (decl->initializer) root = &decl->initializer;
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        root = &assign->value;
+    } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+        root = &exprStmt->expr;
+    } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        if (ret->expr) root = &ret->expr;
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        inlineBlock(block, ctx);
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        inlineExpr(ifStmt->condition, ctx);
+        inlineBlock(ifStmt->thenBlock.get(), ctx);
+        if (ifStmt->elseBlock) inlineBlock(ifStmt->elseBlock.get(), ctx);
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        Context inner = ctx;
+        inner.loopDepth++;
+        inlineExpr(whileStmt->condition, inner);
+        inlineBlock(whileStmt->body.get(), inner);
+    }
+    if (!root) return;
+
+    // 语句根部的调用：被调用者不是单条 return 时在语句级展开
+    auto call = dynamic_cast<CallExpr *>(root->get());
+    int calleeIndex = call ? graph->indexOf(call->callee) : -1;
+    if (calleeIndex >= 0 && graph->func(calleeIndex)->body && !singleReturn(graph->func(calleeIndex))) {
+        for (auto &arg : call->args) inlineExpr(arg, ctx);
+        inlineCallStmt(stmts, index, call, ctx);
+        return;
+    }
+    inlineExpr(*root, ctx);
+}
+
+void Inliner::inlineExpr(std::unique_ptr<Expr> &slot, Context ctx) {
+    if (auto unary = dynamic_cast<UnaryExpr *>(slot.get())) {
+        inlineExpr(unary->operand, ctx);
+        return;
+    } else if (auto bin = dynamic_cast<BinaryExpr *>(slot.get())) {
+        inlineExpr(bin->lhs, ctx);
+        inlineExpr(bin->rhs, ctx);
+        return;
+    }
+    auto call = dynamic_cast<CallExpr *>(slot.get());
+    if (!call) return;
+    for (auto &arg : call->args) inlineExpr(arg, ctx);
+
+    std::string reason;
+    FuncDef *callee = calleeOf(call, ctx, reason);
+    if (!callee) {
+        if (!reason.empty()) remark(graph->func(graph->indexOf(call->callee)), false, reason);
+        return;
+    }
+    ReturnStmt *ret = singleReturn(callee);
+    if (!ret) {
+        remark(callee, false, "call is not at statement level");
+        return;
+    }
+
+    // 被多次引用的复杂实参会被重复求值，计入代价；含调用的实参不复制
+    std::unordered_map<std::string, int> uses;
+    countUses(ret->expr.get(), uses);
+    std::unordered_map<std::string, Expr *> args;
+    int duplicated = 0;
+    for (size_t i = 0; i < callee->params.size(); i++) {
+        Expr *arg = call->args[i].get();
+        int n = uses[callee->params[i].name];
+        args[callee->params[i].name] = arg;
+        if (n <= 1 || dynamic_cast<VarExpr *>(arg) || dynamic_cast<NumberExpr *>(arg)) continue;
+        if (containsCall(arg)) {
+            remark(callee, false, "argument containing a call is used more than once");
+            return;
+        }
+        duplicated += countNodes(arg) * (n - 1);
+    }
+
+    int cost = countNodes(ret->expr.get()) + duplicated - opts.callOverhead - (int)call->args.size();
+    if (!shouldInline(callee, call, cost, ctx, reason)) {
+        remark(callee, false, reason);
+        return;
+    }
+
+    auto replacement = cloneExpr(ret->expr.get());
+    substitute(replacement, args);
+    callerSize += countNodes(replacement.get());
+    slot = std::move(replacement);
+    inlinedCount++;
+    remark(callee, true, reason);
+
+    if (graph->isRecursive(graph->indexOf(callee->name))) {
+        Context inner = ctx;
+        inner.recursionDepth++;
+        inlineExpr(slot, inner);
+    }
+}
+
+std::unique_ptr<Block> Inliner::renameBody(FuncDef *callee, std::vector<std::string> &paramNames) {
+    // 带 '.' 的新名字不可能与源程序中的标识符冲突
+    Renamer renamer;
+    renamer.suffix = "." + callee->name + "." + std::to_string(++renameCount);
+    renamer.scopes.emplace_back();
+    for (auto &param : callee->params) paramNames.push_back(renamer.declare(param.name));
+
+    auto body = cloneBlock(callee->body.get());
+    renamer.scopes.emplace_back();
+    for (auto &s : body->stmts) renamer.stmt(s.get());
+    return body;
+}
+
+bool Inliner::inlineCallStmt(std::vector<std::unique_ptr<Stmt>> &stmts, size_t &index,
+                             CallExpr *call, Context ctx) {
+    std::string reason;
+    FuncDef *callee = calleeOf(call, ctx, reason);
+    if (!callee) {
+        if (!reason.empty()) remark(graph->func(graph->indexOf(call->callee)), false, reason);
+        return false;
+    }
+
+    Stmt *stmt = stmts[index].get();
+    auto &calleeStmts = callee->body->stmts;
+    auto lastRet = calleeStmts.empty() ? nullptr : dynamic_cast<ReturnStmt *>(calleeStmts.back().get());
+    if (countReturns(callee->body.get()) > (lastRet ? 1 : 0)) {
+        remark(callee, false, "callee has multiple return points");
+        return false;
+    }
+    bool needsValue = !dynamic_cast<ExprStmt *>(stmt);
+    if (needsValue && !(lastRet && lastRet->expr) &&
+        !(dynamic_cast<ReturnStmt *>(stmt) && !static_cast<ReturnStmt *>(stmt)->expr)) {
+        remark(callee, false, "callee does not return a value");
+        return false;
+    }
+
+    int cost = countNodes(callee->body.get()) - opts.callOverhead;
+    if (!shouldInline(callee, call, cost, ctx, reason)) {
+        remark(callee, false, reason);
+        return false;
+    }
+
+    // { int p' = arg; ...; 被调用者语句; 目标 = 返回值; }
+    std::vector<std::string> paramNames;
+    auto body = renameBody(callee, paramNames);
+    std::unique_ptr<Expr> value;
+    if (lastRet) {
+        value = std::move(static_cast<ReturnStmt *>(body->stmts.back().get())->expr);
+        body->stmts.pop_back();
+    }
+
+    auto decl = dynamic_cast<VarDeclStmt *>(stmt);
+    bool argsUseDecl = false;
+    if (decl) {
+        for (auto &arg : call->args) argsUseDecl = argsUseDecl || referencesVar(arg.get(), decl->name);
+    }
+
+    auto expansion = std::make_unique<Block>();
+    for (size_t i = 0; i < paramNames.size(); i++) {
+        expansion->stmts.push_back(std::make_unique<VarDeclStmt>("int", paramNames[i], std::move(call->args[i])));
+    }
+    for (auto &s : body->stmts) expansion->stmts.push_back(std::move(s));
+
+    std::vector<std::unique_ptr<Stmt>> replacement;
+    if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        auto newRet = std::make_unique<ReturnStmt>();
+        if (ret->expr) newRet->expr = std::move(value);
+        expansion->stmts.push_back(std::move(newRet));
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        expansion->stmts.push_back(std::make_unique<AssignStmt>(assign->name, std::move(value)));
+    } else if (dynamic_cast<ExprStmt *>(stmt)) {
+        if (value && containsCall(value.get())) {
+            expansion->stmts.push_back(std::make_unique<ExprStmt>(std::move(value)));
+        }
+    } else if (decl && !argsUseDecl) {
+        // int x = f(...); => int x = 0; { ...; x = 返回值; }
+        replacement.push_back(std::make_unique<VarDeclStmt>(decl->varType, decl->name, std::make_unique<NumberExpr>(0)));
+        expansion->stmts.push_back(std::make_unique<AssignStmt>(decl->name, std::move(value)));
+    } else if (decl) {
+        // 实参引用了外层同名变量，先经临时变量中转
+        std::string tmp = decl->name + "." + callee->name + ".ret" + std::to_string(renameCount);
+        replacement.push_back(std::make_unique<VarDeclStmt>("int", tmp, std::make_unique<NumberExpr>(0)));
+        expansion->stmts.push_back(std::make_unique<AssignStmt>(tmp, std::move(value)));
+    }
+
+    Block *inserted = expansion.get();
+    replacement.push_back(std::move(expansion));
+    if (decl && argsUseDecl) {
+        std::string tmp = decl->name + "." + callee->name + ".ret" + std::to_string(renameCount);
+        replacement.push_back(std::make_unique<VarDeclStmt>(decl->varType, decl->name, std::make_unique<VarExpr>(tmp)));
+    }
+
+    callerSize += countNodes(inserted);
+    inlinedCount++;
+    remark(callee, true, reason);
+
+    size_t count = replacement.size();
+    stmts.erase(stmts.begin() + index);
+    for (size_t i = 0; i < count; i++) {
+        stmts.insert(stmts.begin() + index + i, std::move(replacement[i]));
+    }
+
+    if (graph->isRecursive(graph->indexOf(callee->name))) {
+        Context inner = ctx;
+        inner.recursionDepth++;
+        inlineBlock(inserted, inner);
+    }
+    index += count - 1;
+    return true;
+}
@@ -0,0 +1,114 @@
+#include "interpreter.h"
+#include <stdexcept>
+
+AstInterpreter::AstInterpreter(const std::vector<std::unique_ptr<FuncDef>> &program) {
+    for (auto &func : program) {
+        if (!funcs.emplace(func->name, func.get()).second) {
+            throw std::runtime_error("Duplicate function: " + func->name);
+        }
+    }
+}
+
+int32_t AstInterpreter::run(const std::string &entry, const std::vector<int32_t> &args) {
+    auto it = funcs.find(entry);
+    if (it == funcs.end()) throw std::runtime_error("Undefined function: " + entry);
+    depth = 0;
+    return call(it->second, args);
+}
+
+int32_t AstInterpreter::call(const FuncDef *func, const std::vector<int32_t> &args) {
+    if (func->params.size() != args.size()) throw std::runtime_error("Wrong argument count in call to " + func->name);
+    if (++depth > kMaxDepth) throw std::runtime_error("Recursion too deep in call to " + func->name);
+    Env env{func, {}};
+    env.scopes.emplace_back();
+    for (size_t i = 0; i < args.size(); i++) env.scopes.back()[func->params[i].name] = args[i];
+    if (func->body) exec(env, func->body.get());
+    depth--;
+    return env.result;
+}
+
+int32_t &AstInterpreter::lookup(Env &env, const std::string &name) {
+    for (auto it = env.scopes.rbegin(); it != env.scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) return found->second;
+    }
+    throw std::runtime_error("Undefined variable: " + name + " in function " + env.func->name);
+}
+
+int32_t AstInterpreter::eval(Env &env, const Expr *expr) {
+    if (auto num = dynamic_cast<const NumberExpr *>(expr)) {
+        return num->value;
+    } else if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+        return lookup(env, var->name);
+    } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        int32_t value = eval(env, unary->operand.get());
+        if (unary->op == "-") return (int32_t)(0u - (uint32_t)value);
+        if (unary->op == "!") return value == 0;
+        return value;
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        const std::string &op = bin->op;
+        if (op == "&&") return eval(env, bin->lhs.get()) != 0 && eval(env, bin->rhs.get()) != 0;
+        if (op == "||") return eval(env, bin->lhs.get()) != 0 || eval(env, bin->rhs.get()) != 0;
+        int32_t lhs = eval(env, bin->lhs.get());
+        int32_t rhs = eval(env, bin->rhs.get());
+        if (op == "+") return (int32_t)((uint32_t)lhs + (uint32_t)rhs);
+        if (op == "-") return (int32_t)((uint32_t)lhs - (uint32_t)rhs);
+        if (op == "*") return (int32_t)((uint32_t)lhs * (uint32_t)rhs);
+        if (op == "/") return rhs == 0 ? -1 : rhs == -1 ? (int32_t)(0u - (uint32_t)lhs) : lhs / rhs;
+        if (op == "%") return rhs == 0 ? lhs : rhs == -1 ? 0 : lhs % rhs;
+        if (op == "<") return lhs < rhs;
+        if (op == ">") return lhs > rhs;
+        if (op == "<=") return lhs <= rhs;
+        if (op == ">=") return lhs >= rhs;
+        if (op == "==") return lhs == rhs;
+        if (op == "!=") return lhs != rhs;
+        throw std::runtime_error("Unsupported operator: " + op);
+    } else if (auto callExpr = dynamic_cast<const CallExpr *>(expr)) {
+        auto it = funcs.find(callExpr->callee);
+        if (it == funcs.end()) throw std::runtime_error("Undefined function: " + callExpr->callee);
+        std::vector<int32_t> args;
+        for (auto &arg : callExpr->args) args.push_back(eval(env, arg.get()));
+        return call(it->second, args);
+    }
+    throw std::runtime_error("Unsupported expression in function " + env.func->name);
+}
+
+AstInterpreter::Flow AstInterpreter::exec(Env &env, const Stmt *stmt) {
+    if (auto block = dynamic_cast<const Block *>(stmt)) {
+        env.scopes.emplace_back();
+        Flow flow = Flow::Normal;
+        for (auto &s : block->stmts) {
+            flow = exec(env, s.get());
+            if (flow != Flow::Normal) break;
+        }
+        env.scopes.pop_back();
+        return flow;
+    } else if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+        int32_t value = decl->initializer ? eval(env, decl->initializer.get()) : 0;
+        env.scopes.back()[decl->name] = value;
+    } else if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+        int32_t value = eval(env, assign->value.get());
+        lookup(env, assign->name) = value;
+    } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(stmt)) {
+        if (exprStmt->expr) eval(env, exprStmt->expr.get());
+    } else if (auto ret = dynamic_cast<const ReturnStmt *>(stmt)) {
+        env.result = ret->expr ? eval(env, ret->expr.get()) : 0;
+        return Flow::Return;
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        if (eval(env, ifStmt->condition.get()) != 0) return exec(env, ifStmt->thenBlock.get());
+        if (ifStmt->elseBlock) return exec(env, ifStmt->elseBlock.get());
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+        while (eval(env, whileStmt->condition.get()) != 0) {
+            Flow flow = exec(env, whileStmt->body.get());
+            if (flow == Flow::Break) break;
+            if (flow == Flow::Return) return flow;
+        }
+    } else if (dynamic_cast<const BreakStmt *>(stmt)) {
+        return Flow::Break;
+    } else if (dynamic_cast<const ContinueStmt *>(stmt)) {
+        return Flow::Continue;
+    } else {
+        throw std::runtime_error("Unsupported statement in function " + env.func->name);
+    }
+    return Flow::Normal;
+}
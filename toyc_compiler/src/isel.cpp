@@ -0,0 +1,240 @@
+#include "isel.h"
+#include <cassert>
+#include <climits>
+
+namespace {
+
+IselPattern reg() { return {"", Nonterm::Reg, ImmForm::Any, {}}; }
+IselPattern con(ImmForm form) { return {"", Nonterm::Con, form, {}}; }
+IselPattern un(const std::string &op, IselPattern kid) { return {op, Nonterm::Reg, ImmForm::Any, {std::move(kid)}}; }
+IselPattern bin(const std::string &op, IselPattern lhs, IselPattern rhs) {
+    return {op, Nonterm::Reg, ImmForm::Any, {std::move(lhs), std::move(rhs)}};
+}
+
+bool fitsImm12(long long value) {
+    return value >= -2048 && value <= 2047;
+}
+
+// 低 12 位按有符号数解释，lui 的立即数需要补偿其符号
+int32_t lowPart(int32_t value) {
+    return (int32_t)((uint32_t)value << 20) >> 20;
+}
+
+bool satisfies(ImmForm form, int32_t k) {
+    switch (form) {
+    case ImmForm::Any: return true;
+    case ImmForm::Zero: return k == 0;
+    case ImmForm::Imm12: return fitsImm12(k);
+    case ImmForm::NegImm12: return fitsImm12(-(long long)k);
+    case ImmForm::Imm12Plus1: return fitsImm12((long long)k + 1);
+    case ImmForm::UImm12: return k >= 0 && k <= 2047;
+    case ImmForm::Pow2: return k > 0 && (k & (k - 1)) == 0;
+    case ImmForm::High: return lowPart(k) == 0;
+    }
+    return false;
+}
+
+int32_t immediate(ImmForm form, int32_t k) {
+    switch (form) {
+    case ImmForm::NegImm12: return -k;
+    case ImmForm::Imm12Plus1: return k + 1;
+    case ImmForm::Pow2: {
+        int shift = 0;
+        while ((1 << shift) < k) shift++;
+        return shift;
+    }
+    case ImmForm::High: return (int32_t)((uint32_t)k >> 12);
+    default: return k;
+    }
+}
+
+const std::vector<IselRule> &buildRules() {
+    using F = ImmForm;
+    static const std::vector<IselRule> rules = {
+        // 常量：0 即 zero 寄存器，12 位以内 li（即 addi），其余 lui 加低 12 位
+        {"zero", con(F::Zero), 0, {}, "zero"},
+        {"li", con(F::Imm12), 1, {{"li", {"$d", "$k"}}}},
+        {"lui", con(F::High), 1, {{"lui", {"$d", "$k"}}}},
+        {"lui+addi", con(F::Any), 2, {{"lui", {"$d", "$hi"}}, {"addi", {"$d", "$d", "$lo"}}}},
+
+        // 算术
+        {"add", bin("+", reg(), reg()), 1, {{"add", {"$d", "$0", "$1"}}}},
+        {"addi", bin("+", reg(), con(F::Imm12)), 1, {{"addi", {"$d", "$0", "$k"}}}},
+        {"addi", bin("+", con(F::Imm12), reg()), 1, {{"addi", {"$d", "$0", "$k"}}}},
+        {"sub", bin("-", reg(), reg()), 1, {{"sub", {"$d", "$0", "$1"}}}},
+        {"addi", bin("-", reg(), con(F::NegImm12)), 1, {{"addi", {"$d", "$0", "$k"}}}},
+        {"mul", bin("*", reg(), reg()), 3, {{"mul", {"$d", "$0", "$1"}}}},
+        {"slli", bin("*", reg(), con(F::Pow2)), 1, {{"slli", {"$d", "$0", "$k"}}}},
+        {"slli", bin("*", con(F::Pow2), reg()), 1, {{"slli", {"$d", "$0", "$k"}}}},
+        {"div", bin("/", reg(), reg()), 20, {{"div", {"$d", "$0", "$1"}}}},
+        {"rem", bin("%", reg(), reg()), 20, {{"rem", {"$d", "$0", "$1"}}}},
+        {"neg", un("-", reg()), 1, {{"neg", {"$d", "$0"}}}},
+        {"pos", un("+", reg()), 0, {}, "$0"},
+
+        // 比较：只有 slt/slti，其余关系交换操作数、立即数加一或对结果取反
+        {"slt", bin("<", reg(), reg()), 1, {{"slt", {"$d", "$0", "$1"}}}},
+        {"slti", bin("<", reg(), con(F::Imm12)), 1, {{"slti", {"$d", "$0", "$k"}}}},
+        {"slt", bin(">", reg(), reg()), 1, {{"slt", {"$d", "$1", "$0"}}}},
+        {"slti", bin(">", con(F::Imm12), reg()), 1, {{"slti", {"$d", "$0", "$k"}}}},
+        {"slt+xori", bin("<=", reg(), reg()), 2, {{"slt", {"$d", "$1", "$0"}}, {"xori", {"$d", "$d", "1"}}}},
+        {"slti", bin("<=", reg(), con(F::Imm12Plus1)), 1, {{"slti", {"$d", "$0", "$k"}}}},
+        {"slti+xori", bin("<=", con(F::Imm12), reg()), 2, {{"slti", {"$d", "$0", "$k"}}, {"xori", {"$d", "$d", "1"}}}},
+        {"slt+xori", bin(">=", reg(), reg()), 2, {{"slt", {"$d", "$0", "$1"}}, {"xori", {"$d", "$d", "1"}}}},
+        {"slti+xori", bin(">=", reg(), con(F::Imm12)), 2, {{"slti", {"$d", "$0", "$k"}}, {"xori", {"$d", "$d", "1"}}}},
+        {"slti", bin(">=", con(F::Imm12Plus1), reg()), 1, {{"slti", {"$d", "$0", "$k"}}}},
+        {"xor+seqz", bin("==", reg(), reg()), 2, {{"xor", {"$d", "$0", "$1"}}, {"seqz", {"$d", "$d"}}}},
+        {"seqz", bin("==", reg(), con(F::Zero)), 1, {{"seqz", {"$d", "$0"}}}},
+        {"seqz", bin("==", con(F::Zero), reg()), 1, {{"seqz", {"$d", "$0"}}}},
+        {"xori+seqz", bin("==", reg(), con(F::Imm12)), 2, {{"xori", {"$d", "$0", "$k"}}, {"seqz", {"$d", "$d"}}}},
+        {"xori+seqz", bin("==", con(F::Imm12), reg()), 2, {{"xori", {"$d", "$0", "$k"}}, {"seqz", {"$d", "$d"}}}},
+        {"xor+snez", bin("!=", reg(), reg()), 2, {{"xor", {"$d", "$0", "$1"}}, {"snez", {"$d", "$d"}}}},
+        {"snez", bin("!=", reg(), con(F::Zero)), 1, {{"snez", {"$d", "$0"}}}},
+        {"snez", bin("!=", con(F::Zero), reg()), 1, {{"snez", {"$d", "$0"}}}},
+        {"xori+snez", bin("!=", reg(), con(F::Imm12)), 2, {{"xori", {"$d", "$0", "$k"}}, {"snez", {"$d", "$d"}}}},
+        {"xori+snez", bin("!=", con(F::Imm12), reg()), 2, {{"xori", {"$d", "$0", "$k"}}, {"snez", {"$d", "$d"}}}},
+        {"seqz", un("!", reg()), 1, {{"seqz", {"$d", "$0"}}}},
+
+        // 跨结点的组合：取反并入比较
+        {"snez", un("!", un("!", reg())), 1, {{"snez", {"$d", "$0"}}}},
+        {"snez", un("!", bin("==", reg(), con(F::Zero))), 1, {{"snez", {"$d", "$0"}}}},
+        {"xor+snez", un("!", bin("==", reg(), reg())), 2, {{"xor", {"$d", "$0", "$1"}}, {"snez", {"$d", "$d"}}}},
+        {"seqz", un("!", bin("!=", reg(), con(F::Zero))), 1, {{"seqz", {"$d", "$0"}}}},
+        {"xor+seqz", un("!", bin("!=", reg(), reg())), 2, {{"xor", {"$d", "$0", "$1"}}, {"seqz", {"$d", "$d"}}}},
+
+        // 区间判断 0 <= x && x < K：无符号比较把负数视为很大的数，一条 sltiu 即可
+        {"sltiu", bin("&&", bin(">=", reg(), con(F::Zero)), bin("<", reg(), con(F::UImm12))), 1,
+         {{"sltiu", {"$d", "$0", "$k"}}}, "$d", true},
+        {"sltiu", bin("&&", bin("<=", con(F::Zero), reg()), bin("<", reg(), con(F::UImm12))), 1,
+         {{"sltiu", {"$d", "$0", "$k"}}}, "$d", true},
+    };
+    return rules;
+}
+
+// 规则按模式根部的运算符分组，常量规则（根为叶子）的键为空串
+const std::unordered_map<std::string, std::vector<int>> &rulesByRoot() {
+    static const std::unordered_map<std::string, std::vector<int>> index = [] {
+        std::unordered_map<std::string, std::vector<int>> byRoot;
+        const auto &rules = buildRules();
+        for (int i = 0; i < (int)rules.size(); i++) byRoot[rules[i].pattern.op].push_back(i);
+        return byRoot;
+    }();
+    return index;
+}
+
+const std::vector<int> kNoRules;
+
+const std::vector<int> &rulesFor(const std::string &op) {
+    auto it = rulesByRoot().find(op);
+    return it == rulesByRoot().end() ? kNoRules : it->second;
+}
+
+} // namespace
+
+const std::vector<IselRule> &iselRules() {
+    return buildRules();
+}
+
+bool constantValue(Expr *expr, int32_t &value) {
+    if (auto num = dynamic_cast<NumberExpr *>(expr)) {
+        value = num->value;
+        return true;
+    }
+    auto unary = dynamic_cast<UnaryExpr *>(expr);
+    if (!unary || (unary->op != "-" && unary->op != "+") || !constantValue(unary->operand.get(), value)) return false;
+    if (unary->op == "-") value = (int32_t)(0u - (uint32_t)value);
+    return true;
+}
+
+bool InstructionSelector::match(const IselPattern &pattern, Expr *expr, IselMatch &m, int &cost) {
+    if (pattern.op.empty()) {
+        if (pattern.leaf == Nonterm::Reg) {
+            cost += label(expr).cost;
+            m.regs.push_back(expr);
+            return true;
+        }
+        int32_t value;
+        if (!constantValue(expr, value) || !satisfies(pattern.imm, value)) return false;
+        if (pattern.imm != ImmForm::Zero) {
+            assert(m.form == ImmForm::Zero && "At most one immediate per rule");
+            m.form = pattern.imm;
+            m.value = value;
+        }
+        return true;
+    }
+    if (pattern.kids.size() == 1) {
+        auto unary = dynamic_cast<UnaryExpr *>(expr);
+        return unary && unary->op == pattern.op && match(pattern.kids[0], unary->operand.get(), m, cost);
+    }
+    auto bin = dynamic_cast<BinaryExpr *>(expr);
+    return bin && bin->op == pattern.op && match(pattern.kids[0], bin->lhs.get(), m, cost) &&
+           match(pattern.kids[1], bin->rhs.get(), m, cost);
+}
+
+bool InstructionSelector::matchRule(const IselRule &rule, Expr *expr, IselMatch &m, int &cost) {
+    cost = rule.cost;
+    if (!match(rule.pattern, expr, m, cost)) return false;
+    if (!rule.sameVar) return true;
+    auto a = dynamic_cast<VarExpr *>(m.regs[0]);
+    auto b = dynamic_cast<VarExpr *>(m.regs[1]);
+    return a && b && a->name == b->name;
+}
+
+const IselLabel &InstructionSelector::label(Expr *expr) {
+    auto it = labels.find(expr);
+    if (it != labels.end()) return it->second;
+
+    // 变量、调用与短路求值没有规则，由代码生成直接处理
+    IselLabel best{INT_MAX, -1};
+    std::string op;
+    if (dynamic_cast<VarExpr *>(expr) || dynamic_cast<CallExpr *>(expr)) {
+        best.cost = 1;
+    } else if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        op = bin->op;
+        if (op == "&&" || op == "||") best.cost = label(bin->lhs.get()).cost + label(bin->rhs.get()).cost + 4;
+    } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        op = unary->op;
+    }
+
+    // 代价相同时取表中靠前的规则；常量规则（根为叶子）对任何结点都要尝试，如 -5
+    auto consider = [&](const std::vector<int> &group) {
+        for (int i : group) {
+            IselMatch m;
+            int cost;
+            if (matchRule(iselRules()[i], expr, m, cost) && cost < best.cost) best = {cost, i};
+        }
+    };
+    if (!op.empty()) consider(rulesFor(op));
+    consider(rulesFor(""));
+    assert(best.cost != INT_MAX && "No instruction selection rule covers expression");
+    return labels[expr] = best;
+}
+
+IselMatch InstructionSelector::leaves(const IselRule &rule, Expr *expr) {
+    IselMatch m;
+    int cost;
+    bool matched = matchRule(rule, expr, m, cost);
+    assert(matched && "Selected rule no longer matches");
+    (void)matched;
+    return m;
+}
+
+std::vector<std::string> expandOperands(const IselInstr &instr, const std::string &dest,
+                                        const std::vector<std::string> &regs, const IselMatch &match) {
+    std::vector<std::string> args;
+    for (const std::string &arg : instr.args) {
+        if (arg == "$d") {
+            args.push_back(dest);
+        } else if (arg == "$0" || arg == "$1") {
+            args.push_back(regs.at(arg[1] - '0'));
+        } else if (arg == "$k") {
+            args.push_back(std::to_string(immediate(match.form, match.value)));
+        } else if (arg == "$hi") {
+            args.push_back(std::to_string(((uint32_t)match.value - (uint32_t)lowPart(match.value)) >> 12));
+        } else if (arg == "$lo") {
+            args.push_back(std::to_string(lowPart(match.value)));
+        } else {
+            args.push_back(arg);
+        }
+    }
+    return args;
+}
@@ -0,0 +1,619 @@
+#include "jit.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define TOYC_JIT_SUPPORTED 1
+#endif
+
+namespace {
+
+enum Reg : uint8_t { RAX = 0, RCX = 1, RDX = 2 };
+
+// 条件码（jcc/setcc 低 4 位），最低位取反即为相反条件
+enum Cond : uint8_t { CondE = 0x4, CondNE = 0x5, CondL = 0xc, CondGE = 0xd, CondLE = 0xe, CondG = 0xf };
+
+// 指令的第二操作数：寄存器、栈帧槽 [rbp+disp] 或立即数
+struct Operand {
+    enum class Kind { Reg, Frame, Imm };
+    Kind kind;
+    int32_t value;  // 寄存器号 / 偏移 / 立即数
+
+    static Operand reg(Reg r) { return {Kind::Reg, r}; }
+    static Operand frame(int32_t disp) { return {Kind::Frame, disp}; }
+    static Operand imm(int32_t value) { return {Kind::Imm, value}; }
+};
+
+bool fitsImm8(int32_t value) { return value >= -128 && value <= 127; }
+
+// x86-64 机器码缓冲区，跳转统一使用 rel32，标签在 finish 时回填
+class Emitter {
+public:
+    std::vector<uint8_t> code;
+
+    void byte(uint8_t b) { code.push_back(b); }
+    void bytes(std::initializer_list<uint8_t> list) { code.insert(code.end(), list); }
+    void imm32(int32_t value) {
+        for (int i = 0; i < 4; i++) byte((uint8_t)((uint32_t)value >> (8 * i)));
+    }
+    void imm64(uint64_t value) {
+        for (int i = 0; i < 8; i++) byte((uint8_t)(value >> (8 * i)));
+    }
+    void patch32(size_t at, int32_t value) {
+        for (int i = 0; i < 4; i++) code[at + i] = (uint8_t)((uint32_t)value >> (8 * i));
+    }
+
+    int newLabel() {
+        labels.push_back(-1);
+        return (int)labels.size() - 1;
+    }
+    void bind(int label) { labels[label] = (int)code.size(); }
+    void jmp(int label) {
+        byte(0xe9);
+        fixup(label);
+    }
+    void jcc(Cond cc, int label) {
+        bytes({0x0f, (uint8_t)(0x80 | cc)});
+        fixup(label);
+    }
+    void finish() {
+        for (auto &f : fixups) patch32(f.at, labels[f.label] - (int32_t)(f.at + 4));
+        fixups.clear();
+    }
+
+    // ModRM：reg 字段与 r/m 操作数（寄存器或 [rbp+disp]）
+    void modrm(int reg, const Operand &rm) {
+        if (rm.kind == Operand::Kind::Reg) {
+            byte((uint8_t)(0xc0 | reg << 3 | rm.value));
+        } else if (fitsImm8(rm.value)) {
+            byte((uint8_t)(0x45 | reg << 3));
+            byte((uint8_t)rm.value);
+        } else {
+            byte((uint8_t)(0x85 | reg << 3));
+            imm32(rm.value);
+        }
+    }
+
+    // 32 位操作
+    void movImm(Reg r, int32_t value) {
+        if (value == 0) {
+            bytes({0x31, (uint8_t)(0xc0 | r << 3 | r)});  // xor r, r
+        } else {
+            byte((uint8_t)(0xb8 + r));
+            imm32(value);
+        }
+    }
+    void load(Reg r, const Operand &src) {
+        if (src.kind == Operand::Kind::Imm) {
+            movImm(r, src.value);
+        } else if (src.kind != Operand::Kind::Reg || src.value != r) {
+            byte(0x8b);
+            modrm(r, src);
+        }
+    }
+    void store(int32_t disp) {
+        byte(0x89);
+        modrm(RAX, Operand::frame(disp));
+    }
+    // add/sub/cmp eax, 操作数；digit 为 0x81 组的扩展操作码，opcode 为 r, r/m 形式
+    void alu(uint8_t digit, uint8_t opcode, const Operand &src) {
+        if (src.kind == Operand::Kind::Imm) {
+            byte(fitsImm8(src.value) ? 0x83 : 0x81);
+            byte((uint8_t)(0xc0 | digit << 3));
+            if (fitsImm8(src.value)) byte((uint8_t)src.value);
+            else imm32(src.value);
+        } else {
+            byte(opcode);
+            modrm(RAX, src);
+        }
+    }
+    void imul(const Operand &src) {
+        if (src.kind == Operand::Kind::Imm) {
+            byte(fitsImm8(src.value) ? 0x6b : 0x69);
+            byte(0xc0);
+            if (fitsImm8(src.value)) byte((uint8_t)src.value);
+            else imm32(src.value);
+        } else {
+            bytes({0x0f, 0xaf});
+            modrm(RAX, src);
+        }
+    }
+    void testEax() { bytes({0x85, 0xc0}); }
+    void setcc(Cond cc) {
+        bytes({0x0f, (uint8_t)(0x90 | cc), 0xc0});  // setcc al
+        bytes({0x0f, 0xb6, 0xc0});                  // movzx eax, al
+    }
+    void push(const Operand &src) {
+        if (src.kind == Operand::Kind::Imm) {
+            byte(0x68);
+            imm32(src.value);
+        } else if (src.kind == Operand::Kind::Reg) {
+            byte((uint8_t)(0x50 + src.value));
+        } else {
+            byte(0xff);
+            modrm(6, src);  // push qword [rbp+disp]，槽宽 8 字节
+        }
+    }
+    void pop(Reg r) { byte((uint8_t)(0x58 + r)); }
+    void leaveRet() { bytes({0xc9, 0xc3}); }
+
+private:
+    struct Fixup {
+        size_t at;
+        int label;
+    };
+    std::vector<int> labels;
+    std::vector<Fixup> fixups;
+
+    void fixup(int label) {
+        fixups.push_back({code.size(), label});
+        imm32(0);
+    }
+};
+
+bool isRelOp(const std::string &op) {
+    return op == "<" || op == ">" || op == "<=" || op == ">=" || op == "==" || op == "!=";
+}
+
+Cond condOf(const std::string &op) {
+    if (op == "<") return CondL;
+    if (op == ">") return CondG;
+    if (op == "<=") return CondLE;
+    if (op == ">=") return CondGE;
+    if (op == "==") return CondE;
+    return CondNE;
+}
+
+Cond invert(Cond cc) { return (Cond)(cc ^ 1); }
+
+// 交换比较的两个操作数
+std::string swapRelOp(const std::string &op) {
+    if (op == "<") return ">";
+    if (op == ">") return "<";
+    if (op == "<=") return ">=";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+// 单个函数的代码生成：表达式结果在 eax，临时值压栈；变量住在 8 字节的栈帧槽中。
+// 调用约定：实参从右到左压栈（参数 i 位于 [rbp+16+8i]），调用者弹栈，返回值在 eax；
+// 调用之间不保留任何寄存器，因此桩代码可以直接调用 C++ 编译器
+class FuncCompiler {
+public:
+    FuncCompiler(const FuncDef *func, const std::unordered_map<std::string, int> &funcIndex,
+                 const std::vector<const FuncDef *> &funcs, void **entries)
+        : func(func), funcIndex(funcIndex), funcs(funcs), entries(entries) {}
+
+    std::vector<uint8_t> compile() {
+        e.bytes({0x55, 0x48, 0x89, 0xe5});  // push rbp; mov rbp, rsp
+        e.bytes({0x48, 0x81, 0xec});        // sub rsp, imm32（帧大小最后回填）
+        size_t frameAt = e.code.size();
+        e.imm32(0);
+
+        scopes.emplace_back();
+        for (size_t i = 0; i < func->params.size(); i++) {
+            scopes.back()[func->params[i].name] = 16 + 8 * (int32_t)i;
+        }
+        if (func->body) genBlock(func->body.get());
+        e.movImm(RAX, 0);
+        e.leaveRet();
+
+        e.patch32(frameAt, (maxSlots * 8 + 15) / 16 * 16);
+        e.finish();
+        return std::move(e.code);
+    }
+
+private:
+    const FuncDef *func;
+    const std::unordered_map<std::string, int> &funcIndex;
+    const std::vector<const FuncDef *> &funcs;
+    void **entries;
+    Emitter e;
+    std::vector<std::unordered_map<std::string, int32_t>> scopes;
+    int slots = 0;
+    int maxSlots = 0;
+    std::vector<std::pair<int, int>> loops;  // {continue 目标, break 目标}
+
+    int32_t lookup(const std::string &name) const {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end()) return found->second;
+        }
+        throw std::runtime_error("Undefined variable: " + name + " in function " + func->name);
+    }
+
+    // 常量与变量可直接作为指令的立即数或内存操作数
+    bool simple(const Expr *expr, Operand &out) const {
+        if (auto num = dynamic_cast<const NumberExpr *>(expr)) {
+            out = Operand::imm(num->value);
+            return true;
+        }
+        if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+            out = Operand::frame(lookup(var->name));
+            return true;
+        }
+        return false;
+    }
+
+    // eax = eax op src
+    void arith(const std::string &op, const Operand &src) {
+        if (op == "+") {
+            e.alu(0, 0x03, src);
+        } else if (op == "-") {
+            e.alu(5, 0x2b, src);
+        } else if (op == "*") {
+            e.imul(src);
+        } else if (op == "/" || op == "%") {
+            divide(op == "%", src);
+        } else if (isRelOp(op)) {
+            compare(src);
+            e.setcc(condOf(op));
+        } else {
+            throw std::runtime_error("Unsupported operator: " + op);
+        }
+    }
+
+    void compare(const Operand &src) {
+        if (src.kind == Operand::Kind::Imm && src.value == 0) e.testEax();
+        else e.alu(7, 0x3b, src);
+    }
+
+    // 按 RV32IM 语义处理除以 0 与 INT_MIN / -1，避免 idiv 触发 #DE
+    void divide(bool isRem, const Operand &src) {
+        if (src.kind == Operand::Kind::Imm && (src.value == 0 || src.value == -1)) {
+            if (src.value == 0) {
+                if (!isRem) e.movImm(RAX, -1);
+            } else if (isRem) {
+                e.movImm(RAX, 0);
+            } else {
+                e.bytes({0xf7, 0xd8});  // neg eax
+            }
+            return;
+        }
+        e.load(RCX, src);
+        int done = e.newLabel();
+        if (src.kind != Operand::Kind::Imm) {
+            int zero = e.newLabel(), normal = e.newLabel();
+            e.bytes({0x85, 0xc9});        // test ecx, ecx
+            e.jcc(CondE, zero);
+            e.bytes({0x83, 0xf9, 0xff});  // cmp ecx, -1
+            e.jcc(CondNE, normal);
+            if (isRem) e.movImm(RAX, 0);
+            else e.bytes({0xf7, 0xd8});
+            e.jmp(done);
+            e.bind(zero);
+            if (!isRem) e.movImm(RAX, -1);
+            e.jmp(done);
+            e.bind(normal);
+        }
+        e.bytes({0x99, 0xf7, 0xf9});  // cdq; idiv ecx
+        if (isRem) e.bytes({0x89, 0xd0});  // mov eax, edx
+        e.bind(done);
+    }
+
+    void genExpr(const Expr *expr) {
+        Operand operand{};
+        if (simple(expr, operand)) {
+            e.load(RAX, operand);
+        } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+            genExpr(unary->operand.get());
+            if (unary->op == "-") {
+                e.bytes({0xf7, 0xd8});  // neg eax
+            } else if (unary->op == "!") {
+                e.testEax();
+                e.setcc(CondE);
+            }
+        } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+            if (bin->op == "&&" || bin->op == "||") {
+                int skip = e.newLabel(), done = e.newLabel();
+                branch(expr, false, skip);
+                e.movImm(RAX, 1);
+                e.jmp(done);
+                e.bind(skip);
+                e.movImm(RAX, 0);
+                e.bind(done);
+                return;
+            }
+            genBinary(bin);
+        } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+            genCall(call);
+        } else {
+            throw std::runtime_error("Unsupported expression in function " + func->name);
+        }
+    }
+
+    // 右操作数简单时直接作为指令操作数；可交换时左操作数简单也可以
+    void genBinary(const BinaryExpr *bin) {
+        Operand operand{};
+        if (simple(bin->rhs.get(), operand)) {
+            genExpr(bin->lhs.get());
+            arith(bin->op, operand);
+        } else if ((bin->op == "+" || bin->op == "*" || isRelOp(bin->op)) && simple(bin->lhs.get(), operand)) {
+            genExpr(bin->rhs.get());
+            arith(swapRelOp(bin->op), operand);
+        } else {
+            genExpr(bin->rhs.get());
+            e.push(Operand::reg(RAX));
+            genExpr(bin->lhs.get());
+            e.pop(RCX);
+            arith(bin->op, Operand::reg(RCX));
+        }
+    }
+
+    void genCall(const CallExpr *call) {
+        auto it = funcIndex.find(call->callee);
+        if (it == funcIndex.end()) throw std::runtime_error("Undefined function: " + call->callee);
+        if (funcs[it->second]->params.size() != call->args.size()) {
+            throw std::runtime_error("Wrong argument count in call to " + call->callee);
+        }
+        for (size_t i = call->args.size(); i-- > 0;) {
+            Operand operand{};
+            if (simple(call->args[i].get(), operand)) {
+                e.push(operand);
+            } else {
+                genExpr(call->args[i].get());
+                e.push(Operand::reg(RAX));
+            }
+        }
+        e.bytes({0x48, 0xb8});  // mov rax, &entries[i]
+        e.imm64((uint64_t)(uintptr_t)&entries[it->second]);
+        e.bytes({0xff, 0x10});  // call [rax]
+        if (!call->args.empty()) {
+            int32_t bytes = 8 * (int32_t)call->args.size();
+            e.bytes({0x48, 0x81, 0xc4});  // add rsp, imm32
+            e.imm32(bytes);
+        }
+    }
+
+    // 当 expr 的真值等于 when 时跳到 label
+    void branch(const Expr *expr, bool when, int label) {
+        if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+            if (bin->op == "&&" || bin->op == "||") {
+                bool isAnd = bin->op == "&&";
+                if (isAnd != when) {
+                    branch(bin->lhs.get(), when, label);
+                    branch(bin->rhs.get(), when, label);
+                } else {
+                    int skip = e.newLabel();
+                    branch(bin->lhs.get(), !when, skip);
+                    branch(bin->rhs.get(), when, label);
+                    e.bind(skip);
+                }
+                return;
+            }
+            if (isRelOp(bin->op)) {
+                Operand operand{};
+                std::string op = bin->op;
+                if (simple(bin->rhs.get(), operand)) {
+                    genExpr(bin->lhs.get());
+                } else if (simple(bin->lhs.get(), operand)) {
+                    genExpr(bin->rhs.get());
+                    op = swapRelOp(op);
+                } else {
+                    genExpr(bin->rhs.get());
+                    e.push(Operand::reg(RAX));
+                    genExpr(bin->lhs.get());
+                    e.pop(RCX);
+                    operand = Operand::reg(RCX);
+                }
+                compare(operand);
+                e.jcc(when ? condOf(op) : invert(condOf(op)), label);
+                return;
+            }
+        }
+        if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+            if (unary->op == "!") {
+                branch(unary->operand.get(), !when, label);
+                return;
+            }
+        }
+        genExpr(expr);
+        e.testEax();
+        e.jcc(when ? CondNE : CondE, label);
+    }
+
+    void genBlock(const Block *block) {
+        scopes.emplace_back();
+        int savedSlots = slots;
+        for (auto &stmt : block->stmts) genStmt(stmt.get());
+        slots = savedSlots;
+        scopes.pop_back();
+    }
+
+    void genStmt(const Stmt *stmt) {
+        if (auto block = dynamic_cast<const Block *>(stmt)) {
+            genBlock(block);
+        } else if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+            int32_t disp = -8 * ++slots;
+            maxSlots = std::max(maxSlots, slots);
+            if (decl->initializer) {
+                genExpr(decl->initializer.get());
+                e.store(disp);
+            }
+            scopes.back()[decl->name] = disp;
+        } else if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+            int32_t disp = lookup(assign->name);
+            genExpr(assign->value.get());
+            e.store(disp);
+        } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(stmt)) {
+            if (exprStmt->expr) genExpr(exprStmt->expr.get());
+        } else if (auto ret = dynamic_cast<const ReturnStmt *>(stmt)) {
+            if (ret->expr) genExpr(ret->expr.get());
+            e.leaveRet();
+        } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+            int elseLabel = e.newLabel(), endLabel = e.newLabel();
+            branch(ifStmt->condition.get(), false, elseLabel);
+            genBlock(ifStmt->thenBlock.get());
+            if (ifStmt->elseBlock) {
+                e.jmp(endLabel);
+                e.bind(elseLabel);
+                genBlock(ifStmt->elseBlock.get());
+            } else {
+                e.bind(elseLabel);
+            }
+            e.bind(endLabel);
+        } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+            // 条件放在循环体之后，每轮只有一次条件跳转
+            int bodyLabel = e.newLabel(), checkLabel = e.newLabel(), endLabel = e.newLabel();
+            e.jmp(checkLabel);
+            e.bind(bodyLabel);
+            loops.push_back({checkLabel, endLabel});
+            genBlock(whileStmt->body.get());
+            loops.pop_back();
+            e.bind(checkLabel);
+            branch(whileStmt->condition.get(), true, bodyLabel);
+            e.bind(endLabel);
+        } else if (dynamic_cast<const BreakStmt *>(stmt)) {
+            if (loops.empty()) throw std::runtime_error("break outside of a loop in function " + func->name);
+            e.jmp(loops.back().second);
+        } else if (dynamic_cast<const ContinueStmt *>(stmt)) {
+            if (loops.empty()) throw std::runtime_error("continue outside of a loop in function " + func->name);
+            e.jmp(loops.back().first);
+        } else {
+            throw std::runtime_error("Unsupported statement in function " + func->name);
+        }
+    }
+};
+
+}  // namespace
+
+Jit::Jit(const std::vector<std::unique_ptr<FuncDef>> &program) {
+#ifndef TOYC_JIT_SUPPORTED
+    (void)program;
+    throw std::runtime_error("The JIT requires an x86-64 POSIX host");
+#else
+    for (auto &func : program) {
+        if (!funcIndex.emplace(func->name, (int)funcs.size()).second) {
+            throw std::runtime_error("Duplicate function: " + func->name);
+        }
+        funcs.push_back(func.get());
+    }
+    counters.functions = (int)funcs.size();
+    entries.reset(new void *[std::max<size_t>(funcs.size(), 1)]);
+
+    Emitter e;
+    int resolver = e.newLabel();
+    e.bind(resolver);
+    // 公共解析桩：对齐栈后调用 Jit::resolve(this, esi)，恢复栈帧后跳到编译结果，
+    // 栈上的实参与返回地址保持原样，如同直接调用了目标函数
+    e.bytes({0x55, 0x48, 0x89, 0xe5});  // push rbp; mov rbp, rsp
+    e.bytes({0x48, 0x83, 0xe4, 0xf0});  // and rsp, -16
+    e.bytes({0x48, 0xbf});              // mov rdi, this
+    e.imm64((uint64_t)(uintptr_t)this);
+    e.bytes({0x48, 0xb8});              // mov rax, &Jit::resolve
+    e.imm64((uint64_t)(uintptr_t)&Jit::resolve);
+    e.bytes({0xff, 0xd0, 0xc9});        // call rax; leave
+    e.bytes({0xff, 0xe0});              // jmp rax
+
+    // callThunk(entry, args, n)：实参从右到左压栈后调用 *entry
+    size_t callAt = e.code.size();
+    int loop = e.newLabel(), call = e.newLabel();
+    e.bytes({0x55, 0x48, 0x89, 0xe5});
+    e.bind(loop);
+    e.bytes({0x48, 0x85, 0xd2});  // test rdx, rdx
+    e.jcc(CondE, call);
+    e.bytes({0x48, 0xff, 0xca});  // dec rdx
+    e.bytes({0xff, 0x34, 0xd6});  // push qword [rsi+rdx*8]
+    e.jmp(loop);
+    e.bind(call);
+    e.bytes({0xff, 0x17});        // call [rdi]
+    e.leaveRet();
+
+    // 每个函数一个桩：mov esi, index; jmp 公共解析桩
+    std::vector<size_t> stubAt;
+    for (size_t i = 0; i < funcs.size(); i++) {
+        stubAt.push_back(e.code.size());
+        e.byte(0xbe);
+        e.imm32((int32_t)i);
+        e.jmp(resolver);
+    }
+    e.finish();
+
+    uint8_t *base = (uint8_t *)install(e.code);
+    callThunk = base + callAt;
+    for (size_t i = 0; i < funcs.size(); i++) entries[i] = base + stubAt[i];
+#endif
+}
+
+Jit::~Jit() {
+#ifdef TOYC_JIT_SUPPORTED
+    for (auto &chunk : chunks) munmap(chunk.base, chunk.size);
+#endif
+}
+
+// 新代码追加到当前内存块；写入期间只把涉及的页改为可写，写完恢复为可执行
+void *Jit::install(const std::vector<uint8_t> &code) {
+#ifndef TOYC_JIT_SUPPORTED
+    (void)code;
+    return nullptr;
+#else
+    static const size_t kChunkSize = 1 << 20;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (chunks.empty() || chunks.back().used + code.size() > chunks.back().size) {
+        size_t size = std::max(kChunkSize, (code.size() + page - 1) / page * page);
+        void *base = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) throw std::runtime_error("Cannot allocate executable memory");
+        chunks.push_back({(uint8_t *)base, size, 0});
+    }
+    CodeChunk &chunk = chunks.back();
+    uint8_t *target = chunk.base + chunk.used;
+    uint8_t *first = chunk.base + chunk.used / page * page;
+    size_t length = (size_t)(target + code.size() - first + page - 1) / page * page;
+    if (mprotect(first, length, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error("Cannot make JIT code writable");
+    }
+    std::memcpy(target, code.data(), code.size());
+    if (mprotect(first, length, PROT_READ | PROT_EXEC) != 0) {
+        throw std::runtime_error("Cannot make JIT code executable");
+    }
+    chunk.used = (chunk.used + code.size() + 15) / 16 * 16;
+    return target;
+#endif
+}
+
+void *Jit::compile(int index) {
+    auto start = std::chrono::steady_clock::now();
+    FuncCompiler compiler(funcs[index], funcIndex, funcs, entries.get());
+    std::vector<uint8_t> code = compiler.compile();
+    void *entry = install(code);
+    entries[index] = entry;
+    counters.compiled++;
+    counters.codeBytes += code.size();
+    counters.compileSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return entry;
+}
+
+// 由桩代码调用。JIT 代码的栈帧没有展开信息，异常不能穿过它们，编译失败时 longjmp 回 run
+void *Jit::resolve(Jit *jit, int index) {
+    void *entry = nullptr;
+    try {
+        entry = jit->compile(index);
+    } catch (const std::exception &ex) {
+        jit->error = ex.what();
+    }
+    if (!entry) std::longjmp(jit->escape, 1);
+    return entry;
+}
+
+int32_t Jit::run(const std::string &entry, const std::vector<int32_t> &args) {
+    auto it = funcIndex.find(entry);
+    if (it == funcIndex.end()) throw std::runtime_error("Undefined function: " + entry);
+    if (funcs[it->second]->params.size() != args.size()) {
+        throw std::runtime_error("Wrong argument count for " + entry);
+    }
+    std::vector<int64_t> values(args.begin(), args.end());
+    auto thunk = reinterpret_cast<int64_t (*)(void **, const int64_t *, int64_t)>(callThunk);
+    if (setjmp(escape)) throw std::runtime_error(error);
+    return (int32_t)thunk(&entries[it->second], values.data(), (int64_t)values.size());
+}
+
+void Jit::printStats(std::ostream &os) const {
+    os << "jit: " << counters.compiled << " of " << counters.functions << " functions compiled, "
+       << counters.codeBytes << " bytes of code, " << std::fixed << std::setprecision(3)
+       << counters.compileSeconds * 1000 << " ms\n";
+}
@@ -1,33 +1,36 @@
 #include "lexer.h"
+#include <algorithm>
 #include <cctype>
 #include <stdexcept>
+#include <thread>
 
 Lexer::Lexer(const std::string& src)
     : source(src), start(0), current(0), line(1), column(1) {}
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
+    return tokens;
+}
 
-    while (!isAtEnd()) {
-        skipWhitespace();
-        start = current;
+Token Lexer::next() {
+    skipWhitespace();
+    start = current;
 
-        if (isAtEnd()) break;
+    if (isAtEnd()) return Token(TokenType::END_OF_FILE, "", line, column);
 
-        char c = advance();
+    char c = advance();
 
-        if (std::isalpha(c) || c == '_') {
-            tokens.push_back(identifier());
-        } else if (std::isdigit(c)) {
-            tokens.push_back(number());
-        } else {
-            current--; column--; // put back for operatorOrDelimiter
-            tokens.push_back(operatorOrDelimiter());
-        }
+    if (std::isalpha(c) || c == '_') {
+        return identifier();
+    } else if (std::isdigit(c)) {
+        return number();
+    } else {
+        current--; column--; // put back for operatorOrDelimiter
+        return operatorOrDelimiter();
     }
-
-    tokens.emplace_back(TokenType::END_OF_FILE, "", line, column);
-    return tokens;
 }
 
 bool Lexer::isAtEnd() const {
@@ -144,5 +147,56 @@ Token Lexer::operatorOrDelimiter() {
 }
 
 Token Lexer::makeToken(TokenType type, const std::string& lexeme) {
-    return Token(type, lexeme, line, column - (int)lexeme.size() + 1);
-}
\ No newline at end of file
+    return Token(type, lexeme, line, column - (int)lexeme.size());
+}
+
+// 在 count 个任务上运行 body，任务 0 在当前线程，其余各占一个线程
+template <typename F>
+static void runChunks(size_t count, F &&body) {
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < count; i++) workers.emplace_back(body, i);
+    body(0);
+    for (auto &worker : workers) worker.join();
+}
+
+std::vector<Token> tokenizeParallel(const std::string& source, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::min<size_t>(threads, source.size() / kMinParallelChunk);
+    if (chunks <= 1) return Lexer(source).tokenize();
+
+    // 切分点取均分位置之后的第一个换行之后，每块都从某行的第 1 列开始
+    std::vector<size_t> cuts = {0};
+    for (size_t i = 1; i < chunks; i++) {
+        size_t pos = source.find('\n', std::max(cuts.back(), source.size() / chunks * i));
+        if (pos == std::string::npos) break;
+        cuts.push_back(pos + 1);
+    }
+    cuts.push_back(source.size());
+    chunks = cuts.size() - 1;
+
+    // 各块从第 1 行开始扫描；块尾的 END_OF_FILE 的行号减一即块内换行数
+    std::vector<std::vector<Token>> parts(chunks);
+    std::vector<int> lines(chunks);
+    runChunks(chunks, [&](size_t i) {
+        parts[i] = Lexer(source.substr(cuts[i], cuts[i + 1] - cuts[i])).tokenize();
+        lines[i] = parts[i].back().line - 1;
+        if (i + 1 < chunks) parts[i].pop_back();
+    });
+
+    std::vector<size_t> offsets(chunks + 1, 0);
+    std::vector<int> firstLine(chunks, 0);
+    for (size_t i = 0; i < chunks; i++) {
+        offsets[i + 1] = offsets[i] + parts[i].size();
+        firstLine[i] = i == 0 ? 0 : firstLine[i - 1] + lines[i - 1];
+    }
+    std::vector<Token> tokens(offsets[chunks]);
+    runChunks(chunks, [&](size_t i) {
+        Token *out = tokens.data() + offsets[i];
+        for (auto &token : parts[i]) {
+            token.line += firstLine[i];
+            *out++ = std::move(token);
+        }
+        std::vector<Token>().swap(parts[i]);
+    });
+    return tokens;
+}
@@ -1,4 +1,5 @@
 // main.cpp
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -7,15 +8,213 @@
 #include "parser.h"
 #include "semantic.h"
 #include "codegen.h"
+#include "elf.h"
+#include "astbin.h"
+#include "jit.h"
+#include "bytecode.h"
+#include "callgraph.h"
+#include "interpreter.h"
+#include "passes.h"
+#include "pipeline.h"
+#include "profile.h"
 
 int main(int argc, char *argv[]) {
     std::string source;
+    std::string inputPath;
+    PassOptions passOpts;
+    InlineOptions &inlineOpts = passOpts.inlining;
+    UnrollOptions &unrollOpts = passOpts.unrolling;
+    CodeGenOptions &codegenOpts = passOpts.codegen;
+    bool peepholeStats = false;
+    bool emitObject = false;
+    std::string runEngine;      // --run[=jit|vm|ast]，空表示生成代码
+    bool emitBytecode = false;
+    bool emitAstBin = false;    // 输出语义分析后的二进制 AST
+    bool fromAstBin = false;    // 输入是 --emit-ast-bin 的结果，跳过词法、语法与语义分析
+    bool stream = false;        // 逐个函数编译，生成后即释放
+    bool pipelined = false;     // --pipeline：流式编译，词法、语法分析各在一个线程
+    bool printCallgraph = false;
+    bool keepDeadFunctions = false;
+    unsigned lexThreads = 0;    // 0 表示硬件线程数
+    bool dumpTokens = false;
+    std::string outputPath;
+    bool passStats = false;
+    std::string costReportFormat;   // --cost-report[=text|json]，空表示不输出
+    std::string costReportPath;     // --cost-report-file=，默认写到 stderr
+    std::string profileUsePath;
+    int optLevel = 2;
+    std::string passList;
+    // -fno-* 作用在 -O 级别或 --passes 给出的流水线之上，与出现顺序无关
+    std::vector<std::string> disabledPasses;
+    bool noTailCalls = false, noIfConvert = false, noIpra = false;
+    bool rvc = false;           // -mrvc：最后运行 compress，输出 RVC 压缩指令
 
-    if (argc >= 2) {
+    // 命令行选项：toyc [选项] [文件]
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            optLevel = arg[2] - '0';
+        } else if (arg.rfind("--passes=", 0) == 0) {
+            passList = arg.substr(9);
+        } else if (arg.rfind("--print-after=", 0) == 0) {
+            std::istringstream names(arg.substr(14));
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (name != "all" && !findPass(name)) {
+                    std::cerr << "Error: Unknown pass " << name << "\n";
+                    return 1;
+                }
+                passOpts.printAfter.push_back(name);
+            }
+        } else if (arg == "--pass-stats") {
+            passStats = true;
+        } else if (arg == "--cost-report") {
+            costReportFormat = "text";
+        } else if (arg.rfind("--cost-report=", 0) == 0) {
+            costReportFormat = arg.substr(14);
+            if (costReportFormat != "text" && costReportFormat != "json") {
+                std::cerr << "Error: Unknown cost report format " << costReportFormat << "\n";
+                return 1;
+            }
+        } else if (arg.rfind("--cost-report-file=", 0) == 0) {
+            costReportPath = arg.substr(19);
+            if (costReportFormat.empty()) costReportFormat = "text";
+        } else if (arg == "--list-passes") {
+            for (auto &pass : registeredPasses()) {
+                std::cout << pass.name << (pass.kind == PassInfo::Kind::Ast ? " (ast): " : " (machine): ")
+                          << pass.description << "\n";
+            }
+            return 0;
+        } else if (arg == "--run") {
+            runEngine = "jit";
+        } else if (arg.rfind("--run=", 0) == 0) {
+            runEngine = arg.substr(6);
+            if (runEngine != "jit" && runEngine != "vm" && runEngine != "ast") {
+                std::cerr << "Error: Unknown execution engine " << runEngine << "\n";
+                return 1;
+            }
+        } else if (arg == "--emit-bytecode") {
+            emitBytecode = true;
+        } else if (arg == "--emit-ast-bin") {
+            emitAstBin = true;
+        } else if (arg == "--from-ast-bin") {
+            fromAstBin = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--pipeline") {
+            stream = pipelined = true;
+        } else if (arg == "--print-callgraph") {
+            printCallgraph = true;
+        } else if (arg == "-fkeep-dead-functions") {
+            keepDeadFunctions = true;
+        } else if (arg.rfind("--lex-threads=", 0) == 0) {
+            lexThreads = (unsigned)std::stoul(arg.substr(14));
+        } else if (arg == "--dump-tokens") {
+            dumpTokens = true;
+        } else if (arg == "-c") {
+            emitObject = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "-fno-inline") {
+            disabledPasses.push_back("inline");
+        } else if (arg.rfind("-finline-threshold=", 0) == 0) {
+            inlineOpts.threshold = std::stoi(arg.substr(19));
+        } else if (arg.rfind("-finline-recursive-depth=", 0) == 0) {
+            inlineOpts.recursiveDepth = std::stoi(arg.substr(25));
+        } else if (arg == "-fno-optimize-sibling-calls") {
+            noTailCalls = true;
+            disabledPasses.push_back("tailrec");
+        } else if (arg == "-fno-peephole") {
+            disabledPasses.push_back("peephole");
+        } else if (arg == "-fno-unroll-loops") {
+            disabledPasses.push_back("unroll");
+        } else if (arg.rfind("-funroll-factor=", 0) == 0) {
+            unrollOpts.factor = std::stoi(arg.substr(16));
+        } else if (arg.rfind("-funroll-full-budget=", 0) == 0) {
+            unrollOpts.fullBudget = std::stoi(arg.substr(21));
+        } else if (arg == "-fno-if-conversion") {
+            noIfConvert = true;
+        } else if (arg == "-fno-ipa-ra") {
+            noIpra = true;
+        } else if (arg == "-fno-schedule-insns") {
+            disabledPasses.push_back("schedule");
+        } else if (arg.rfind("-mtune=", 0) == 0) {
+            codegenOpts.tune = arg.substr(7);
+            if (!findLatencyModel(codegenOpts.tune)) {
+                std::cerr << "Error: Unknown -mtune value " << codegenOpts.tune << "\n";
+                return 1;
+            }
+        } else if (arg == "-mrvc") {
+            rvc = true;
+        } else if (arg == "--profile-generate") {
+            codegenOpts.profileGenerate = true;
+        } else if (arg.rfind("--profile-generate=", 0) == 0) {
+            codegenOpts.profileGenerate = true;
+            codegenOpts.profilePath = arg.substr(19);
+        } else if (arg.rfind("--profile-use=", 0) == 0) {
+            profileUsePath = arg.substr(14);
+        } else if (arg == "-fpeephole-stats") {
+            peepholeStats = true;
+        } else if (arg == "-Rpass=inline") {
+            inlineOpts.remarks = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Error: Unknown option " << arg << "\n";
+            return 1;
+        } else {
+            inputPath = arg;
+        }
+    }
+
+    // 先按优化级别确定流水线，--passes 替换之，最后应用 -fno-*
+    applyOptLevel(optLevel, passOpts);
+    if (!passList.empty()) {
+        try {
+            passOpts.pipeline = parsePipeline(passList);
+        } catch (const std::exception &ex) {
+            std::cerr << "Error: " << ex.what() << "\n";
+            return 1;
+        }
+    }
+    // 插桩构建不内联、不展开，计数器与源码结构一一对应
+    if (codegenOpts.profileGenerate) {
+        disabledPasses.push_back("inline");
+        disabledPasses.push_back("unroll");
+    }
+    auto &pipeline = passOpts.pipeline;
+    for (auto &name : disabledPasses) {
+        pipeline.erase(std::remove(pipeline.begin(), pipeline.end(), name), pipeline.end());
+    }
+    if (rvc && std::find(pipeline.begin(), pipeline.end(), "compress") == pipeline.end()) {
+        pipeline.push_back("compress");
+    }
+    // 流式编译只见过当前函数：内联与死函数删除需要整个程序，使用剖析需要整体的结构校验和
+    if (stream) {
+        if (emitObject || !runEngine.empty() || emitBytecode || emitAstBin || fromAstBin || !profileUsePath.empty() ||
+            printCallgraph || keepDeadFunctions) {
+            std::cerr << "Error: --stream only supports assembly output\n";
+            return 1;
+        }
+        pipeline.erase(std::remove(pipeline.begin(), pipeline.end(), "inline"), pipeline.end());
+    }
+    if (!costReportFormat.empty() && (!runEngine.empty() || emitBytecode || emitAstBin)) {
+        std::cerr << "Error: --cost-report requires RISC-V code generation\n";
+        return 1;
+    }
+    if (noTailCalls) codegenOpts.tailCalls = false;
+    if (noIfConvert) codegenOpts.ifConvert = false;
+    if (noIpra) codegenOpts.ipra = false;
+
+    if (fromAstBin) {
+        // 二进制 AST 直接映射文件，不经过 source
+        if (inputPath.empty()) {
+            std::cerr << "Error: --from-ast-bin requires an input file\n";
+            return 1;
+        }
+    } else if (!inputPath.empty()) {
         // 如果提供文件名，尝试从文件读取
-        std::ifstream file(argv[1]);
+        std::ifstream file(inputPath);
         if (!file) {
-            std::cerr << "Error: Cannot open file " << argv[1] << "\n";
+            std::cerr << "Error: Cannot open file " << inputPath << "\n";
             return 1;
         }
         std::stringstream buffer;
@@ -29,32 +228,189 @@ int main(int argc, char *argv[]) {
     }
 
     try {
-        // 词法分析
-        Lexer lexer(source);
-        auto tokens = lexer.tokenize();
+        PassManager passes(passOpts);
 
-        // 可选调试：如果需要打印 Token 列表，写到 stderr
-        std::cerr << "Tokens:\n";
-        for (const auto &tok : tokens) {
-            std::cerr << "  Type: " << static_cast<int>(tok.type)
-                      << ", Lexeme: '" << tok.lexeme
-                      << "', Line: " << tok.line << "\n";
+        // 汇编代码、-c 的 ELF 目标文件以及 --emit-* 的输出写到 -o 指定的文件，默认 stdout
+        std::ofstream outputFile;
+        if (!outputPath.empty() && runEngine.empty()) {
+            outputFile.open(outputPath, std::ios::binary);
+            if (!outputFile) throw std::runtime_error("Cannot open output file " + outputPath);
         }
+        std::ostream &output = outputFile.is_open() ? outputFile : std::cout;
 
-        // 语法分析
-        Parser parser(tokens);
-        auto program = parser.parseCompUnit();
+        // --cost-report：代码生成逐个函数记录静态代价估计，结束后按代价从高到低输出
+        std::unique_ptr<CostReport> costReport;
+        if (!costReportFormat.empty()) {
+            costReport = std::make_unique<CostReport>(*findLatencyModel(codegenOpts.tune));
+            codegenOpts.costReport = costReport.get();
+        }
+        auto writeCostReport = [&] {
+            if (!costReport) return;
+            std::ofstream reportFile;
+            if (!costReportPath.empty()) {
+                reportFile.open(costReportPath);
+                if (!reportFile) throw std::runtime_error("Cannot open cost report file " + costReportPath);
+            }
+            std::ostream &os = reportFile.is_open() ? reportFile : std::cerr;
+            if (costReportFormat == "json") costReport->printJson(os);
+            else costReport->printText(os);
+        };
 
-        std::cerr << "Parsing succeeded.\n";
+        // --stream：语法分析按需从词法分析取 token，每读完一个函数就做语义分析、剖析编号、
+        // AST 变换和代码生成，然后释放它。同时存活的只有当前函数、其 token 与签名表
+        if (stream) {
+            passes.attach(codegenOpts);
+            CodeGen codegen(output, codegenOpts);
+            SemanticAnalyzer semantic;
+            ProfileLayout layout;
+            // --pipeline 时本线程只做语义分析及之后的工作，"parse" 阶段记的是等待函数环的时间
+            std::unique_ptr<PipelinedFrontEnd> frontEnd;
+            std::unique_ptr<Lexer> lexer;
+            std::unique_ptr<Parser> parser;
+            if (pipelined) {
+                frontEnd = std::make_unique<PipelinedFrontEnd>(source);
+            } else {
+                lexer = std::make_unique<Lexer>(source);
+                parser = std::make_unique<Parser>([&] { return lexer->next(); });
+            }
+            while (true) {
+                std::vector<std::unique_ptr<FuncDef>> unit;
+                passes.timePhase("parse", [&] {
+                    auto func = frontEnd ? frontEnd->next() : parser->parseNextFunc();
+                    if (func) unit.push_back(std::move(func));
+                });
+                if (unit.empty()) break;
+                passes.timePhase("semantic", [&] { semantic.analyzeFunction(unit[0].get()); });
+                if (semantic.errorCount() > 0) break;
+                assignProfileIds(*unit[0], layout);
+                passes.runAstPasses(unit);
+                passes.timePhase("codegen", [&] { codegen.generateFunction(unit[0].get()); });
+            }
+            // 前向调用的签名检查推迟到全部函数读完
+            semantic.finish();
+            if (semantic.errorCount() > 0) {
+                throw std::runtime_error(std::to_string(semantic.errorCount()) + " semantic error(s)");
+            }
+            codegen.finishStream(layout);
+            if (peepholeStats) passes.peepholeStats().printStats(std::cerr);
+            if (passStats) passes.printStats(std::cerr);
+            if (passStats && rvc) passes.compressStats().printStats(std::cerr);
+            if (passStats && frontEnd) frontEnd->stats().print(std::cerr);
+            writeCostReport();
+            return 0;
+        }
 
-        // 语义分析
-        SemanticAnalyzer semantic;
-        semantic.analyze(program);
-        std::cerr << "Semantic analysis succeeded.\n";
+        std::vector<std::unique_ptr<FuncDef>> program;
+        if (fromAstBin) {
+            passes.timePhase("load-ast", [&] { program = loadAstBin(inputPath); });
+        } else {
+            // 词法分析
+            std::vector<Token> tokens;
+            passes.timePhase("lex", [&] { tokens = tokenizeParallel(source, lexThreads); });
 
-        // 汇编代码生成，唯一写到 stdout
-        CodeGen codegen(std::cout);
-        codegen.generate(program);
+            // 可选调试：--dump-tokens 把 Token 列表写到 stderr
+            if (dumpTokens) {
+                std::cerr << "Tokens:\n";
+                for (const auto &tok : tokens) {
+                    std::cerr << "  Type: " << static_cast<int>(tok.type)
+                              << ", Lexeme: '" << tok.lexeme
+                              << "', Line: " << tok.line << "\n";
+                }
+            }
+
+            // 语法分析
+            passes.timePhase("parse", [&] {
+                Parser parser(tokens);
+                program = parser.parseCompUnit();
+            });
+
+            std::cerr << "Parsing succeeded.\n";
+        }
+
+        // 从 main 不可达的函数不做语义分析、不生成代码
+        if (printCallgraph) printCallGraph(std::cerr, CallGraph(program));
+        if (!keepDeadFunctions) {
+            passes.timePhase("dead-funcs", [&] { eliminateDeadFunctions(program); });
+        }
+
+        if (!fromAstBin) {
+            // 语义分析
+            SemanticAnalyzer semantic;
+            passes.timePhase("semantic", [&] { semantic.analyze(program); });
+            if (semantic.errorCount() > 0) {
+                throw std::runtime_error(std::to_string(semantic.errorCount()) + " semantic error(s)");
+            }
+            std::cerr << "Semantic analysis succeeded.\n";
+        }
+
+        // 剖析计数器编号，须在任何 AST 变换之前分配
+        codegenOpts.profileLayout = assignProfileIds(program);
+
+        // --emit-ast-bin：序列化语义分析后、AST 变换前的函数列表
+        if (emitAstBin) {
+            passes.timePhase("emit-ast", [&] { writeAstBin(output, program); });
+            if (passStats) passes.printStats(std::cerr);
+            return 0;
+        }
+
+        ProfileData profile;
+        if (!profileUsePath.empty()) {
+            profile = ProfileData::load(profileUsePath, codegenOpts.profileLayout, std::cerr);
+            if (!profile.empty()) {
+                inlineOpts.profile = &profile;
+                unrollOpts.profile = &profile;
+                codegenOpts.profile = &profile;
+            }
+        }
+
+        // AST 层变换：内联、尾递归转循环、循环展开，按流水线顺序
+        passes.runAstPasses(program);
+
+        // --run：直接执行 main，不生成 RISC-V 代码。jit 编译为本机代码，vm 解释字节码，ast 遍历语法树
+        if (!runEngine.empty()) {
+            int32_t result = 0;
+            if (runEngine == "jit") {
+                Jit jit(program);
+                passes.timePhase("run", [&] { result = jit.run("main"); });
+                if (passStats) jit.printStats(std::cerr);
+            } else if (runEngine == "vm") {
+                BcModule module;
+                passes.timePhase("bytecode", [&] { module = compileBytecode(program); });
+                Vm vm(module);
+                passes.timePhase("run", [&] { result = vm.run("main"); });
+                if (passStats) vm.printStats(std::cerr);
+            } else {
+                AstInterpreter interpreter(program);
+                passes.timePhase("run", [&] { result = interpreter.run("main"); });
+            }
+            std::cerr << "return value: " << result << "\n";
+            if (passStats) passes.printStats(std::cerr);
+            return result & 0xff;
+        }
+
+        // --emit-bytecode：输出虚拟机字节码的反汇编
+        if (emitBytecode) {
+            BcModule module;
+            passes.timePhase("bytecode", [&] { module = compileBytecode(program); });
+            printBytecode(output, module);
+            if (passStats) passes.printStats(std::cerr);
+            return 0;
+        }
+
+        // 机器层变换在每个函数生成后运行，其耗时同时计入 codegen 阶段
+        passes.attach(codegenOpts);
+        CodeGen codegen(output, codegenOpts);
+        if (emitObject) {
+            std::vector<AsmInstr> code;
+            passes.timePhase("codegen", [&] { code = codegen.lower(program); });
+            passes.timePhase("assemble", [&] { writeElf(output, assembleObject(code)); });
+        } else {
+            passes.timePhase("codegen", [&] { codegen.generate(program); });
+        }
+        if (peepholeStats) passes.peepholeStats().printStats(std::cerr);
+        if (passStats) passes.printStats(std::cerr);
+        if (passStats && rvc) passes.compressStats().printStats(std::cerr);
+        writeCostReport();
 
     } catch (const std::exception &ex) {
         std::cerr << "Compilation failed: " << ex.what() << "\n";
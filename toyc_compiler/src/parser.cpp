@@ -5,20 +5,31 @@
 
 Parser::Parser(const std::vector<Token> &tokens) : tokens(tokens), current(0) {}
 
+Parser::Parser(std::function<Token()> source) : source(std::move(source)), tokens(window), current(0) {}
+
+
+// 流式输入时按需读入 token，直到下标 index 可用或读到 END_OF_FILE
+bool Parser::available(size_t index) {
+    while (source && index >= window.size() &&
+           (window.empty() || window.back().type != TokenType::END_OF_FILE)) {
+        window.push_back(source());
+    }
+    return index < tokens.size();
+}
 
 // 工具函数实现
-const Token &Parser::peek() const {
-    if (current >= tokens.size()) throw std::runtime_error("Unexpected EOF");
+const Token &Parser::peek() {
+    if (!available(current)) throw std::runtime_error("Unexpected EOF");
     return tokens[current];
 }
 
 const Token &Parser::advance() {
-    if (current >= tokens.size()) throw std::runtime_error("Unexpected EOF");
+    if (!available(current)) throw std::runtime_error("Unexpected EOF");
     return tokens[current++];
 }
 
 bool Parser::match(TokenType type) {
-    if (current < tokens.size() && tokens[current].type == type) {
+    if (available(current) && tokens[current].type == type) {
         current++;
         return true;
     }
@@ -30,17 +41,38 @@ bool Parser::expect(TokenType type, const char* errMsg) {
     throw std::runtime_error(errMsg);
 }
 
+void Parser::setSpan(ASTNode &node, size_t first) const {
+    const Token &begin = tokens[first];
+    const Token &end = tokens[current > first ? current - 1 : first];
+    node.span.line = begin.line;
+    node.span.column = begin.column;
+    node.span.endLine = end.line;
+    node.span.endColumn = end.column + (int)end.lexeme.size();
+}
+
 // CompUnit -> FuncDef+
 std::vector<std::unique_ptr<FuncDef>> Parser::parseCompUnit() {
     std::vector<std::unique_ptr<FuncDef>> funcs;
-    while (current < tokens.size() && tokens[current].type != TokenType::END_OF_FILE) {
-        funcs.push_back(parseFuncDef());
+    while (auto func = parseNextFunc()) {
+        funcs.push_back(std::move(func));
     }
     return funcs;
 }
 
+std::unique_ptr<FuncDef> Parser::parseNextFunc() {
+    if (!available(current) || tokens[current].type == TokenType::END_OF_FILE) return nullptr;
+    auto func = parseFuncDef();
+    // 流式输入时丢弃已解析函数的 token，窗口只保留当前函数
+    if (source) {
+        window.erase(window.begin(), window.begin() + current);
+        current = 0;
+    }
+    return func;
+}
+
 // FuncDef -> ("int" | "void") ID "(" (Param ("," Param)*)? ")" Block
 std::unique_ptr<FuncDef> Parser::parseFuncDef() {
+    size_t first = current;
     std::string retType;
     if (match(TokenType::INT)) {
         retType = "int";
@@ -71,18 +103,21 @@ std::unique_ptr<FuncDef> Parser::parseFuncDef() {
     }
 
     func->body = parseBlock();
+    setSpan(*func, first);
 
     return func;
 }
 
 // Block -> "{" Stmt* "}"
 std::unique_ptr<Block> Parser::parseBlock() {
+    size_t first = current;
     expect(TokenType::LBRACE, "Expected '{' to start block");
     auto block = std::make_unique<Block>();
 
     while (!match(TokenType::RBRACE)) {
         block->stmts.push_back(parseStmt());
     }
+    setSpan(*block, first);
 
     return block;
 }
@@ -106,6 +141,7 @@ std::unique_ptr<Stmt> Parser::parseStmt() {
 }
 
 std::unique_ptr<Stmt> Parser::parseVarDecl() {
+    size_t first = current;
     expect(TokenType::INT, "Expected 'int' for variable declaration");
 
     if (!match(TokenType::IDENTIFIER))
@@ -119,10 +155,13 @@ std::unique_ptr<Stmt> Parser::parseVarDecl() {
 
     expect(TokenType::SEMICOLON, "Expected ';' after variable declaration");
 
-    return std::make_unique<VarDeclStmt>("int", name, std::move(initializer));
+    auto decl = std::make_unique<VarDeclStmt>("int", name, std::move(initializer));
+    setSpan(*decl, first);
+    return decl;
 }
 
 std::unique_ptr<Stmt> Parser::parseIfStmt() {
+    size_t first = current;
     expect(TokenType::IF, "Expected 'if'");
 
     expect(TokenType::LPAREN, "Expected '(' after if");
@@ -138,6 +177,7 @@ std::unique_ptr<Stmt> Parser::parseIfStmt() {
         thenBlk = std::unique_ptr<Block>(static_cast<Block*>(thenBlock.release()));
     } else {
         thenBlk = std::make_unique<Block>();
+        thenBlk->span = thenBlock->span;
         thenBlk->stmts.push_back(std::move(thenBlock));
     }
 
@@ -148,14 +188,18 @@ std::unique_ptr<Stmt> Parser::parseIfStmt() {
             elseBlk = std::unique_ptr<Block>(static_cast<Block*>(elseStmt.release()));
         } else {
             elseBlk = std::make_unique<Block>();
+            elseBlk->span = elseStmt->span;
             elseBlk->stmts.push_back(std::move(elseStmt));
         }
     }
 
-    return std::make_unique<IfStmt>(std::move(cond), std::move(thenBlk), std::move(elseBlk));
+    auto ifStmt = std::make_unique<IfStmt>(std::move(cond), std::move(thenBlk), std::move(elseBlk));
+    setSpan(*ifStmt, first);
+    return ifStmt;
 }
 
 std::unique_ptr<Stmt> Parser::parseWhileStmt() {
+    size_t first = current;
     expect(TokenType::WHILE, "Expected 'while'");
 
     expect(TokenType::LPAREN, "Expected '(' after while");
@@ -171,58 +215,71 @@ std::unique_ptr<Stmt> Parser::parseWhileStmt() {
         bodyBlk = std::unique_ptr<Block>(static_cast<Block*>(bodyStmt.release()));
     } else {
         bodyBlk = std::make_unique<Block>();
+        bodyBlk->span = bodyStmt->span;
         bodyBlk->stmts.push_back(std::move(bodyStmt));
     }
 
-    return std::make_unique<WhileStmt>(std::move(cond), std::move(bodyBlk));
+    auto whileStmt = std::make_unique<WhileStmt>(std::move(cond), std::move(bodyBlk));
+    setSpan(*whileStmt, first);
+    return whileStmt;
 }
 
 std::unique_ptr<Stmt> Parser::parseBreakStmt() {
+    size_t first = current;
     expect(TokenType::BREAK, "Expected 'break'");
     expect(TokenType::SEMICOLON, "Expected ';' after break");
-    return std::make_unique<BreakStmt>();
+    auto stmt = std::make_unique<BreakStmt>();
+    setSpan(*stmt, first);
+    return stmt;
 }
 
 std::unique_ptr<Stmt> Parser::parseContinueStmt() {
+    size_t first = current;
     expect(TokenType::CONTINUE, "Expected 'continue'");
     expect(TokenType::SEMICOLON, "Expected ';' after continue");
-    return std::make_unique<ContinueStmt>();
+    auto stmt = std::make_unique<ContinueStmt>();
+    setSpan(*stmt, first);
+    return stmt;
 }
 
 std::unique_ptr<Stmt> Parser::parseReturnStmt() {
+    size_t first = current;
     expect(TokenType::RETURN, "Expected 'return'");
+    auto retStmt = std::make_unique<ReturnStmt>();
     if (peek().type != TokenType::SEMICOLON) {
-        auto expr = parseExpr();
+        retStmt->expr = parseExpr();
         expect(TokenType::SEMICOLON, "Expected ';' after return expression");
-        auto retStmt = std::make_unique<ReturnStmt>();
-        retStmt->expr = std::move(expr);
-        return retStmt;
     } else {
         expect(TokenType::SEMICOLON, "Expected ';' after return");
-        return std::make_unique<ReturnStmt>();
     }
+    setSpan(*retStmt, first);
+    return retStmt;
 }
 
 std::unique_ptr<Stmt> Parser::parseAssignOrExprStmt() {
+    size_t first = current;
+    std::unique_ptr<Stmt> stmt;
     if (match(TokenType::IDENTIFIER)) {
         std::string name = tokens[current - 1].lexeme;
 
         if (match(TokenType::ASSIGN)) {
             auto value = parseExpr();
             expect(TokenType::SEMICOLON, "Expected ';' after assignment");
-            return std::make_unique<AssignStmt>(name, std::move(value));
+            stmt = std::make_unique<AssignStmt>(name, std::move(value));
         } else {
             // 不是赋值，回退以解析表达式
             current--;
             auto expr = parseExpr();
             expect(TokenType::SEMICOLON, "Expected ';' after expression");
-            return std::make_unique<ExprStmt>(std::move(expr));
+            stmt = std::make_unique<ExprStmt>(std::move(expr));
         }
     } else {
         auto expr = parseExpr();
         expect(TokenType::SEMICOLON, "Expected ';' after expression");
-        return std::make_unique<ExprStmt>(std::move(expr));
+        stmt = std::make_unique<ExprStmt>(std::move(expr));
     }
+    setSpan(*stmt, first);
+    return stmt;
 }
 
 // 递归下降表达式解析，支持优先级
@@ -232,46 +289,57 @@ std::unique_ptr<Expr> Parser::parseExpr() {
 }
 
 std::unique_ptr<Expr> Parser::parseLOrExpr() {
+    size_t first = current;
     auto lhs = parseLAndExpr();
     while (match(TokenType::LOGICAL_OR)) {
         std::string op = tokens[current - 1].lexeme;
         auto rhs = parseLAndExpr();
         lhs = std::make_unique<BinaryExpr>(op, std::move(lhs), std::move(rhs));
+        setSpan(*lhs, first);
     }
     return lhs;
 }
 
 std::unique_ptr<Expr> Parser::parseLAndExpr() {
+    size_t first = current;
     auto lhs = parseRelExpr();
     while (match(TokenType::LOGICAL_AND)) {
         std::string op = tokens[current - 1].lexeme;
         auto rhs = parseRelExpr();
         lhs = std::make_unique<BinaryExpr>(op, std::move(lhs), std::move(rhs));
+        setSpan(*lhs, first);
     }
     return lhs;
 }
 
 std::unique_ptr<Expr> Parser::parseRelExpr() {
+    size_t first = current;
     auto lhs = parseAddExpr();
     while (true) {
         if (match(TokenType::LESS)) {
             auto rhs = parseAddExpr();
             lhs = std::make_unique<BinaryExpr>("<", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::GREATER)) {
             auto rhs = parseAddExpr();
             lhs = std::make_unique<BinaryExpr>(">", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::LESS_EQUAL)) {
             auto rhs = parseAddExpr();
             lhs = std::make_unique<BinaryExpr>("<=", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::GREATER_EQUAL)) {
             auto rhs = parseAddExpr();
             lhs = std::make_unique<BinaryExpr>(">=", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::EQUAL)) {
             auto rhs = parseAddExpr();
             lhs = std::make_unique<BinaryExpr>("==", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::NOT_EQUAL)) {
             auto rhs = parseAddExpr();
             lhs = std::make_unique<BinaryExpr>("!=", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else {
             break;
         }
@@ -280,14 +348,17 @@ std::unique_ptr<Expr> Parser::parseRelExpr() {
 }
 
 std::unique_ptr<Expr> Parser::parseAddExpr() {
+    size_t first = current;
     auto lhs = parseMulExpr();
     while (true) {
         if (match(TokenType::PLUS)) {
             auto rhs = parseMulExpr();
             lhs = std::make_unique<BinaryExpr>("+", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::MINUS)) {
             auto rhs = parseMulExpr();
             lhs = std::make_unique<BinaryExpr>("-", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else {
             break;
         }
@@ -296,17 +367,21 @@ std::unique_ptr<Expr> Parser::parseAddExpr() {
 }
 
 std::unique_ptr<Expr> Parser::parseMulExpr() {
+    size_t first = current;
     auto lhs = parseUnaryExpr();
     while (true) {
         if (match(TokenType::MULTIPLY)) {
             auto rhs = parseUnaryExpr();
             lhs = std::make_unique<BinaryExpr>("*", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::DIVIDE)) {
             auto rhs = parseUnaryExpr();
             lhs = std::make_unique<BinaryExpr>("/", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else if (match(TokenType::MODULO)) {
             auto rhs = parseUnaryExpr();
             lhs = std::make_unique<BinaryExpr>("%", std::move(lhs), std::move(rhs));
+            setSpan(*lhs, first);
         } else {
             break;
         }
@@ -315,17 +390,23 @@ std::unique_ptr<Expr> Parser::parseMulExpr() {
 }
 
 std::unique_ptr<Expr> Parser::parseUnaryExpr() {
+    size_t first = current;
+    std::unique_ptr<Expr> expr;
     if (match(TokenType::PLUS)) {
-        return std::make_unique<UnaryExpr>("+", parseUnaryExpr());
+        expr = std::make_unique<UnaryExpr>("+", parseUnaryExpr());
     } else if (match(TokenType::MINUS)) {
-        return std::make_unique<UnaryExpr>("-", parseUnaryExpr());
+        expr = std::make_unique<UnaryExpr>("-", parseUnaryExpr());
     } else if (match(TokenType::NOT)) {
-        return std::make_unique<UnaryExpr>("!", parseUnaryExpr());
+        expr = std::make_unique<UnaryExpr>("!", parseUnaryExpr());
+    } else {
+        return parsePrimaryExpr();
     }
-    return parsePrimaryExpr();
+    setSpan(*expr, first);
+    return expr;
 }
 
 std::unique_ptr<Expr> Parser::parsePrimaryExpr() {
+    size_t first = current;
     if (match(TokenType::IDENTIFIER)) {
         std::string id = tokens[current - 1].lexeme;
 
@@ -338,13 +419,18 @@ std::unique_ptr<Expr> Parser::parsePrimaryExpr() {
                 } while (match(TokenType::COMMA));
                 expect(TokenType::RPAREN, "Expected ')' after function call arguments");
             }
+            setSpan(*callExpr, first);
             return callExpr;
         }
 
-        return std::make_unique<VarExpr>(id);
+        auto var = std::make_unique<VarExpr>(id);
+        setSpan(*var, first);
+        return var;
     } else if (match(TokenType::NUMBER)) {
         int val = std::stoi(tokens[current - 1].lexeme);
-        return std::make_unique<NumberExpr>(val);
+        auto num = std::make_unique<NumberExpr>(val);
+        setSpan(*num, first);
+        return num;
     } else if (match(TokenType::LPAREN)) {
         auto expr = parseExpr();
         expect(TokenType::RPAREN, "Expected ')' after expression");
@@ -0,0 +1,208 @@
+#include "passes.h"
+#include "tailcall.h"
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+const std::vector<PassInfo> &registeredPasses() {
+    using K = PassInfo::Kind;
+    static const std::vector<PassInfo> passes = {
+        {"inline", K::Ast, "inline small functions bottom-up over the call graph"},
+        {"tailrec", K::Ast, "turn self tail calls into loops"},
+        {"unroll", K::Ast, "fully or partially unroll counted loops"},
+        {"peephole", K::Machine, "table-driven peephole rewrites to a fixpoint"},
+        {"schedule", K::Machine, "basic-block list scheduling for the -mtune latency model"},
+        {"compress", K::Machine, "RVC compressed encodings where operands qualify (-mrvc)"},
+    };
+    return passes;
+}
+
+const PassInfo *findPass(const std::string &name) {
+    for (auto &pass : registeredPasses()) {
+        if (name == pass.name) return &pass;
+    }
+    return nullptr;
+}
+
+void applyOptLevel(int level, PassOptions &options) {
+    CodeGenOptions &cg = options.codegen;
+    if (level <= 0) {
+        options.pipeline.clear();
+        cg.tailCalls = cg.ipra = cg.ifConvert = false;
+    } else if (level == 1) {
+        options.pipeline = {"tailrec", "peephole"};
+        cg.tailCalls = cg.ipra = true;
+        cg.ifConvert = false;
+    } else {
+        options.pipeline = {"inline", "tailrec", "unroll", "peephole", "schedule"};
+        cg.tailCalls = cg.ipra = cg.ifConvert = true;
+    }
+}
+
+std::vector<std::string> parsePipeline(const std::string &list) {
+    std::vector<std::string> pipeline;
+    bool sawMachine = false, sawCompress = false;
+    std::istringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ',')) {
+        if (name.empty()) continue;
+        const PassInfo *pass = findPass(name);
+        if (!pass) throw std::runtime_error("Unknown pass: " + name);
+        if (sawCompress) throw std::runtime_error("Pass " + name + " must come before compress");
+        if (pass->kind == PassInfo::Kind::Machine) {
+            sawMachine = true;
+            sawCompress = name == "compress";
+        } else if (sawMachine) {
+            throw std::runtime_error("AST pass " + name + " must come before machine passes");
+        }
+        pipeline.push_back(name);
+    }
+    return pipeline;
+}
+
+static const LatencyModel &tuneModel(const std::string &tune) {
+    const LatencyModel *model = findLatencyModel(tune);
+    if (!model) throw std::runtime_error("Unknown -mtune value: " + tune);
+    return *model;
+}
+
+PassManager::PassManager(PassOptions &opts, std::ostream &os)
+    : options(opts), dump(os), scheduler(tuneModel(opts.codegen.tune)) {
+    for (auto &name : options.pipeline) {
+        const PassInfo *pass = findPass(name);
+        if (!pass) throw std::runtime_error("Unknown pass: " + name);
+        Stats entry;
+        entry.name = name;
+        entry.kind = pass->kind;
+        stats.push_back(entry);
+    }
+}
+
+double PassManager::elapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PassManager::recordPhase(const std::string &name, double seconds) {
+    auto it = std::find_if(phases.begin(), phases.end(), [&](const Phase &p) { return p.name == name; });
+    if (it == phases.end()) it = phases.insert(phases.end(), Phase{name});
+    it->runs++;
+    it->seconds += seconds;
+}
+
+bool PassManager::shouldPrint(const std::string &pass) const {
+    for (auto &name : options.printAfter) {
+        if (name == pass || name == "all") return true;
+    }
+    return false;
+}
+
+static long programSize(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    long size = 0;
+    for (auto &func : funcs) {
+        if (func->body) size += countNodes(func->body.get());
+    }
+    return size;
+}
+
+void PassManager::runAstPasses(std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    for (auto &entry : stats) {
+        if (entry.kind != PassInfo::Kind::Ast) continue;
+        long before = programSize(funcs);
+        auto start = std::chrono::steady_clock::now();
+        int changed = 0;
+        if (entry.name == "inline") {
+            Inliner inliner(options.inlining);
+            changed = inliner.run(funcs);
+        } else if (entry.name == "tailrec") {
+            changed = eliminateTailRecursion(funcs);
+        } else if (entry.name == "unroll") {
+            changed = unrollLoops(funcs, options.unrolling);
+        } else {
+            assert(false && "Unhandled AST pass");
+        }
+        entry.seconds += elapsedSince(start);
+        entry.runs++;
+        entry.changed += changed;
+        entry.sizeBefore += before;
+        entry.sizeAfter += programSize(funcs);
+
+        if (shouldPrint(entry.name)) {
+            dump << "*** AST after " << entry.name << " ***\n";
+            printSource(dump, funcs);
+        }
+    }
+}
+
+// 改动的指令数：去掉前后相同的部分，剩余区间中较长一侧的长度
+static long changedInstrs(const std::vector<AsmInstr> &before, const std::vector<AsmInstr> &after) {
+    auto same = [](const AsmInstr &a, const AsmInstr &b) {
+        return a.kind == b.kind && a.op == b.op && a.args == b.args;
+    };
+    size_t prefix = 0;
+    while (prefix < before.size() && prefix < after.size() && same(before[prefix], after[prefix])) prefix++;
+    size_t suffix = 0;
+    while (suffix + prefix < before.size() && suffix + prefix < after.size() &&
+           same(before[before.size() - 1 - suffix], after[after.size() - 1 - suffix])) {
+        suffix++;
+    }
+    return (long)std::max(before.size(), after.size()) - (long)(prefix + suffix);
+}
+
+void PassManager::runMachinePasses(const std::string &func, std::vector<AsmInstr> &code,
+                                   const ClobberMap *clobbers) {
+    for (auto &entry : stats) {
+        if (entry.kind != PassInfo::Kind::Machine) continue;
+        std::vector<AsmInstr> before = code;
+        auto start = std::chrono::steady_clock::now();
+        if (entry.name == "peephole") {
+            peephole.run(code, clobbers);
+        } else if (entry.name == "schedule") {
+            scheduler.run(code);
+        } else if (entry.name == "compress") {
+            compressor.run(code, clobbers);
+        } else {
+            assert(false && "Unhandled machine pass");
+        }
+        entry.seconds += elapsedSince(start);
+        entry.runs++;
+        entry.changed += changedInstrs(before, code);
+        // 压缩不改变指令条数，按字节计
+        bool bytes = entry.name == "compress";
+        entry.sizeBefore += bytes ? (long)codeBytes(before) : (long)before.size();
+        entry.sizeAfter += bytes ? (long)codeBytes(code) : (long)code.size();
+
+        if (shouldPrint(entry.name)) {
+            dump << "*** " << func << " after " << entry.name << " ***\n";
+            printAsm(dump, code);
+        }
+    }
+}
+
+void PassManager::attach(CodeGenOptions &codegen) {
+    codegen.machinePasses = [this](const std::string &func, std::vector<AsmInstr> &code, const ClobberMap *clobbers) {
+        runMachinePasses(func, code, clobbers);
+    };
+}
+
+void PassManager::printStats(std::ostream &os) const {
+    auto ms = [](double seconds) {
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(3) << seconds * 1000;
+        return s.str();
+    };
+    os << "pass statistics:\n";
+    os << "  " << std::left << std::setw(12) << "pass" << std::right << std::setw(6) << "runs"
+       << std::setw(12) << "time(ms)" << std::setw(10) << "changed" << "  size\n";
+    for (auto &phase : phases) {
+        os << "  " << std::left << std::setw(12) << phase.name << std::right << std::setw(6) << phase.runs
+           << std::setw(12) << ms(phase.seconds) << std::setw(10) << "-" << "\n";
+    }
+    for (auto &entry : stats) {
+        const char *unit = entry.kind == PassInfo::Kind::Ast ? "nodes" : entry.name == "compress" ? "bytes" : "instrs";
+        os << "  " << std::left << std::setw(12) << entry.name << std::right << std::setw(6) << entry.runs
+           << std::setw(12) << ms(entry.seconds) << std::setw(10) << entry.changed << "  "
+           << entry.sizeBefore << " -> " << entry.sizeAfter << " " << unit << "\n";
+    }
+}
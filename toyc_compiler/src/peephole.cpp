@@ -0,0 +1,343 @@
+#include "peephole.h"
+#include <algorithm>
+#include <iomanip>
+#include <unordered_set>
+
+// 指令引用的标签：跳转目标，或伪指令的第一个操作数（如 .globl）
+static std::string labelRef(const AsmInstr &ins) {
+    if (ins.kind == AsmInstr::Kind::Directive) return ins.args.empty() ? "" : ins.args[0];
+    return branchTarget(ins);
+}
+
+void PeepholeContext::rebuild() {
+    liveOut = computeLiveOut(code, clobbers);
+    liveValid = true;
+    labels.clear();
+    uses.clear();
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i].isLabel()) labels.emplace(code[i].op, i);
+        std::string ref = labelRef(code[i]);
+        if (!ref.empty()) uses[ref]++;
+    }
+}
+
+bool PeepholeContext::deadAfter(size_t i, const std::string &reg) {
+    if (!liveValid) rebuild();
+    return !(liveOut[i] & regBit(regIndex(reg)));
+}
+
+size_t PeepholeContext::findLabel(const std::string &name) const {
+    auto it = labels.find(name);
+    return it == labels.end() ? code.size() : it->second;
+}
+
+int PeepholeContext::labelUses(const std::string &name) const {
+    auto it = uses.find(name);
+    return it == uses.end() ? 0 : it->second;
+}
+
+void PeepholeContext::erase(size_t i) {
+    if (code[i].isLabel()) labels.erase(code[i].op);
+    code.erase(code.begin() + i);
+    if (liveValid) liveOut.erase(liveOut.begin() + i);
+    for (auto &entry : labels) {
+        if (entry.second > i) entry.second--;
+    }
+}
+
+RegSet PeepholeContext::liveIn(size_t i) const {
+    return regUses(code[i]) | (liveOut[i] & ~regDefs(code[i], clobbers));
+}
+
+// 与 computeLiveOut 相同的方程，后继的活跃信息取当前值
+RegSet PeepholeContext::successorLive(size_t i) const {
+    const AsmInstr &ins = code[i];
+    RegSet out = 0;
+    std::string target = branchTarget(ins);
+    if (!target.empty()) {
+        auto it = labels.find(target);
+        out |= it == labels.end() ? kExitLiveSet : liveIn(it->second);
+    }
+    if (!isUncondTransfer(ins)) out |= i + 1 < code.size() ? liveIn(i + 1) : kExitLiveSet;
+    else if (target.empty()) out |= kExitLiveSet;
+    return out;
+}
+
+void PeepholeContext::beginRewrite(size_t i, size_t window) {
+    if (!liveValid) rebuild();
+    rewriteAt = i;
+    rewriteSize = code.size();
+    rewriteLiveIn = liveIn(i);
+    size_t end = std::min(i + window, code.size());
+    rewriteRefs.clear();
+    rewriteLabels.clear();
+    for (size_t k = i; k < end; k++) {
+        rewriteRefs.push_back(labelRef(code[k]));
+        rewriteLabels.push_back(code[k].isLabel());
+    }
+}
+
+void PeepholeContext::endRewrite(size_t n) {
+    // 规则只改写或删除区间内的指令
+    size_t removed = rewriteSize - code.size();
+    size_t end = rewriteAt + n - removed;
+    for (size_t k = 0; k < n; k++) {
+        if (!rewriteRefs[k].empty()) uses[rewriteRefs[k]]--;
+    }
+    for (size_t k = rewriteAt; k < end; k++) {
+        std::string ref = labelRef(code[k]);
+        if (!ref.empty()) uses[ref]++;
+    }
+
+    // 区间中间的标签另有前驱，其活跃信息无法只在区间内更新
+    bool innerLabel = std::find(rewriteLabels.begin() + 1, rewriteLabels.begin() + n, true) != rewriteLabels.begin() + n;
+    if (!liveValid || innerLabel) {
+        liveValid = false;
+        return;
+    }
+    for (size_t k = end; k-- > rewriteAt;) liveOut[k] = successorLive(k);
+    // 入口的活跃集合只缩小时，前驱的信息仍是保守的
+    RegSet in = rewriteAt < code.size() ? liveIn(rewriteAt) : kExitLiveSet;
+    if (in & ~rewriteLiveIn) liveValid = false;
+}
+
+static bool isOp(const AsmInstr &ins, const char *op) {
+    return ins.isInstr() && ins.op == op;
+}
+
+// 跳过标签，返回从 i 开始的第一条指令或伪指令
+static size_t skipLabels(const std::vector<AsmInstr> &code, size_t i) {
+    while (i < code.size() && code[i].isLabel()) i++;
+    return i;
+}
+
+// i 之后紧邻的标签中是否有 name（即跳到 name 等价于顺序执行到 i）
+static bool labelFollows(const std::vector<AsmInstr> &code, size_t i, const std::string &name) {
+    for (; i < code.size() && code[i].isLabel(); i++) {
+        if (code[i].op == name) return true;
+    }
+    return false;
+}
+
+static bool fitsImm12(long long value) {
+    return value >= -2048 && value <= 2047;
+}
+
+// 把指令读取 from 的操作数改为 to；写入的操作数不变
+static void replaceUses(AsmInstr &ins, const std::string &from, const std::string &to) {
+    size_t first = regDefs(ins) ? 1 : 0;
+    for (size_t a = first; a < ins.args.size(); a++) {
+        std::string &arg = ins.args[a];
+        int offset;
+        std::string base;
+        if (arg == from) {
+            arg = to;
+        } else if (parseMemOperand(arg, offset, base) && base == from) {
+            arg = memOperand(offset, to);
+        }
+    }
+}
+
+// mv r, r
+static bool redundantMove(PeepholeContext &ctx, size_t i) {
+    const AsmInstr &ins = ctx.code[i];
+    if (!isOp(ins, "mv") || ins.args[0] != ins.args[1]) return false;
+    ctx.erase(i);
+    return true;
+}
+
+// sw r, M; lw d, M  =>  sw r, M; mv d, r
+static bool storeLoadForward(PeepholeContext &ctx, size_t i) {
+    const AsmInstr &st = ctx.code[i];
+    const AsmInstr &ld = ctx.code[i + 1];
+    if (!isOp(st, "sw") || !isOp(ld, "lw") || st.args[1] != ld.args[1]) return false;
+    if (ld.args[0] == st.args[0]) {
+        ctx.erase(i + 1);
+    } else {
+        ctx.code[i + 1] = AsmInstr::instr("mv", {ld.args[0], st.args[0]});
+    }
+    return true;
+}
+
+// 结果不再被读取的无副作用指令
+static bool deadDef(PeepholeContext &ctx, size_t i) {
+    const AsmInstr &ins = ctx.code[i];
+    if (!isPure(ins) || ins.args[0] == "zero" || !ctx.deadAfter(i, ins.args[0])) return false;
+    ctx.erase(i);
+    return true;
+}
+
+// op t, ...; mv d, t（t 随后不再使用） =>  op d, ...
+static bool foldMoveIntoDef(PeepholeContext &ctx, size_t i) {
+    AsmInstr &def = ctx.code[i];
+    const AsmInstr &mv = ctx.code[i + 1];
+    if (!isPure(def) || !isOp(mv, "mv") || mv.args[1] != def.args[0] || mv.args[0] == mv.args[1]) return false;
+    if (!ctx.deadAfter(i + 1, def.args[0])) return false;
+    def.args[0] = mv.args[0];
+    ctx.erase(i + 1);
+    return true;
+}
+
+// mv d, s; op ..., d, ...（d 随后不再使用） =>  op ..., s, ...
+static bool propagateMove(PeepholeContext &ctx, size_t i) {
+    const AsmInstr &mv = ctx.code[i];
+    AsmInstr &use = ctx.code[i + 1];
+    if (!isOp(mv, "mv") || !use.isInstr() || !(isPure(use) || isStore(use) || isCondBranch(use))) return false;
+    const std::string &d = mv.args[0], &s = mv.args[1];
+    RegSet bit = regBit(regIndex(d));
+    if (d == s || !(regUses(use) & bit)) return false;
+    if (!(regDefs(use) & bit) && !ctx.deadAfter(i + 1, d)) return false;
+    replaceUses(use, d, s);
+    ctx.erase(i);
+    return true;
+}
+
+// li t, K; op d, a, t  =>  opi d, a, K
+static bool immFold(PeepholeContext &ctx, size_t i) {
+    const AsmInstr &li = ctx.code[i];
+    AsmInstr &ins = ctx.code[i + 1];
+    if (!isOp(li, "li") || !ins.isInstr() || ins.args.size() != 3) return false;
+    static const std::unordered_set<std::string> commutative = {"add", "xor", "or", "and", "mul"};
+    static const std::unordered_set<std::string> rhsOnly = {"sub", "slt", "sltu"};
+    const std::string &t = li.args[0];
+    bool lhsIsT = ins.args[1] == t, rhsIsT = ins.args[2] == t;
+    if (lhsIsT == rhsIsT) return false;
+    if (!commutative.count(ins.op) && !(rhsOnly.count(ins.op) && rhsIsT)) return false;
+    if (ins.args[0] != t && !ctx.deadAfter(i + 1, t)) return false;
+
+    long long k = std::stoll(li.args[1]);
+    std::string other = lhsIsT ? ins.args[2] : ins.args[1];
+    AsmInstr folded;
+    if (ins.op == "mul") {
+        if (k <= 0 || (k & (k - 1))) return false;
+        int shift = 0;
+        while ((1LL << shift) < k) shift++;
+        folded = shift == 0 ? AsmInstr::instr("mv", {ins.args[0], other})
+                            : AsmInstr::instr("slli", {ins.args[0], other, std::to_string(shift)});
+    } else {
+        if (ins.op == "sub") k = -k;
+        if (!fitsImm12(k)) return false;
+        std::string op = ins.op == "sub" ? "add" : ins.op;
+        folded = AsmInstr::instr(op == "sltu" ? "sltiu" : op + "i", {ins.args[0], other, std::to_string(k)});
+    }
+    ins = folded;
+    ctx.erase(i);
+    return true;
+}
+
+// j L; L:
+static bool jumpToNext(PeepholeContext &ctx, size_t i) {
+    const AsmInstr &ins = ctx.code[i];
+    if (!isOp(ins, "j") || !labelFollows(ctx.code, i + 1, ins.args[0])) return false;
+    ctx.erase(i);
+    return true;
+}
+
+// bcc L1; j L2; L1:  =>  b!cc L2; L1:
+static bool branchOverJump(PeepholeContext &ctx, size_t i) {
+    AsmInstr &br = ctx.code[i];
+    const AsmInstr &jmp = ctx.code[i + 1];
+    if (!isCondBranch(br) || !isOp(jmp, "j") || !labelFollows(ctx.code, i + 2, branchTarget(br))) return false;
+    br.op = invertBranch(br.op);
+    setBranchTarget(br, jmp.args[0]);
+    ctx.erase(i + 1);
+    return true;
+}
+
+// 跳到另一条无条件跳转的跳转直接改跳最终目标；j 到 ret 改为 ret
+static bool jumpThread(PeepholeContext &ctx, size_t i) {
+    AsmInstr &ins = ctx.code[i];
+    std::string target = branchTarget(ins);
+    if (target.empty()) return false;
+    // 沿跳转链走到最终目标；链成环（死循环）时保持原样
+    std::string final = target;
+    std::unordered_set<std::string> seen = {target};
+    size_t at;
+    while ((at = skipLabels(ctx.code, ctx.findLabel(final))) < ctx.code.size() && isOp(ctx.code[at], "j")) {
+        final = ctx.code[at].args[0];
+        if (!seen.insert(final).second) return false;
+    }
+    if (final != target) {
+        setBranchTarget(ins, final);
+        return true;
+    }
+    if (at < ctx.code.size() && isOp(ctx.code[at], "ret") && isOp(ins, "j")) {
+        ins = ctx.code[at];
+        return true;
+    }
+    return false;
+}
+
+// 无条件跳转之后、下一个标签之前的指令不可达
+static bool unreachable(PeepholeContext &ctx, size_t i) {
+    if (!isUncondTransfer(ctx.code[i]) || !ctx.code[i + 1].isInstr()) return false;
+    ctx.erase(i + 1);
+    return true;
+}
+
+// 没有任何跳转引用的局部标签
+static bool unusedLabel(PeepholeContext &ctx, size_t i) {
+    const AsmInstr &label = ctx.code[i];
+    if (!label.isLabel() || ctx.labelUses(label.op) > 0) return false;
+    ctx.erase(i);
+    return true;
+}
+
+const std::vector<PeepholeRule> &peepholeRules() {
+    static const std::vector<PeepholeRule> rules = {
+        {"redundant-move", 1, redundantMove},
+        {"store-load-forward", 2, storeLoadForward},
+        {"dead-def", 1, deadDef},
+        {"fold-move-into-def", 2, foldMoveIntoDef},
+        {"propagate-move", 2, propagateMove},
+        {"imm-fold", 2, immFold},
+        {"jump-to-next", 1, jumpToNext},
+        {"branch-over-jump", 2, branchOverJump},
+        {"jump-thread", 1, jumpThread},
+        {"unreachable", 2, unreachable},
+        {"unused-label", 1, unusedLabel},
+    };
+    return rules;
+}
+
+Peephole::Peephole() : hitCounts(peepholeRules().size(), 0) {}
+
+int Peephole::run(std::vector<AsmInstr> &code, const ClobberMap *clobbers) {
+    const auto &rules = peepholeRules();
+    PeepholeContext ctx(code);
+    ctx.clobbers = clobbers;
+    size_t maxWindow = 0;
+    for (auto &rule : rules) maxWindow = std::max(maxWindow, (size_t)rule.window);
+    int rewrites = 0;
+    // 跳转串联成环时 jump-thread 可能反复改写，限制轮数。
+    // 每轮开始时整体计算活跃信息与标签表，轮内随改写局部更新
+    for (int pass = 0; pass < 16; pass++) {
+        bool changed = false;
+        ctx.rebuild();
+        for (size_t i = 0; i < code.size(); i++) {
+            ctx.beginRewrite(i, maxWindow);
+            // 命中后在同一位置重新尝试所有规则
+            for (size_t r = 0; r < rules.size() && i < code.size(); r++) {
+                if (i + rules[r].window > code.size()) continue;
+                if (rules[r].apply(ctx, i)) {
+                    hitCounts[r]++;
+                    rewrites++;
+                    changed = true;
+                    ctx.endRewrite(rules[r].window);
+                    if (i < code.size()) ctx.beginRewrite(i, maxWindow);
+                    r = (size_t)-1;
+                }
+            }
+        }
+        if (!changed) break;
+    }
+    return rewrites;
+}
+
+void Peephole::printStats(std::ostream &os) const {
+    const auto &rules = peepholeRules();
+    os << "peephole statistics:\n";
+    for (size_t r = 0; r < rules.size(); r++) {
+        os << "  " << std::left << std::setw(20) << rules[r].name << hitCounts[r] << "\n";
+    }
+}
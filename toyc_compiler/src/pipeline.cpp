@@ -0,0 +1,102 @@
+#include "pipeline.h"
+#include "lexer.h"
+#include "parser.h"
+#include <iomanip>
+
+namespace {
+
+// 语法分析线程在等待 token 时发现已取消，借异常退出 Parser
+struct Cancelled {};
+
+// 等待 ready() 成立，先自旋再让出 CPU；第一次不成立时记一次等待。取消时返回 false
+template <typename F>
+bool waitFor(F &&ready, const std::atomic<bool> &cancelled, size_t &stalls) {
+    if (ready()) return true;
+    stalls++;
+    for (int spin = 0; !ready(); spin++) {
+        if (cancelled.load(std::memory_order_relaxed)) return false;
+        if (spin >= 64) std::this_thread::yield();
+    }
+    return true;
+}
+
+} // namespace
+
+PipelinedFrontEnd::PipelinedFrontEnd(const std::string &source, const PipelineOptions &options)
+    : tokenRing(options.tokenBatches), funcRing(options.functions) {
+    size_t batchSize = options.tokenBatch > 0 ? options.tokenBatch : 1;
+    lexerThread = std::thread([this, &source, batchSize] { lex(source, batchSize); });
+    parserThread = std::thread([this] { parse(); });
+}
+
+PipelinedFrontEnd::~PipelinedFrontEnd() {
+    cancelled.store(true, std::memory_order_relaxed);
+    lexerThread.join();
+    parserThread.join();
+}
+
+void PipelinedFrontEnd::lex(const std::string &source, size_t batchSize) {
+    Lexer lexer(source);
+    bool done = false;
+    while (!done) {
+        std::vector<Token> batch;
+        batch.reserve(batchSize);
+        while (batch.size() < batchSize && !done) {
+            batch.push_back(lexer.next());
+            done = batch.back().type == TokenType::END_OF_FILE;
+        }
+        counters.tokens += batch.size();
+        counters.batches++;
+        if (!waitFor([&] { return tokenRing.tryPush(batch); }, cancelled, counters.lexerStalls)) return;
+    }
+}
+
+void PipelinedFrontEnd::parse() {
+    std::vector<Token> batch;
+    size_t pos = 0;
+    Parser parser([&]() -> Token {
+        while (pos == batch.size()) {
+            if (!waitFor([&] { return tokenRing.tryPop(batch); }, cancelled, counters.parserStarved)) {
+                throw Cancelled();
+            }
+            pos = 0;
+        }
+        return std::move(batch[pos++]);
+    });
+    try {
+        while (auto func = parser.parseNextFunc()) {
+            counters.functions++;
+            if (!waitFor([&] { return funcRing.tryPush(func); }, cancelled, counters.parserStalls)) return;
+        }
+    } catch (const Cancelled &) {
+        return;
+    } catch (...) {
+        parseError = std::current_exception();
+    }
+    // 空指针是结束标记，之前写入的 parseError 随之对调用者可见
+    std::unique_ptr<FuncDef> end;
+    waitFor([&] { return funcRing.tryPush(end); }, cancelled, counters.parserStalls);
+}
+
+std::unique_ptr<FuncDef> PipelinedFrontEnd::next() {
+    if (finished) return nullptr;
+    std::unique_ptr<FuncDef> func;
+    waitFor([&] { return funcRing.tryPop(func); }, cancelled, counters.consumerStarved);
+    if (!func) {
+        finished = true;
+        if (parseError) std::rethrow_exception(parseError);
+    }
+    return func;
+}
+
+void PipelineStats::print(std::ostream &os) const {
+    auto row = [&](const char *what, size_t count) {
+        os << "  " << std::left << std::setw(40) << what << std::right << count << "\n";
+    };
+    os << "pipeline statistics:\n";
+    os << "  " << tokens << " tokens in " << batches << " batches, " << functions << " functions\n";
+    row("lexer waited on full token ring", lexerStalls);
+    row("parser waited on empty token ring", parserStarved);
+    row("parser waited on full function ring", parserStalls);
+    row("codegen waited on empty function ring", consumerStarved);
+}
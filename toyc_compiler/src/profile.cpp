@@ -0,0 +1,153 @@
+#include "profile.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+// FNV-1a
+static void mix(uint32_t &hash, const std::string &text) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+}
+
+static void assignIds(Expr *expr, ProfileLayout &layout);
+
+static void assignIds(Stmt *stmt, ProfileLayout &layout) {
+    if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
+        if (decl->initializer) assignIds(decl->initializer.get(), layout);
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        assignIds(assign->value.get(), layout);
+    } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+        assignIds(exprStmt->expr.get(), layout);
+    } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        if (ret->expr) assignIds(ret->expr.get(), layout);
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        for (auto &s : block->stmts) assignIds(s.get(), layout);
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        ifStmt->profileId = layout.counters;
+        layout.counters += 2;
+        mix(layout.checksum, "if");
+        assignIds(ifStmt->condition.get(), layout);
+        assignIds(ifStmt->thenBlock.get(), layout);
+        if (ifStmt->elseBlock) assignIds(ifStmt->elseBlock.get(), layout);
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        whileStmt->profileId = layout.counters;
+        layout.counters += 2;
+        mix(layout.checksum, "while");
+        assignIds(whileStmt->condition.get(), layout);
+        assignIds(whileStmt->body.get(), layout);
+    }
+}
+
+static void assignIds(Expr *expr, ProfileLayout &layout) {
+    if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        assignIds(unary->operand.get(), layout);
+    } else if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        assignIds(bin->lhs.get(), layout);
+        assignIds(bin->rhs.get(), layout);
+    } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
+        for (auto &arg : call->args) assignIds(arg.get(), layout);
+        call->profileId = layout.counters++;
+        mix(layout.checksum, "call " + call->callee);
+    }
+}
+
+ProfileLayout assignProfileIds(std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    ProfileLayout layout;
+    for (auto &func : funcs) assignProfileIds(*func, layout);
+    return layout;
+}
+
+void assignProfileIds(FuncDef &func, ProfileLayout &layout) {
+    func.profileId = layout.counters++;
+    mix(layout.checksum, "func " + func.name);
+    if (func.body) assignIds(func.body.get(), layout);
+}
+
+static uint32_t readWord(std::istream &in) {
+    unsigned char bytes[4];
+    if (!in.read(reinterpret_cast<char *>(bytes), 4)) throw std::runtime_error("Truncated profile data");
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+ProfileData ProfileData::load(const std::string &path, const ProfileLayout &layout, std::ostream &warn) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open profile " + path);
+    if (readWord(in) != kProfileMagic) throw std::runtime_error("Not a toyc profile: " + path);
+    if (readWord(in) != kProfileVersion) throw std::runtime_error("Unsupported profile version: " + path);
+
+    ProfileData data;
+    uint32_t counters = readWord(in);
+    uint32_t checksum = readWord(in);
+    if ((int)counters != layout.counters || checksum != layout.checksum) {
+        warn << "warning: profile " << path << " does not match the source, ignoring it\n";
+        return data;
+    }
+    data.counts.resize(counters);
+    for (auto &count : data.counts) {
+        count = readWord(in);
+        data.maxCount = std::max(data.maxCount, count);
+    }
+    return data;
+}
+
+static std::string quote(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+std::vector<AsmInstr> profileRuntime(const ProfileLayout &layout, const std::string &path) {
+    using I = AsmInstr;
+    int bytes = (kProfileHeaderWords + layout.counters) * 4;
+    std::vector<AsmInstr> code = {
+        I::directive(".data"),
+        I::directive(".p2align", {"2"}),
+        I::label("__toyc_prof_data"),
+        I::directive(".word", {std::to_string(kProfileMagic), std::to_string(kProfileVersion),
+                               std::to_string(layout.counters), std::to_string(layout.checksum)}),
+        I::label(kProfileCounters),
+        I::directive(".zero", {std::to_string(layout.counters * 4)}),
+        I::label("__toyc_prof_path"),
+        I::directive(".asciz", {quote(path)}),
+        I::directive(".text"),
+
+        // openat(AT_FDCWD, path, O_WRONLY | O_CREAT | O_TRUNC, 0644); write; close
+        I::directive(".globl", {"__toyc_prof_dump"}),
+        I::label("__toyc_prof_dump"),
+        I::instr("li", {"a0", "-100"}),
+        I::instr("la", {"a1", "__toyc_prof_path"}),
+        I::instr("li", {"a2", "577"}),
+        I::instr("li", {"a3", "420"}),
+        I::instr("li", {"a7", "56"}),
+        I::instr("ecall"),
+        I::instr("bltz", {"a0", "__toyc_prof_done"}),
+        I::instr("mv", {"t0", "a0"}),
+        I::instr("la", {"a1", "__toyc_prof_data"}),
+        I::instr("li", {"a2", std::to_string(bytes)}),
+        I::instr("li", {"a7", "64"}),
+        I::instr("ecall"),
+        I::instr("mv", {"a0", "t0"}),
+        I::instr("li", {"a7", "57"}),
+        I::instr("ecall"),
+        I::label("__toyc_prof_done"),
+        I::instr("ret"),
+
+        I::directive(".globl", {"main"}),
+        I::label("main"),
+        I::instr("addi", {"sp", "sp", "-16"}),
+        I::instr("sw", {"ra", "0(sp)"}),
+        I::instr("call", {kProfileUserMain}),
+        I::instr("sw", {"a0", "4(sp)"}),
+        I::instr("call", {"__toyc_prof_dump"}),
+        I::instr("lw", {"a0", "4(sp)"}),
+        I::instr("lw", {"ra", "0(sp)"}),
+        I::instr("addi", {"sp", "sp", "16"}),
+        I::instr("ret"),
+    };
+    return code;
+}
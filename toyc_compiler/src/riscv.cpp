@@ -0,0 +1,416 @@
+#include "riscv.h"
+#include <climits>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+AsmInstr AsmInstr::instr(const std::string &op, std::vector<std::string> args) {
+    AsmInstr ins;
+    ins.op = op;
+    ins.args = std::move(args);
+    return ins;
+}
+
+AsmInstr AsmInstr::label(const std::string &name) {
+    AsmInstr ins;
+    ins.kind = Kind::Label;
+    ins.op = name;
+    return ins;
+}
+
+AsmInstr AsmInstr::directive(const std::string &name, std::vector<std::string> args) {
+    AsmInstr ins;
+    ins.kind = Kind::Directive;
+    ins.op = name;
+    ins.args = std::move(args);
+    return ins;
+}
+
+std::string AsmInstr::text() const {
+    if (kind == Kind::Label) return op + ":";
+    std::string s = kind == Kind::Instr ? "\t" + op : op;
+    for (size_t i = 0; i < args.size(); i++) {
+        s += (i == 0 ? " " : ", ") + args[i];
+    }
+    return s;
+}
+
+static const char *kRegNames[32] = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+    "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+    "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"};
+
+int regIndex(const std::string &name) {
+    static const std::unordered_map<std::string, int> table = [] {
+        std::unordered_map<std::string, int> t;
+        for (int i = 0; i < 32; i++) {
+            t[kRegNames[i]] = i;
+            t["x" + std::to_string(i)] = i;
+        }
+        t["fp"] = 8;
+        return t;
+    }();
+    auto it = table.find(name);
+    return it == table.end() ? -1 : it->second;
+}
+
+const char *regName(int index) {
+    return index >= 0 && index < 32 ? kRegNames[index] : "?";
+}
+
+std::string memOperand(int offset, const std::string &base) {
+    return std::to_string(offset) + "(" + base + ")";
+}
+
+bool parseMemOperand(const std::string &operand, int &offset, std::string &base) {
+    size_t open = operand.find('(');
+    size_t close = operand.find(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) return false;
+    offset = open == 0 ? 0 : std::stoi(operand.substr(0, open));
+    base = operand.substr(open + 1, close - open - 1);
+    return true;
+}
+
+static RegSet makeSet(std::initializer_list<const char *> names) {
+    RegSet set = 0;
+    for (auto n : names) set |= regBit(regIndex(n));
+    return set;
+}
+
+const RegSet kArgRegSet = makeSet({"a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7"});
+const RegSet kCallerSavedSet = kArgRegSet | makeSet({"ra", "t0", "t1", "t2", "t3", "t4", "t5", "t6"});
+const RegSet kCalleeSavedSet = makeSet({"s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"});
+const RegSet kExitLiveSet = makeSet({"a0", "sp", "ra"}) | kCalleeSavedSet;
+
+static const std::unordered_set<std::string> kRTypeOps = {
+    "add", "sub", "mul", "mulh", "mulhu", "mulhsu", "div", "divu", "rem", "remu",
+    "slt", "sltu", "xor", "or", "and", "sll", "srl", "sra"};
+static const std::unordered_set<std::string> kITypeOps = {
+    "addi", "slti", "sltiu", "xori", "ori", "andi", "slli", "srli", "srai"};
+static const std::unordered_set<std::string> kUnaryOps = {
+    "mv", "neg", "not", "seqz", "snez", "sltz", "sgtz"};
+static const std::unordered_set<std::string> kBranch2Ops = {
+    "beq", "bne", "blt", "bge", "bltu", "bgeu", "bgt", "ble", "bgtu", "bleu"};
+static const std::unordered_set<std::string> kBranch1Ops = {
+    "beqz", "bnez", "blez", "bgez", "bltz", "bgtz"};
+
+bool isCompressed(const AsmInstr &ins) {
+    return ins.isInstr() && ins.op.size() > 2 && ins.op[0] == 'c' && ins.op[1] == '.';
+}
+
+AsmInstr expandCompressed(const AsmInstr &ins) {
+    if (!isCompressed(ins)) return ins;
+    const std::string op = ins.op.substr(2);
+    const auto &a = ins.args;
+    auto need = [&](size_t n) {
+        if (a.size() != n) throw std::runtime_error("Wrong operand count: " + ins.text());
+    };
+    // 两地址形式：rd 同时是第一个源操作数
+    static const std::unordered_set<std::string> twoAddress = {
+        "add", "sub", "xor", "or", "and", "addi", "slli", "srli", "srai", "andi"};
+    if (twoAddress.count(op)) {
+        need(2);
+        return AsmInstr::instr(op, {a[0], a[0], a[1]});
+    }
+    if (op == "addi16sp" || op == "addi4spn") {
+        need(op == "addi16sp" ? 2 : 3);
+        return AsmInstr::instr("addi", {a[0], "sp", a.back()});
+    }
+    if (op == "lwsp" || op == "lw" || op == "swsp" || op == "sw") {
+        need(2);
+        return AsmInstr::instr(op[0] == 'l' ? "lw" : "sw", a);
+    }
+    if (op == "li" || op == "lui" || op == "mv" || op == "beqz" || op == "bnez") {
+        need(2);
+        return AsmInstr::instr(op, a);
+    }
+    if (op == "j" || op == "jalr") {
+        need(1);
+        return AsmInstr::instr(op, a);
+    }
+    if (op == "jr") {
+        need(1);
+        return a[0] == "ra" ? AsmInstr::instr("ret") : AsmInstr::instr("jr", a);
+    }
+    if (op == "nop") {
+        need(0);
+        return AsmInstr::instr("nop");
+    }
+    throw std::runtime_error("Unsupported instruction: " + ins.text());
+}
+
+bool isCondBranch(const AsmInstr &ins) {
+    if (isCompressed(ins)) return ins.op == "c.beqz" || ins.op == "c.bnez";
+    return ins.isInstr() && (kBranch2Ops.count(ins.op) || kBranch1Ops.count(ins.op));
+}
+
+bool isUncondTransfer(const AsmInstr &ins) {
+    if (isCompressed(ins)) return ins.op == "c.j" || ins.op == "c.jr";
+    return ins.isInstr() && (ins.op == "j" || ins.op == "jr" || ins.op == "ret" || ins.op == "tail");
+}
+
+std::string branchTarget(const AsmInstr &ins) {
+    if (isCondBranch(ins) || (ins.isInstr() && (ins.op == "j" || ins.op == "c.j"))) return ins.args.back();
+    return "";
+}
+
+void setBranchTarget(AsmInstr &ins, const std::string &target) {
+    ins.args.back() = target;
+}
+
+std::string invertBranch(const std::string &op) {
+    static const std::unordered_map<std::string, std::string> table = {
+        {"beq", "bne"}, {"bne", "beq"}, {"blt", "bge"}, {"bge", "blt"},
+        {"bltu", "bgeu"}, {"bgeu", "bltu"}, {"bgt", "ble"}, {"ble", "bgt"},
+        {"bgtu", "bleu"}, {"bleu", "bgtu"}, {"beqz", "bnez"}, {"bnez", "beqz"},
+        {"blez", "bgtz"}, {"bgtz", "blez"}, {"bltz", "bgez"}, {"bgez", "bltz"},
+        {"c.beqz", "c.bnez"}, {"c.bnez", "c.beqz"}};
+    return table.at(op);
+}
+
+bool isLoad(const AsmInstr &ins) {
+    if (isCompressed(ins)) return ins.op == "c.lw" || ins.op == "c.lwsp";
+    return ins.isInstr() && (ins.op == "lw" || ins.op == "lh" || ins.op == "lb" || ins.op == "lhu" || ins.op == "lbu");
+}
+
+bool isStore(const AsmInstr &ins) {
+    if (isCompressed(ins)) return ins.op == "c.sw" || ins.op == "c.swsp";
+    return ins.isInstr() && (ins.op == "sw" || ins.op == "sh" || ins.op == "sb");
+}
+
+static RegSet reg(const std::string &name) {
+    return regBit(regIndex(name));
+}
+
+static RegSet memBase(const std::string &operand) {
+    int offset;
+    std::string base;
+    return parseMemOperand(operand, offset, base) ? reg(base) : 0;
+}
+
+static RegSet calleeClobbers(const std::string &callee, const ClobberMap *clobbers) {
+    if (!clobbers) return kCallerSavedSet;
+    auto it = clobbers->find(callee);
+    return it == clobbers->end() ? kCallerSavedSet : it->second;
+}
+
+RegSet regDefs(const AsmInstr &ins, const ClobberMap *clobbers) {
+    if (!ins.isInstr()) return 0;
+    if (isCompressed(ins)) return regDefs(expandCompressed(ins), clobbers);
+    const std::string &op = ins.op;
+    if (kRTypeOps.count(op) || kITypeOps.count(op) || kUnaryOps.count(op) ||
+        op == "li" || op == "la" || op == "lui" || op == "auipc" || isLoad(ins)) {
+        return reg(ins.args[0]);
+    }
+    if (op == "ecall") return reg("a0");
+    if (op == "call") return calleeClobbers(ins.args[0], clobbers) | reg("ra");
+    if (op == "jal") return ins.args.size() == 2 ? reg(ins.args[0]) : reg("ra");
+    return 0;
+}
+
+RegSet regUses(const AsmInstr &ins) {
+    if (!ins.isInstr()) return 0;
+    if (isCompressed(ins)) return regUses(expandCompressed(ins));
+    const std::string &op = ins.op;
+    if (kRTypeOps.count(op) || kBranch2Ops.count(op)) {
+        size_t first = kBranch2Ops.count(op) ? 0 : 1;
+        return reg(ins.args[first]) | reg(ins.args[first + 1]);
+    }
+    if (kITypeOps.count(op) || kUnaryOps.count(op)) return reg(ins.args[1]);
+    if (kBranch1Ops.count(op) || op == "jr") return reg(ins.args[0]);
+    if (isLoad(ins)) return memBase(ins.args[1]);
+    if (isStore(ins)) return reg(ins.args[0]) | memBase(ins.args[1]);
+    if (op == "call") return kArgRegSet | reg("sp");
+    if (op == "ret") return kExitLiveSet;
+    if (op == "tail") return kExitLiveSet | kArgRegSet;
+    if (op == "ecall") return kArgRegSet;
+    return 0;
+}
+
+bool isPure(const AsmInstr &ins) {
+    if (!ins.isInstr()) return false;
+    if (isCompressed(ins)) return isPure(expandCompressed(ins));
+    const std::string &op = ins.op;
+    return kRTypeOps.count(op) || kITypeOps.count(op) || kUnaryOps.count(op) ||
+           op == "li" || op == "la" || op == "lui" || isLoad(ins);
+}
+
+std::vector<RegSet> computeLiveOut(const std::vector<AsmInstr> &code, const ClobberMap *clobbers) {
+    size_t n = code.size();
+    std::unordered_map<std::string, size_t> labels;
+    for (size_t i = 0; i < n; i++) {
+        if (code[i].isLabel()) labels[code[i].op] = i;
+    }
+
+    // 后继：顺序执行的下一条和跳转目标；SIZE_MAX 表示函数出口
+    const size_t kExit = SIZE_MAX;
+    std::vector<std::vector<size_t>> succs(n);
+    std::vector<RegSet> defs(n), uses(n);
+    for (size_t i = 0; i < n; i++) {
+        const AsmInstr &ins = code[i];
+        defs[i] = regDefs(ins, clobbers);
+        uses[i] = regUses(ins);
+        std::string target = branchTarget(ins);
+        if (!target.empty()) {
+            auto it = labels.find(target);
+            succs[i].push_back(it == labels.end() ? kExit : it->second);
+        }
+        if (!isUncondTransfer(ins)) succs[i].push_back(i + 1 < n ? i + 1 : kExit);
+        else if (target.empty()) succs[i].push_back(kExit);
+    }
+
+    std::vector<RegSet> liveIn(n, 0), liveOut(n, 0);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = n; i-- > 0;) {
+            RegSet out = 0;
+            for (size_t s : succs[i]) out |= s == kExit ? kExitLiveSet : liveIn[s];
+            RegSet in = uses[i] | (out & ~defs[i]);
+            if (out != liveOut[i] || in != liveIn[i]) {
+                liveOut[i] = out;
+                liveIn[i] = in;
+                changed = true;
+            }
+        }
+    }
+    return liveOut;
+}
+
+RegSet clobberSetOf(const std::vector<AsmInstr> &code, RegSet savedRegs, const ClobberMap &clobbers) {
+    RegSet set = reg("ra");
+    for (auto &ins : code) {
+        if (ins.isInstr() && ins.op == "tail") {
+            // tail 展开为 auipc t1 + jalr x0, t1
+            set |= reg("t1") | calleeClobbers(ins.args[0], &clobbers);
+        } else {
+            set |= regDefs(ins, &clobbers);
+        }
+    }
+    return set & ~savedRegs & ~reg("sp");
+}
+
+void printAsm(std::ostream &out, const std::vector<AsmInstr> &code) {
+    for (auto &ins : code) out << ins.text() << "\n";
+}
+
+// 按逗号切分操作数，引号内的逗号不切分
+static std::vector<std::string> splitArgs(const std::string &text) {
+    std::vector<std::string> args;
+    std::string cur;
+    bool quoted = false;
+    auto flush = [&]() {
+        size_t b = cur.find_first_not_of(" \t");
+        size_t e = cur.find_last_not_of(" \t");
+        if (b != std::string::npos) args.push_back(cur.substr(b, e - b + 1));
+        cur.clear();
+    };
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (quoted && c == '\\' && i + 1 < text.size()) {
+            cur += c;
+            cur += text[++i];
+            continue;
+        }
+        if (c == '"') quoted = !quoted;
+        if (c == ',' && !quoted) {
+            flush();
+        } else {
+            cur += c;
+        }
+    }
+    flush();
+    return args;
+}
+
+std::vector<AsmInstr> parseAsm(std::istream &in) {
+    std::vector<AsmInstr> code;
+    std::string line;
+    while (std::getline(in, line)) {
+        // 去掉注释（引号外的 #）
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (quoted && line[i] == '\\') {
+                i++;
+            } else if (line[i] == '"') {
+                quoted = !quoted;
+            } else if (line[i] == '#' && !quoted) {
+                line.resize(i);
+                break;
+            }
+        }
+        size_t pos = line.find_first_not_of(" \t\r");
+        while (pos != std::string::npos) {
+            size_t end = line.find_first_of(" \t\r", pos);
+            std::string word = line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+            size_t colon = word.find(':');
+            if (colon != std::string::npos && word.find('"') == std::string::npos) {
+                // 标签，同一行后面可能还有指令
+                code.push_back(AsmInstr::label(word.substr(0, colon)));
+                pos = line.find_first_not_of(" \t\r", pos + colon + 1);
+                continue;
+            }
+            std::string rest = end == std::string::npos ? "" : line.substr(end);
+            std::vector<std::string> args = splitArgs(rest);
+            code.push_back(word[0] == '.' ? AsmInstr::directive(word, std::move(args))
+                                          : AsmInstr::instr(word, std::move(args)));
+            break;
+        }
+    }
+    return code;
+}
+
+std::string unquoteString(const std::string &text) {
+    if (text.size() < 2 || text.front() != '"' || text.back() != '"') {
+        throw std::runtime_error("Expected a string literal: " + text);
+    }
+    std::string s;
+    for (size_t i = 1; i + 1 < text.size(); i++) {
+        char c = text[i];
+        if (c == '\\' && i + 2 < text.size()) {
+            c = text[++i];
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c == '0') c = '\0';
+        }
+        s += c;
+    }
+    return s;
+}
+
+int32_t parseImmediate(const std::string &text) {
+    try {
+        size_t used = 0;
+        long long value = std::stoll(text, &used, 0);
+        if (used == text.size() && value >= INT32_MIN && value <= UINT32_MAX) return (int32_t)value;
+    } catch (const std::exception &) {
+    }
+    throw std::runtime_error("Invalid immediate: " + text);
+}
+
+// 数值取自各核心公开文档的近似值
+const std::vector<LatencyModel> &latencyModels() {
+    static const std::vector<LatencyModel> models = {
+        {"generic", 1, 2, 3, 20, 2},
+        {"rocket", 1, 3, 4, 33, 3},
+        {"sifive-e31", 1, 2, 2, 33, 2},
+        {"sifive-e76", 1, 3, 3, 20, 1},
+    };
+    return models;
+}
+
+const LatencyModel *findLatencyModel(const std::string &name) {
+    for (auto &model : latencyModels()) {
+        if (name == model.name) return &model;
+    }
+    return nullptr;
+}
+
+int latencyOf(const AsmInstr &ins, const LatencyModel &model) {
+    if (isLoad(ins)) return model.load;
+    const std::string &op = ins.op;
+    if (op == "mul" || op == "mulh" || op == "mulhu" || op == "mulhsu") return model.mul;
+    if (op == "div" || op == "divu" || op == "rem" || op == "remu") return model.div;
+    return model.alu;
+}
@@ -0,0 +1,255 @@
+#include "rvc.h"
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+
+static bool fitsImm6(int32_t v) { return v >= -32 && v <= 31; }
+static bool fitsImm12(int32_t v) { return v >= -2048 && v <= 2047; }
+
+// 非 zero 的寄存器
+static bool nonZero(const std::string &reg) { return regIndex(reg) > 0; }
+
+// 压缩形式 3 位寄存器字段可寻址的 x8-x15
+static bool isRvcReg(const std::string &reg) {
+    int index = regIndex(reg);
+    return index >= 8 && index <= 15;
+}
+
+static bool fitsWordOffset(int32_t offset, int32_t max) { return offset >= 0 && offset <= max && offset % 4 == 0; }
+
+uint32_t encodedSize(const AsmInstr &ins) {
+    if (!ins.isInstr()) return 0;
+    if (isCompressed(ins)) return 2;
+    if (ins.op == "call" || ins.op == "tail" || ins.op == "la") return 8;
+    if (ins.op == "li" && ins.args.size() == 2) {
+        int32_t value = parseImmediate(ins.args[1]);
+        return fitsImm12(value) || (value & 0xfff) == 0 ? 4 : 8;
+    }
+    return 4;
+}
+
+uint32_t codeBytes(const std::vector<AsmInstr> &code) {
+    uint32_t bytes = 0;
+    for (const auto &ins : code) bytes += encodedSize(ins);
+    return bytes;
+}
+
+bool compressInstr(const AsmInstr &ins, AsmInstr &out) {
+    if (!ins.isInstr() || isCompressed(ins)) return false;
+    const std::string &op = ins.op;
+    const auto &a = ins.args;
+    auto make = [&](const std::string &cop, std::vector<std::string> args) {
+        out = AsmInstr::instr(cop, std::move(args));
+        return true;
+    };
+    // 与 zero 相加或加 0 的各种写法都是寄存器复制
+    auto copy = [&](const std::string &rd, const std::string &rs) {
+        return nonZero(rs) ? make("c.mv", {rd, rs}) : make("c.li", {rd, "0"});
+    };
+
+    if (op == "mv" && a.size() == 2) {
+        if (!nonZero(a[0])) return false;
+        return copy(a[0], a[1]);
+    }
+    if (op == "li" && a.size() == 2) {
+        int32_t value = parseImmediate(a[1]);
+        if (!nonZero(a[0]) || !fitsImm6(value)) return false;
+        return make("c.li", {a[0], std::to_string(value)});
+    }
+    if (op == "lui" && a.size() == 2) {
+        int32_t value = parseImmediate(a[1]);
+        int index = regIndex(a[0]);
+        // 非零的 6 位有符号数，按 20 位立即数的写法
+        bool fits = (value >= 1 && value <= 31) || (value >= 0xfffe0 && value <= 0xfffff);
+        if (index <= 0 || index == 2 || !fits) return false;
+        return make("c.lui", {a[0], a[1]});
+    }
+    if (op == "addi" && a.size() == 3) {
+        const std::string &rd = a[0], &rs = a[1];
+        int32_t value = parseImmediate(a[2]);
+        if (!nonZero(rd)) return false;
+        if (value == 0) return copy(rd, rs);
+        if (rs == "zero") return fitsImm6(value) && make("c.li", {rd, std::to_string(value)});
+        if (rd == rs && fitsImm6(value)) return make("c.addi", {rd, std::to_string(value)});
+        if (rd == "sp" && rs == "sp" && value % 16 == 0 && value >= -512 && value <= 496)
+            return make("c.addi16sp", {"sp", std::to_string(value)});
+        if (rs == "sp" && isRvcReg(rd) && value > 0 && fitsWordOffset(value, 1020))
+            return make("c.addi4spn", {rd, "sp", std::to_string(value)});
+        return false;
+    }
+    if (op == "add" && a.size() == 3) {
+        const std::string &rd = a[0], &rs1 = a[1], &rs2 = a[2];
+        if (!nonZero(rd)) return false;
+        if (rs1 == "zero" && nonZero(rs2)) return make("c.mv", {rd, rs2});
+        if (rs2 == "zero" && nonZero(rs1)) return make("c.mv", {rd, rs1});
+        if (rd == rs1 && nonZero(rs2)) return make("c.add", {rd, rs2});
+        if (rd == rs2 && nonZero(rs1)) return make("c.add", {rd, rs1});
+        return false;
+    }
+    if ((op == "sub" || op == "xor" || op == "or" || op == "and") && a.size() == 3) {
+        const std::string &rd = a[0], &rs1 = a[1], &rs2 = a[2];
+        if (!isRvcReg(rd) || !isRvcReg(rs1) || !isRvcReg(rs2)) return false;
+        if (rd == rs1) return make("c." + op, {rd, rs2});
+        if (rd == rs2 && op != "sub") return make("c." + op, {rd, rs1});
+        return false;
+    }
+    if ((op == "slli" || op == "srli" || op == "srai" || op == "andi") && a.size() == 3) {
+        const std::string &rd = a[0];
+        int32_t value = parseImmediate(a[2]);
+        if (rd != a[1]) return false;
+        bool ok = op == "andi"   ? isRvcReg(rd) && fitsImm6(value)
+                  : op == "slli" ? nonZero(rd) && value >= 1 && value <= 31
+                                 : isRvcReg(rd) && value >= 1 && value <= 31;
+        return ok && make("c." + op, {rd, std::to_string(value)});
+    }
+    if ((op == "lw" || op == "sw") && a.size() == 2) {
+        int offset = 0;
+        std::string base;
+        if (!parseMemOperand(a[1], offset, base)) return false;
+        // c.lwsp 不能写 zero，c.swsp 可以存 zero
+        if (base == "sp" && fitsWordOffset(offset, 252) && (op == "sw" || nonZero(a[0])))
+            return make(op == "lw" ? "c.lwsp" : "c.swsp", a);
+        if (isRvcReg(base) && isRvcReg(a[0]) && fitsWordOffset(offset, 124))
+            return make("c." + op, a);
+        return false;
+    }
+    if (op == "ret" && a.empty()) return make("c.jr", {"ra"});
+    if ((op == "jr" || op == "jalr") && a.size() == 1 && nonZero(a[0])) return make("c." + op, a);
+    if (op == "nop" && a.empty()) return make("c.nop", {});
+    return false;
+}
+
+bool compressBranch(const AsmInstr &ins, AsmInstr &out) {
+    if (!ins.isInstr()) return false;
+    const auto &a = ins.args;
+    if ((ins.op == "beqz" || ins.op == "bnez") && a.size() == 2 && isRvcReg(a[0])) {
+        out = AsmInstr::instr("c." + ins.op, a);
+        return true;
+    }
+    if ((ins.op == "beq" || ins.op == "bne") && a.size() == 3 && isRvcReg(a[0]) && a[1] == "zero") {
+        out = AsmInstr::instr(ins.op == "beq" ? "c.beqz" : "c.bnez", {a[0], a[2]});
+        return true;
+    }
+    if (ins.op == "j" && a.size() == 1) {
+        out = AsmInstr::instr("c.j", a);
+        return true;
+    }
+    return false;
+}
+
+int32_t compressedRange(const AsmInstr &ins) {
+    return ins.op == "c.j" ? 2048 : 256;
+}
+
+static void renameReg(std::vector<AsmInstr> &code, const std::string &from, const std::string &to) {
+    for (auto &ins : code) {
+        if (!ins.isInstr()) continue;
+        for (auto &arg : ins.args) {
+            int offset = 0;
+            std::string base;
+            if (arg == from) arg = to;
+            else if (parseMemOperand(arg, offset, base) && base == from) arg = std::to_string(offset) + "(" + to + ")";
+        }
+    }
+}
+
+int Compressor::renameTemps(std::vector<AsmInstr> &code, const ClobberMap *clobbers) {
+    static const char *const kTemps[] = {"t0", "t1", "t2", "t3", "t4", "t5", "t6"};
+    static const char *const kTargets[] = {"a0", "a1", "a2", "a3", "a4", "a5"};
+
+    std::unordered_map<std::string, int> occurrences;
+    for (const auto &ins : code) {
+        if (!ins.isInstr()) continue;
+        for (const auto &arg : ins.args) {
+            int offset = 0;
+            std::string base;
+            occurrences[parseMemOperand(arg, offset, base) ? base : arg]++;
+        }
+    }
+    std::vector<std::string> temps;
+    for (const char *t : kTemps) {
+        if (occurrences.count(t)) temps.push_back(t);
+    }
+    // 出现次数多的临时寄存器优先
+    std::stable_sort(temps.begin(), temps.end(), [&](const std::string &x, const std::string &y) {
+        return occurrences[x] > occurrences[y];
+    });
+
+    int count = 0;
+    for (const auto &t : temps) {
+        // 冲突：t 被定义时存活的寄存器，以及 t 存活时被定义（含调用隐式改写）的寄存器
+        RegSet bit = regBit(regIndex(t));
+        std::vector<RegSet> liveOut = computeLiveOut(code, clobbers);
+        RegSet interfere = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (!code[i].isInstr()) continue;
+            RegSet defs = regDefs(code[i], clobbers);
+            if (defs & bit) interfere |= liveOut[i];
+            if (liveOut[i] & bit) interfere |= defs;
+        }
+        for (const char *target : kTargets) {
+            if (interfere & regBit(regIndex(target))) continue;
+            renameReg(code, t, target);
+            count++;
+            break;
+        }
+    }
+    // 改名到复制的另一端时复制成为自身赋值
+    code.erase(std::remove_if(code.begin(), code.end(), [](const AsmInstr &ins) {
+        return ins.isInstr() && ins.op == "mv" && ins.args.size() == 2 && ins.args[0] == ins.args[1];
+    }), code.end());
+    return count;
+}
+
+int Compressor::run(std::vector<AsmInstr> &code, const ClobberMap *clobbers) {
+    before += codeBytes(code);
+    renamed += renameTemps(code, clobbers);
+
+    int count = 0;
+    for (auto &ins : code) {
+        AsmInstr small;
+        if (compressInstr(ins, small)) {
+            ins = small;
+            count++;
+        }
+    }
+
+    // 分支按当前布局估计偏移。压缩只会缩短距离，已压缩的分支不会因后续压缩而越界，
+    // 同一轮中使用过时的偏移也是保守的
+    for (bool changed = true; changed;) {
+        changed = false;
+        std::unordered_map<std::string, int32_t> labels;
+        std::vector<int32_t> offsets(code.size());
+        int32_t pc = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (code[i].isLabel()) labels[code[i].op] = pc;
+            offsets[i] = pc;
+            pc += encodedSize(code[i]);
+        }
+        for (size_t i = 0; i < code.size(); i++) {
+            AsmInstr small;
+            if (!compressBranch(code[i], small)) continue;
+            auto it = labels.find(branchTarget(code[i]));
+            if (it == labels.end()) continue;
+            int32_t delta = it->second - offsets[i];
+            int32_t range = compressedRange(small);
+            if (delta < -range || delta >= range) continue;
+            code[i] = small;
+            count++;
+            changed = true;
+        }
+    }
+
+    compressed += count;
+    after += codeBytes(code);
+    return count;
+}
+
+void Compressor::printStats(std::ostream &os) const {
+    os << "rvc statistics:\n";
+    os << "  " << std::left << std::setw(20) << "compressed" << compressed << "\n";
+    os << "  " << std::left << std::setw(20) << "renamed" << renamed << "\n";
+    os << "  " << std::left << std::setw(20) << "bytes" << before << " -> " << after;
+    if (before > 0) os << " (" << std::fixed << std::setprecision(1) << 100.0 * (before - after) / before << "% smaller)";
+    os << "\n";
+}
@@ -0,0 +1,119 @@
+#include "scheduler.h"
+#include <algorithm>
+
+Scheduler::Scheduler(const LatencyModel &m) : model(m) {}
+
+// 基本块的最后一条：跳转、调用或返回，调度时固定在块尾
+static bool endsBlock(const AsmInstr &ins) {
+    return isCondBranch(ins) || isUncondTransfer(ins) || (ins.isInstr() && ins.op == "call");
+}
+
+// 两条访存指令是否可能访问同一地址；只有同基址不同偏移能证明不相交
+static bool mayAlias(const AsmInstr &a, const AsmInstr &b) {
+    int offA, offB;
+    std::string baseA, baseB;
+    if (!parseMemOperand(a.args[1], offA, baseA) || !parseMemOperand(b.args[1], offB, baseB)) return true;
+    return baseA != baseB || offA == offB;
+}
+
+// 依赖边：{前驱下标, 前驱发射后到本指令可发射的最少周期}
+using DepGraph = std::vector<std::vector<std::pair<int, int>>>;
+
+static DepGraph buildDeps(const std::vector<AsmInstr> &code, size_t begin, size_t end, const LatencyModel &model) {
+    int n = (int)(end - begin);
+    DepGraph preds(n);
+    for (int j = 0; j < n; j++) {
+        const AsmInstr &b = code[begin + j];
+        RegSet useB = regUses(b), defB = regDefs(b);
+        bool memB = isLoad(b) || isStore(b);
+        bool last = j == n - 1 && endsBlock(b);
+        for (int i = 0; i < j; i++) {
+            const AsmInstr &a = code[begin + i];
+            RegSet useA = regUses(a), defA = regDefs(a);
+            int lat = -1;
+            if (defA & useB) lat = latencyOf(a, model);          // 写后读
+            else if (defA & defB) lat = 1;                       // 写后写
+            else if ((useA & defB) || last) lat = 0;             // 读后写，块尾
+            else if (memB && (isLoad(a) || isStore(a)) && (isStore(a) || isStore(b)) && mayAlias(a, b)) lat = 1;
+            if (lat >= 0) preds[j].push_back({i, lat});
+        }
+    }
+    return preds;
+}
+
+int Scheduler::estimateCycles(const std::vector<AsmInstr> &code, size_t begin, size_t end) const {
+    DepGraph preds = buildDeps(code, begin, end, model);
+    std::vector<int> issue(preds.size());
+    int cycle = 0;
+    for (size_t j = 0; j < preds.size(); j++) {
+        for (auto [p, lat] : preds[j]) cycle = std::max(cycle, issue[p] + lat);
+        issue[j] = cycle++;
+    }
+    return cycle;
+}
+
+int Scheduler::scheduleBlock(std::vector<AsmInstr> &code, size_t begin, size_t end) {
+    int n = (int)(end - begin);
+    DepGraph preds = buildDeps(code, begin, end, model);
+
+    // 优先级：到块尾的最长延迟路径
+    std::vector<int> height(n, 0);
+    for (int j = n - 1; j >= 0; j--) {
+        for (auto [p, lat] : preds[j]) height[p] = std::max(height[p], height[j] + lat);
+    }
+
+    std::vector<int> issue(n, -1), order;
+    int cycle = 0;
+    for (int k = 0; k < n; k++) {
+        int best = -1, bestReady = 0;
+        for (int j = 0; j < n; j++) {
+            if (issue[j] >= 0) continue;
+            int ready = 0;
+            bool avail = true;
+            for (auto [p, lat] : preds[j]) {
+                if (issue[p] < 0) { avail = false; break; }
+                ready = std::max(ready, issue[p] + lat);
+            }
+            if (!avail) continue;
+            // 先选已就绪的，再选就绪最早的；同等条件下取优先级高、原顺序靠前的
+            int r = std::max(ready, cycle);
+            if (best < 0 || r < bestReady || (r == bestReady && height[j] > height[best])) {
+                best = j;
+                bestReady = r;
+            }
+        }
+        issue[best] = bestReady;
+        cycle = bestReady + 1;
+        order.push_back(best);
+    }
+
+    std::vector<AsmInstr> block(code.begin() + begin, code.begin() + end);
+    int before = estimateCycles(code, begin, end);
+    for (int k = 0; k < n; k++) code[begin + k] = block[order[k]];
+    int after = estimateCycles(code, begin, end);
+    if (after >= before) {
+        std::copy(block.begin(), block.end(), code.begin() + begin);
+        return 0;
+    }
+    return before - after;
+}
+
+int Scheduler::run(std::vector<AsmInstr> &code) {
+    int total = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i <= code.size(); i++) {
+        bool boundary = i == code.size() || !code[i].isInstr();
+        if (!boundary && !endsBlock(code[i])) continue;
+        size_t end = boundary ? i : i + 1;
+        if (end - begin >= 3) {
+            int gain = scheduleBlock(code, begin, end);
+            if (gain > 0) {
+                reordered++;
+                total += gain;
+            }
+        }
+        begin = i + 1;
+    }
+    saved += total;
+    return total;
+}
@@ -16,46 +16,61 @@ void SemanticAnalyzer::exitScope() {
 bool SemanticAnalyzer::declare(const std::string& name, const Symbol& symbol) {
     if (scopes.empty()) enterScope();
     auto& current = scopes.back();
-    if (current.find(name) != current.end()) {
-        reportError("Variable '" + name + "' redeclared in current scope");
-        return false;
-    }
+    if (current.find(name) != current.end()) return false;
     current[name] = symbol;
     return true;
 }
 
-Symbol SemanticAnalyzer::lookup(const std::string& name) {
+const Symbol* SemanticAnalyzer::lookup(const std::string& name) const {
     for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
         auto found = it->find(name);
         if (found != it->end()) {
-            return found->second;
+            return &found->second;
         }
     }
-    reportError("Undeclared identifier '" + name + "'");
-    return Symbol{Type::Unknown, false, {}};
+    return nullptr;
 }
 
 void SemanticAnalyzer::analyze(const std::vector<std::unique_ptr<FuncDef>>& funcs) {
-    enterScope();
     for (const auto& func : funcs) {
-        analyzeFunc(func.get());
+        analyzeFunction(func.get());
     }
-    exitScope();
+    finish();
 }
 
-void SemanticAnalyzer::analyzeFunc(FuncDef* func) {
+void SemanticAnalyzer::analyzeFunction(const FuncDef* func) {
+    // 先登记签名，函数体内的递归调用可以立即检查
+    Symbol signature{func->retType == "void" ? Type::Void : Type::Int, true, {}};
+    signature.paramTypes.assign(func->params.size(), Type::Int);
+    if (!functions.emplace(func->name, signature).second) {
+        reportError("Function '" + func->name + "' redefined", func->span);
+    }
+
+    currentFunc = func->name;
+    loopDepth = 0;
     enterScope();
     for (auto& param : func->params) {
-        Symbol sym{Type::Int, false, {}};
-        if (!declare(param.name, sym)) {
-            reportError("Duplicate parameter name: " + param.name);
+        if (!declare(param.name, Symbol{Type::Int, false, {}})) {
+            reportError("Duplicate parameter name: " + param.name, func->span);
         }
     }
     analyzeBlock(func->body.get());
     exitScope();
 }
 
-void SemanticAnalyzer::analyzeBlock(Block* block) {
+void SemanticAnalyzer::finish() {
+    for (auto& call : pending) {
+        auto found = functions.find(call.callee);
+        if (found == functions.end()) {
+            reportError("Call to undefined function '" + call.callee + "' in '" + call.caller + "'", call.span);
+        } else {
+            checkCall(found->second, call.callee, call.args, call.asValue, call.span);
+        }
+    }
+    pending.clear();
+}
+
+void SemanticAnalyzer::analyzeBlock(const Block* block) {
     enterScope();
     for (auto& stmt : block->stmts) {
         analyzeStmt(stmt.get());
@@ -63,66 +78,106 @@ void SemanticAnalyzer::analyzeBlock(Block* block) {
     exitScope();
 }
 
-void SemanticAnalyzer::analyzeStmt(Stmt* stmt) {
-    if (auto decl = dynamic_cast<VarDeclStmt*>(stmt)) {
-        Symbol sym{Type::Int, false, {}};
-        if (!declare(decl->name, sym)) {
-            reportError("Variable '" + decl->name + "' redeclared");
+void SemanticAnalyzer::analyzeStmt(const Stmt* stmt) {
+    if (auto block = dynamic_cast<const Block*>(stmt)) {
+        analyzeBlock(block);
+    }
+    else if (auto decl = dynamic_cast<const VarDeclStmt*>(stmt)) {
+        if (!declare(decl->name, Symbol{Type::Int, false, {}})) {
+            reportError("Variable '" + decl->name + "' redeclared in current scope", decl->span);
         }
         if (decl->initializer) analyzeExpr(decl->initializer.get());
     }
-    else if (auto assign = dynamic_cast<AssignStmt*>(stmt)) {
-        Symbol sym = lookup(assign->name);
-        if (sym.type == Type::Unknown) {
-            reportError("Variable '" + assign->name + "' used before declaration");
+    else if (auto assign = dynamic_cast<const AssignStmt*>(stmt)) {
+        if (!lookup(assign->name)) {
+            reportError("Variable '" + assign->name + "' used before declaration", assign->span);
         }
         analyzeExpr(assign->value.get());
     }
-    else if (auto ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+    else if (auto ret = dynamic_cast<const ReturnStmt*>(stmt)) {
+        if (ret->expr) analyzeExpr(ret->expr.get());
+    }
+    else if (auto exprStmt = dynamic_cast<const ExprStmt*>(stmt)) {
+        // 语句级调用的返回值被丢弃，允许调用 void 函数
+        if (auto call = dynamic_cast<const CallExpr*>(exprStmt->expr.get())) {
+            analyzeCall(call, false);
+        } else {
+            analyzeExpr(exprStmt->expr.get());
+        }
+    }
+    else if (auto ifStmt = dynamic_cast<const IfStmt*>(stmt)) {
         analyzeExpr(ifStmt->condition.get());
         analyzeStmt(ifStmt->thenBlock.get());
         if (ifStmt->elseBlock) analyzeStmt(ifStmt->elseBlock.get());
     }
-    else if (auto whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
+    else if (auto whileStmt = dynamic_cast<const WhileStmt*>(stmt)) {
         analyzeExpr(whileStmt->condition.get());
+        loopDepth++;
         analyzeStmt(whileStmt->body.get());
+        loopDepth--;
     }
-    else if (dynamic_cast<BreakStmt*>(stmt) || dynamic_cast<ContinueStmt*>(stmt)) {
-        // 可做循环上下文检测
+    else if (dynamic_cast<const BreakStmt*>(stmt) || dynamic_cast<const ContinueStmt*>(stmt)) {
+        if (loopDepth == 0) {
+            reportError(std::string(dynamic_cast<const BreakStmt*>(stmt) ? "'break'" : "'continue'") +
+                        " outside of a loop", stmt->span);
+        }
     }
     else {
-        reportError("Unknown statement type");
+        reportError("Unknown statement type", stmt->span);
     }
 }
 
-void SemanticAnalyzer::analyzeExpr(Expr* expr) {
-    if (auto var = dynamic_cast<VarExpr*>(expr)) {
-        Symbol sym = lookup(var->name);
-        if (sym.type == Type::Unknown) {
-            reportError("Variable '" + var->name + "' used before declaration");
+void SemanticAnalyzer::analyzeExpr(const Expr* expr) {
+    if (auto var = dynamic_cast<const VarExpr*>(expr)) {
+        if (!lookup(var->name)) {
+            reportError("Variable '" + var->name + "' used before declaration", var->span);
         }
     }
-    else if (auto num = dynamic_cast<NumberExpr*>(expr)) {
+    else if (dynamic_cast<const NumberExpr*>(expr)) {
         // 数字不需要检查
     }
-    else if (auto bin = dynamic_cast<BinaryExpr*>(expr)) {
+    else if (auto bin = dynamic_cast<const BinaryExpr*>(expr)) {
         analyzeExpr(bin->lhs.get());
         analyzeExpr(bin->rhs.get());
     }
-    else if (auto unary = dynamic_cast<UnaryExpr*>(expr)) {
+    else if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
         analyzeExpr(unary->operand.get());
     }
-    else if (auto call = dynamic_cast<CallExpr*>(expr)) {
-        for (auto& arg : call->args) {
-            analyzeExpr(arg.get());
-        }
-        // TODO: 函数调用检查
+    else if (auto call = dynamic_cast<const CallExpr*>(expr)) {
+        analyzeCall(call, true);
     }
     else {
-        reportError("Unknown expression type");
+        reportError("Unknown expression type", expr->span);
+    }
+}
+
+void SemanticAnalyzer::analyzeCall(const CallExpr* call, bool asValue) {
+    for (auto& arg : call->args) {
+        analyzeExpr(arg.get());
+    }
+    auto found = functions.find(call->callee);
+    if (found != functions.end()) {
+        checkCall(found->second, call->callee, call->args.size(), asValue, call->span);
+    } else {
+        // 前向调用：签名要等被调用者出现后才知道
+        pending.push_back({currentFunc, call->callee, call->args.size(), asValue, call->span});
+    }
+}
+
+void SemanticAnalyzer::checkCall(const Symbol& callee, const std::string& name, size_t args, bool asValue,
+                                 const SourceSpan& span) {
+    if (args != callee.paramTypes.size()) {
+        reportError("Function '" + name + "' expects " + std::to_string(callee.paramTypes.size()) +
+                    " argument(s), got " + std::to_string(args), span);
+    }
+    if (asValue && callee.type == Type::Void) {
+        reportError("Void function '" + name + "' used as a value", span);
     }
 }
 
-void SemanticAnalyzer::reportError(const std::string& msg) {
-    std::cerr << "Semantic error: " << msg << std::endl;
+void SemanticAnalyzer::reportError(const std::string& msg, const SourceSpan& span) {
+    errors++;
+    std::cerr << "Semantic error: ";
+    if (span.line > 0) std::cerr << span.line << ":" << span.column << ": ";
+    std::cerr << msg << std::endl;
 }
@@ -0,0 +1,405 @@
+#include "simulator.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+// 伪指令在汇编时归约为这些基本操作
+enum class Simulator::Op : uint8_t {
+    Add, Sub, Sll, Slt, Sltu, Xor, Srl, Sra, Or, And,
+    Mul, Mulh, Mulhsu, Mulhu, Div, Divu, Rem, Remu,
+    Addi, Slti, Sltiu, Xori, Ori, Andi, Slli, Srli, Srai,
+    Li,
+    Lb, Lh, Lw, Lbu, Lhu, Sb, Sh, Sw,
+    Beq, Bne, Blt, Bge, Bltu, Bgeu,
+    Jal, Jalr,
+    Ecall,
+};
+
+using Op = Simulator::Op;
+
+static const std::unordered_map<std::string, Op> kRTypeTable = {
+    {"add", Op::Add}, {"sub", Op::Sub}, {"sll", Op::Sll}, {"slt", Op::Slt}, {"sltu", Op::Sltu},
+    {"xor", Op::Xor}, {"srl", Op::Srl}, {"sra", Op::Sra}, {"or", Op::Or}, {"and", Op::And},
+    {"mul", Op::Mul}, {"mulh", Op::Mulh}, {"mulhsu", Op::Mulhsu}, {"mulhu", Op::Mulhu},
+    {"div", Op::Div}, {"divu", Op::Divu}, {"rem", Op::Rem}, {"remu", Op::Remu}};
+static const std::unordered_map<std::string, Op> kITypeTable = {
+    {"addi", Op::Addi}, {"slti", Op::Slti}, {"sltiu", Op::Sltiu}, {"xori", Op::Xori},
+    {"ori", Op::Ori}, {"andi", Op::Andi}, {"slli", Op::Slli}, {"srli", Op::Srli}, {"srai", Op::Srai}};
+static const std::unordered_map<std::string, Op> kMemTable = {
+    {"lb", Op::Lb}, {"lh", Op::Lh}, {"lw", Op::Lw}, {"lbu", Op::Lbu}, {"lhu", Op::Lhu},
+    {"sb", Op::Sb}, {"sh", Op::Sh}, {"sw", Op::Sw}};
+static const std::unordered_map<std::string, Op> kBranchTable = {
+    {"beq", Op::Beq}, {"bne", Op::Bne}, {"blt", Op::Blt}, {"bge", Op::Bge},
+    {"bltu", Op::Bltu}, {"bgeu", Op::Bgeu}};
+
+static bool isStoreOp(Op op) { return op == Op::Sb || op == Op::Sh || op == Op::Sw; }
+
+static uint8_t parseReg(const std::string &text) {
+    int index = regIndex(text);
+    if (index < 0) throw std::runtime_error("Invalid register: " + text);
+    return (uint8_t)index;
+}
+
+Simulator::Simulator(const std::vector<AsmInstr> &program, const SimOptions &opts)
+    : options(opts), stack(opts.stackSize) {
+    assemble(program);
+}
+
+void Simulator::assemble(const std::vector<AsmInstr> &program) {
+    // 第一遍：确定标签地址与数据段内容
+    bool inData = false;
+    uint32_t textCount = 0;
+    for (auto &ins : program) {
+        if (ins.isLabel()) {
+            symbols[ins.op] = inData ? kDataBase + (uint32_t)data.size() : kTextBase + textCount * 4;
+        } else if (ins.isInstr()) {
+            if (inData) throw std::runtime_error("Instruction in data section: " + ins.text());
+            textCount++;
+        } else if (ins.op == ".data" || (ins.op == ".section" && !ins.args.empty() && ins.args[0] != ".text")) {
+            inData = true;
+        } else if (ins.op == ".text") {
+            inData = false;
+        } else if (ins.op == ".word" || ins.op == ".byte" || ins.op == ".half") {
+            size_t size = ins.op == ".word" ? 4 : ins.op == ".half" ? 2 : 1;
+            for (auto &arg : ins.args) {
+                uint32_t value = (uint32_t)parseImmediate(arg);
+                for (size_t b = 0; b < size; b++) data.push_back((uint8_t)(value >> (8 * b)));
+            }
+        } else if (ins.op == ".zero") {
+            data.resize(data.size() + parseImmediate(ins.args.at(0)));
+        } else if (ins.op == ".asciz" || ins.op == ".string") {
+            std::string s = unquoteString(ins.args.at(0));
+            data.insert(data.end(), s.begin(), s.end());
+            data.push_back(0);
+        } else if (ins.op == ".p2align" || ins.op == ".align") {
+            uint32_t align = 1u << parseImmediate(ins.args.at(0));
+            while (inData && data.size() % align) data.push_back(0);
+        }
+    }
+
+    // 第二遍：把指令与伪指令归约为基本操作
+    auto symbol = [&](const std::string &name) {
+        size_t plus = name.find('+');
+        std::string base = name.substr(0, plus);
+        auto it = symbols.find(base);
+        if (it == symbols.end()) throw std::runtime_error("Undefined symbol: " + base);
+        return it->second + (plus == std::string::npos ? 0 : parseImmediate(name.substr(plus + 1)));
+    };
+    for (auto &raw : program) {
+        if (!raw.isInstr()) continue;
+        // 压缩指令按展开后的 32 位形式执行
+        const AsmInstr ins = expandCompressed(raw);
+        const std::string &op = ins.op;
+        const auto &a = ins.args;
+        auto need = [&](size_t n) {
+            if (a.size() != n) throw std::runtime_error("Wrong operand count: " + ins.text());
+        };
+        Instr out;
+        out.latency = (uint8_t)latencyOf(ins, options.model);
+        if (kRTypeTable.count(op)) {
+            need(3);
+            out = {kRTypeTable.at(op), parseReg(a[0]), parseReg(a[1]), parseReg(a[2]), 0, out.latency};
+        } else if (kITypeTable.count(op)) {
+            need(3);
+            out = {kITypeTable.at(op), parseReg(a[0]), parseReg(a[1]), 0, parseImmediate(a[2]), out.latency};
+        } else if (kMemTable.count(op)) {
+            need(2);
+            int offset;
+            std::string base;
+            if (!parseMemOperand(a[1], offset, base)) throw std::runtime_error("Invalid memory operand: " + ins.text());
+            Op mop = kMemTable.at(op);
+            if (isStoreOp(mop)) out = {mop, 0, parseReg(base), parseReg(a[0]), offset, out.latency};
+            else out = {mop, parseReg(a[0]), parseReg(base), 0, offset, out.latency};
+        } else if (kBranchTable.count(op)) {
+            need(3);
+            out = {kBranchTable.at(op), 0, parseReg(a[0]), parseReg(a[1]), (int32_t)symbol(a[2]), out.latency};
+        } else if (op == "bgt" || op == "ble" || op == "bgtu" || op == "bleu") {
+            // 交换操作数
+            need(3);
+            Op bop = op == "bgt" ? Op::Blt : op == "ble" ? Op::Bge : op == "bgtu" ? Op::Bltu : Op::Bgeu;
+            out = {bop, 0, parseReg(a[1]), parseReg(a[0]), (int32_t)symbol(a[2]), out.latency};
+        } else if (op == "beqz" || op == "bnez" || op == "bltz" || op == "bgez") {
+            need(2);
+            Op bop = op == "beqz" ? Op::Beq : op == "bnez" ? Op::Bne : op == "bltz" ? Op::Blt : Op::Bge;
+            out = {bop, 0, parseReg(a[0]), 0, (int32_t)symbol(a[1]), out.latency};
+        } else if (op == "blez" || op == "bgtz") {
+            need(2);
+            out = {op == "blez" ? Op::Bge : Op::Blt, 0, 0, parseReg(a[0]), (int32_t)symbol(a[1]), out.latency};
+        } else if (op == "li" || op == "la" || op == "lui") {
+            need(2);
+            int32_t value = op == "li" ? parseImmediate(a[1]) : op == "la" ? (int32_t)symbol(a[1])
+                                                                     : (int32_t)((uint32_t)parseImmediate(a[1]) << 12);
+            out = {Op::Li, parseReg(a[0]), 0, 0, value, out.latency};
+        } else if (op == "mv") {
+            need(2);
+            out = {Op::Addi, parseReg(a[0]), parseReg(a[1]), 0, 0, out.latency};
+        } else if (op == "not") {
+            need(2);
+            out = {Op::Xori, parseReg(a[0]), parseReg(a[1]), 0, -1, out.latency};
+        } else if (op == "neg") {
+            need(2);
+            out = {Op::Sub, parseReg(a[0]), 0, parseReg(a[1]), 0, out.latency};
+        } else if (op == "seqz") {
+            need(2);
+            out = {Op::Sltiu, parseReg(a[0]), parseReg(a[1]), 0, 1, out.latency};
+        } else if (op == "snez") {
+            need(2);
+            out = {Op::Sltu, parseReg(a[0]), 0, parseReg(a[1]), 0, out.latency};
+        } else if (op == "sltz") {
+            need(2);
+            out = {Op::Slt, parseReg(a[0]), parseReg(a[1]), 0, 0, out.latency};
+        } else if (op == "sgtz") {
+            need(2);
+            out = {Op::Slt, parseReg(a[0]), 0, parseReg(a[1]), 0, out.latency};
+        } else if (op == "nop") {
+            out = {Op::Addi, 0, 0, 0, 0, out.latency};
+        } else if (op == "j" || op == "call" || op == "tail" || op == "jal") {
+            // call 经 ra 返回；tail 展开为 auipc t1 + jalr x0, t1，t1 写入地址值作为毒化，j 不写回
+            if (op == "jal" && a.size() == 2) {
+                out = {Op::Jal, parseReg(a[0]), 0, 0, (int32_t)symbol(a[1]), out.latency};
+            } else {
+                need(1);
+                uint8_t rd = op == "call" || op == "jal" ? 1 : op == "tail" ? 6 : 0;
+                out = {Op::Jal, rd, 0, 0, (int32_t)symbol(a[0]), out.latency};
+                out.callee = a[0];
+            }
+        } else if (op == "jr" || op == "ret") {
+            need(op == "jr" ? 1 : 0);
+            out = {Op::Jalr, 0, op == "ret" ? (uint8_t)1 : parseReg(a[0]), 0, 0, out.latency};
+        } else if (op == "jalr") {
+            int offset = 0;
+            std::string base;
+            if (a.size() == 1) out = {Op::Jalr, 1, parseReg(a[0]), 0, 0, out.latency};
+            else if (a.size() == 2 && parseMemOperand(a[1], offset, base))
+                out = {Op::Jalr, parseReg(a[0]), parseReg(base), 0, offset, out.latency};
+            else if (a.size() == 3) out = {Op::Jalr, parseReg(a[0]), parseReg(a[1]), 0, parseImmediate(a[2]), out.latency};
+            else throw std::runtime_error("Wrong operand count: " + ins.text());
+        } else if (op == "ecall") {
+            need(0);
+            out = {Op::Ecall, 10, 10, 17, 0, out.latency};
+        } else {
+            throw std::runtime_error("Unsupported instruction: " + ins.text());
+        }
+        text.push_back(out);
+    }
+}
+
+uint8_t *Simulator::addressOf(uint32_t addr, uint32_t size) {
+    if (addr >= kDataBase && addr - kDataBase + size <= data.size()) return &data[addr - kDataBase];
+    uint32_t stackBase = kStackTop - (uint32_t)stack.size();
+    if (addr >= stackBase && addr - stackBase + size <= stack.size()) return &stack[addr - stackBase];
+    std::ostringstream msg;
+    msg << "Invalid memory access at 0x" << std::hex << addr;
+    throw std::runtime_error(msg.str());
+}
+
+uint32_t Simulator::load(uint32_t addr, uint32_t size, bool isSigned) {
+    const uint8_t *p = addressOf(addr, size);
+    uint32_t value = 0;
+    for (uint32_t b = 0; b < size; b++) value |= (uint32_t)p[b] << (8 * b);
+    if (isSigned && size < 4 && (value >> (8 * size - 1)) & 1) value |= ~0u << (8 * size);
+    return value;
+}
+
+void Simulator::store(uint32_t addr, uint32_t size, uint32_t value) {
+    uint8_t *p = addressOf(addr, size);
+    for (uint32_t b = 0; b < size; b++) p[b] = (uint8_t)(value >> (8 * b));
+}
+
+// Linux RV32 系统调用号：a7 为编号，a0-a3 为参数，结果写回 a0
+void Simulator::syscall() {
+    uint32_t *a = &regs[10];
+    switch (regs[17]) {
+    case 56: { // openat
+        std::string path;
+        for (uint32_t p = a[1];; p++) {
+            char c = (char)load(p, 1, false);
+            if (!c) break;
+            path += c;
+        }
+        int fd = ::open(path.c_str(), (int)a[2], (mode_t)a[3]);
+        if (fd < 0) {
+            a[0] = (uint32_t)-1;
+        } else {
+            files[nextFd] = fd;
+            a[0] = (uint32_t)nextFd++;
+        }
+        break;
+    }
+    case 64: { // write
+        const char *buf = (const char *)addressOf(a[1], a[2]);
+        int32_t fd = (int32_t)a[0];
+        if (fd == 1 || fd == 2) {
+            std::ostream &os = options.out ? *options.out : fd == 1 ? std::cout : std::cerr;
+            os.write(buf, a[2]);
+        } else if (files.count(fd)) {
+            a[0] = (uint32_t)::write(files[fd], buf, a[2]);
+            break;
+        } else {
+            a[0] = (uint32_t)-1;
+            break;
+        }
+        a[0] = a[2];
+        break;
+    }
+    case 57: { // close
+        auto it = files.find((int32_t)a[0]);
+        if (it == files.end()) {
+            a[0] = (uint32_t)-1;
+        } else {
+            ::close(it->second);
+            files.erase(it);
+            a[0] = 0;
+        }
+        break;
+    }
+    case 93: // exit
+    case 94: // exit_group
+        exited = true;
+        exitCode = (int32_t)a[0];
+        break;
+    default:
+        throw std::runtime_error("Unsupported system call " + std::to_string(regs[17]));
+    }
+}
+
+int32_t Simulator::run(const std::vector<int32_t> &args) {
+    auto entry = symbols.find(options.entry);
+    if (entry == symbols.end()) throw std::runtime_error("Undefined entry point: " + options.entry);
+    std::memset(regs, 0, sizeof(regs));
+    std::memset(ready, 0, sizeof(ready));
+    counters = SimStats();
+    exited = false;
+    regs[1] = kExitAddress;
+    regs[2] = kStackTop;
+    for (size_t i = 0; i < args.size() && i < 8; i++) regs[10 + i] = (uint32_t)args[i];
+
+    const uint32_t penalty = (uint32_t)options.model.branch;
+    uint64_t cycle = 0;
+    uint32_t pc = entry->second;
+    while (pc != kExitAddress && !exited) {
+        uint32_t index = (pc - kTextBase) / 4;
+        if (pc < kTextBase || pc % 4 || index >= text.size()) {
+            std::ostringstream msg;
+            msg << "Jump to invalid address 0x" << std::hex << pc;
+            throw std::runtime_error(msg.str());
+        }
+        if (++counters.instructions > options.maxSteps) throw std::runtime_error("Step limit exceeded");
+        const Instr &ins = text[index];
+        uint32_t x = regs[ins.rs1], y = regs[ins.rs2];
+        int32_t sx = (int32_t)x, sy = (int32_t)y;
+        uint64_t issue = std::max({cycle, ready[ins.rs1], ready[ins.rs2]});
+        cycle = issue + 1;
+        uint32_t next = pc + 4;
+        uint32_t result = 0;
+        bool writes = true;
+        bool taken = false;
+
+        switch (ins.op) {
+        case Op::Add: result = x + y; break;
+        case Op::Sub: result = x - y; break;
+        case Op::Sll: result = x << (y & 31); break;
+        case Op::Slt: result = sx < sy; break;
+        case Op::Sltu: result = x < y; break;
+        case Op::Xor: result = x ^ y; break;
+        case Op::Srl: result = x >> (y & 31); break;
+        case Op::Sra: result = (uint32_t)(sx >> (y & 31)); break;
+        case Op::Or: result = x | y; break;
+        case Op::And: result = x & y; break;
+        case Op::Mul: result = x * y; break;
+        case Op::Mulh: result = (uint32_t)(((int64_t)sx * sy) >> 32); break;
+        case Op::Mulhsu: result = (uint32_t)(((int64_t)sx * (int64_t)(uint64_t)y) >> 32); break;
+        case Op::Mulhu: result = (uint32_t)(((uint64_t)x * y) >> 32); break;
+        case Op::Div:
+            result = sy == 0 ? ~0u : (sx == INT32_MIN && sy == -1) ? x : (uint32_t)(sx / sy);
+            break;
+        case Op::Divu: result = y == 0 ? ~0u : x / y; break;
+        case Op::Rem:
+            result = sy == 0 ? x : (sx == INT32_MIN && sy == -1) ? 0 : (uint32_t)(sx % sy);
+            break;
+        case Op::Remu: result = y == 0 ? x : x % y; break;
+        case Op::Addi: result = x + (uint32_t)ins.imm; break;
+        case Op::Slti: result = sx < ins.imm; break;
+        case Op::Sltiu: result = x < (uint32_t)ins.imm; break;
+        case Op::Xori: result = x ^ (uint32_t)ins.imm; break;
+        case Op::Ori: result = x | (uint32_t)ins.imm; break;
+        case Op::Andi: result = x & (uint32_t)ins.imm; break;
+        case Op::Slli: result = x << (ins.imm & 31); break;
+        case Op::Srli: result = x >> (ins.imm & 31); break;
+        case Op::Srai: result = (uint32_t)(sx >> (ins.imm & 31)); break;
+        case Op::Li: result = (uint32_t)ins.imm; break;
+        case Op::Lb: result = load(x + ins.imm, 1, true); counters.loads++; break;
+        case Op::Lh: result = load(x + ins.imm, 2, true); counters.loads++; break;
+        case Op::Lw: result = load(x + ins.imm, 4, false); counters.loads++; break;
+        case Op::Lbu: result = load(x + ins.imm, 1, false); counters.loads++; break;
+        case Op::Lhu: result = load(x + ins.imm, 2, false); counters.loads++; break;
+        case Op::Sb: store(x + ins.imm, 1, y); counters.stores++; writes = false; break;
+        case Op::Sh: store(x + ins.imm, 2, y); counters.stores++; writes = false; break;
+        case Op::Sw: store(x + ins.imm, 4, y); counters.stores++; writes = false; break;
+        case Op::Beq: taken = x == y; break;
+        case Op::Bne: taken = x != y; break;
+        case Op::Blt: taken = sx < sy; break;
+        case Op::Bge: taken = sx >= sy; break;
+        case Op::Bltu: taken = x < y; break;
+        case Op::Bgeu: taken = x >= y; break;
+        case Op::Jal:
+            result = next;
+            next = (uint32_t)ins.imm;
+            break;
+        case Op::Jalr:
+            result = next;
+            next = (x + (uint32_t)ins.imm) & ~1u;
+            break;
+        case Op::Ecall:
+            writes = false;
+            syscall();
+            ready[10] = cycle;
+            break;
+        }
+
+        if (ins.op >= Op::Beq && ins.op <= Op::Bgeu) {
+            writes = false;
+            counters.branches++;
+            if (taken) {
+                counters.takenBranches++;
+                next = (uint32_t)ins.imm;
+                cycle += penalty;
+            }
+        } else if (ins.op == Op::Jal || ins.op == Op::Jalr) {
+            if (ins.rd == 1) counters.calls++;
+            else counters.jumps++;
+            cycle += penalty;
+        }
+        if (writes && ins.rd != 0) {
+            regs[ins.rd] = result;
+            ready[ins.rd] = issue + ins.latency;
+        }
+        pc = next;
+    }
+    counters.cycles = cycle;
+
+    for (auto &file : files) ::close(file.second);
+    files.clear();
+    return exited ? exitCode : (int32_t)regs[10];
+}
+
+void Simulator::printStats(std::ostream &os) const {
+    auto line = [&](const char *name, uint64_t value) {
+        os << "  " << std::left << std::setw(16) << name << value << "\n";
+    };
+    os << "simulation statistics (" << options.model.name << "):\n";
+    line("instructions", counters.instructions);
+    line("loads", counters.loads);
+    line("stores", counters.stores);
+    line("branches", counters.branches);
+    line("taken branches", counters.takenBranches);
+    line("jumps", counters.jumps);
+    line("calls", counters.calls);
+    line("cycles", counters.cycles);
+}
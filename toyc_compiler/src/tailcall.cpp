@@ -0,0 +1,96 @@
+#include "tailcall.h"
+#include <string>
+
+static bool isSelfTailCall(const ReturnStmt *ret, const FuncDef *func) {
+    auto call = dynamic_cast<const CallExpr *>(ret->expr.get());
+    return call && call->callee == func->name && call->args.size() == func->params.size();
+}
+
+static bool referencesVar(const Expr *expr, const std::string &name) {
+    if (auto var = dynamic_cast<const VarExpr *>(expr)) {
+        return var->name == name;
+    } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        return referencesVar(unary->operand.get(), name);
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        return referencesVar(bin->lhs.get(), name) || referencesVar(bin->rhs.get(), name);
+    } else if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+        for (auto &arg : call->args) {
+            if (referencesVar(arg.get(), name)) return true;
+        }
+    }
+    return false;
+}
+
+// return f(a0, a1, ...) => { p0 = a0; p1 = a1; ...; continue; }
+// 若后面的实参读到了前面已被改写的参数，则先全部求值到临时变量
+static std::unique_ptr<Stmt> rewriteTailCall(ReturnStmt *ret, FuncDef *func) {
+    auto call = static_cast<CallExpr *>(ret->expr.get());
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < call->args.size(); i++) {
+        auto var = dynamic_cast<VarExpr *>(call->args[i].get());
+        if (!var || var->name != func->params[i].name) changed.push_back(i);
+    }
+
+    bool needTemps = false;
+    for (size_t a = 0; a < changed.size(); a++) {
+        for (size_t b = a + 1; b < changed.size(); b++) {
+            needTemps = needTemps || referencesVar(call->args[changed[b]].get(), func->params[changed[a]].name);
+        }
+    }
+
+    auto block = std::make_unique<Block>();
+    for (size_t i : changed) {
+        const std::string &param = func->params[i].name;
+        if (needTemps) {
+            // 带 '.' 的名字不会与源程序中的标识符冲突
+            block->stmts.push_back(std::make_unique<VarDeclStmt>("int", param + ".tail", std::move(call->args[i])));
+        } else {
+            block->stmts.push_back(std::make_unique<AssignStmt>(param, std::move(call->args[i])));
+        }
+    }
+    if (needTemps) {
+        for (size_t i : changed) {
+            const std::string &param = func->params[i].name;
+            block->stmts.push_back(std::make_unique<AssignStmt>(param, std::make_unique<VarExpr>(param + ".tail")));
+        }
+    }
+    block->stmts.push_back(std::make_unique<ContinueStmt>());
+    return block;
+}
+
+// 不进入用户循环：其中的 continue 回不到函数入口
+static int rewriteBlock(Block *block, FuncDef *func) {
+    int count = 0;
+    for (auto &stmt : block->stmts) {
+        if (auto ret = dynamic_cast<ReturnStmt *>(stmt.get())) {
+            if (isSelfTailCall(ret, func)) {
+                stmt = rewriteTailCall(ret, func);
+                count++;
+            }
+        } else if (auto inner = dynamic_cast<Block *>(stmt.get())) {
+            count += rewriteBlock(inner, func);
+        } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt.get())) {
+            count += rewriteBlock(ifStmt->thenBlock.get(), func);
+            if (ifStmt->elseBlock) count += rewriteBlock(ifStmt->elseBlock.get(), func);
+        }
+    }
+    return count;
+}
+
+int eliminateTailRecursion(std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    int total = 0;
+    for (auto &func : funcs) {
+        if (!func->body) continue;
+        int count = rewriteBlock(func->body.get(), func.get());
+        if (count == 0) continue;
+        total += count;
+
+        // 循环体末尾补 return，原来落出函数体的路径不能变成下一次迭代
+        auto loopBody = std::move(func->body);
+        loopBody->stmts.push_back(std::make_unique<ReturnStmt>());
+
+        func->body = std::make_unique<Block>();
+        func->body->stmts.push_back(std::make_unique<WhileStmt>(std::make_unique<NumberExpr>(1), std::move(loopBody)));
+    }
+    return total;
+}
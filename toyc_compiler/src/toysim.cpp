@@ -0,0 +1,107 @@
+// toysim.cpp：执行 toyc 输出的汇编并报告动态指令数与估算周期。
+// 入口函数的返回值输出到 stderr；退出码只表示 toysim 自身的状态，
+// 0 为正常执行完毕，1 为命令行或输入文件错误，2 为汇编或执行失败
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "simulator.h"
+
+static const int kUsageError = 1;
+static const int kSimulationError = 2;
+
+static bool parseLatency(const std::string &text, LatencyModel &model) {
+    std::istringstream in(text);
+    char comma;
+    return (in >> model.alu >> comma >> model.load >> comma >> model.mul >> comma >> model.div >> comma >>
+            model.branch) && in.eof();
+}
+
+// 整个参数须是 [min, max] 内的十进制整数
+static bool parseInteger(const std::string &text, long long min, long long max, long long &value) {
+    size_t used = 0;
+    try {
+        value = std::stoll(text, &used);
+    } catch (const std::logic_error &) {
+        return false;
+    }
+    return used == text.size() && value >= min && value <= max;
+}
+
+int main(int argc, char *argv[]) {
+    SimOptions options;
+    std::string inputPath;
+    std::vector<int32_t> args;
+    bool quiet = false;
+
+    // 命令行选项：toysim [选项] [文件] [-- 实参...]
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("-mtune=", 0) == 0) {
+            const LatencyModel *model = findLatencyModel(arg.substr(7));
+            if (!model) {
+                std::cerr << "Error: Unknown -mtune value " << arg.substr(7) << "\n";
+                return kUsageError;
+            }
+            options.model = *model;
+        } else if (arg.rfind("--latency=", 0) == 0) {
+            // 自定义延迟表：alu,load,mul,div,branch
+            options.model.name = "custom";
+            if (!parseLatency(arg.substr(10), options.model)) {
+                std::cerr << "Error: --latency expects alu,load,mul,div,branch\n";
+                return kUsageError;
+            }
+        } else if (arg.rfind("--max-steps=", 0) == 0) {
+            long long steps = 0;
+            if (!parseInteger(arg.substr(12), 1, LLONG_MAX, steps)) {
+                std::cerr << "Error: Invalid --max-steps value " << arg.substr(12) << "\n";
+                return kUsageError;
+            }
+            options.maxSteps = (uint64_t)steps;
+        } else if (arg.rfind("--entry=", 0) == 0) {
+            options.entry = arg.substr(8);
+        } else if (arg == "-q") {
+            quiet = true;
+        } else if (arg == "--") {
+            for (i++; i < argc; i++) {
+                long long value = 0;
+                if (!parseInteger(argv[i], INT32_MIN, INT32_MAX, value)) {
+                    std::cerr << "Error: Invalid argument " << argv[i] << "\n";
+                    return kUsageError;
+                }
+                args.push_back((int32_t)value);
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Error: Unknown option " << arg << "\n";
+            return kUsageError;
+        } else {
+            inputPath = arg;
+        }
+    }
+
+    std::vector<AsmInstr> program;
+    if (!inputPath.empty()) {
+        std::ifstream file(inputPath);
+        if (!file) {
+            std::cerr << "Error: Cannot open file " << inputPath << "\n";
+            return kUsageError;
+        }
+        program = parseAsm(file);
+    } else {
+        program = parseAsm(std::cin);
+    }
+
+    try {
+        Simulator sim(program, options);
+        int32_t result = sim.run(args);
+        // 返回值写到 stderr，与程序自身的输出分开；-q 只省略统计
+        std::cerr << "return value: " << result << "\n";
+        if (!quiet) sim.printStats(std::cerr);
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Simulation failed: " << ex.what() << "\n";
+        return kSimulationError;
+    }
+}
@@ -0,0 +1,195 @@
+#include "unroll.h"
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+// 计数循环的形状：while (var cmp bound) { ...; var = var + step; }
+struct CountedLoop {
+    std::string var;
+    std::string cmp;
+    const Expr *bound = nullptr;
+    int step = 0;
+};
+
+// 语句中是否给 name 赋值或在本层声明同名变量（同名的内层变量也保守地算作改写）
+static bool writesVar(const Stmt *stmt, const std::string &name) {
+    if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+        return assign->name == name;
+    } else if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+        return decl->name == name;
+    } else if (auto block = dynamic_cast<const Block *>(stmt)) {
+        for (auto &s : block->stmts) {
+            if (writesVar(s.get(), name)) return true;
+        }
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        return writesVar(ifStmt->thenBlock.get(), name) ||
+               (ifStmt->elseBlock && writesVar(ifStmt->elseBlock.get(), name));
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+        return writesVar(whileStmt->body.get(), name);
+    }
+    return false;
+}
+
+// 本层循环的 break/continue（嵌套循环内的不算）
+static bool hasLoopExit(const Stmt *stmt) {
+    if (dynamic_cast<const BreakStmt *>(stmt) || dynamic_cast<const ContinueStmt *>(stmt)) return true;
+    if (auto block = dynamic_cast<const Block *>(stmt)) {
+        for (auto &s : block->stmts) {
+            if (hasLoopExit(s.get())) return true;
+        }
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        return hasLoopExit(ifStmt->thenBlock.get()) || (ifStmt->elseBlock && hasLoopExit(ifStmt->elseBlock.get()));
+    }
+    return false;
+}
+
+static bool matchCounted(const WhileStmt *loop, CountedLoop &info) {
+    auto cond = dynamic_cast<const BinaryExpr *>(loop->condition.get());
+    if (!cond || (cond->op != "<" && cond->op != "<=" && cond->op != ">" && cond->op != ">=")) return false;
+    auto var = dynamic_cast<const VarExpr *>(cond->lhs.get());
+    if (!var) return false;
+    auto boundVar = dynamic_cast<const VarExpr *>(cond->rhs.get());
+    if (!boundVar && !dynamic_cast<const NumberExpr *>(cond->rhs.get())) return false;
+    if (boundVar && boundVar->name == var->name) return false;
+
+    // 末尾的步进语句 i = i + C / i = C + i / i = i - C
+    auto &stmts = loop->body->stmts;
+    if (stmts.empty()) return false;
+    auto inc = dynamic_cast<const AssignStmt *>(stmts.back().get());
+    if (!inc || inc->name != var->name) return false;
+    auto add = dynamic_cast<const BinaryExpr *>(inc->value.get());
+    if (!add || (add->op != "+" && add->op != "-")) return false;
+    auto isVar = [&](const Expr *e) {
+        auto v = dynamic_cast<const VarExpr *>(e);
+        return v && v->name == var->name;
+    };
+    const NumberExpr *step = nullptr;
+    if (isVar(add->lhs.get())) step = dynamic_cast<const NumberExpr *>(add->rhs.get());
+    else if (add->op == "+" && isVar(add->rhs.get())) step = dynamic_cast<const NumberExpr *>(add->lhs.get());
+    if (!step || step->value == 0 || std::abs(step->value) > (1 << 16)) return false;
+
+    info.var = var->name;
+    info.cmp = cond->op;
+    info.bound = cond->rhs.get();
+    info.step = add->op == "+" ? step->value : -step->value;
+    bool up = info.cmp == "<" || info.cmp == "<=";
+    if (up != (info.step > 0)) return false;
+
+    for (size_t i = 0; i + 1 < stmts.size(); i++) {
+        if (writesVar(stmts[i].get(), info.var)) return false;
+        if (boundVar && writesVar(stmts[i].get(), boundVar->name)) return false;
+        if (hasLoopExit(stmts[i].get())) return false;
+    }
+    return true;
+}
+
+static bool compare(const std::string &cmp, int32_t a, int32_t b) {
+    if (cmp == "<") return a < b;
+    if (cmp == "<=") return a <= b;
+    if (cmp == ">") return a > b;
+    return a >= b;
+}
+
+// 紧邻循环之前的 int i = c; 或 i = c; 给出初值时，按 32 位回绕模拟迭代次数；超过 limit 返回 -1
+static int tripCount(const CountedLoop &info, const Stmt *prev, int limit) {
+    auto bound = dynamic_cast<const NumberExpr *>(info.bound);
+    if (!bound || !prev) return -1;
+    const Expr *init = nullptr;
+    if (auto decl = dynamic_cast<const VarDeclStmt *>(prev)) {
+        if (decl->name == info.var) init = decl->initializer.get();
+    } else if (auto assign = dynamic_cast<const AssignStmt *>(prev)) {
+        if (assign->name == info.var) init = assign->value.get();
+    }
+    auto start = dynamic_cast<const NumberExpr *>(init);
+    if (!start) return -1;
+
+    int32_t value = start->value;
+    int trips = 0;
+    while (compare(info.cmp, value, bound->value)) {
+        if (++trips > limit) return -1;
+        value = (int32_t)((uint32_t)value + (uint32_t)info.step);
+    }
+    return trips;
+}
+
+static std::unique_ptr<Block> repeatBody(const Block *body, int times) {
+    auto block = std::make_unique<Block>();
+    for (int i = 0; i < times; i++) block->stmts.push_back(cloneBlock(body));
+    return block;
+}
+
+// 主循环条件：剩余距离足够再走 factor 轮。先比较 i 与 N，保证相减在数学意义上非负；
+// 相减回绕只会让条件为假，余下的迭代仍由原循环完成
+static std::unique_ptr<Expr> mainLoopCondition(const CountedLoop &info, int factor) {
+    auto var = [&]() { return std::make_unique<VarExpr>(info.var); };
+    bool up = info.step > 0;
+    bool strict = info.cmp == "<" || info.cmp == ">";
+    int reach = (factor - 1) * std::abs(info.step);
+    auto distance = up ? std::make_unique<BinaryExpr>("-", cloneExpr(info.bound), var())
+                       : std::make_unique<BinaryExpr>("-", var(), cloneExpr(info.bound));
+    auto enough = std::make_unique<BinaryExpr>(strict ? ">" : ">=", std::move(distance),
+                                               std::make_unique<NumberExpr>(reach));
+    auto inRange = std::make_unique<BinaryExpr>(info.cmp, var(), cloneExpr(info.bound));
+    return std::make_unique<BinaryExpr>("&&", std::move(inRange), std::move(enough));
+}
+
+static int unrollBlock(Block *block, const UnrollOptions &options);
+
+static int unrollChildren(Stmt *stmt, const UnrollOptions &options) {
+    if (auto inner = dynamic_cast<Block *>(stmt)) {
+        return unrollBlock(inner, options);
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        int count = unrollBlock(ifStmt->thenBlock.get(), options);
+        if (ifStmt->elseBlock) count += unrollBlock(ifStmt->elseBlock.get(), options);
+        return count;
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        return unrollBlock(whileStmt->body.get(), options);
+    }
+    return 0;
+}
+
+static int unrollBlock(Block *block, const UnrollOptions &options) {
+    int count = 0;
+    auto &stmts = block->stmts;
+    for (size_t i = 0; i < stmts.size(); i++) {
+        // 先处理内层循环
+        count += unrollChildren(stmts[i].get(), options);
+        auto loop = dynamic_cast<WhileStmt *>(stmts[i].get());
+        CountedLoop info;
+        if (!loop || !matchCounted(loop, info)) continue;
+
+        const ProfileData *profile = options.profile;
+        if (profile && profile->isCold(loop->profileId)) continue;
+        int bodySize = countNodes(loop->body.get());
+        int trips = tripCount(info, i > 0 ? stmts[i - 1].get() : nullptr, options.maxFullTrips);
+        if (trips >= 0 && trips * bodySize <= options.fullBudget) {
+            stmts[i] = repeatBody(loop->body.get(), trips);
+            count++;
+            continue;
+        }
+
+        int maxBodySize = options.maxBodySize;
+        if (profile && profile->count(loop->profileId) > 0) {
+            uint32_t entries = profile->count(loop->profileId);
+            if (profile->count(loop->profileId + 1) / entries < (uint32_t)options.factor) continue;
+            if (profile->isHot(loop->profileId + 1)) maxBodySize *= 2;
+        }
+        if (options.factor < 2 || bodySize > maxBodySize) continue;
+        if ((long long)(options.factor - 1) * std::abs(info.step) > INT32_MAX) continue;
+        auto mainLoop = std::make_unique<WhileStmt>(mainLoopCondition(info, options.factor),
+                                                    repeatBody(loop->body.get(), options.factor));
+        stmts.insert(stmts.begin() + i, std::move(mainLoop));
+        i++;
+        count++;
+    }
+    return count;
+}
+
+int unrollLoops(std::vector<std::unique_ptr<FuncDef>> &funcs, const UnrollOptions &options) {
+    if (!options.enabled) return 0;
+    int total = 0;
+    for (auto &func : funcs) {
+        if (func->body) total += unrollBlock(func->body.get(), options);
+    }
+    return total;
+}
@@ -0,0 +1,137 @@
+// test_astbin.cpp
+#include "lexer.h"
+#include "parser.h"
+#include "profile.h"
+#include "astbin.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+static const char *kSource = R"(int sum(int n, int step) {
+    int s = 0;
+    while (n > 0) {
+        if (n % 2 == 0 && step != -1) s = s + n; else { s = s - 1; continue; }
+        n = n - step;
+    }
+    return s;
+}
+void nothing() { return; }
+int main() {
+    nothing();
+    return sum(10, 1) + !(-2147483647 - 1 >= 0) * 7;
+}
+)";
+
+static std::vector<std::unique_ptr<FuncDef>> parse(const std::string &source) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    return parser.parseCompUnit();
+}
+
+static std::string serialize(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    std::ostringstream out;
+    writeAstBin(out, funcs);
+    return out.str();
+}
+
+static std::string source(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    std::ostringstream out;
+    printSource(out, funcs);
+    return out.str();
+}
+
+// 读取时需要 4 字节对齐的缓冲区，与映射文件一致
+static std::vector<std::unique_ptr<FuncDef>> deserialize(const std::string &bytes) {
+    std::vector<uint32_t> aligned((bytes.size() + 3) / 4);
+    std::memcpy(aligned.data(), bytes.data(), bytes.size());
+    return readAstBin(AstBinView(aligned.data(), bytes.size()));
+}
+
+void test_parser_spans() {
+    auto funcs = parse(kSource);
+    const FuncDef &sum = *funcs[0];
+    assert(sum.span.line == 1 && sum.span.column == 1 && sum.span.endLine == 8 && sum.span.endColumn == 2);
+    auto decl = dynamic_cast<VarDeclStmt *>(sum.body->stmts[0].get());
+    assert(decl && decl->span.line == 2 && decl->span.column == 5 && decl->span.endColumn == 15);
+    auto loop = dynamic_cast<WhileStmt *>(sum.body->stmts[1].get());
+    assert(loop->condition->span.line == 3 && loop->condition->span.column == 12 && loop->condition->span.endColumn == 17);
+    std::cout << "test_parser_spans passed\n";
+}
+
+void test_round_trip() {
+    auto funcs = parse(kSource);
+    assignProfileIds(funcs);
+    std::string bytes = serialize(funcs);
+    auto loaded = deserialize(bytes);
+
+    assert(source(loaded) == source(funcs));
+    assert(serialize(loaded) == bytes);
+    assert(loaded[0]->params.size() == 2 && loaded[0]->params[1].name == "step");
+    assert(loaded[1]->retType == "void");
+    auto loop = dynamic_cast<WhileStmt *>(loaded[0]->body->stmts[1].get());
+    auto original = dynamic_cast<WhileStmt *>(funcs[0]->body->stmts[1].get());
+    assert(loop->profileId == original->profileId && loop->profileId >= 0);
+    assert(loop->condition->span.column == 12 && loop->condition->span.endColumn == 17);
+    std::cout << "test_round_trip passed\n";
+}
+
+void test_view() {
+    auto funcs = parse(kSource);
+    std::string bytes = serialize(funcs);
+    std::vector<uint32_t> aligned((bytes.size() + 3) / 4);
+    std::memcpy(aligned.data(), bytes.data(), bytes.size());
+    AstBinView view(aligned.data(), bytes.size());
+
+    assert(view.functionCount() == 3);
+    const AstBinNode &sum = view.function(0);
+    assert(sum.kind == AstBinKind::Func && std::strcmp(view.string(sum.value), "sum") == 0);
+    assert(sum.childCount == 3 && view.child(sum, 0).kind == AstBinKind::Param);
+    const AstBinNode &body = view.child(sum, 2);
+    assert(body.kind == AstBinKind::Block && body.childCount == 3);
+    const AstBinNode &loop = view.child(body, 1);
+    const AstBinNode &cond = view.child(loop, 0);
+    assert(cond.kind == AstBinKind::Binary && cond.op == AstBinOp::Gt && cond.line == 3 && cond.column == 12);
+
+    // 同名只存一份：sum、n、step、s、int、nothing、void、main
+    assert(view.stringCount() == 8);
+    std::cout << "test_view passed\n";
+}
+
+void test_malformed() {
+    std::string bytes = serialize(parse(kSource));
+    auto rejects = [](const std::string &data) {
+        try {
+            deserialize(data);
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    assert(rejects(bytes.substr(0, 20)));
+    assert(rejects(bytes.substr(0, bytes.size() - 4)));
+    std::string badMagic = bytes;
+    badMagic[0] = 'X';
+    assert(rejects(badMagic));
+
+    // 把第一个节点的子节点数改大，栈上没有足够的子树
+    AstBinHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    std::string badNode = bytes;
+    uint16_t children = 5;
+    std::memcpy(&badNode[header.nodes + offsetof(AstBinNode, childCount)], &children, sizeof(children));
+    assert(rejects(badNode));
+    std::cout << "test_malformed passed\n";
+}
+
+int main() {
+    test_parser_spans();
+    test_round_trip();
+    test_view();
+    test_malformed();
+    std::cout << "All AST serialization tests done.\n";
+    return 0;
+}
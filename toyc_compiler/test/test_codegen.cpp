@@ -2,17 +2,48 @@
 #include <sstream>
 #include <memory>
 #include <vector>
+#include <cassert>
 
 #include "codegen.h"
 #include "ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include "tailcall.h"
+#include "unroll.h"
+#include "peephole.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "passes.h"
+#include "simulator.h"
 
-int main() {
-    // 创建一个输出字符串流，用于捕获代码生成输出
+static std::string generateCode(std::vector<std::unique_ptr<FuncDef>> &funcs,
+                                const CodeGenOptions &options = CodeGenOptions()) {
     std::ostringstream oss;
+    CodeGen codegen(oss, options);
+    codegen.generate(funcs);
+    return oss.str();
+}
 
-    // 创建CodeGen对象，传入输出流
-    CodeGen codegen(oss);
+static std::string compileSource(const std::string &source,
+                                 const CodeGenOptions &options = CodeGenOptions()) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto funcs = parser.parseCompUnit();
+    return generateCode(funcs, options);
+}
+
+// 在 toysim 中执行生成的汇编，返回入口函数的 a0
+static int32_t runCode(const std::string &code, const std::string &entry = "main",
+                       const std::vector<int32_t> &args = {}) {
+    std::istringstream in(code);
+    SimOptions options;
+    options.entry = entry;
+    Simulator sim(parseAsm(in), options);
+    return sim.run(args);
+}
 
+void test_return_constant() {
     // 构造一个简单的函数AST：
     // int main() { return 42; }
     auto func = std::make_unique<FuncDef>("int", "main");
@@ -29,11 +60,577 @@ int main() {
     std::vector<std::unique_ptr<FuncDef>> funcs;
     funcs.push_back(std::move(func));
 
-    // 调用CodeGen生成代码
-    codegen.generate(funcs);
+    std::string code = generateCode(funcs);
+    // 窥孔优化把 li t0, 42; mv a0, t0 合并为一条
+    assert(code.find("li a0, 42") != std::string::npos);
+    assert(code.find("mv a0") == std::string::npos);
 
     // 输出生成的代码
-    std::cout << "Generated code:\n" << oss.str() << std::endl;
+    std::cout << "Generated code:\n" << code << std::endl;
+}
+
+void test_fused_compare_branch() {
+    // int f(int a, int b) { if (a < b && b != 0) return 1; return 0; }
+    auto func = std::make_unique<FuncDef>("int", "f");
+    func->params.emplace_back("int", "a");
+    func->params.emplace_back("int", "b");
+
+    auto cond = std::make_unique<BinaryExpr>("&&",
+        std::make_unique<BinaryExpr>("<", std::make_unique<VarExpr>("a"), std::make_unique<VarExpr>("b")),
+        std::make_unique<BinaryExpr>("!=", std::make_unique<VarExpr>("b"), std::make_unique<NumberExpr>(0)));
+
+    auto thenBlk = std::make_unique<Block>();
+    auto ret1 = std::make_unique<ReturnStmt>();
+    ret1->expr = std::make_unique<NumberExpr>(1);
+    thenBlk->stmts.push_back(std::move(ret1));
+
+    auto ret0 = std::make_unique<ReturnStmt>();
+    ret0->expr = std::make_unique<NumberExpr>(0);
+
+    func->body = std::make_unique<Block>();
+    func->body->stmts.push_back(std::make_unique<IfStmt>(std::move(cond), std::move(thenBlk), nullptr));
+    func->body->stmts.push_back(std::move(ret0));
+
+    std::vector<std::unique_ptr<FuncDef>> funcs;
+    funcs.push_back(std::move(func));
+
+    std::string code = generateCode(funcs);
+    // 关系运算直接融合为条件跳转，不再先物化 0/1
+    assert(code.find("bge ") != std::string::npos);
+    assert(code.find(", zero, ") != std::string::npos);
+    assert(code.find("slt") == std::string::npos);
+    assert(code.find("beqz") == std::string::npos);
+
+    std::cout << "test_fused_compare_branch passed\n";
+}
+
+void test_frame_layout() {
+    // int sq(int x) { return x * x; }
+    auto sq = std::make_unique<FuncDef>("int", "sq");
+    sq->params.emplace_back("int", "x");
+    auto sqRet = std::make_unique<ReturnStmt>();
+    sqRet->expr = std::make_unique<BinaryExpr>("*", std::make_unique<VarExpr>("x"), std::make_unique<VarExpr>("x"));
+    sq->body = std::make_unique<Block>();
+    sq->body->stmts.push_back(std::move(sqRet));
+
+    // int main() { { int a = 1; } { int b = 2; } return sq(3) + 1; }
+    auto mainFunc = std::make_unique<FuncDef>("int", "main");
+    mainFunc->body = std::make_unique<Block>();
+    auto blockA = std::make_unique<Block>();
+    blockA->stmts.push_back(std::make_unique<VarDeclStmt>("int", "a", std::make_unique<NumberExpr>(1)));
+    auto blockB = std::make_unique<Block>();
+    blockB->stmts.push_back(std::make_unique<VarDeclStmt>("int", "b", std::make_unique<NumberExpr>(2)));
+    auto call = std::make_unique<CallExpr>("sq");
+    call->args.push_back(std::make_unique<NumberExpr>(3));
+    auto mainRet = std::make_unique<ReturnStmt>();
+    mainRet->expr = std::make_unique<BinaryExpr>("+", std::move(call), std::make_unique<NumberExpr>(1));
+    mainFunc->body->stmts.push_back(std::move(blockA));
+    mainFunc->body->stmts.push_back(std::move(blockB));
+    mainFunc->body->stmts.push_back(std::move(mainRet));
+
+    std::vector<std::unique_ptr<FuncDef>> funcs;
+    funcs.push_back(std::move(sq));
+    funcs.push_back(std::move(mainFunc));
+
+    // 关闭过程间分配，变量只能放在 s 寄存器中
+    CodeGenOptions options;
+    options.ipra = false;
+    std::string code = generateCode(funcs, options);
+    std::string sqCode = code.substr(0, code.find(".globl main"));
+    std::string mainCode = code.substr(code.find(".globl main"));
+
+    // 叶函数不分配栈帧
+    assert(sqCode.find("sp") == std::string::npos);
+    // 非叶函数保存 ra，兄弟作用域中的 a、b 共用同一个 s0
+    assert(mainCode.find("sw ra") != std::string::npos);
+    assert(mainCode.find("sw s0") != std::string::npos);
+    assert(mainCode.find("s1") == std::string::npos);
+    assert(mainCode.find("addi sp, sp, -16") != std::string::npos);
+
+    std::cout << "test_frame_layout passed\n";
+}
+
+void test_shrink_wrap() {
+    std::string code = compileSource(R"(
+        int fib(int n) {
+            if (n <= 1) return n;
+            return fib(n - 1) + fib(n - 2);
+        }
+    )");
+
+    // 提前返回的路径在序言之前直接 ret，不触碰栈
+    size_t firstRet = code.find("\tret\n");
+    size_t prologue = code.find("addi sp, sp, -");
+    assert(firstRet != std::string::npos && prologue != std::string::npos);
+    assert(firstRet < prologue);
+    assert(code.find("mv a0, a0") == std::string::npos);
+
+    // 主路径的尾声只出现一次
+    assert(code.find("addi sp, sp, 16") == code.rfind("addi sp, sp, 16"));
+
+    // 前缀中读取的任一参数都还在传入的 a 寄存器中，不只是前几个
+    const char *twoParams = R"(
+        int g(int x) { return x + 1; }
+        int f(int a, int b) { if (a <= 0) return b; return g(a) + b; }
+        int main() { return f(0, 42) * 100 + f(3, 5); }
+    )";
+    assert(runCode(compileSource(twoParams)) == 4209);
+    CodeGenOptions unoptimized;
+    unoptimized.peephole = false;
+    unoptimized.schedule = false;
+    assert(runCode(compileSource(twoParams, unoptimized)) == 4209);
+
+    // 前缀覆盖整个函数体时不建立栈帧，也不在 ret 之后留下死序言
+    code = compileSource("int clamp(int a, int b) { while (a > 0) { b = b + a; a = a - 1; } if (b > 100) return 100; return b; }");
+    assert(code.find("sp") == std::string::npos);
+    assert(code.find("ret\n\tret") == std::string::npos);
+    assert(runCode(code, "clamp", {4, 1}) == 11 && runCode(code, "clamp", {20, 1}) == 100);
+
+    std::cout << "test_shrink_wrap passed\n";
+}
+
+void test_tail_calls() {
+    Lexer lexer(R"(
+        int sum(int n, int acc) { if (n == 0) return acc; return sum(n - 1, acc + n); }
+        int even(int n) { if (n == 0) return 1; return odd(n - 1); }
+        int odd(int n) { if (n == 0) return 0; return even(n - 1); }
+    )");
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto funcs = parser.parseCompUnit();
+
+    // 自尾递归改写为循环，函数不再调用自己
+    assert(eliminateTailRecursion(funcs) == 1);
+    std::string code = generateCode(funcs);
+    std::string sumCode = code.substr(0, code.find(".globl even"));
+    assert(sumCode.find("tail sum") == std::string::npos && sumCode.find("call sum") == std::string::npos);
+    assert(sumCode.find("sp") == std::string::npos);
+
+    // 互相递归的尾调用复用栈帧，用 tail 跳转且不保存 ra
+    assert(code.find("tail odd") != std::string::npos);
+    assert(code.find("tail even") != std::string::npos);
+    assert(code.find("call") == std::string::npos);
+    assert(code.find("ra") == std::string::npos);
+
+    std::cout << "test_tail_calls passed\n";
+}
+
+static std::string unrollAndGenerate(const std::string &source, const UnrollOptions &options, int &unrolled) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto funcs = parser.parseCompUnit();
+    unrolled = unrollLoops(funcs, options);
+    return generateCode(funcs);
+}
+
+void test_loops() {
+    // 旋转后的循环体末尾只有一条向回的条件跳转，没有 j 回到循环头
+    int unrolled = 0;
+    UnrollOptions noUnroll;
+    noUnroll.enabled = false;
+    std::string code = unrollAndGenerate(R"(
+        int sum(int n) { int s = 0; int i = 0; while (i < n) { s = s + i; i = i + 1; } return s; }
+    )", noUnroll, unrolled);
+    assert(unrolled == 0);
+    assert(code.find("\tj ") == std::string::npos);
+    assert(code.find("blt ") != std::string::npos);
+
+    // 次数未知：按 factor 展开的主循环加上处理余数的原循环
+    UnrollOptions options;
+    options.factor = 4;
+    code = unrollAndGenerate(R"(
+        int sum(int n) { int s = 0; int i = 0; while (i < n) { s = s + i; i = i + 1; } return s; }
+    )", options, unrolled);
+    assert(unrolled == 1);
+    size_t adds = 0;
+    for (size_t pos = 0; (pos = code.find("addi a2, a2, 1", pos)) != std::string::npos; pos++) adds++;
+    assert(adds == 5);
+
+    // 次数为小常数：完全展开，不再有循环
+    code = unrollAndGenerate(R"(
+        int tri() { int s = 0; int i = 10; while (i >= 0) { s = s + i; i = i - 3; } return s; }
+    )", options, unrolled);
+    assert(unrolled == 1);
+    assert(code.find("loop") == std::string::npos);
+
+    // 超出预算、或循环体内有 break 时保持原样
+    options.fullBudget = 10;
+    options.maxBodySize = 5;
+    code = unrollAndGenerate(R"(
+        int f(int n) { int s = 0; int i = 0; while (i < 100) { s = s + i * n; i = i + 1; } return s; }
+        int g(int n) { int i = 0; while (i < n) { if (i == 3) break; i = i + 1; } return i; }
+    )", options, unrolled);
+    assert(unrolled == 0);
 
+    std::cout << "test_loops passed\n";
+}
+
+void test_if_conversion() {
+    // min 与 abs 的条件赋值改为 slt/neg/xor/and 掩码选择，不再有分支
+    std::string code = compileSource(R"(
+        int mn(int a, int b) { int m = 0; if (a < b) m = a; else m = b; return m; }
+        int ab(int x) { if (x < 0) x = -x; return x; }
+    )");
+    assert(code.find("neg t0, t0") != std::string::npos);
+    assert(code.find("and ") != std::string::npos);
+    assert(code.find("endif") == std::string::npos);
+    assert(code.find("bge") == std::string::npos && code.find("blt") == std::string::npos);
+
+    // 分支较大、含调用或除法时仍使用分支
+    code = compileSource(R"(
+        int sq(int x) { return x * x; }
+        int f(int a, int b) { if (a < b) a = sq(b); return a; }
+        int g(int a, int b) { if (a < b) a = (a + 1) * (b + 2) - (a * b + 3); return a; }
+        int h(int a, int b) { if (b != 0) a = a / b; return a; }
+    )");
+    assert(code.find("and ") == std::string::npos);
+
+    CodeGenOptions options;
+    options.ifConvert = false;
+    code = compileSource("int ab(int x) { if (x < 0) x = -x; return x; }", options);
+    assert(code.find("bge") != std::string::npos);
+
+    std::cout << "test_if_conversion passed\n";
+}
+
+void test_ipra() {
+    const char *source = R"(
+        int inc(int x) { return x + 1; }
+        int main() { int a = 5; int b = inc(a) * inc(a + 1); return a + b + 1; }
+    )";
+    std::string code = compileSource(source);
+    std::string mainCode = code.substr(code.find(".globl main"));
+
+    // inc 只改写 a0，a、b 放在 a1、a2 中跨调用存活，不必保存 s 寄存器
+    assert(mainCode.find("s0") == std::string::npos);
+    assert(mainCode.find("a1") != std::string::npos);
+    // 第一次调用的结果留在 t 寄存器中，不必在第二次调用前溢出
+    assert(mainCode.find("sw t") == std::string::npos);
+
+    // 关闭后恢复按调用约定保存
+    CodeGenOptions options;
+    options.ipra = false;
+    std::string plain = compileSource(source, options);
+    assert(plain.find("sw s0") != std::string::npos);
+    assert(plain.find("sw t") != std::string::npos);
+
+    // 尾调用经 t1 跳转，经过尾调用的被调用者也改写 t1
+    ClobberMap clobbers = {{"leaf", regBit(regIndex("a0"))}};
+    RegSet viaTail = clobberSetOf({AsmInstr::instr("tail", {"leaf"})}, 0, clobbers);
+    assert((viaTail & regBit(regIndex("t1"))) && (viaTail & regBit(regIndex("a0"))));
+    // 调用前算好的 (a * b) * 3 在 t1 中，跨过 mid 时须保存；窥孔与调度改变 mid 的代码，两种流水线都检查
+    const char *tailSource = R"(
+        int leaf(int x) { return x + 1; }
+        int mid(int x) { return leaf(x * 2); }
+        int main() { int a = 5; int b = 7; return (a + b) * 2 + ((a * b) * 3 + mid(b)); }
+    )";
+    CodeGenOptions unoptimized;
+    unoptimized.peephole = false;
+    unoptimized.schedule = false;
+    for (const std::string &tailCode : {compileSource(tailSource), compileSource(tailSource, unoptimized)}) {
+        assert(tailCode.find("tail leaf") != std::string::npos);
+        assert(tailCode.find("sw t1") != std::string::npos);
+        assert(runCode(tailCode) == 24 + 105 + 15);
+    }
+
+    std::cout << "test_ipra passed\n";
+}
+
+void test_peephole() {
+    using I = AsmInstr;
+    std::vector<AsmInstr> code = {
+        I::directive(".globl", {"f"}),
+        I::label("f"),
+        I::instr("li", {"t0", "8"}),
+        I::instr("mul", {"t1", "a0", "t0"}),
+        I::instr("li", {"t2", "5"}),
+        I::instr("add", {"t1", "t1", "t2"}),
+        I::instr("sw", {"t1", "0(sp)"}),
+        I::instr("lw", {"t3", "0(sp)"}),
+        I::instr("mv", {"a0", "t3"}),
+        I::instr("mv", {"a0", "a0"}),
+        I::instr("bnez", {"a0", "skip_0"}),
+        I::instr("j", {"out_1"}),
+        I::label("skip_0"),
+        I::instr("li", {"t4", "99"}),
+        I::instr("j", {"out_1"}),
+        I::instr("addi", {"a0", "a0", "1"}),
+        I::label("out_1"),
+        I::instr("ret"),
+    };
+
+    Peephole peephole;
+    assert(peephole.run(code) > 0);
+    std::ostringstream oss;
+    printAsm(oss, code);
+    std::string text = oss.str();
+
+    // 乘 2 的幂变为移位，小常数折叠进立即数
+    assert(text.find("slli t1, a0, 3") != std::string::npos);
+    assert(text.find("addi t1, t1, 5") != std::string::npos);
+    // 存后立即读回同一槽位改为寄存器传递，多余的搬运消失
+    assert(text.find("lw ") == std::string::npos);
+    assert(text.find("mv a0, a0") == std::string::npos);
+    // 死代码与不可达代码删除，无引用的标签随之删除
+    assert(text.find("li t4") == std::string::npos);
+    assert(text.find("addi a0, a0, 1") == std::string::npos);
+    assert(text.find("skip_0") == std::string::npos);
+
+    // 命中计数按规则表顺序累计
+    const auto &rules = peepholeRules();
+    int total = 0;
+    for (size_t r = 0; r < rules.size(); r++) {
+        if (std::string(rules[r].name) == "imm-fold") assert(peephole.hits()[r] == 2);
+        total += peephole.hits()[r];
+    }
+    assert(total > 2);
+
+    std::cout << "test_peephole passed\n";
+}
+
+void test_instruction_selection() {
+    // 关闭窥孔优化，立即数与组合形式只能来自指令选择
+    CodeGenOptions options;
+    options.peephole = false;
+    options.schedule = false;
+    std::string code = compileSource(R"(
+        int f(int x, int y) {
+            int a = x + 5;
+            int b = x < 10;
+            int c = x == 0;
+            int d = 305419896;
+            int e = 0 <= x && x < 100;
+            int g = x * 8 - 3;
+            int h = !(x == y);
+            int k = x <= 7;
+            return a + b + c + d + e + g + h + k + 65536;
+        }
+    )", options);
+    assert(code.find("addi t0, a0, 5") != std::string::npos);
+    assert(code.find("slti t0, a0, 10") != std::string::npos);
+    assert(code.find("seqz t0, a0") != std::string::npos);
+    // 0x12345678 = lui 0x12345 + 0x678；低 12 位为 0 时只需 lui
+    assert(code.find("lui t0, 74565\n\taddi t0, t0, 1656") != std::string::npos);
+    assert(code.find("lui t1, 16") != std::string::npos);
+    // 区间判断合并为一次无符号比较
+    assert(code.find("sltiu t0, a0, 100") != std::string::npos);
+    assert(code.find("slli t0, a0, 3\n\taddi t0, t0, -3") != std::string::npos);
+    assert(code.find("xor t0, a0, a1\n\tsnez t0, t0") != std::string::npos);
+    // x <= 7 即 x < 8
+    assert(code.find("slti t0, a0, 8") != std::string::npos);
+    assert(code.find("\tli ") == std::string::npos);
+    assert(code.find("mul") == std::string::npos);
+    // 选出的指令在 toysim 中与按源语义计算的结果一致，覆盖各比较的边界两侧
+    auto expected = [](int x, int y) {
+        return (x + 5) + (x < 10) + (x == 0) + 305419896 + (0 <= x && x < 100) + (x * 8 - 3) + (x != y) +
+               (x <= 7) + 65536;
+    };
+    for (int x : {-1, 0, 7, 8, 10, 99, 100}) {
+        for (int y : {0, 8}) assert(runCode(code, "f", {x, y}) == expected(x, y));
+    }
+
+    // 条件中的区间判断也不再拆成两次分支
+    std::string branch = compileSource(R"(
+        int g(int x) {
+            if (0 <= x && x < 16) return 1;
+            return 2;
+        }
+    )", options);
+    assert(branch.find("sltiu") != std::string::npos);
+    assert(branch.find("bltz") == std::string::npos && branch.find("blt ") == std::string::npos);
+    for (int x : {-1, 0, 15, 16}) assert(runCode(branch, "g", {x}) == (0 <= x && x < 16 ? 1 : 2));
+    std::cout << "test_instruction_selection passed\n";
+}
+
+void test_schedule() {
+    using I = AsmInstr;
+    // lw 的结果紧接着被使用；第二个 lw 与第一组运算无关，可以提前填补空拍
+    std::vector<AsmInstr> code = {
+        I::label("f"),
+        I::instr("lw", {"t0", "0(sp)"}),
+        I::instr("add", {"a0", "a0", "t0"}),
+        I::instr("lw", {"t1", "4(sp)"}),
+        I::instr("mul", {"a0", "a0", "t1"}),
+        I::instr("sw", {"a1", "8(sp)"}),
+        I::instr("ret"),
+    };
+
+    Scheduler scheduler(*findLatencyModel("rocket"));
+    int before = scheduler.estimateCycles(code, 1, code.size());
+    assert(scheduler.run(code) > 0);
+    assert(scheduler.estimateCycles(code, 1, code.size()) < before);
+    assert(code[2].op == "lw");
+    // 依赖顺序保持不变，块尾的 ret 不动
+    assert(code[1].args[0] == "t0" && code[2].args[0] == "t1");
+    assert(code.back().op == "ret");
+
+    // 同一栈槽的写和读不能交换
+    std::vector<AsmInstr> alias = {
+        I::instr("sw", {"a0", "0(sp)"}),
+        I::instr("li", {"t2", "3"}),
+        I::instr("lw", {"t0", "0(sp)"}),
+        I::instr("add", {"a0", "t0", "t2"}),
+        I::instr("ret"),
+    };
+    scheduler.run(alias);
+    assert(alias[0].op == "sw");
+
+    assert(findLatencyModel("no-such-core") == nullptr);
+    std::cout << "test_schedule passed\n";
+}
+
+void test_profile() {
+    const char *source = R"(
+        int f(int x) { if (x > 0) { x = x * 3 + 1; x = x / 2; } else { x = x - 1; } return x; }
+        int main() { return f(4); }
+    )";
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto funcs = parser.parseCompUnit();
+    ProfileLayout layout = assignProfileIds(funcs);
+    // f 入口、if 执行/then 两个、main 入口、调用点
+    assert(layout.counters == 5);
+
+    CodeGenOptions options;
+    options.profileGenerate = true;
+    options.profileLayout = layout;
+    std::string code = generateCode(funcs, options);
+    assert(code.find("la t0, __toyc_prof_counters+4") != std::string::npos);
+    assert(code.find(".globl __toyc_main") != std::string::npos);
+    assert(code.find("call __toyc_prof_dump") != std::string::npos);
+    assert(code.find(".zero 20") != std::string::npos);
+
+    // else 执行得更多：反转条件，else 分支顺序执行
+    ProfileData profile;
+    profile.counts = {10, 10, 1, 1, 1};
+    profile.maxCount = 10;
+    options = CodeGenOptions();
+    options.profile = &profile;
+    code = generateCode(funcs, options);
+    assert(code.find("addi a0, a0, -1") < code.find("mul"));
+
+    // else 从不执行：移到函数末尾的返回之后
+    profile.counts = {100, 100, 100, 1, 1};
+    profile.maxCount = 100;
+    code = generateCode(funcs, options);
+    assert(code.find("mul") < code.find("\tret\n"));
+    assert(code.find("addi a0, a0, -1") > code.find("\tret\n"));
+
+    std::cout << "test_profile passed\n";
+}
+
+void test_pass_manager() {
+    // -O0 不运行任何 pass，-O2 包含除 compress（由 -mrvc 开启）外的全部
+    PassOptions options;
+    applyOptLevel(0, options);
+    assert(options.pipeline.empty() && !options.codegen.ipra);
+    applyOptLevel(2, options);
+    assert(options.pipeline.size() == registeredPasses().size() - 1);
+
+    assert(parsePipeline("unroll,peephole").size() == 2);
+    bool threw = false;
+    try { parsePipeline("peephole,inline"); } catch (const std::runtime_error &) { threw = true; }
+    assert(threw);
+    threw = false;
+    try { parsePipeline("licm"); } catch (const std::runtime_error &) { threw = true; }
+    assert(threw);
+    threw = false;
+    try { parsePipeline("compress,schedule"); } catch (const std::runtime_error &) { threw = true; }
+    assert(threw);
+
+    const char *source = R"(
+        int main() { int s = 0; int i = 0; while (i < 3) { s = s + i; i = i + 1; } return -s; }
+    )";
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto funcs = parser.parseCompUnit();
+
+    options.pipeline = parsePipeline("unroll,peephole");
+    options.printAfter = {"unroll", "peephole"};
+    std::ostringstream dump;
+    PassManager passes(options, dump);
+    passes.runAstPasses(funcs);
+    // 展开后的 AST 以源码形式输出，且可以重新解析
+    std::string printed = dump.str();
+    assert(printed.find("*** AST after unroll ***") != std::string::npos);
+    assert(printed.find("while") == std::string::npos);
+    std::ostringstream again;
+    Lexer relexer(printed.substr(printed.find('\n') + 1));
+    auto retokens = relexer.tokenize();
+    Parser reparser(retokens);
+    auto reparsed = reparser.parseCompUnit();
+    printSource(again, reparsed);
+    assert(printed.substr(printed.find('\n') + 1) == again.str());
+
+    passes.attach(options.codegen);
+    std::string code = generateCode(funcs, options.codegen);
+    assert(dump.str().find("*** main after peephole ***") != std::string::npos);
+
+    std::ostringstream stats;
+    passes.printStats(stats);
+    assert(stats.str().find("unroll") != std::string::npos);
+    assert(stats.str().find("schedule") == std::string::npos);
+    std::cout << "test_pass_manager passed\n";
+}
+
+void test_cost_report() {
+    const char *source = R"(
+        int helper(int x) { return x * 3 + 1; }
+        int work(int n) {
+            int s = 0; int i = 0;
+            while (i < n) {
+                int j = 0;
+                while (j < i) { s = s + helper(j); j = j + 1; }
+                i = i + 1;
+            }
+            return s;
+        }
+        int main() { return work(30); }
+    )";
+    const LatencyModel &model = *findLatencyModel("generic");
+    CostReport report(model);
+    CodeGenOptions options;
+    options.costReport = &report;
+    compileSource(source, options);
+
+    // main 尾调用 work，代价最低
+    auto ranked = report.ranked();
+    assert(ranked.size() == 3 && ranked[0].name == "work" && ranked[1].name == "helper" && ranked[2].calls == 1);
+    const FunctionCost &work = ranked[0];
+    assert(work.calls == 1 && work.frameSize > 0 && work.loops.size() == 2);
+    // 内层循环权重为 10^2，外层循环的代价包含内层
+    const LoopCost &outer = work.loops[0], &inner = work.loops[1];
+    assert(outer.depth == 1 && inner.depth == 2 && outer.instrs > inner.instrs);
+    assert(inner.cost == inner.perIteration * 100 && outer.cost > inner.cost && work.cost > outer.cost);
+    // 叶函数无栈帧；ret 计入跳转损失
+    const FunctionCost &helper = ranked[1];
+    assert(helper.frameSize == 0 && helper.loops.empty() && helper.cost >= helper.instrs + model.branch);
+
+    std::ostringstream json;
+    report.printJson(json);
+    assert(json.str().find("{\"name\": \"work\"") != std::string::npos);
+    assert(json.str().find("\"depth\": 2") != std::string::npos);
+    std::cout << "test_cost_report passed\n";
+}
+
+int main() {
+    test_return_constant();
+    test_fused_compare_branch();
+    test_frame_layout();
+    test_shrink_wrap();
+    test_tail_calls();
+    test_loops();
+    test_if_conversion();
+    test_ipra();
+    test_peephole();
+    test_instruction_selection();
+    test_schedule();
+    test_profile();
+    test_pass_manager();
+    test_cost_report();
+    std::cout << "All codegen tests done.\n";
     return 0;
 }
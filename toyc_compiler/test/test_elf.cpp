@@ -0,0 +1,235 @@
+// test_elf.cpp
+#include "lexer.h"
+#include "parser.h"
+#include "codegen.h"
+#include "elf.h"
+#include "rvc.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <stdexcept>
+
+static std::vector<AsmInstr> assemble(const std::string &text) {
+    std::istringstream in(text);
+    return parseAsm(in);
+}
+
+static std::vector<AsmInstr> compile(const std::string &source, const CodeGenOptions &options = CodeGenOptions()) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto funcs = parser.parseCompUnit();
+    std::ostringstream oss;
+    CodeGen codegen(oss, options);
+    return codegen.lower(funcs);
+}
+
+static uint32_t wordAt(const std::vector<uint8_t> &bytes, uint32_t offset) {
+    return bytes[offset] | bytes[offset + 1] << 8 | bytes[offset + 2] << 16 | (uint32_t)bytes[offset + 3] << 24;
+}
+
+static uint32_t halfAt(const std::vector<uint8_t> &bytes, uint32_t offset) {
+    return bytes[offset] | bytes[offset + 1] << 8;
+}
+
+static const char *kProgram = R"(
+    int gcd(int a, int b) { while (b != 0) { int t = a % b; a = b; b = t; } return a; }
+    int f(int n) { if (n > 1000000) return n - 305419896; return gcd(n, 12) + 1; }
+    int main() { return f(36) + f(2000000); }
+)";
+
+void test_encoding() {
+    auto object = assembleObject(assemble(R"(
+.globl main
+main:
+	addi a0, a0, 1
+	sw ra, 12(sp)
+	li a1, 0x12345678
+	beqz a0, done
+	srai a2, a1, 3
+done:
+	call helper
+	ret
+)"));
+    assert(wordAt(object.text, 0) == 0x00150513);
+    assert(wordAt(object.text, 4) == 0x00112623);
+    // li 展开为 lui + addi
+    assert(wordAt(object.text, 8) == 0x123455b7);
+    assert(wordAt(object.text, 12) == 0x67858593);
+    // beqz 跳过 srai，偏移 +8
+    assert(wordAt(object.text, 16) == 0x00050463);
+    assert(wordAt(object.text, 20) == 0x4035d613);
+    // call 为 auipc ra + jalr ra，带 R_RISCV_CALL
+    assert(wordAt(object.text, 24) == 0x00000097);
+    assert(wordAt(object.text, 28) == 0x000080e7);
+    assert(wordAt(object.text, 32) == 0x00008067);
+    assert(object.relocs.size() == 1);
+    assert(object.relocs[0].offset == 24 && object.relocs[0].type == R_RISCV_CALL && object.relocs[0].symbol == "helper");
+
+    const ElfSymbol *main = object.findSymbol("main");
+    assert(main && main->global && main->function && main->size == 36);
+    const ElfSymbol *helper = object.findSymbol("helper");
+    assert(helper && helper->global && helper->section == ElfSymbol::Section::Undefined);
+    assert(object.findSymbol("done") && !object.findSymbol("done")->global);
+    std::cout << "test_encoding passed\n";
+}
+
+void test_long_branch() {
+    // 条件分支超出 ±4KiB 时改写为反向分支加 jal
+    std::string text = "main:\n\tbnez a0, far\n";
+    for (int i = 0; i < 1100; i++) text += "\tnop\n";
+    text += "far:\n\tret\n";
+    auto object = assembleObject(assemble(text));
+    assert(object.text.size() == 8 + 1100 * 4 + 4);
+    assert(wordAt(object.text, 0) == 0x00050463);  // beqz a0, +8
+    assert((wordAt(object.text, 4) & 0xfff) == 0x06f);
+
+    bool threw = false;
+    try { assembleObject(assemble("main:\n\tli a0, 1\n\tfoo a0\n")); } catch (const std::runtime_error &) { threw = true; }
+    assert(threw);
+    threw = false;
+    try { assembleObject(assemble("main:\n\taddi a0, a0, 4096\n")); } catch (const std::runtime_error &) { threw = true; }
+    assert(threw);
+    std::cout << "test_long_branch passed\n";
+}
+
+void test_compressed() {
+    auto object = assembleObject(assemble(R"(
+main:
+	c.addi a0, 1
+	c.lwsp ra, 12(sp)
+	c.swsp ra, 4(sp)
+	c.addi16sp sp, -16
+	c.addi4spn a0, sp, 16
+	c.lui a0, 1048575
+	c.lw a0, 4(a1)
+	c.sw s0, 4(a5)
+	c.mv a0, a1
+	c.add t0, t1
+	c.sub a0, a1
+	c.or s0, s1
+	c.slli t0, 3
+	c.srai a0, 3
+	c.andi a0, -32
+	c.li a0, -1
+	c.jalr t0
+	c.jr ra
+)"));
+    const uint32_t expected[] = {0x0505, 0x40b2, 0xc206, 0x717d, 0x0808, 0x757d, 0x41c8, 0xc3c0, 0x852e,
+                                 0x929a, 0x8d0d, 0x8c45, 0x028e, 0x850d, 0x9901, 0x557d, 0x9282, 0x8082};
+    assert(object.text.size() == sizeof(expected) / sizeof(expected[0]) * 2);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) assert(halfAt(object.text, i * 2) == expected[i]);
+    assert(object.rvc);
+
+    // 超出 ±256 字节的 c.beqz 改用 32 位 beqz
+    std::string text = "main:\n\tc.beqz a0, far\n\tc.j near\nnear:\n";
+    for (int i = 0; i < 200; i++) text += "\tc.nop\n";
+    text += "far:\n\tc.jr ra\n";
+    object = assembleObject(assemble(text));
+    assert(object.text.size() == 4 + 2 + 200 * 2 + 2);
+    assert((wordAt(object.text, 0) & 0x7f) == 0x63);
+    assert(halfAt(object.text, 4) == 0xa009);  // c.j +2
+
+    std::ostringstream out;
+    writeElf(out, object);
+    assert(readElf(out.str()).rvc);
+    assert(!assembleObject(assemble("main:\n\tret\n")).rvc);
+
+    std::cout << "test_compressed passed\n";
+}
+
+void test_round_trip() {
+    // 剖析插桩带数据段与 la
+    CodeGenOptions options;
+    options.profileGenerate = true;
+    ElfObject object = assembleObject(compile(kProgram, options));
+    assert(!object.data.empty());
+    std::ostringstream out;
+    writeElf(out, object);
+    ElfObject back = readElf(out.str());
+    assert(back.text == object.text && back.data == object.data);
+    assert(back.relocs.size() == object.relocs.size());
+    for (size_t i = 0; i < back.relocs.size(); i++) {
+        assert(back.relocs[i].offset == object.relocs[i].offset && back.relocs[i].type == object.relocs[i].type);
+        assert(back.relocs[i].symbol == object.relocs[i].symbol && back.relocs[i].addend == object.relocs[i].addend);
+    }
+    assert(back.symbols.size() == object.symbols.size());
+    const ElfSymbol *counters = back.findSymbol("__toyc_prof_counters");
+    assert(counters && counters->section == ElfSymbol::Section::Data);
+    std::cout << "test_round_trip passed\n";
+}
+
+// 外部工具的比对不依赖 assert，NDEBUG 构建下同样检查
+static void expect(bool ok, const std::string &what) {
+    if (ok) return;
+    std::cerr << "test_external_assembler failed: " << what << "\n";
+    std::abort();
+}
+
+// 与外部汇编器（关闭链接器松弛）汇编同一份文本的结果比对
+void test_external_assembler() {
+#ifdef TOYC_RISCV_AS
+    std::string as = TOYC_RISCV_AS;
+    bool isLlvm = as.find("llvm-mc") != std::string::npos;
+    CodeGenOptions profiled;
+    profiled.profileGenerate = true;
+    // -mrvc：外部汇编器开启 C 扩展时会压缩一切合格的指令，结果应与 Compressor 完全一致
+    Compressor compressor;
+    CodeGenOptions compressed;
+    compressed.machinePasses = [&](const std::string &, std::vector<AsmInstr> &code, const ClobberMap *clobbers) {
+        compressor.run(code, clobbers);
+    };
+    for (auto &options : {CodeGenOptions(), profiled, compressed}) {
+        auto code = compile(kProgram, options);
+        {
+            std::ofstream asmFile("test_elf_tmp.s");
+            printAsm(asmFile, code);
+        }
+        bool rvc = (bool)options.machinePasses;
+        std::string command = isLlvm ? as + " -triple=riscv32 -mattr=+m" + (rvc ? ",+c" : "") +
+                                           ",-relax -filetype=obj -o test_elf_tmp.o test_elf_tmp.s"
+                                     : as + " -march=rv32im" + (rvc ? "c" : "") +
+                                           " -mabi=ilp32 -mno-relax -o test_elf_tmp.o test_elf_tmp.s";
+        expect(std::system(command.c_str()) == 0, command);
+        std::ifstream objFile("test_elf_tmp.o", std::ios::binary);
+        std::stringstream bytes;
+        bytes << objFile.rdbuf();
+        ElfObject expected = readElf(bytes.str());
+        ElfObject object = assembleObject(code);
+
+        expect(object.text == expected.text, ".text differs");
+        expect(object.data == expected.data, ".data differs");
+        expect(object.relocs.size() == expected.relocs.size(), "relocation count differs");
+        for (size_t i = 0; i < object.relocs.size(); i++) {
+            uint32_t type = expected.relocs[i].type == R_RISCV_CALL_PLT ? R_RISCV_CALL : expected.relocs[i].type;
+            expect(object.relocs[i].offset == expected.relocs[i].offset && object.relocs[i].type == type &&
+                       object.relocs[i].addend == expected.relocs[i].addend,
+                   "relocation " + std::to_string(i) + " differs");
+        }
+        for (auto &sym : object.symbols) {
+            if (!sym.global) continue;
+            const ElfSymbol *other = expected.findSymbol(sym.name);
+            expect(other && other->global && other->section == sym.section && other->value == sym.value,
+                   "symbol " + sym.name + " differs");
+        }
+    }
+    std::remove("test_elf_tmp.s");
+    std::remove("test_elf_tmp.o");
+    std::cout << "test_external_assembler passed (" << as << ")\n";
+#else
+    std::cout << "test_external_assembler skipped: no RISC-V assembler found\n";
+#endif
+}
+
+int main() {
+    test_encoding();
+    test_long_branch();
+    test_compressed();
+    test_round_trip();
+    test_external_assembler();
+    std::cout << "All ELF tests done.\n";
+    return 0;
+}
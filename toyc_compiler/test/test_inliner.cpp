@@ -0,0 +1,141 @@
+// test_inliner.cpp
+#include "lexer.h"
+#include "parser.h"
+#include "inliner.h"
+#include "callgraph.h"
+#include "codegen.h"
+#include "interpreter.h"
+
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+static std::vector<std::unique_ptr<FuncDef>> parseSource(const std::string &source) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    return parser.parseCompUnit();
+}
+
+static std::string generateCode(std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    std::ostringstream oss;
+    CodeGen codegen(oss);
+    codegen.generate(funcs);
+    return oss.str();
+}
+
+void test_inline_expression_body() {
+    auto funcs = parseSource(R"(
+        int sq(int x) { return x * x; }
+        int main() {
+            int s = 0;
+            int i = 0;
+            while (i < 10) { s = s + sq(i); i = i + 1; }
+            return s;
+        }
+    )");
+
+    std::ostringstream remarks;
+    InlineOptions opts;
+    opts.remarks = true;
+    Inliner inliner(opts, remarks);
+    assert(inliner.run(funcs) == 1);
+    assert(remarks.str().find("inlined 'sq' into 'main'") != std::string::npos);
+
+    std::string code = generateCode(funcs);
+    std::string mainCode = code.substr(code.find(".globl main"));
+    assert(mainCode.find("call sq") == std::string::npos);
+
+    std::cout << "test_inline_expression_body passed\n";
+}
+
+void test_inline_statement_renames_locals() {
+    auto funcs = parseSource(R"(
+        int add3(int a, int b, int c) { int s = a + b; s = s + c; return s; }
+        int main() {
+            int s = 1;
+            int a = add3(s, s, 2);
+            return a + s;
+        }
+    )");
+
+    InlineOptions opts;
+    Inliner inliner(opts);
+    assert(inliner.run(funcs) == 1);
+
+    std::string code = generateCode(funcs);
+    std::string mainCode = code.substr(code.find(".globl main"));
+    assert(mainCode.find("call add3") == std::string::npos);
+    // 被内联的 s 不能覆盖调用者的 s：add3(1, 1, 2) + 1，覆盖时会得到 4 + 4
+    assert(AstInterpreter(funcs).run() == 5);
+
+    std::cout << "test_inline_statement_renames_locals passed\n";
+}
+
+void test_recursion_not_inlined() {
+    auto funcs = parseSource(R"(
+        int fib(int n) { if (n <= 1) return n; return fib(n - 1) + fib(n - 2); }
+        int main() { return fib(10); }
+    )");
+
+    std::ostringstream remarks;
+    InlineOptions opts;
+    opts.remarks = true;
+    Inliner inliner(opts, remarks);
+    assert(inliner.run(funcs) == 0);
+    assert(remarks.str().find("'fib' not inlined into 'main': callee is recursive") != std::string::npos);
+
+    std::cout << "test_recursion_not_inlined passed\n";
+}
+
+void test_cost_threshold() {
+    auto funcs = parseSource(R"(
+        int sq(int x) { return x * x; }
+        int main() { return sq(3); }
+    )");
+
+    InlineOptions opts;
+    opts.threshold = -100;
+    Inliner inliner(opts);
+    assert(inliner.run(funcs) == 0);
+
+    std::cout << "test_cost_threshold passed\n";
+}
+
+void test_dead_functions() {
+    auto funcs = parseSource(R"(
+        int unused(int x) { return helper(x) + 1; }
+        int helper(int x) { return x * 2; }
+        int even(int n) { if (n == 0) return 1; return odd(n - 1); }
+        int odd(int n) { if (n == 0) return 0; return even(n - 1); }
+        int main() { return even(4) + even(3); }
+    )");
+    CallGraph graph(funcs);
+    std::vector<bool> live = graph.reachableFrom(graph.indexOf("main"));
+    assert(!live[0] && !live[1] && live[2] && live[3] && live[4]);
+
+    std::ostringstream dump;
+    printCallGraph(dump, graph);
+    assert(dump.str().find("unused [dead] -> helper") != std::string::npos);
+    assert(dump.str().find("main -> even x2") != std::string::npos);
+
+    assert(eliminateDeadFunctions(funcs) == 2);
+    assert(funcs.size() == 3 && funcs[0]->name == "even" && funcs[2]->name == "main");
+    std::string code = generateCode(funcs);
+    assert(code.find("helper") == std::string::npos);
+
+    // 没有 main 的函数库全部保留
+    auto library = parseSource("int a() { return 1; } int b() { return a(); }");
+    assert(eliminateDeadFunctions(library) == 0 && library.size() == 2);
+    std::cout << "test_dead_functions passed\n";
+}
+
+int main() {
+    test_inline_expression_body();
+    test_inline_statement_renames_locals();
+    test_recursion_not_inlined();
+    test_cost_threshold();
+    test_dead_functions();
+    std::cout << "All inliner tests done.\n";
+    return 0;
+}
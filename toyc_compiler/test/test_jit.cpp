@@ -0,0 +1,106 @@
+// test_jit.cpp
+#include "lexer.h"
+#include "parser.h"
+#include "codegen.h"
+#include "simulator.h"
+#include "jit.h"
+
+#include <climits>
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <stdexcept>
+
+static std::vector<std::unique_ptr<FuncDef>> parse(const std::string &source) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    return parser.parseCompUnit();
+}
+
+// 同一程序在模拟器中的结果作为参照
+static int32_t simulate(const std::string &source) {
+    auto funcs = parse(source);
+    std::ostringstream oss;
+    CodeGen codegen(oss);
+    Simulator sim(codegen.lower(funcs));
+    return sim.run();
+}
+
+static void expectSame(const std::string &source) {
+    auto funcs = parse(source);
+    Jit jit(funcs);
+    assert(jit.run() == simulate(source));
+}
+
+void test_programs() {
+    expectSame(R"(
+        int fib(int n) { if (n <= 1) return n; return fib(n - 1) + fib(n - 2); }
+        int gcd(int a, int b) { while (b != 0) { int t = a % b; a = b; b = t; } return a; }
+        int main() { return fib(15) + gcd(1071, 462); }
+    )");
+    expectSame(R"(
+        int f(int a, int b, int c, int d, int e, int f, int g, int h, int i) {
+            return a - b * c + d / e - f % g + (h > i) * 100 + (h <= i || a == 0) - !(b != c);
+        }
+        int main() {
+            int s = 0;
+            int i = 0;
+            while (i < 40) {
+                i = i + 1;
+                if (i % 3 == 0 && i % 5 != 0) continue;
+                if (i > 35) break;
+                { int i = 7; s = s + i; }
+                s = s + f(i, 2, 3, 100, i, 17, 5, i, 20);
+            }
+            return s;
+        }
+    )");
+    // 除以 0、INT_MIN / -1 按 RV32IM 语义，不触发主机异常
+    expectSame(R"(
+        int div(int a, int b) { return a / b; }
+        int rem(int a, int b) { return a % b; }
+        int main() {
+            int m = -2147483647 - 1;
+            return div(7, 0) + rem(7, 0) + div(m, -1) + rem(m, -1) + m / -1 + m % -1 + 5 / 0 + 5 % 0 + 9 / -1;
+        }
+    )");
+    std::cout << "test_programs passed\n";
+}
+
+void test_lazy_compile() {
+    auto funcs = parse(R"(
+        int add3(int a, int b, int c) { return a + b + c; }
+        int broken() { return missing + 1; }
+        int unused() { return 1; }
+        int main() { return add3(1, 2, 3); }
+    )");
+    Jit jit(funcs);
+    assert(jit.stats().functions == 4 && jit.stats().compiled == 0);
+    assert(jit.run() == 6);
+    assert(jit.stats().compiled == 2);
+    assert(jit.run("add3", {10, 20, INT_MAX}) == (int32_t)(30u + INT_MAX));
+
+    // 编译错误在第一次调用时报告，且不影响之后的执行
+    bool threw = false;
+    try {
+        jit.run("broken");
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    assert(jit.run() == 6);
+    assert(jit.stats().compiled == 2);
+    std::cout << "test_lazy_compile passed\n";
+}
+
+int main() {
+#if defined(__x86_64__) && defined(__unix__)
+    test_programs();
+    test_lazy_compile();
+    std::cout << "All JIT tests done.\n";
+#else
+    std::cout << "JIT tests skipped: not an x86-64 host\n";
+#endif
+    return 0;
+}
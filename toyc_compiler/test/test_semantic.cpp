@@ -1,10 +1,14 @@
 // test_semantic.cpp
 #include "../include/semantic.h"
 #include "../include/ast.h"
+#include "../include/lexer.h"
+#include "../include/parser.h"
+#include "../include/pipeline.h"
 
 #include <iostream>
 #include <memory>
 #include <cassert>
+#include <stdexcept>
 
 void test_simple_function() {
     auto func = std::make_unique<FuncDef>("int", "main");
@@ -72,10 +76,126 @@ void test_duplicate_variable() {
     std::cout << "test_duplicate_variable passed (should print an error above)\n";
 }
 
+// 流式分析：逐个函数解析、分析后即释放，前向调用在 finish 时检查
+static int analyzeStreaming(const std::string &source) {
+    Lexer lexer(source);
+    Parser parser([&] { return lexer.next(); });
+    SemanticAnalyzer analyzer;
+    int functions = 0;
+    while (auto func = parser.parseNextFunc()) {
+        analyzer.analyzeFunction(func.get());
+        functions++;
+    }
+    assert(functions > 0);
+    analyzer.finish();
+    return analyzer.errorCount();
+}
+
+void test_forward_calls() {
+    assert(analyzeStreaming(R"(
+        int main() { helper(1, 2); return twice(3); }
+        void helper(int a, int b) { return; }
+        int twice(int x) { if (x > 0) { while (1) { break; } } return x + x; }
+    )") == 0);
+
+    // 被调用者在调用之后才出现：finish 之前不报错，finish 时只报告从未定义的函数
+    Lexer lexer("int main() { return f(1) + g() + h(); } int f(int a) { return a; } int g() { return 0; }");
+    Parser parser([&] { return lexer.next(); });
+    SemanticAnalyzer analyzer;
+    while (auto func = parser.parseNextFunc()) analyzer.analyzeFunction(func.get());
+    assert(analyzer.errorCount() == 0);
+    analyzer.finish();
+    assert(analyzer.errorCount() == 1);
+    std::cout << "test_forward_calls passed (should print an error above)\n";
+}
+
+void test_call_arity() {
+    // 已知签名的调用立即检查，前向调用在 finish 时检查
+    assert(analyzeStreaming("int f(int a) { return a; } int main() { return f(); }") == 1);
+    assert(analyzeStreaming("int main() { return f(1, 2); } int f(int a) { return a; }") == 1);
+    assert(analyzeStreaming("int f(int a, int b) { return a + b; } int main() { return f(1, 2); }") == 0);
+    std::cout << "test_call_arity passed (should print errors above)\n";
+}
+
+void test_void_as_value() {
+    assert(analyzeStreaming("void g() { return; } int main() { return g() + 1; }") == 1);
+    assert(analyzeStreaming("int main() { int x = g(); return x; } void g() { return; }") == 1);
+    // 语句级调用丢弃返回值，可以调用 void 函数
+    assert(analyzeStreaming("void g() { return; } int main() { g(); return 0; }") == 0);
+    std::cout << "test_void_as_value passed (should print errors above)\n";
+}
+
+void test_loop_control_outside_loop() {
+    assert(analyzeStreaming("int main() { break; return 0; }") == 1);
+    assert(analyzeStreaming("int main() { if (1) { continue; } return 0; }") == 1);
+    assert(analyzeStreaming("int main() { while (1) { if (1) { break; } continue; } return 0; }") == 0);
+    // 循环深度按函数计，不会带到下一个函数
+    assert(analyzeStreaming("int f() { while (1) { break; } return 0; } int main() { break; return 0; }") == 1);
+    std::cout << "test_loop_control_outside_loop passed (should print errors above)\n";
+}
+
+void test_function_redefined() {
+    assert(analyzeStreaming("int f() { return 1; } int f() { return 2; } int main() { return f(); }") == 1);
+    std::cout << "test_function_redefined passed (should print an error above)\n";
+}
+
+void test_pipelined_front_end() {
+    SpscRing<int> ring(3);
+    assert(ring.capacity() == 4);
+    int value = 0;
+    assert(!ring.tryPop(value));
+    for (int i = 1; i <= 4; i++) assert(ring.tryPush(i));
+    int extra = 5;
+    assert(!ring.tryPush(extra) && extra == 5);
+    assert(ring.tryPop(value) && value == 1);
+
+    // 很小的批与环让三个线程频繁互相等待，函数仍按源码顺序到达
+    std::string source;
+    for (int i = 0; i < 200; i++) {
+        source += "int f" + std::to_string(i) + "(int x) { while (x > 0) { x = x - 1; } return f" +
+                  std::to_string(i + 1) + "(x); }\n";
+    }
+    source += "int f200(int x) { return x; }\n";
+    PipelineOptions options;
+    options.tokenBatch = 7;
+    options.tokenBatches = 2;
+    options.functions = 1;
+    PipelinedFrontEnd frontEnd(source, options);
+    SemanticAnalyzer analyzer;
+    int count = 0;
+    while (auto func = frontEnd.next()) {
+        assert(func->name == "f" + std::to_string(count));
+        analyzer.analyzeFunction(func.get());
+        count++;
+    }
+    analyzer.finish();
+    assert(count == 201 && analyzer.errorCount() == 0);
+    assert(frontEnd.next() == nullptr && frontEnd.stats().functions == 201);
+
+    // 语法错误在调用者线程重新抛出；提前销毁时取消仍在等待的线程
+    std::string broken = "int ok() { return 1; } int bad( { }" + source;
+    bool threw = false;
+    try {
+        PipelinedFrontEnd failing(broken, options);
+        while (failing.next()) {}
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    { PipelinedFrontEnd abandoned(source, options); abandoned.next(); }
+    std::cout << "test_pipelined_front_end passed\n";
+}
+
 int main() {
     test_simple_function();
     test_undeclared_variable();
     test_duplicate_variable();
+    test_forward_calls();
+    test_call_arity();
+    test_void_as_value();
+    test_loop_control_outside_loop();
+    test_function_redefined();
+    test_pipelined_front_end();
     std::cout << "All semantic tests done.\n";
     return 0;
 }
@@ -0,0 +1,144 @@
+// test_simulator.cpp
+#include "lexer.h"
+#include "parser.h"
+#include "codegen.h"
+#include "simulator.h"
+
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <stdexcept>
+
+static std::vector<AsmInstr> assemble(const std::string &text) {
+    std::istringstream in(text);
+    return parseAsm(in);
+}
+
+static std::vector<AsmInstr> compile(const std::string &source) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto funcs = parser.parseCompUnit();
+    std::ostringstream oss;
+    CodeGen codegen(oss);
+    codegen.generate(funcs);
+    return assemble(oss.str());
+}
+
+void test_parse_asm() {
+    auto code = assemble(".globl main\nmain: li a0, 1 # comment\n\t.asciz \"a, #b\"\n");
+    assert(code.size() == 4);
+    assert(code[1].isLabel() && code[1].op == "main");
+    assert(code[2].op == "li" && code[2].args.size() == 2 && code[2].args[1] == "1");
+    assert(code[3].op == ".asciz" && code[3].args.size() == 1 && code[3].args[0] == "\"a, #b\"");
+    std::cout << "test_parse_asm passed\n";
+}
+
+void test_counters() {
+    // 1 + 2 + ... + 10，每轮 add/addi/blt 三条
+    auto code = assemble(R"(
+main:
+	li a0, 0
+	li t0, 1
+	li t1, 11
+loop:
+	add a0, a0, t0
+	addi t0, t0, 1
+	blt t0, t1, loop
+	ret
+)");
+    SimOptions options;
+    options.model = {"test", 1, 2, 3, 20, 2};
+    Simulator sim(code, options);
+    assert(sim.run() == 55);
+    const SimStats &stats = sim.stats();
+    assert(stats.instructions == 3 + 30 + 1);
+    assert(stats.branches == 10 && stats.takenBranches == 9);
+    assert(stats.jumps == 1 && stats.calls == 0);
+    // 每条一个周期，9 次分支跳转与 ret 各加 2
+    assert(stats.cycles == 34 + 10 * 2);
+    std::cout << "test_counters passed\n";
+}
+
+void test_load_use_stall() {
+    auto code = assemble(R"(
+main:
+	addi sp, sp, -16
+	li t0, 7
+	sw t0, 0(sp)
+	lw a0, 0(sp)
+	addi a0, a0, 1
+	addi sp, sp, 16
+	ret
+)");
+    SimOptions options;
+    options.model = {"test", 1, 3, 3, 20, 0};
+    Simulator sim(code, options);
+    assert(sim.run() == 8);
+    assert(sim.stats().loads == 1 && sim.stats().stores == 1);
+    // lw 的结果 3 个周期后才可用，紧随的 addi 停顿 2 个周期
+    assert(sim.stats().cycles == 7 + 2);
+    std::cout << "test_load_use_stall passed\n";
+}
+
+void test_compiled_program() {
+    auto code = compile(R"(
+        int fib(int n) { if (n <= 1) return n; return fib(n - 1) + fib(n - 2); }
+        int gcd(int a, int b) { while (b != 0) { int t = a % b; a = b; b = t; } return a; }
+        int main() { return fib(15) + gcd(1071, 462); }
+    )");
+    Simulator sim(code);
+    assert(sim.run() == 610 + 21);
+    assert(sim.stats().calls > 1000);
+    assert(sim.stats().cycles > sim.stats().instructions);
+
+    Simulator entry(code, [] { SimOptions o; o.entry = "gcd"; return o; }());
+    assert(entry.run({48, 18}) == 6);
+
+    // tail 经 t1 跳转，被跳过的 t1 不再保持原值
+    Simulator tail(assemble("main:\n\tli t1, 7\n\ttail callee\ncallee:\n\tmv a0, t1\n\tret\n"));
+    assert(tail.run() != 7);
+    assert(tail.stats().jumps == 2 && tail.stats().calls == 0);
+    std::cout << "test_compiled_program passed\n";
+}
+
+void test_errors() {
+    bool threw = false;
+    try {
+        Simulator sim(assemble("main:\n\tlw a0, 0(zero)\n\tret\n"));
+        sim.run();
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    threw = false;
+    try {
+        Simulator sim(assemble("main:\n\tj nowhere\n"));
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    threw = false;
+    try {
+        SimOptions options;
+        options.maxSteps = 1000;
+        Simulator sim(assemble("main:\n\tj main\n"), options);
+        sim.run();
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "test_errors passed\n";
+}
+
+int main() {
+    test_parse_asm();
+    test_counters();
+    test_load_use_stall();
+    test_compiled_program();
+    test_errors();
+    std::cout << "All simulator tests done.\n";
+    return 0;
+}
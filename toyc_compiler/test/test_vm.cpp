@@ -0,0 +1,140 @@
+// test_vm.cpp
+#include "lexer.h"
+#include "parser.h"
+#include "codegen.h"
+#include "simulator.h"
+#include "bytecode.h"
+#include "interpreter.h"
+
+#include <climits>
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <stdexcept>
+
+static std::vector<std::unique_ptr<FuncDef>> parse(const std::string &source) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    return parser.parseCompUnit();
+}
+
+// 字节码虚拟机、AST 解释器与模拟器三者的结果一致
+static int32_t expectSame(const std::string &source) {
+    auto funcs = parse(source);
+    BcModule module = compileBytecode(funcs);
+    Vm vm(module);
+    int32_t result = vm.run();
+    AstInterpreter interpreter(funcs);
+    assert(interpreter.run() == result);
+    std::ostringstream oss;
+    CodeGen codegen(oss);
+    Simulator sim(codegen.lower(funcs));
+    assert(sim.run() == result);
+    return result;
+}
+
+void test_programs() {
+    assert(expectSame(R"(
+        int fib(int n) { if (n <= 1) return n; return fib(n - 1) + fib(n - 2); }
+        int main() { return fib(18); }
+    )") == 2584);
+    expectSame(R"(
+        int f(int a, int b, int c, int d, int e, int f, int g, int h, int i) {
+            return a - b * c + d / e - f % g + (h > i) * 100 + (h <= i || a == 0) - !(b != c) + (3 - a) * (7 / e);
+        }
+        int main() {
+            int s = 0;
+            int i = 0;
+            while (i < 40) {
+                i = i + 1;
+                if (i % 3 == 0 && i % 5 != 0) continue;
+                if (i > 35 || !(i != 33)) break;
+                { int i = 7; s = s + i; }
+                int x = i;
+                { int x = x * 2 + 1; s = s + x; }
+                x = (x + 1) * (x + 2);
+                s = s + f(i, 2, 3, 100, i, 17, 5, i, 20) + x;
+            }
+            return s;
+        }
+    )");
+    expectSame(R"(
+        int div(int a, int b) { return a / b; }
+        int rem(int a, int b) { return a % b; }
+        int main() {
+            int m = -2147483647 - 1;
+            return div(7, 0) + rem(7, 0) + div(m, -1) + rem(m, -1) + m / -1 + m % -1 + 5 / 0 + 5 % 0 + (m - 1 > 0);
+        }
+    )");
+    std::cout << "test_programs passed\n";
+}
+
+void test_bytecode_shape() {
+    auto funcs = parse(R"(
+        int add3(int a, int b, int c) { return a + b + c; }
+        int main() {
+            int i = 0;
+            while (i < 10) { i = i + 1; }
+            return add3(i, 2, 3);
+        }
+    )");
+    BcModule module = compileBytecode(funcs);
+    assert(sizeof(BcInstr) == 12);
+    const BcFunction &main = module.functions[module.index.at("main")];
+
+    // i = i + 1 直接写回变量的寄存器，常量内联；循环条件是一条比较跳转
+    bool sawAddK = false, sawJump = false, sawCall = false;
+    for (auto &in : main.code) {
+        if (in.op == BcOp::AddK && in.a == in.b && in.c == 1) sawAddK = true;
+        if (in.op == BcOp::JLtK && in.b == 10) sawJump = true;
+        if (in.op == BcOp::Call) {
+            // 实参位于连续寄存器，被调用者的帧从那里开始
+            assert(in.b == module.index.at("add3") && in.c + 3 <= main.registers);
+            sawCall = true;
+        }
+    }
+    assert(sawAddK && sawJump && sawCall);
+    // a + b 借用返回值的临时寄存器，整个函数只需参数外的一个寄存器
+    assert(module.functions[module.index.at("add3")].registers == 4);
+
+    Vm vm(module);
+    assert(vm.run() == 15);
+    assert(vm.run("add3", {INT_MAX, 1, 0}) == INT_MIN);
+    assert(vm.stats().calls == 1);
+    std::cout << "test_bytecode_shape passed\n";
+}
+
+void test_errors() {
+    bool threw = false;
+    try {
+        compileBytecode(parse("int main() { return missing; }"));
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    // 递归超出帧栈时报错而不是越界
+    auto funcs = parse("int down(int n) { return down(n + 1); } int main() { return down(0); }");
+    BcModule module = compileBytecode(funcs);
+    VmOptions options;
+    options.maxFrames = 100;
+    Vm vm(module, options);
+    threw = false;
+    try {
+        vm.run();
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    assert(vm.stats().maxDepth == 99);
+    std::cout << "test_errors passed\n";
+}
+
+int main() {
+    test_programs();
+    test_bytecode_shape();
+    test_errors();
+    std::cout << "All VM tests done.\n";
+    return 0;
+}